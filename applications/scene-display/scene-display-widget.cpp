@@ -774,6 +774,14 @@ static void handleAssetController(
 			}
 		}
 
+		auto lodNode = animationNode->getFirstChild("lod");
+		if (lodNode.get()) {
+			LoadingContext ctx(&sceneParser, {});
+			auto lod = AnimationLOD::load(ctx, *lodNode.get());
+			lod->setTransform(tf->get(), instanceIndex);
+			nodeAnimations[instanceIndex]->setLevelOfDetail(lod);
+		}
+
 		animalController->startAnimation();
 	} else {
 		REGEN_WARN("Unhandled controller type in '" << animationNode->getDescription() << "'.");
@@ -963,6 +971,10 @@ void SceneDisplayWidget::loadSceneGraphicsThread(const string &sceneFile) {
 		auto time_d = configurationNode->getValue<double>("timestamp", 0.0);
 		app_->setWorldTime(static_cast<time_t>(time_d));
 	}
+	// advance synchronized animations in ticks of fixed length, e.g. tick-rate="30"
+	AnimationManager::get().setFixedTimestep(
+			configurationNode->getValue<double>("tick-rate", 0.0),
+			configurationNode->getValue<unsigned int>("max-catch-up-ticks", 5u));
 
 	/////////////////////////////
 	//////// Scene Parsing
@@ -10,6 +10,8 @@ AnimationController::AnimationController(
 		animation_(animalAnimation),
 		animationRanges_(ranges),
 		tf_(tf) {
+	// the controller activates animation ranges of the node animation
+	addWriteDependency(animation_.get());
 }
 
 void AnimationController::setTarget(
@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <boost/algorithm/string.hpp>
+
+#include "animation-lod.h"
+#include <regen/camera/camera.h>
+#include <regen/shapes/spatial-index.h>
+
+using namespace regen;
+
+std::atomic<unsigned int> AnimationLOD::numInstances_ = 0u;
+
+AnimationLOD::AnimationLOD() {
+	// stagger the steps of different animations such that not all
+	// distant animations are evaluated in the same frame.
+	stepCounter_ = numInstances_.fetch_add(1u);
+}
+
+AnimationLOD::~AnimationLOD() = default;
+
+void AnimationLOD::setTransform(const ref_ptr<ShaderInputMat4> &transform, unsigned int instance) {
+	transform_ = transform;
+	instance_ = instance;
+}
+
+void AnimationLOD::setVisibility(const ref_ptr<SpatialIndex> &index,
+								 const ref_ptr<Camera> &camera,
+								 std::string_view shapeName) {
+	spatialIndex_ = index;
+	camera_ = camera;
+	shapeName_ = shapeName;
+}
+
+void AnimationLOD::addLevel(float distance, unsigned int interval) {
+	Level level{distance, std::max(interval, 1u)};
+	auto it = std::upper_bound(levels_.begin(), levels_.end(), level,
+							   [](const Level &a, const Level &b) { return a.distance < b.distance; });
+	levels_.insert(it, level);
+}
+
+bool AnimationLOD::isVisible() const {
+	if (spatialIndex_.get() == nullptr || camera_.get() == nullptr) {
+		return true;
+	}
+	return spatialIndex_->isVisible(*camera_.get(), shapeName_);
+}
+
+unsigned int AnimationLOD::distanceInterval() const {
+	if (levels_.empty() || cameraPosition_.get() == nullptr || transform_.get() == nullptr) {
+		return 1u;
+	}
+	auto objectPosition = transform_->getVertexClamped(instance_).r.position();
+	auto cameraPosition = cameraPosition_->getVertex(0).r;
+	auto distance = (objectPosition - cameraPosition).length();
+	unsigned int interval = 1u;
+	for (auto &level: levels_) {
+		if (distance < level.distance) break;
+		interval = level.interval;
+	}
+	return interval;
+}
+
+bool AnimationLOD::nextStep() {
+	stepCounter_ += 1u;
+	unsigned int interval;
+	if (isVisible()) {
+		interval = distanceInterval();
+		if (!wasVisible_) {
+			// evaluate immediately when the object becomes visible again,
+			// else it would be shown in a stale pose.
+			wasVisible_ = true;
+			currentInterval_ = interval;
+			stepCounter_ = 0u;
+			return true;
+		}
+	} else {
+		wasVisible_ = false;
+		interval = offscreenInterval_;
+	}
+	currentInterval_ = interval;
+	if (interval == 0u) {
+		return false;
+	}
+	return (stepCounter_ % interval) == 0u;
+}
+
+ref_ptr<AnimationLOD> AnimationLOD::load(LoadingContext &ctx, scene::SceneInputNode &input) {
+	auto scene = ctx.scene();
+	auto lod = ref_ptr<AnimationLOD>::alloc();
+
+	if (input.hasAttribute("camera")) {
+		auto camera = scene->getResource<Camera>(input.getValue("camera"));
+		if (camera.get() == nullptr) {
+			REGEN_WARN("Unable to find camera for '" << input.getDescription() << "'.");
+		} else {
+			lod->setCameraPosition(camera->position());
+			if (input.hasAttribute("culling-index")) {
+				auto index = scene->getResource<SpatialIndex>(input.getValue("culling-index"));
+				if (index.get() == nullptr) {
+					REGEN_WARN("Unable to find spatial index for '" << input.getDescription() << "'.");
+				} else {
+					lod->setVisibility(index, camera, input.getValue<std::string>("shape", ""));
+				}
+			}
+		}
+	}
+
+	if (input.hasAttribute("distances")) {
+		std::vector<std::string> distances, intervals;
+		boost::split(distances, input.getValue("distances"), boost::is_any_of(","));
+		boost::split(intervals, input.getValue<std::string>("intervals", ""), boost::is_any_of(","));
+		for (unsigned int i = 0; i < distances.size(); ++i) {
+			// by default, double the interval with each level
+			unsigned int interval = 2u << i;
+			if (i < intervals.size() && !intervals[i].empty()) {
+				interval = std::stoi(intervals[i]);
+			}
+			lod->addLevel(std::stof(distances[i]), interval);
+		}
+	}
+	lod->setOffscreenInterval(input.getValue<unsigned int>("offscreen-interval", 0u));
+
+	return lod;
+}
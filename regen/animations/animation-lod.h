@@ -0,0 +1,121 @@
+#ifndef REGEN_ANIMATION_LOD_H_
+#define REGEN_ANIMATION_LOD_H_
+
+#include <vector>
+#include <string>
+#include <atomic>
+
+#include <regen/gl-types/shader-input.h>
+#include <regen/scene/loading-context.h>
+
+namespace regen {
+	class Camera;
+	class SpatialIndex;
+
+	/**
+	 * \brief Reduces the update rate of an animation with the distance to a camera.
+	 * The animation asks each step whether it should be evaluated, it must keep
+	 * accumulating the time of skipped steps such that playback stays correct.
+	 * Animations that are not visible in the camera are evaluated at a separate
+	 * rate, or not at all.
+	 */
+	class AnimationLOD {
+	public:
+		/**
+		 * \brief The update interval beyond a distance.
+		 */
+		struct Level {
+			/** the minimum distance to the camera. */
+			float distance;
+			/** evaluate the animation every n-th step. */
+			unsigned int interval;
+		};
+
+		AnimationLOD();
+
+		virtual ~AnimationLOD();
+
+		AnimationLOD(const AnimationLOD &) = delete;
+
+		/**
+		 * Load the LOD configuration from scene input, e.g.:
+		 * <lod camera="main-camera" distances="20,50" intervals="2,4" offscreen-interval="0"
+		 *      culling-index="index" shape="character"/>
+		 * @param ctx the loading context.
+		 * @param input the scene input node.
+		 * @return the LOD configuration.
+		 */
+		static ref_ptr<AnimationLOD> load(LoadingContext &ctx, scene::SceneInputNode &input);
+
+		/**
+		 * @param cameraPosition the position of the camera, distances are measured to this position.
+		 */
+		void setCameraPosition(const ref_ptr<ShaderInput3f> &cameraPosition) { cameraPosition_ = cameraPosition; }
+
+		/**
+		 * @param transform the model transformation of the animated object.
+		 * @param instance the instance of the transformation.
+		 */
+		void setTransform(const ref_ptr<ShaderInputMat4> &transform, unsigned int instance = 0u);
+
+		/**
+		 * Use the visibility computed by a spatial index.
+		 * @param index the spatial index.
+		 * @param camera a camera of the index.
+		 * @param shapeName the name of the shape of the animated object.
+		 */
+		void setVisibility(const ref_ptr<SpatialIndex> &index,
+						   const ref_ptr<Camera> &camera,
+						   std::string_view shapeName);
+
+		/**
+		 * Add a level, the animation is evaluated every n-th step beyond the distance.
+		 * @param distance the minimum distance to the camera.
+		 * @param interval the update interval in steps.
+		 */
+		void addLevel(float distance, unsigned int interval);
+
+		/**
+		 * @return the levels sorted by distance.
+		 */
+		auto &levels() const { return levels_; }
+
+		/**
+		 * @param interval the update interval in steps while the animated object is not visible,
+		 * 0 to not evaluate the animation while it is not visible.
+		 */
+		void setOffscreenInterval(unsigned int interval) { offscreenInterval_ = interval; }
+
+		/**
+		 * @return the update interval of the last step, 0 if the animation is not evaluated.
+		 */
+		unsigned int currentInterval() const { return currentInterval_; }
+
+		/**
+		 * Advance by one step.
+		 * @return true if the animation should be evaluated in this step.
+		 */
+		bool nextStep();
+
+	protected:
+		std::vector<Level> levels_;
+		unsigned int offscreenInterval_ = 0u;
+		ref_ptr<ShaderInput3f> cameraPosition_;
+		ref_ptr<ShaderInputMat4> transform_;
+		unsigned int instance_ = 0u;
+		ref_ptr<SpatialIndex> spatialIndex_;
+		ref_ptr<Camera> camera_;
+		std::string shapeName_;
+
+		unsigned int stepCounter_;
+		unsigned int currentInterval_ = 1u;
+		bool wasVisible_ = true;
+		static std::atomic<unsigned int> numInstances_;
+
+		virtual bool isVisible() const;
+
+		unsigned int distanceInterval() const;
+	};
+} // namespace
+
+#endif /* REGEN_ANIMATION_LOD_H_ */
@@ -6,6 +6,9 @@
  */
 
 #include <map>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 
 #include <regen/utility/threading.h>
 #include <regen/utility/logging.h>
@@ -17,9 +20,15 @@ using namespace regen;
 #define IDLE_SLEEP 100000
 // Synchronize animation and render thread.
 #define SYNCHRONIZE_THREADS
-// Use a spinlock instead of a condition variables
-#define USE_SYNCHRONIZE_SPINLOCK
-#define SYNCHRONIZE_SPINLOCK_SLEEP 10
+// Number of threads that animate unsynchronized animations.
+#define NUM_UNSYNCHRONIZED_WORKERS 2
+
+// true for threads that currently animate synchronized animations
+static thread_local bool isAnimationTask_ = false;
+
+static double elapsedMilliseconds(const std::chrono::steady_clock::time_point &t0) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
 
 AnimationManager &AnimationManager::get() {
 	static AnimationManager manager;
@@ -29,12 +38,11 @@ AnimationManager &AnimationManager::get() {
 AnimationManager::AnimationManager()
 		: animInProgress_(false),
 		  glInProgress_(false),
-		  removeInProgress_(false),
-		  addInProgress_(false),
-		  animChangedDuringLoop_(false),
-		  glChangedDuringLoop_(false),
 		  closeFlag_(false),
-		  pauseFlag_(true) {
+		  pauseFlag_(true),
+		  unsynchronizedScheduler_(NUM_UNSYNCHRONIZED_WORKERS),
+		  jobSystem_(&JobSystem::get()) {
+	unsynchronizedScheduler_.setPaused(true);
 	resetTime();
 	thread_ = boost::thread(&AnimationManager::run, this);
 }
@@ -80,294 +88,381 @@ void AnimationManager::setSpatialIndices(const std::map<std::string, ref_ptr<Spa
 	spatialIndices_ = indices;
 }
 
-void AnimationManager::addAnimation(Animation *animation) {
-	// Don't add while removing
-	while (removeInProgress_) usleepRegen(1000);
+bool AnimationManager::isAnimationStepThread() const {
+	return animInProgress_.load(std::memory_order_acquire) &&
+		   (isAnimationTask_ || std::this_thread::get_id() == animationThreadID_.load(std::memory_order_relaxed));
+}
 
-	addThreadID_ = boost::this_thread::get_id();
-	addInProgress_ = true;
+bool AnimationManager::isGraphicsLoopThread() const {
+	return glInProgress_.load(std::memory_order_acquire) &&
+		   std::this_thread::get_id() == glThreadID_.load(std::memory_order_relaxed);
+}
 
-	if (animation->isGPUAnimation()) {
-		if (rootState_.get() != nullptr) {
-			animation->joinAnimationState(rootState_);
-		}
-		if (glInProgress_ && addThreadID_ == glThreadID_) {
-			// Called from glAnimate().
-			glChangedDuringLoop_ = true;
-			gpuAnimations_.insert(animation);
+void AnimationManager::processAnimationCommands() {
+	Command cmd{};
+	while (animCommands_.pop(cmd)) {
+		if (cmd.isAdd) {
+			synchronizedAnimations_.emplace_back(cmd.animation);
 		} else {
-			// Wait for the current loop to finish.
-			while (glInProgress_) usleepRegen(1000);
-			// save to remove from set
-			gpuAnimations_.insert(animation);
+			auto it = std::find(synchronizedAnimations_.begin(), synchronizedAnimations_.end(), cmd.animation);
+			if (it != synchronizedAnimations_.end()) {
+				synchronizedAnimations_.erase(it);
+			}
 		}
+		hasScheduleChanged_ = true;
 	}
+}
 
-	if (animation->isCPUAnimation()) {
-		if (animation->isSynchronized()) {
-			if (animInProgress_ && addThreadID_ == animationThreadID_) {
-				// Called from animate().
-				animChangedDuringLoop_ = true;
-				synchronizedAnimations_.emplace_back(animation);
-			} else {
-				// Wait for the current loop to finish.
-				while (animInProgress_) usleepRegen(1000);
-				// save to remove from set
-				synchronizedAnimations_.emplace_back(animation);
-			}
+void AnimationManager::processGraphicsCommands() {
+	Command cmd{};
+	while (glCommands_.pop(cmd)) {
+		if (cmd.isAdd) {
+			gpuAnimations_.insert(cmd.animation);
 		} else {
-			// start a new dedicated thread
-			boost::unique_lock<boost::mutex> lock(unsynchronizedMut_);
-			unsynchronizedAnimations_.emplace_back(animation);
-			unsynchronizedThreads_.emplace_back([this, animation]()
-				{ runUnsynchronized(animation); });
+			gpuAnimations_.erase(cmd.animation);
 		}
 	}
+}
 
-	addInProgress_ = false;
+void AnimationManager::ReleasedAnimations::add(Animation *animation) {
+	std::lock_guard<std::mutex> lock(mutex);
+	animations.push_back(animation);
+	hasAnimations.store(true, std::memory_order_release);
 }
 
-void AnimationManager::removeAnimation(Animation *animation) {
-	// Don't remove while adding
-	while (addInProgress_) usleepRegen(1000);
+bool AnimationManager::ReleasedAnimations::contains(Animation *animation) {
+	if (!hasAnimations.load(std::memory_order_acquire)) return false;
+	std::lock_guard<std::mutex> lock(mutex);
+	return std::find(animations.begin(), animations.end(), animation) != animations.end();
+}
 
-	removeThreadID_ = boost::this_thread::get_id();
-	removeInProgress_ = true;
+void AnimationManager::ReleasedAnimations::clear() {
+	if (!hasAnimations.load(std::memory_order_acquire)) return;
+	std::lock_guard<std::mutex> lock(mutex);
+	animations.clear();
+	hasAnimations.store(false, std::memory_order_release);
+}
 
+void AnimationManager::addAnimation(Animation *animation) {
 	if (animation->isGPUAnimation()) {
-		if (glInProgress_ && removeThreadID_ == glThreadID_) {
-			// Called from glAnimate().
-			glChangedDuringLoop_ = true;
-			gpuAnimations_.erase(animation);
-		} else {
-			// Wait for the current loop to finish.
-			while (glInProgress_) usleepRegen(1000);
-			// save to remove from set
-			gpuAnimations_.erase(animation);
+		if (rootState_.get() != nullptr) {
+			animation->joinAnimationState(rootState_);
 		}
+		// the GL thread adds the animation before its next loop
+		glCommands_.push({animation, true});
 	}
 
 	if (animation->isCPUAnimation()) {
 		if (animation->isSynchronized()) {
-			if (animInProgress_ && removeThreadID_ == animationThreadID_) {
-				// Called from animate().
-				animChangedDuringLoop_ = true;
-			} else {
-				// Wait for the current loop to finish.
-				while (animInProgress_) usleepRegen(1000);
-				// save to remove from set
-			}
-			// remove from list
-			auto it = synchronizedAnimations_.begin();
-			while (it != synchronizedAnimations_.end()) {
-				if (*it == animation) {
-					synchronizedAnimations_.erase(it);
-					break;
-				}
-				++it;
+			// the animation thread adds the animation before its next step,
+			// or when the current step has finished.
+			animCommands_.push({animation, true});
+		} else {
+			// animated by the scheduler at the desired frame rate
+			{
+				boost::unique_lock<boost::mutex> lock(unsynchronizedMut_);
+				unsynchronizedAnimations_.emplace_back(animation);
 			}
+			unsynchronizedScheduler_.add(animation);
+		}
+	}
+}
+
+void AnimationManager::removeAnimation(Animation *animation) {
+	// Note: the animation is not animated anymore once it is not running,
+	// it is removed from the lists before the next loop.
+	if (animation->isGPUAnimation()) {
+		glCommands_.push({animation, false});
+	}
+
+	if (animation->isCPUAnimation()) {
+		if (animation->isSynchronized()) {
+			animCommands_.push({animation, false});
 		}
 		else {
-			// remove from list
+			// blocks until the current step of the animation has finished
+			unsynchronizedScheduler_.remove(animation);
 			boost::unique_lock<boost::mutex> lock(unsynchronizedMut_);
-			animation->isRunning_ = false;
-			for (size_t i = 0; i < unsynchronizedAnimations_.size(); i++) {
-				if (unsynchronizedAnimations_[i] == animation) {
-					unsynchronizedThreads_[i].join();
-					unsynchronizedAnimations_.erase(unsynchronizedAnimations_.begin() + i);
-					unsynchronizedThreads_.erase(unsynchronizedThreads_.begin() + i);
-					break;
-				}
+			auto it = std::find(unsynchronizedAnimations_.begin(), unsynchronizedAnimations_.end(), animation);
+			if (it != unsynchronizedAnimations_.end()) {
+				unsynchronizedAnimations_.erase(it);
 			}
 		}
 	}
+}
+
+void AnimationManager::releaseAnimation(Animation *animation) {
+	// Note: if the animation is destroyed from within a loop, the loop skips the animation,
+	// and the pending removal is applied when the loop has finished.
+	if (animation->isCPUAnimation() && animation->isSynchronized()) {
+		if (isAnimationStepThread()) {
+			releasedInStep_.add(animation);
+		} else {
+			// wait for the current step to finish, and apply the pending removal
+			std::lock_guard<std::mutex> lock(animLoopMut_);
+			processAnimationCommands();
+		}
+	}
+	if (animation->isGPUAnimation()) {
+		if (isGraphicsLoopThread()) {
+			releasedInGLLoop_.add(animation);
+		} else {
+			std::lock_guard<std::mutex> lock(glLoopMut_);
+			processGraphicsCommands();
+		}
+	}
+}
 
-	removeInProgress_ = false;
+void AnimationManager::setSynchronizationMode(ThreadSignal::Mode mode) {
+	frameSignal_.setMode(mode);
+	stepSignal_.setMode(mode);
 }
 
 void AnimationManager::nextFrame() {
-	// set the next frame condition to true
-	// and notify waitForFrame if it is waiting.
+	// set the next frame signal and wake up waitForFrame if it is waiting.
 	// waitForStep waits only if it was faster to render
 	// a new frame then calculating the next animation step
-	hasNextFrame_.store(true, std::memory_order_relaxed);
-#ifndef USE_SYNCHRONIZE_SPINLOCK
-	frameCond_.notify_all();
-#endif
+	frameSignal_.notify();
 }
 
 void AnimationManager::nextStep() {
-	// set the next step condition to true
-	// and notify waitForStep if it is waiting.
+	// set the next step signal and wake up waitForStep if it is waiting.
 	// waitForStep waits only if it was faster to render
 	// a new frame then calculating the next animation step
-	hasNextStep_.store(true, std::memory_order_relaxed);
-#ifndef USE_SYNCHRONIZE_SPINLOCK
-	stepCond_.notify_all();
-#endif
+	stepSignal_.notify();
 }
 
 void AnimationManager::waitForFrame() {
 #ifdef SYNCHRONIZE_THREADS
-	#ifdef USE_SYNCHRONIZE_SPINLOCK
-	while (!hasNextFrame_.load(std::memory_order_acquire)) {
-		#ifdef SYNCHRONIZE_SPINLOCK_SLEEP
-		std::this_thread::sleep_for(std::chrono::microseconds(SYNCHRONIZE_SPINLOCK_SLEEP));
-		#endif
-	}
-	#else
-	// wait until a new frame is rendered.
-	{
-		boost::unique_lock<boost::mutex> lock(frameMut_);
-		while (!hasNextFrame_.load(std::memory_order_acquire)) {
-			frameCond_.wait(lock);
-		}
-	}
-	#endif // USE_SYNCHRONIZE_SPINLOCK
-	// toggle hasNextFrame_ to false
-	hasNextFrame_.store(false, std::memory_order_release);
+	// wait until a new frame is rendered, and reset the signal
+	auto t0 = std::chrono::steady_clock::now();
+	frameSignal_.wait();
+	frameWaitTime_.store(elapsedMilliseconds(t0), std::memory_order_relaxed);
 #endif
 }
 
 void AnimationManager::waitForStep() {
 #ifdef SYNCHRONIZE_THREADS
-	// wait for hasNextStep_ to be true
-	#ifdef USE_SYNCHRONIZE_SPINLOCK
-	while (!hasNextStep_.load(std::memory_order_acquire)) {
-		#ifdef SYNCHRONIZE_SPINLOCK_SLEEP
-		std::this_thread::sleep_for(std::chrono::microseconds(SYNCHRONIZE_SPINLOCK_SLEEP));
-		#endif
-	}
-	#else
-	{
-		boost::unique_lock<boost::mutex> lock(stepMut_);
-		while (!hasNextStep_.load(std::memory_order_acquire)) {
-			stepCond_.wait(lock);
-		}
-	}
-	#endif // USE_SYNCHRONIZE_SPINLOCK
-	// toggle hasNextStep_ to false
-	hasNextStep_.store(false, std::memory_order_release);
+	// wait until the next step was calculated, and reset the signal
+	auto t0 = std::chrono::steady_clock::now();
+	stepSignal_.wait();
+	stepWaitTime_.store(elapsedMilliseconds(t0), std::memory_order_relaxed);
 #endif
 }
 
 void AnimationManager::updateGraphics(RenderState *_, GLdouble dt) {
 	if (pauseFlag_) return;
-	glThreadID_ = boost::this_thread::get_id();
+	glThreadID_.store(std::this_thread::get_id(), std::memory_order_relaxed);
 
 #ifdef SYNCHRONIZE_THREADS
 	nextFrame();
 #endif
-	// wait for remove/remove to return
-	while (removeInProgress_) usleepRegen(1000);
-	while (addInProgress_) usleepRegen(1000);
-
-	// Set processing flags, so that other threads can wait
+	// Hold the loop mutex, so that other threads can wait
 	// for the completion of this loop
-	glInProgress_ = true;
-	std::set<Animation *> processed;
-	bool animationsRemaining = true;
-	while (animationsRemaining && !pauseFlag_) {
-		animationsRemaining = false;
-		for (auto it = gpuAnimations_.begin(); it != gpuAnimations_.end(); ++it) {
-			Animation *anim = *it;
-			processed.insert(anim);
-			if (anim->isRunning()) {
+	{
+		std::lock_guard<std::mutex> lock(glLoopMut_);
+		glInProgress_ = true;
+		processGraphicsCommands();
+		for (auto anim : gpuAnimations_) {
+			if (pauseFlag_) break;
+			if (anim->isRunning() && !releasedInGLLoop_.contains(anim)) {
 				auto animState = anim->animationState();
 				animState->enable(RenderState::get());
 				anim->glAnimate(RenderState::get(), dt);
 				animState->disable(RenderState::get());
-				// Animation was removed in glAnimate call.
-				// We have to restart the loop because iterator is invalid.
-				if (glChangedDuringLoop_) {
-					glChangedDuringLoop_ = false;
-					animationsRemaining = true;
-					break;
-				}
 			}
 		}
+		// apply changes made during the loop
+		processGraphicsCommands();
+		glInProgress_ = false;
+		releasedInGLLoop_.clear();
 	}
-	glInProgress_ = false;
 
 	waitForStep();
 }
 
-void AnimationManager::runUnsynchronized(Animation *animation) const {
-	// call animate until the animation is stopped
-	// try to reach a dedicated frame rate.
-	const auto goalTime = (1.0 / animation->desiredFrameRate()) * 1000.0;
-	boost::posix_time::ptime time0, time1;
-	time0 = boost::posix_time::ptime(boost::posix_time::microsec_clock::local_time());
-	time1 = time0;
-	double dt;
-	int delta_micros;
+AnimationScheduler::Statistics AnimationManager::unsynchronizedStatistics(const Animation *animation) const {
+	AnimationScheduler::Statistics stats;
+	unsynchronizedScheduler_.statistics(animation, stats);
+	return stats;
+}
 
-	while (animation->isRunning()) {
-		if (pauseFlag_) {
-			usleepRegen(IDLE_SLEEP);
-			time0 += boost::posix_time::microseconds(IDLE_SLEEP);
-			time1 += boost::posix_time::microseconds(IDLE_SLEEP);
-			continue;
+void AnimationManager::updateSchedule() {
+	parallelGroups_.clear();
+	serialAnimations_.clear();
+	// join animations with conflicting dependencies into groups (union-find)
+	std::vector<Animation *> parallel;
+	for (auto anim: synchronizedAnimations_) {
+		if (anim->isParallelizable()) {
+			parallel.push_back(anim);
+		} else {
+			serialAnimations_.push_back(anim);
+		}
+	}
+	std::vector<unsigned int> parent(parallel.size());
+	for (unsigned int i = 0; i < parent.size(); ++i) {
+		parent[i] = i;
+	}
+	auto findRoot = [&parent](unsigned int i) {
+		while (parent[i] != i) {
+			parent[i] = parent[parent[i]];
+			i = parent[i];
+		}
+		return i;
+	};
+	for (unsigned int i = 0; i < parallel.size(); ++i) {
+		for (unsigned int j = i + 1; j < parallel.size(); ++j) {
+			if (parallel[i]->hasDependencyConflict(*parallel[j])) {
+				auto a = findRoot(i), b = findRoot(j);
+				// the group is identified by its first animation, this keeps the list order
+				if (a != b) parent[std::max(a, b)] = std::min(a, b);
+			}
+		}
+	}
+	std::vector<int> groupIndex(parallel.size(), -1);
+	for (unsigned int i = 0; i < parallel.size(); ++i) {
+		auto root = findRoot(i);
+		if (groupIndex[root] < 0) {
+			groupIndex[root] = static_cast<int>(parallelGroups_.size());
+			parallelGroups_.emplace_back();
+		}
+		parallelGroups_[groupIndex[root]].push_back(parallel[i]);
+	}
+	groupTimes_.resize(parallelGroups_.size());
+}
+
+void AnimationManager::animateGroup(const std::vector<Animation *> &group, double dt) {
+	for (auto anim: group) {
+		// skip animations that were stopped or destroyed during this step
+		if (anim->isRunning() && !releasedInStep_.contains(anim)) {
+			anim->animate(dt);
+		}
+	}
+}
+
+void AnimationManager::animateSynchronized(double dt) {
+	auto stepStart = std::chrono::steady_clock::now();
+	auto stamp = Animation::dependencyStamp();
+	if (hasScheduleChanged_.exchange(false) || stamp != scheduleStamp_) {
+		scheduleStamp_ = stamp;
+		updateSchedule();
+	}
+
+	// animate groups without conflicting dependencies in parallel
+	auto animateGroupJob = [this, dt](unsigned int groupIdx) {
+		auto t0 = std::chrono::steady_clock::now();
+		auto wasAnimationTask = isAnimationTask_;
+		isAnimationTask_ = true;
+		animateGroup(parallelGroups_[groupIdx], dt);
+		isAnimationTask_ = wasAnimationTask;
+		groupTimes_[groupIdx] = elapsedMilliseconds(t0);
+	};
+	auto numGroups = static_cast<unsigned int>(parallelGroups_.size());
+	if (useThreading_ && numGroups > 1) {
+		jobSystem_->parallelFor(numGroups, 1, animateGroupJob);
+	} else {
+		for (unsigned int i = 0; i < numGroups; ++i) {
+			animateGroupJob(i);
+		}
+	}
+	double criticalPath = 0.0;
+	for (auto groupTime: groupTimes_) {
+		criticalPath = std::max(criticalPath, groupTime);
+	}
+
+	// animations without declared dependencies are animated one after another
+	auto t0 = std::chrono::steady_clock::now();
+	animateGroup(serialAnimations_, dt);
+	for (auto &index: spatialIndices_) {
+		index.second->update(dt);
+	}
+	criticalPath += elapsedMilliseconds(t0);
+
+	criticalPathTime_.store(criticalPath, std::memory_order_relaxed);
+	stepTime_.store(elapsedMilliseconds(stepStart), std::memory_order_relaxed);
+}
+
+void AnimationManager::setFixedTimestep(double tickRate, unsigned int maxCatchUpTicks) {
+	maxCatchUpTicks_.store(std::max(maxCatchUpTicks, 1u), std::memory_order_relaxed);
+	tickInterval_.store(tickRate > 0.0 ? 1000.0 / tickRate : 0.0, std::memory_order_relaxed);
+}
+
+void AnimationManager::addTickListener(TickListener *listener) {
+	std::lock_guard<std::mutex> lock(tickListenerMut_);
+	tickListeners_.push_back(listener);
+}
+
+void AnimationManager::removeTickListener(TickListener *listener) {
+	std::lock_guard<std::mutex> lock(tickListenerMut_);
+	auto it = std::find(tickListeners_.begin(), tickListeners_.end(), listener);
+	if (it != tickListeners_.end()) {
+		tickListeners_.erase(it);
+	}
+}
+
+void AnimationManager::tick() {
+	{
+		std::lock_guard<std::mutex> lock(tickListenerMut_);
+		for (auto listener: tickListeners_) {
+			listener->onTick();
 		}
+	}
+	tickCount_.fetch_add(1u, std::memory_order_release);
+}
 
-		// make a step
-		dt = static_cast<double>((time1 - time0).total_microseconds()) / 1000.0;
-		time0 = boost::posix_time::ptime(boost::posix_time::microsec_clock::local_time());
-		animation->animate(static_cast<double>(dt));
-		time1 = boost::posix_time::ptime(boost::posix_time::microsec_clock::local_time());
-
-		// synchronize to the desired frame rate
-		dt = static_cast<double>((time1 - time0).total_microseconds()) / 1000.0;
-		if (dt < goalTime) {
-			delta_micros = static_cast<int>((goalTime - dt) * 1000);
-			usleepRegen(delta_micros);
-			time1 += boost::posix_time::microseconds(delta_micros);
+void AnimationManager::animateFixedTimestep(double dt) {
+	const double tickInterval = tickInterval_.load(std::memory_order_relaxed);
+	const unsigned int maxTicks = maxCatchUpTicks_.load(std::memory_order_relaxed);
+	tickAccumulator_ += dt;
+	unsigned int numTicks = 0u;
+	while (tickAccumulator_ >= tickInterval) {
+		if (numTicks == maxTicks) {
+			// drop the remaining ticks, but keep the fraction of a tick for the interpolation
+			auto numDropped = std::floor(tickAccumulator_ / tickInterval);
+			droppedTicks_.fetch_add(static_cast<unsigned int>(numDropped), std::memory_order_relaxed);
+			tickAccumulator_ -= numDropped * tickInterval;
+			break;
 		}
+		animateSynchronized(tickInterval);
+		tickAccumulator_ -= tickInterval;
+		numTicks += 1;
+		tick();
 	}
+	interpolationFactor_.store(tickAccumulator_ / tickInterval, std::memory_order_release);
 }
 
 void AnimationManager::run() {
-	animationThreadID_ = boost::this_thread::get_id();
+	animationThreadID_.store(std::this_thread::get_id(), std::memory_order_relaxed);
 	resetTime();
 
 	while (!closeFlag_) {
 		time_ = boost::posix_time::ptime(
 				boost::posix_time::microsec_clock::local_time());
 
+		std::unique_lock<std::mutex> lock(animLoopMut_);
+		processAnimationCommands();
 		if (pauseFlag_ || synchronizedAnimations_.empty()) {
+			lock.unlock();
 #ifndef SYNCHRONIZE_THREADS
 			usleepRegen(IDLE_SLEEP);
 #endif // SYNCHRONIZE_THREADS
 		} else {
 			double dt = ((GLdouble) (time_ - lastTime_).total_microseconds()) / 1000.0;
 
-			// wait for remove/add to return
-			while (removeInProgress_) usleepRegen(1000);
-			while (addInProgress_) usleepRegen(1000);
-
 			animInProgress_ = true;
-			bool animsRemaining = true;
-			std::set<Animation *> processed;
-			while (animsRemaining) {
-				animsRemaining = false;
-				for (auto anim : synchronizedAnimations_) {
-					processed.insert(anim);
-					if (anim->isRunning()) {
-						anim->animate(dt);
-						// Animation was removed in animate call.
-						// We have to restart the loop because iterator is invalid.
-						if (animChangedDuringLoop_) {
-							animChangedDuringLoop_ = false;
-							animsRemaining = true;
-							break;
-						}
-					}
-				}
-			}
-			for (auto &index : spatialIndices_) {
-				index.second->update(dt);
+			if (isFixedTimestep()) {
+				animateFixedTimestep(dt);
+			} else {
+				animateSynchronized(dt);
+				tickAccumulator_ = 0.0;
+				interpolationFactor_.store(1.0, std::memory_order_release);
+				tick();
 			}
+			// apply changes made during the step
+			processAnimationCommands();
 			animInProgress_ = false;
+			releasedInStep_.clear();
+			lock.unlock();
 #ifndef SYNCHRONIZE_THREADS
 			if(dt<10) usleepRegen((10-dt) * 1000);
 #endif // SYNCHRONIZE_THREADS
@@ -384,27 +479,33 @@ void AnimationManager::run() {
 void AnimationManager::close(bool blocking) {
 	closeFlag_ = true;
 	if (blocking) {
-		boost::thread::id callingThread = boost::this_thread::get_id();
-		if (callingThread != animationThreadID_)
-			while (animInProgress_) usleepRegen(1000); // TODO: rather use signals
-		if (callingThread != glThreadID_)
-			while (glInProgress_) usleepRegen(1000);
+		auto callingThread = std::this_thread::get_id();
+		if (callingThread != animationThreadID_.load(std::memory_order_relaxed)) {
+			std::lock_guard<std::mutex> lock(animLoopMut_);
+		}
+		if (callingThread != glThreadID_.load(std::memory_order_relaxed)) {
+			std::lock_guard<std::mutex> lock(glLoopMut_);
+		}
 	}
 }
 
 void AnimationManager::pause(bool blocking) {
 	pauseFlag_ = true;
+	unsynchronizedScheduler_.setPaused(true);
 	if (blocking) {
-		boost::thread::id callingThread = boost::this_thread::get_id();
-		if (callingThread != animationThreadID_)
-			while (animInProgress_) usleepRegen(1000);
-		if (callingThread != glThreadID_)
-			while (glInProgress_) usleepRegen(1000);
+		auto callingThread = std::this_thread::get_id();
+		if (callingThread != animationThreadID_.load(std::memory_order_relaxed)) {
+			std::lock_guard<std::mutex> lock(animLoopMut_);
+		}
+		if (callingThread != glThreadID_.load(std::memory_order_relaxed)) {
+			std::lock_guard<std::mutex> lock(glLoopMut_);
+		}
 	}
 }
 
 void AnimationManager::clear() {
 	synchronizedAnimations_.clear();
+	hasScheduleChanged_ = true;
 	unsynchronizedAnimations_.clear();
 	gpuAnimations_.clear();
 	spatialIndices_.clear();
@@ -412,6 +513,7 @@ void AnimationManager::clear() {
 
 void AnimationManager::resume(bool blocking) {
 	pauseFlag_ = false;
+	unsynchronizedScheduler_.setPaused(false);
 	if (blocking) {
 		auto last_t = lastTime_;
 		nextFrame();
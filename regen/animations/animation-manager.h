@@ -10,14 +10,31 @@
 
 #include <list>
 #include <set>
+#include <atomic>
+#include <mutex>
+#include <thread>
 
 #include <regen/utility/threading.h>
 #include <regen/animations/animation.h>
 #include "regen/shapes/spatial-index.h"
+#include "regen/utility/job-system.h"
+#include "regen/utility/mpsc-queue.h"
+#include "regen/utility/thread-signal.h"
+#include "regen/animations/tick-interpolation.h"
+#include "regen/animations/animation-scheduler.h"
 
 namespace regen {
 	/**
 	 * \brief Manages multiple glAnimations in a separate thread.
+	 * Adding and removing animations does not block, the changes are queued
+	 * and applied by the animation and GL threads at the start of their next loop.
+	 * Synchronized animations that are independent or have declared their dependencies
+	 * are animated in parallel using the job system, animations that conflict with each other
+	 * are animated one after another in the same job.
+	 * Other synchronized animations are animated one after another after the parallel ones.
+	 * Unsynchronized animations are animated on a small pool of worker threads at their desired frame rate.
+	 * Optionally, synchronized animations are advanced in ticks of a fixed length
+	 * instead of the measured frame time, and the render thread blends between the last two ticks.
 	 */
 	class AnimationManager {
 	public:
@@ -38,6 +55,14 @@ namespace regen {
 		 */
 		void removeAnimation(Animation *animation);
 
+		/**
+		 * Wait until the manager does not reference a removed animation anymore.
+		 * This is called when an animation is destroyed, it blocks until
+		 * the current loop has finished unless called from within the loop.
+		 * @param animation a removed Animation instance.
+		 */
+		void releaseAnimation(Animation *animation);
+
 		/**
 		 * Invoke glAnimate() on added glAnimations.
 		 * @param rs the render state.
@@ -109,39 +134,174 @@ namespace regen {
 		 */
 		void setSpatialIndices(const std::map<std::string, ref_ptr<SpatialIndex>> &indices);
 
+		/**
+		 * Enable or disable parallel animation of independent animations.
+		 * @param useThreading true to enable parallel animation.
+		 */
+		void setUseThreading(bool useThreading) { useThreading_ = useThreading; }
+
+		/**
+		 * The critical path is the longest sequence of work in a step that cannot
+		 * run in parallel, i.e. the slowest job of parallel animations, plus the
+		 * animations that run one after another, plus the spatial index updates.
+		 * @return the critical path time of the last step in milliseconds.
+		 */
+		double criticalPathTime() const { return criticalPathTime_.load(std::memory_order_relaxed); }
+
+		/**
+		 * @return the time of the last step in milliseconds.
+		 */
+		double stepTime() const { return stepTime_.load(std::memory_order_relaxed); }
+
+		/**
+		 * Set how the animation and render thread wait for each other.
+		 * The default is to spin for a short, adaptive time before blocking.
+		 * @param mode the wait mode.
+		 */
+		void setSynchronizationMode(ThreadSignal::Mode mode);
+
+		/**
+		 * @return how the animation and render thread wait for each other.
+		 */
+		ThreadSignal::Mode synchronizationMode() const { return frameSignal_.mode(); }
+
+		/**
+		 * @return the time the animation thread has waited for the last frame in milliseconds.
+		 */
+		double frameWaitTime() const { return frameWaitTime_.load(std::memory_order_relaxed); }
+
+		/**
+		 * @return the time the render thread has waited for the last step in milliseconds.
+		 */
+		double stepWaitTime() const { return stepWaitTime_.load(std::memory_order_relaxed); }
+
+		/**
+		 * Advance synchronized animations in ticks of fixed length instead of the measured
+		 * frame time. If a frame took longer than a tick, multiple ticks are made to catch up,
+		 * up to the given maximum. Remaining time is dropped if the maximum is reached, i.e.
+		 * the simulation runs slower than real time.
+		 * @param tickRate the number of ticks per second, 0 disables the fixed-timestep mode.
+		 * @param maxCatchUpTicks the maximum number of ticks per step.
+		 */
+		void setFixedTimestep(double tickRate, unsigned int maxCatchUpTicks = 5u);
+
+		/**
+		 * @return true if synchronized animations are advanced in ticks of fixed length.
+		 */
+		bool isFixedTimestep() const { return tickInterval_.load(std::memory_order_relaxed) > 0.0; }
+
+		/**
+		 * @return the length of a tick in milliseconds, 0 if the fixed-timestep mode is disabled.
+		 */
+		double tickInterval() const { return tickInterval_.load(std::memory_order_relaxed); }
+
+		/**
+		 * The time that has passed since the last tick relative to the tick length.
+		 * The render thread uses this to blend between the state of the last two ticks.
+		 * It is always 1 if the fixed-timestep mode is disabled.
+		 * @return the interpolation factor in the range [0,1].
+		 */
+		double interpolationFactor() const { return interpolationFactor_.load(std::memory_order_acquire); }
+
+		/**
+		 * @return the number of ticks made so far, i.e. the number of steps if the fixed-timestep mode is disabled.
+		 */
+		unsigned int tickCount() const { return tickCount_.load(std::memory_order_acquire); }
+
+		/**
+		 * @return the number of ticks that were dropped because the maximum number of catch-up ticks was reached.
+		 */
+		unsigned int droppedTicks() const { return droppedTicks_.load(std::memory_order_relaxed); }
+
+		/**
+		 * Add a listener that is called by the animation thread after each tick.
+		 * @param listener the listener.
+		 */
+		void addTickListener(TickListener *listener);
+
+		/**
+		 * Remove a previously added listener. Blocks while the listeners are called,
+		 * so it must not be called from within TickListener::onTick.
+		 * @param listener the listener.
+		 */
+		void removeTickListener(TickListener *listener);
+
+		/**
+		 * @param animation an unsynchronized animation.
+		 * @return the scheduling statistics of the animation, e.g. how often it missed its deadline.
+		 */
+		AnimationScheduler::Statistics unsynchronizedStatistics(const Animation *animation) const;
+
 	private:
 		boost::posix_time::ptime time_;
 		boost::posix_time::ptime lastTime_;
 		std::vector<Animation *> synchronizedAnimations_;
 		std::vector<Animation *> unsynchronizedAnimations_;
-		std::vector<boost::thread> unsynchronizedThreads_;
 		std::set<Animation *> gpuAnimations_;
 		ref_ptr<State> rootState_;
 		std::map<std::string, ref_ptr<SpatialIndex>> spatialIndices_;
 
-		boost::thread::id animationThreadID_;
-		boost::thread::id glThreadID_;
-		boost::thread::id removeThreadID_;
-		boost::thread::id addThreadID_;
+		// note: read by threads that add or remove animations, hence atomic
+		std::atomic<std::thread::id> animationThreadID_;
+		std::atomic<std::thread::id> glThreadID_;
 		boost::thread thread_;
 		boost::mutex threadLock_;
 
-		bool animInProgress_;
-		bool glInProgress_;
-		bool removeInProgress_;
-		bool addInProgress_;
-		bool animChangedDuringLoop_;
-		bool glChangedDuringLoop_;
-		bool closeFlag_;
-		bool pauseFlag_;
-
-		boost::mutex stepMut_;
-		boost::mutex frameMut_;
+		std::atomic<bool> animInProgress_;
+		std::atomic<bool> glInProgress_;
+		std::atomic<bool> closeFlag_;
+		std::atomic<bool> pauseFlag_;
+
 		boost::mutex unsynchronizedMut_;
-		boost::condition_variable stepCond_;
-		boost::condition_variable frameCond_;
-		std::atomic<bool> hasNextFrame_ = false;
-		std::atomic<bool> hasNextStep_ = false;
+		AnimationScheduler unsynchronizedScheduler_;
+		ThreadSignal frameSignal_;
+		ThreadSignal stepSignal_;
+		std::atomic<double> frameWaitTime_ = 0.0;
+		std::atomic<double> stepWaitTime_ = 0.0;
+
+		// synchronized animations grouped for parallel execution,
+		// each group is animated one after another in a job.
+		JobSystem *jobSystem_;
+		bool useThreading_ = true;
+		std::vector<std::vector<Animation *>> parallelGroups_;
+		std::vector<Animation *> serialAnimations_;
+		std::vector<double> groupTimes_;
+		std::atomic<bool> hasScheduleChanged_ = true;
+		unsigned int scheduleStamp_ = 0u;
+		// queued add and remove commands, consumed by the holder of the loop mutex
+		struct Command {
+			Animation *animation;
+			bool isAdd;
+		};
+		MPSCQueue<Command> animCommands_;
+		MPSCQueue<Command> glCommands_;
+		std::mutex animLoopMut_;
+		std::mutex glLoopMut_;
+		// animations destroyed from within a loop, skipped for the rest of the loop
+		struct ReleasedAnimations {
+			std::mutex mutex;
+			std::vector<Animation *> animations;
+			std::atomic<bool> hasAnimations = false;
+
+			void add(Animation *animation);
+
+			bool contains(Animation *animation);
+
+			void clear();
+		};
+		ReleasedAnimations releasedInStep_;
+		ReleasedAnimations releasedInGLLoop_;
+		std::atomic<double> criticalPathTime_ = 0.0;
+		std::atomic<double> stepTime_ = 0.0;
+		// fixed-timestep mode, only the animation thread accesses the accumulator
+		std::atomic<double> tickInterval_ = 0.0;
+		std::atomic<unsigned int> maxCatchUpTicks_ = 5u;
+		double tickAccumulator_ = 0.0;
+		std::atomic<double> interpolationFactor_ = 1.0;
+		std::atomic<unsigned int> tickCount_ = 0u;
+		std::atomic<unsigned int> droppedTicks_ = 0u;
+		std::vector<TickListener *> tickListeners_;
+		std::mutex tickListenerMut_;
 
 		AnimationManager();
 
@@ -149,7 +309,23 @@ namespace regen {
 
 		void run();
 
-		void runUnsynchronized(Animation *animation) const;
+		bool isAnimationStepThread() const;
+
+		void updateSchedule();
+
+		void animateSynchronized(double dt);
+
+		void animateGroup(const std::vector<Animation *> &group, double dt);
+
+		void animateFixedTimestep(double dt);
+
+		void tick();
+
+		bool isGraphicsLoopThread() const;
+
+		void processAnimationCommands();
+
+		void processGraphicsCommands();
 
 		void nextStep();
 
@@ -5,6 +5,7 @@
  *      Author: daniel
  */
 
+#include <algorithm>
 #include <regen/utility/logging.h>
 
 #include "animation-node.h"
@@ -128,6 +129,170 @@ void AnimationNode::updateTransforms(const std::vector<Mat4f> &transforms) {
 	}
 }
 
+static inline bool isAffine(const Mat4f &m) {
+	return m.x[12] == 0.0f && m.x[13] == 0.0f && m.x[14] == 0.0f && m.x[15] == 1.0f;
+}
+
+// out = a*b, assuming both matrices have (0,0,0,1) as last row
+static inline void multiplyAffine(const Mat4f &a, const Mat4f &b, Mat4f &out) {
+	for (GLuint i = 0; i < 12; i += 4) {
+		out.x[i + 0] = a.x[i] * b.x[0] + a.x[i + 1] * b.x[4] + a.x[i + 2] * b.x[8];
+		out.x[i + 1] = a.x[i] * b.x[1] + a.x[i + 1] * b.x[5] + a.x[i + 2] * b.x[9];
+		out.x[i + 2] = a.x[i] * b.x[2] + a.x[i + 1] * b.x[6] + a.x[i + 2] * b.x[10];
+		out.x[i + 3] = a.x[i] * b.x[3] + a.x[i + 1] * b.x[7] + a.x[i + 2] * b.x[11] + a.x[i + 3];
+	}
+	out.x[12] = 0.0f;
+	out.x[13] = 0.0f;
+	out.x[14] = 0.0f;
+	out.x[15] = 1.0f;
+}
+
+// the same matrix as Quaternion::calculateMatrix followed by Mat4f::scale and translation
+static inline void composeTRS(const Skeleton::TRS &trs, Mat4f &m) {
+	auto &q = trs.rotation;
+	auto &s = trs.scaling;
+	m.x[0] = (-2.0f * (q.y * q.y + q.z * q.z) + 1.0f) * s.x;
+	m.x[1] = (2.0f * (q.x * q.y - q.z * q.w)) * s.y;
+	m.x[2] = (2.0f * (q.x * q.z + q.y * q.w)) * s.z;
+	m.x[3] = trs.translation.x;
+	m.x[4] = (2.0f * (q.x * q.y + q.z * q.w)) * s.x;
+	m.x[5] = (-2.0f * (q.x * q.x + q.z * q.z) + 1.0f) * s.y;
+	m.x[6] = (2.0f * (q.y * q.z - q.x * q.w)) * s.z;
+	m.x[7] = trs.translation.y;
+	m.x[8] = (2.0f * (q.x * q.z - q.y * q.w)) * s.x;
+	m.x[9] = (2.0f * (q.y * q.z + q.x * q.w)) * s.y;
+	m.x[10] = (-2.0f * (q.x * q.x + q.y * q.y) + 1.0f) * s.z;
+	m.x[11] = trs.translation.z;
+	m.x[12] = 0.0f;
+	m.x[13] = 0.0f;
+	m.x[14] = 0.0f;
+	m.x[15] = 1.0f;
+}
+
+Skeleton::Skeleton(const ref_ptr<AnimationNode> &rootNode)
+		: rootNode_(rootNode) {
+	// breadth-first order, parents come before their children
+	nodes_.push_back(rootNode_.get());
+	parents_.push_back(-1);
+	for (GLuint i = 0; i < nodes_.size(); ++i) {
+		for (auto &child: nodes_[i]->children()) {
+			nodes_.push_back(child.get());
+			parents_.push_back(static_cast<GLint>(i));
+		}
+	}
+	localTransforms_.resize(nodes_.size());
+	globalTransforms_.resize(nodes_.size());
+	for (GLuint i = 0; i < nodes_.size(); ++i) {
+		localTransforms_[i] = nodes_[i]->localTransform_;
+		globalTransforms_[i] = nodes_[i]->globalTransform_;
+		isAffine_ = isAffine_ && isAffine(localTransforms_[i]);
+	}
+	// the root transform is not animated
+	isAffine_ = isAffine_ && isAffine(globalTransforms_[0]);
+	updateChannels();
+}
+
+GLint Skeleton::nodeIndex(const AnimationNode *node) const {
+	for (GLuint i = 0; i < nodes_.size(); ++i) {
+		if (nodes_[i] == node) return static_cast<GLint>(i);
+	}
+	return -1;
+}
+
+void Skeleton::updateChannels() {
+	channels_.resize(nodes_.size());
+	for (GLuint i = 0; i < nodes_.size(); ++i) {
+		channels_[i] = nodes_[i]->channelIndex_;
+	}
+}
+
+void Skeleton::addBoneTarget(const ref_ptr<ShaderInputMat4> &target,
+							 const std::list<ref_ptr<AnimationNode> > &bones,
+							 GLuint firstBone) {
+	BoneTarget boneTarget;
+	boneTarget.input = target;
+	boneTarget.firstBone = firstBone;
+	for (auto &bone: bones) {
+		auto index = nodeIndex(bone.get());
+		if (index < 0) {
+			REGEN_WARN("Bone '" << bone->name() << "' is not part of the skeleton.");
+			continue;
+		}
+		boneTarget.nodeIndices.push_back(static_cast<GLuint>(index));
+		boneTarget.offsetMatrices.push_back(bone->boneOffsetMatrix());
+	}
+	std::lock_guard<std::mutex> lock(targetMutex_);
+	// initially write the current pose
+	{
+		auto mapped = target->mapClientData<Mat4f>(ShaderData::WRITE | ShaderData::INDEX);
+		for (GLuint i = 0; i < boneTarget.nodeIndices.size(); ++i) {
+			computeBoneMatrix(boneTarget.nodeIndices[i], boneTarget.offsetMatrices[i],
+							  mapped.w[firstBone + i]);
+		}
+		mapped.markDirty(firstBone, boneTarget.nodeIndices.size());
+	}
+	targets_.push_back(boneTarget);
+}
+
+void Skeleton::removeBoneTarget(const ShaderInputMat4 *target) {
+	std::lock_guard<std::mutex> lock(targetMutex_);
+	targets_.erase(std::remove_if(targets_.begin(), targets_.end(),
+			[target](const BoneTarget &x) { return x.input.get() == target; }), targets_.end());
+}
+
+void Skeleton::computeBoneMatrix(GLuint nodeIndex, const Mat4f &offsetMatrix, Mat4f &out) const {
+	auto &g = globalTransforms_[nodeIndex];
+	auto &o = offsetMatrix;
+	// Bone matrices transform from mesh coordinates in bind pose
+	// to mesh coordinates in skinned pose.
+	// The product is written transposed, as expected by the shaders.
+	for (GLuint i = 0; i < 4; ++i) {
+		const GLfloat *row = &g.x[i * 4];
+		for (GLuint j = 0; j < 4; ++j) {
+			out.x[j * 4 + i] = row[0] * o.x[j] + row[1] * o.x[4 + j] + row[2] * o.x[8 + j] + row[3] * o.x[12 + j];
+		}
+	}
+}
+
+void Skeleton::update(const TRS *channelTransforms, GLuint numChannels) {
+	Mat4f local;
+	// the root transform is kept, see AnimationNode::updateTransforms
+	for (GLuint i = 1; i < nodes_.size(); ++i) {
+		auto channel = channels_[i];
+		const Mat4f *l = &localTransforms_[i];
+		if (channel >= 0 && static_cast<GLuint>(channel) < numChannels) {
+			composeTRS(channelTransforms[channel], local);
+			l = &local;
+		}
+		if (isAffine_) {
+			multiplyAffine(globalTransforms_[parents_[i]], *l, globalTransforms_[i]);
+		} else {
+			globalTransforms_[i] = globalTransforms_[parents_[i]] * (*l);
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(targetMutex_);
+	if (targets_.empty()) {
+		// nobody reads the bone matrices directly, update the nodes instead
+		for (GLuint i = 1; i < nodes_.size(); ++i) {
+			auto *n = nodes_[i];
+			n->globalTransform_ = globalTransforms_[i];
+			if (n->isBoneNode_) {
+				computeBoneMatrix(i, n->offsetMatrix_, n->boneTransformationMatrix_);
+			}
+		}
+		return;
+	}
+	for (auto &target: targets_) {
+		auto mapped = target.input->mapClientData<Mat4f>(ShaderData::WRITE | ShaderData::INDEX);
+		for (GLuint i = 0; i < target.nodeIndices.size(); ++i) {
+			computeBoneMatrix(target.nodeIndices[i], target.offsetMatrices[i],
+							  mapped.w[target.firstBone + i]);
+		}
+		mapped.markDirty(target.firstBone, target.nodeIndices.size());
+	}
+}
+
 ////////////////
 
 static void loadNodeNames(AnimationNode *n, std::map<std::string, AnimationNode *> &nameToNode_) {
@@ -207,6 +372,9 @@ NodeAnimation::NodeAnimation(const ref_ptr<AnimationNode> &rootNode)
 		  timeFactor_(1.0),
 		  tickRange_(0.0, 0.0) {
 	loadNodeNames(rootNode_.get(), nameToNode_);
+	skeleton_ = ref_ptr<Skeleton>::alloc(rootNode_);
+	// the node tree is owned by this animation
+	addWriteDependency(this);
 }
 
 ref_ptr<NodeAnimation> NodeAnimation::copy(GLboolean autoStart) {
@@ -274,7 +442,7 @@ void NodeAnimation::setAnimationIndexActive(
 	NodeAnimation::Data &anim = *animData_[animationIndex_].get();
 	anim.active_ = true;
 	if (anim.transforms_.size() != anim.channels_->size()) {
-		anim.transforms_.resize(anim.channels_->size(), Mat4f::identity());
+		anim.transforms_.resize(anim.channels_->size());
 	}
 	if (anim.startFramePosition_.size() != anim.channels_->size()) {
 		anim.startFramePosition_.resize(anim.channels_->size());
@@ -285,6 +453,7 @@ void NodeAnimation::setAnimationIndexActive(
 		const std::string nodeName = anim.channels_->data()[a].nodeName_;
 		nameToNode_[nodeName]->set_channelIndex(a);
 	}
+	skeleton_->updateChannels();
 
 	tickRange_.x = -1.0;
 	tickRange_.y = -1.0;
@@ -393,6 +562,10 @@ void NodeAnimation::animate(GLdouble milliSeconds) {
 		stopNodeAnimation(anim);
 		return;
 	}
+	if (lod_.get() && !lod_->nextStep()) {
+		// skip this step, the elapsed time is still accumulated
+		return;
+	}
 	// Time runs backwards when start tick is higher then stop tick
 	if (tickRange_.x > tickRange_.y) {
 		timeInTicks = -timeInTicks;
@@ -402,40 +575,36 @@ void NodeAnimation::animate(GLdouble milliSeconds) {
 	// update transformations
 	for (GLuint i = 0; i < anim.channels_->size(); i++) {
 		const Channel &channel = anim.channels_->data()[i];
-		Mat4f &m = anim.transforms_[i];
+		Skeleton::TRS &trs = anim.transforms_[i];
 
 		if (channel.rotationKeys_->empty()) {
-			m = Mat4f::identity();
+			trs.rotation = Quaternion(1.0f, 0.0f, 0.0f, 0.0f);
 		} else if (channel.rotationKeys_->size() == 1) {
-			m = channel.rotationKeys_->data()[0].value.calculateMatrix();
+			trs.rotation = channel.rotationKeys_->data()[0].value;
 		} else {
-			m = nodeRotation(anim, channel, timeInTicks, i).calculateMatrix();
+			trs.rotation = nodeRotation(anim, channel, timeInTicks, i);
 		}
 
 		if (channel.scalingKeys_->empty()) {
+			trs.scaling = Vec3f(1.0f);
 		} else if (channel.scalingKeys_->size() == 1) {
-			m.scale(channel.scalingKeys_->data()[0].value);
+			trs.scaling = channel.scalingKeys_->data()[0].value;
 		} else {
-			m.scale(nodeScaling(anim, channel, timeInTicks, i));
+			trs.scaling = nodeScaling(anim, channel, timeInTicks, i);
 		}
 
 		if (channel.positionKeys_->empty()) {
+			trs.translation = Vec3f(0.0f);
 		} else if (channel.positionKeys_->size() == 1) {
-			Vec3f &pos = channel.positionKeys_->data()[0].value;
-			m.x[3] = pos.x;
-			m.x[7] = pos.y;
-			m.x[11] = pos.z;
+			trs.translation = channel.positionKeys_->data()[0].value;
 		} else {
-			Vec3f pos = nodePosition(anim, channel, timeInTicks, i);
-			m.x[3] = pos.x;
-			m.x[7] = pos.y;
-			m.x[11] = pos.z;
+			trs.translation = nodePosition(anim, channel, timeInTicks, i);
 		}
 	}
 
 	anim.lastTime_ = timeInTicks;
 
-	rootNode_->updateTransforms(anim.transforms_);
+	skeleton_->update(anim.transforms_.data(), anim.transforms_.size());
 }
 
 Vec3f NodeAnimation::nodePosition(
@@ -12,9 +12,13 @@
 #include <regen/math/matrix.h>
 #include <regen/math/quaternion.h>
 #include <regen/animations/animation.h>
+#include <regen/gl-types/shader-input.h>
+#include <regen/animations/animation-lod.h>
 
 #include <map>
 #include <vector>
+#include <list>
+#include <mutex>
 
 namespace regen {
 	/**
@@ -122,6 +126,106 @@ namespace regen {
 		GLint channelIndex_;
 
 		GLboolean isBoneNode_;
+
+		friend class Skeleton;
+	};
+
+	/**
+	 * \brief A node tree compiled into flat arrays for transform propagation.
+	 * Nodes are sorted such that parents come before their children, the
+	 * global transforms are then computed in a single linear pass.
+	 * Bone matrices are written directly into the bone matrix inputs
+	 * registered with addBoneTarget().
+	 */
+	class Skeleton {
+	public:
+		/**
+		 * \brief Local transform of an animated node.
+		 */
+		struct TRS {
+			Quaternion rotation = Quaternion(1.0f, 0.0f, 0.0f, 0.0f); /**< node rotation. */
+			Vec3f scaling = Vec3f(1.0f); /**< node scaling. */
+			Vec3f translation = Vec3f(0.0f); /**< node translation. */
+		};
+
+		/**
+		 * @param rootNode the root of the node tree.
+		 */
+		explicit Skeleton(const ref_ptr<AnimationNode> &rootNode);
+
+		Skeleton(const Skeleton &) = delete;
+
+		/**
+		 * @return number of nodes.
+		 */
+		auto numNodes() const { return static_cast<GLuint>(nodes_.size()); }
+
+		/**
+		 * @param node a node of the tree.
+		 * @return the index of the node, or -1 if the node is not part of the tree.
+		 */
+		GLint nodeIndex(const AnimationNode *node) const;
+
+		/**
+		 * @return parent index of each node, -1 for the root node.
+		 */
+		auto &parents() const { return parents_; }
+
+		/**
+		 * @return global transform of each node.
+		 */
+		auto &globalTransforms() const { return globalTransforms_; }
+
+		/**
+		 * Read the channel indices of the nodes.
+		 * Should be called after animation index changed.
+		 */
+		void updateChannels();
+
+		/**
+		 * Write the matrices of the given bones into a bone matrix input.
+		 * The bone offset matrices are read when the target is added.
+		 * @param target the bone matrix input.
+		 * @param bones the bone nodes.
+		 * @param firstBone array index of the first bone in the input.
+		 */
+		void addBoneTarget(const ref_ptr<ShaderInputMat4> &target,
+						   const std::list<ref_ptr<AnimationNode> > &bones,
+						   GLuint firstBone);
+
+		/**
+		 * @param target a bone matrix input.
+		 */
+		void removeBoneTarget(const ShaderInputMat4 *target);
+
+		/**
+		 * Compute the global transforms and the bone matrices.
+		 * If no bone target was added, the matrices are written to the nodes instead.
+		 * @param channelTransforms local transform of each animation channel.
+		 * @param numChannels number of animation channels.
+		 */
+		void update(const TRS *channelTransforms, GLuint numChannels);
+
+	protected:
+		struct BoneTarget {
+			ref_ptr<ShaderInputMat4> input;
+			GLuint firstBone;
+			std::vector<GLuint> nodeIndices;
+			std::vector<Mat4f> offsetMatrices;
+		};
+		ref_ptr<AnimationNode> rootNode_;
+		std::vector<AnimationNode *> nodes_;
+		std::vector<GLint> parents_;
+		std::vector<GLint> channels_;
+		std::vector<Mat4f> localTransforms_;
+		std::vector<Mat4f> globalTransforms_;
+		std::vector<BoneTarget> targets_;
+		std::mutex targetMutex_;
+		// true if all static transforms have (0,0,0,1) as last row
+		bool isAffine_ = true;
+
+		// out = transpose(globalTransform * offsetMatrix)
+		void computeBoneMatrix(GLuint nodeIndex, const Mat4f &offsetMatrix, Mat4f &out) const;
 	};
 
 	/**
@@ -256,6 +360,23 @@ namespace regen {
 		 */
 		auto timeFactor() const { return timeFactor_; }
 
+		/**
+		 * Reduce the update rate with the distance to a camera.
+		 * Skipped steps are not lost, the next evaluated step includes their time.
+		 * @param lod the level of detail configuration, or a null reference to disable LOD.
+		 */
+		void setLevelOfDetail(const ref_ptr<AnimationLOD> &lod) { lod_ = lod; }
+
+		/**
+		 * @return the level of detail configuration.
+		 */
+		auto &levelOfDetail() const { return lod_; }
+
+		/**
+		 * @return the compiled node tree.
+		 */
+		auto &skeleton() const { return skeleton_; }
+
 		/**
 		 * Find node with given name.
 		 * @param name the node name.
@@ -285,7 +406,7 @@ namespace regen {
 			// Duration of the animation in ticks.
 			GLdouble duration_;
 			// local node transformation
-			std::vector<Mat4f> transforms_;
+			std::vector<Skeleton::TRS> transforms_;
 			// remember last frame for interpolation
 			std::vector<Vec3ui> lastFramePosition_;
 			std::vector<Vec3ui> startFramePosition_;
@@ -293,6 +414,7 @@ namespace regen {
 		};
 
 		ref_ptr<AnimationNode> rootNode_;
+		ref_ptr<Skeleton> skeleton_;
 
 		GLint animationIndex_;
 		std::vector<ref_ptr<NodeAnimation::Data> > animData_;
@@ -305,6 +427,7 @@ namespace regen {
 		GLdouble duration_;
 		GLdouble timeFactor_;
 		Vec2d tickRange_;
+		ref_ptr<AnimationLOD> lod_;
 
 		Quaternion nodeRotation(
 				NodeAnimation::Data &anim,
@@ -0,0 +1,171 @@
+#include <algorithm>
+
+#include "animation-scheduler.h"
+
+using namespace regen;
+
+static double toMilliseconds(std::chrono::steady_clock::duration d) {
+	return std::chrono::duration<double, std::milli>(d).count();
+}
+
+AnimationScheduler::AnimationScheduler(unsigned int numWorkers) {
+	for (unsigned int i = 0; i < std::max(numWorkers, 1u); ++i) {
+		workers_.emplace_back([this]() { runWorker(); });
+	}
+}
+
+AnimationScheduler::~AnimationScheduler() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		isClosed_ = true;
+	}
+	workCond_.notify_all();
+	for (auto &worker: workers_) {
+		worker.join();
+	}
+}
+
+bool AnimationScheduler::hasLaterDeadline(const std::shared_ptr<Task> &a, const std::shared_ptr<Task> &b) {
+	return a->deadline > b->deadline;
+}
+
+void AnimationScheduler::push(const std::shared_ptr<Task> &task) {
+	queue_.push_back(task);
+	std::push_heap(queue_.begin(), queue_.end(), hasLaterDeadline);
+}
+
+std::shared_ptr<AnimationScheduler::Task> AnimationScheduler::pop() {
+	std::pop_heap(queue_.begin(), queue_.end(), hasLaterDeadline);
+	auto task = queue_.back();
+	queue_.pop_back();
+	return task;
+}
+
+void AnimationScheduler::add(Animation *animation) {
+	auto task = std::make_shared<Task>();
+	task->animation = animation;
+	auto frameRate = animation->desiredFrameRate();
+	if (frameRate > 0.0f) {
+		task->period = std::chrono::duration_cast<Clock::duration>(
+				std::chrono::duration<double>(1.0 / frameRate));
+	} else {
+		task->period = Clock::duration::zero();
+	}
+	task->deadline = Clock::now();
+	task->lastTime = task->deadline;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto &existing = tasks_[animation];
+		if (existing.get() != nullptr) {
+			// already scheduled
+			return;
+		}
+		existing = task;
+		push(task);
+	}
+	workCond_.notify_one();
+}
+
+void AnimationScheduler::remove(Animation *animation) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	auto it = tasks_.find(animation);
+	if (it == tasks_.end()) return;
+	auto task = it->second;
+	tasks_.erase(it);
+	// the queued task is skipped by the workers
+	task->isRemoved = true;
+	if (task->runner != std::this_thread::get_id()) {
+		idleCond_.wait(lock, [&task]() { return !task->isInProgress; });
+	}
+}
+
+void AnimationScheduler::setPaused(bool isPaused) {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (isPaused == isPaused_) return;
+		isPaused_ = isPaused;
+		if (isPaused_) {
+			pauseTime_ = Clock::now();
+		} else {
+			// shift all deadlines by the paused time, this keeps the order of the queue
+			auto pausedTime = Clock::now() - pauseTime_;
+			for (auto &task: queue_) {
+				task->deadline += pausedTime;
+				task->lastTime += pausedTime;
+			}
+			for (auto &pair: tasks_) {
+				if (pair.second->isInProgress) {
+					pair.second->deadline += pausedTime;
+					pair.second->lastTime += pausedTime;
+				}
+			}
+		}
+	}
+	workCond_.notify_all();
+}
+
+bool AnimationScheduler::statistics(const Animation *animation, Statistics &stats) const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto it = tasks_.find(animation);
+	if (it == tasks_.end()) return false;
+	stats = it->second->stats;
+	return true;
+}
+
+void AnimationScheduler::runWorker() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (!isClosed_) {
+		if (isPaused_ || queue_.empty()) {
+			workCond_.wait(lock);
+			continue;
+		}
+		if (queue_.front()->isRemoved) {
+			pop();
+			continue;
+		}
+		auto now = Clock::now();
+		if (queue_.front()->deadline > now) {
+			// woken up early if an animation with an earlier deadline is added
+			workCond_.wait_until(lock, queue_.front()->deadline);
+			continue;
+		}
+		auto task = pop();
+		auto dt = toMilliseconds(now - task->lastTime);
+		auto lateness = toMilliseconds(now - task->deadline);
+		task->lastTime = now;
+		task->runner = std::this_thread::get_id();
+		task->isInProgress = true;
+		lock.unlock();
+
+		task->animation->animate(dt);
+
+		auto end = Clock::now();
+		lock.lock();
+		task->isInProgress = false;
+		task->runner = {};
+		auto &stats = task->stats;
+		stats.numSteps += 1;
+		stats.lastStepTime = toMilliseconds(end - now);
+		stats.averageStepTime += (stats.lastStepTime - stats.averageStepTime) / stats.numSteps;
+		stats.maxLateness = std::max(stats.maxLateness, lateness);
+		if (task->isRemoved) {
+			idleCond_.notify_all();
+			continue;
+		}
+		// Note: the deadline was shifted if the scheduler was paused during the step
+		auto nextDeadline = task->deadline + task->period;
+		if (nextDeadline < end) {
+			// do not try to catch up missed steps
+			if (task->period > Clock::duration::zero()) {
+				stats.numOverruns += 1;
+			}
+			nextDeadline = end;
+		}
+		task->deadline = nextDeadline;
+		push(task);
+		if (queue_.front() == task) {
+			// another worker may wait for a later deadline
+			workCond_.notify_one();
+		}
+	}
+}
@@ -0,0 +1,116 @@
+#ifndef REGEN_ANIMATION_SCHEDULER_H_
+#define REGEN_ANIMATION_SCHEDULER_H_
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+
+#include <regen/animations/animation.h>
+
+namespace regen {
+	/**
+	 * @brief Animates unsynchronized animations on a fixed pool of worker threads.
+	 * Each animation has a deadline derived from its desired frame rate, and the
+	 * animation with the earliest deadline is animated by the next idle worker.
+	 * If an animation could not keep its deadline, it is animated again
+	 * as soon as possible, but missed steps are not caught up.
+	 */
+	class AnimationScheduler {
+	public:
+		/**
+		 * \brief Scheduling statistics of an animation.
+		 */
+		struct Statistics {
+			/** number of animation steps. */
+			unsigned int numSteps = 0u;
+			/** number of steps that finished after the deadline of the next step. */
+			unsigned int numOverruns = 0u;
+			/** the maximum time a step has started after its deadline in milliseconds. */
+			double maxLateness = 0.0;
+			/** the average time of a step in milliseconds. */
+			double averageStepTime = 0.0;
+			/** the time of the last step in milliseconds. */
+			double lastStepTime = 0.0;
+		};
+
+		/**
+		 * @param numWorkers number of worker threads.
+		 */
+		explicit AnimationScheduler(unsigned int numWorkers);
+
+		~AnimationScheduler();
+
+		AnimationScheduler(const AnimationScheduler &) = delete;
+
+		/**
+		 * @return the number of worker threads.
+		 */
+		auto numWorkers() const { return static_cast<unsigned int>(workers_.size()); }
+
+		/**
+		 * Schedule an animation, the first step is made immediately.
+		 * @param animation the animation.
+		 */
+		void add(Animation *animation);
+
+		/**
+		 * Remove a scheduled animation. Blocks until the animation is not animated anymore,
+		 * unless called from within a step of the animation.
+		 * @param animation the animation.
+		 */
+		void remove(Animation *animation);
+
+		/**
+		 * Pause or resume all animations. The paused time is not included
+		 * in the time difference passed to the animations.
+		 * @param isPaused true to pause.
+		 */
+		void setPaused(bool isPaused);
+
+		/**
+		 * @param animation a scheduled animation.
+		 * @param stats set to the scheduling statistics of the animation.
+		 * @return false if the animation is not scheduled.
+		 */
+		bool statistics(const Animation *animation, Statistics &stats) const;
+
+	protected:
+		using Clock = std::chrono::steady_clock;
+
+		struct Task {
+			Animation *animation;
+			Clock::duration period;
+			Clock::time_point deadline;
+			Clock::time_point lastTime;
+			Statistics stats;
+			std::thread::id runner;
+			bool isInProgress = false;
+			bool isRemoved = false;
+		};
+		std::vector<std::thread> workers_;
+		// min-heap of tasks ordered by deadline
+		std::vector<std::shared_ptr<Task>> queue_;
+		std::unordered_map<const Animation *, std::shared_ptr<Task>> tasks_;
+		mutable std::mutex mutex_;
+		std::condition_variable workCond_;
+		std::condition_variable idleCond_;
+		Clock::time_point pauseTime_;
+		bool isPaused_ = false;
+		bool isClosed_ = false;
+
+		void runWorker();
+
+		// orders the queue such that the earliest deadline is at the front
+		static bool hasLaterDeadline(const std::shared_ptr<Task> &a, const std::shared_ptr<Task> &b);
+
+		void push(const std::shared_ptr<Task> &task);
+
+		std::shared_ptr<Task> pop();
+	};
+} // namespace
+
+#endif /* REGEN_ANIMATION_SCHEDULER_H_ */
@@ -16,6 +16,7 @@ using namespace regen;
 
 GLuint Animation::ANIMATION_STARTED = EventObject::registerEvent("animationStarted");
 GLuint Animation::ANIMATION_STOPPED = EventObject::registerEvent("animationStopped");
+std::atomic<unsigned int> Animation::dependencyStamp_ = 0u;
 
 Animation::Animation(bool isGPUAnimation, bool isCPUAnimation)
 		: EventObject(),
@@ -37,11 +38,15 @@ Animation::~Animation() {
 		unlock_gl();
 	}
 	stopAnimation();
+	if (wasStarted_) {
+		// make sure the animation is not referenced by the animation manager anymore
+		AnimationManager::get().releaseAnimation(this);
+	}
 }
 
 void Animation::startAnimation() {
-	if (isRunning_) return;
-	isRunning_ = true;
+	if (isRunning_.exchange(true)) return;
+	wasStarted_ = true;
 
 	unqueueEmit(ANIMATION_STOPPED);
 	queueEmit(ANIMATION_STARTED);
@@ -49,12 +54,45 @@ void Animation::startAnimation() {
 }
 
 void Animation::stopAnimation() {
-	if (!isRunning_) return;
+	// the animation is not animated anymore once the flag is unset
+	if (!isRunning_.exchange(false)) return;
 
 	unqueueEmit(ANIMATION_STARTED);
 	queueEmit(ANIMATION_STOPPED);
 	AnimationManager::get().removeAnimation(this);
-	isRunning_ = false;
+}
+
+void Animation::setIndependent(bool v) {
+	isIndependent_ = v;
+	dependencyStamp_.fetch_add(1u, std::memory_order_release);
+}
+
+void Animation::addReadDependency(const void *resource) {
+	readDependencies_.push_back(resource);
+	dependencyStamp_.fetch_add(1u, std::memory_order_release);
+}
+
+void Animation::addWriteDependency(const void *resource) {
+	writeDependencies_.push_back(resource);
+	dependencyStamp_.fetch_add(1u, std::memory_order_release);
+}
+
+static bool hasCommonResource(const std::vector<const void *> &a, const std::vector<const void *> &b) {
+	for (auto *x: a) {
+		for (auto *y: b) {
+			if (x == y) return true;
+		}
+	}
+	return false;
+}
+
+bool Animation::hasDependencyConflict(const Animation &other) const {
+	if (!isParallelizable() || !other.isParallelizable()) {
+		return true;
+	}
+	return hasCommonResource(writeDependencies_, other.writeDependencies_) ||
+		   hasCommonResource(writeDependencies_, other.readDependencies_) ||
+		   hasCommonResource(readDependencies_, other.writeDependencies_);
 }
 
 GLboolean Animation::try_lock() { return mutex_.try_lock(); }
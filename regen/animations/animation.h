@@ -10,6 +10,8 @@
 
 #include <GL/glew.h>
 #include <boost/thread/mutex.hpp>
+#include <atomic>
+#include <vector>
 
 #include <regen/utility/event-object.h>
 #include <regen/gl-types/render-state.h>
@@ -65,7 +67,7 @@ namespace regen {
 		/**
 		 * @return true if this animation is active.
 		 */
-		auto isRunning() const { return isRunning_; }
+		bool isRunning() const { return isRunning_.load(std::memory_order_acquire); }
 
 		/**
 		 * @return true if this animation is synchronized.
@@ -83,6 +85,45 @@ namespace regen {
 		 */
 		void setSynchronized(GLboolean v) { isSynchronized_ = v; }
 
+		/**
+		 * Mark this animation as independent, i.e. it only touches its own data.
+		 * Independent synchronized animations are animated in parallel to other animations.
+		 * @param v the independent flag.
+		 */
+		void setIndependent(bool v);
+
+		/**
+		 * Declare that this animation reads a resource in animate().
+		 * Animations with declared dependencies are animated in parallel to other
+		 * animations unless one of them writes a resource the other one reads or writes.
+		 * @param resource the resource, e.g. a shader input or a node.
+		 */
+		void addReadDependency(const void *resource);
+
+		/**
+		 * Declare that this animation writes a resource in animate().
+		 * @param resource the resource, e.g. a shader input or a node.
+		 */
+		void addWriteDependency(const void *resource);
+
+		/**
+		 * Animations without declared dependencies are animated one after another
+		 * after the parallel animations.
+		 * @return true if the animation is independent or has declared its dependencies.
+		 */
+		bool isParallelizable() const { return isIndependent_ || !readDependencies_.empty() || !writeDependencies_.empty(); }
+
+		/**
+		 * @param other another animation.
+		 * @return true if the animations cannot be animated in parallel.
+		 */
+		bool hasDependencyConflict(const Animation &other) const;
+
+		/**
+		 * @return a stamp that changes when an animation has changed its dependencies.
+		 */
+		static unsigned int dependencyStamp() { return dependencyStamp_.load(std::memory_order_acquire); }
+
 		/**
 		 * Activate this animation.
 		 */
@@ -184,10 +225,15 @@ namespace regen {
 		std::string animationName_;
 		bool isGPUAnimation_;
 		bool isCPUAnimation_;
-		bool isRunning_;
+		std::atomic<bool> isRunning_;
+		bool wasStarted_ = false;
 		bool isSynchronized_ = true;
+		bool isIndependent_ = false;
 		float desiredFrameRate_ = 60.0f;
 		ref_ptr<State> animationState_;
+		std::vector<const void *> readDependencies_;
+		std::vector<const void *> writeDependencies_;
+		static std::atomic<unsigned int> dependencyStamp_;
 
 		void operator=(const Animation &) = delete;
 
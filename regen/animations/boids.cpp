@@ -1,32 +1,63 @@
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 #include "boids.h"
 #include "regen/scene/resource-manager.h"
 
 using namespace regen;
 
-// TODO: Make the neighborhood computation faster by using a spatial index.
-//       Currently the computation is O(n^2), which is not very efficient for large number of boids.
-//       An approach could be a grid-based indexed with fixed size cells, then boid positions can easily
-//       be mapped to the grid cell they belong to. Then the neighborhood search can be limited to
-//       through adjacent cells plus knowing their size plus the visual range of the boids.
-//       Maybe an option would be a C array with std::vector elements?
+// cell coordinates are clamped to this range, e.g. for boids that are far away
+#define BOIDS_GRID_MAX_COORD (1 << 20)
+// minimum number of buckets of the spatial hash grid
+#define BOIDS_GRID_MIN_BUCKETS 64u
+// minimum number of boids simulated in one job of the job system
+#define BOIDS_MIN_JOB_SIZE 1024u
+
+static inline int boidCellCoord(float v, float cellSize) {
+	auto c = std::floor(v / cellSize);
+	c = std::max(std::min(c, static_cast<float>(BOIDS_GRID_MAX_COORD)),
+				 -static_cast<float>(BOIDS_GRID_MAX_COORD));
+	return static_cast<int>(c);
+}
+
+static inline unsigned int boidCellHash(int x, int y, int z, unsigned int mask) {
+	return (static_cast<unsigned int>(x) * 73856093u ^
+			static_cast<unsigned int>(y) * 19349663u ^
+			static_cast<unsigned int>(z) * 83492791u) & mask;
+}
+
+static inline float boidRandom(unsigned int &h) {
+	// integer hash, random numbers must be generated without shared state
+	// as boids are simulated in parallel.
+	h ^= h >> 16u;
+	h *= 0x7feb352du;
+	h ^= h >> 15u;
+	h *= 0x846ca68bu;
+	h ^= h >> 16u;
+	return static_cast<float>(h >> 8u) * (1.0f / 16777216.0f);
+}
+
 // TODO: Implement GPU version of the boids simulation.
 
 BoidsSimulation_CPU::BoidsSimulation_CPU(const ref_ptr<ModelTransformation> &tf)
 		: Animation(false, true),
 		  tf_(tf),
-		  bounds_(-10.0f, 10.0f) {
+		  bounds_(-10.0f, 10.0f),
+		  jobSystem_(&JobSystem::get()) {
 	auto tfInput = tf_->get();
+	addWriteDependency(tfInput.get());
 	auto tfData = tfInput->mapClientData<Mat4f>(ShaderData::READ);
 	boidsScale_ = tfData.r[0].scaling();
 
 	initBoidSimulation(tfInput->numInstances());
 
-	// allocate boids data
-	boidData_.resize(tfInput->numInstances());
-	for (GLuint i = 0; i < tfInput->numInstances(); ++i) {
-		auto &d = boidData_[i];
-		d.position = tfData.r[i].position();
-		d.velocity = Vec3f::zero();
+	// initialize boids data
+	auto &state = state_[stateIndex_];
+	for (GLuint i = 0; i < numBoids_; ++i) {
+		state.set(i, tfData.r[i].position(), Vec3f::zero(), Vec3f::front());
 	}
 }
 
@@ -34,23 +65,55 @@ BoidsSimulation_CPU::BoidsSimulation_CPU(const ref_ptr<ShaderInput3f> &position)
 		: Animation(false, true),
 		  position_(position),
 		  bounds_(-10.0f, 10.0f),
-		  boidsScale_(1.0f) {
+		  boidsScale_(1.0f),
+		  jobSystem_(&JobSystem::get()) {
+	addWriteDependency(position_.get());
 	initBoidSimulation(position_->numInstances());
-	// allocate boids data
+	// initialize boids data
 	auto initialPositionData = position_->mapClientData<Vec3f>(ShaderData::READ);
-	boidData_.resize(position_->numInstances());
-	for (GLuint i = 0; i < position_->numInstances(); ++i) {
-		auto &d = boidData_[i];
-		d.position = initialPositionData.r[i];
-		d.velocity = Vec3f::zero();
+	auto &state = state_[stateIndex_];
+	for (GLuint i = 0; i < numBoids_; ++i) {
+		state.set(i, initialPositionData.r[i], Vec3f::zero(), Vec3f::front());
 	}
 }
 
+BoidsSimulation_CPU::~BoidsSimulation_CPU() {
+	if (positionStaging_) {
+		position_->freeClientBuffer(positionStaging_);
+	}
+}
+
+void BoidsSimulation_CPU::BoidState::resize(unsigned int numBoids) {
+	for (auto *v: {&posX, &posY, &posZ, &velX, &velY, &velZ, &dirX, &dirY, &dirZ}) {
+		v->resize(numBoids, 0.0f);
+	}
+}
+
+void BoidsSimulation_CPU::BoidState::set(unsigned int i,
+										 const Vec3f &position,
+										 const Vec3f &velocity,
+										 const Vec3f &direction) {
+	posX[i] = position.x;
+	posY[i] = position.y;
+	posZ[i] = position.z;
+	velX[i] = velocity.x;
+	velY[i] = velocity.y;
+	velZ[i] = velocity.z;
+	dirX[i] = direction.x;
+	dirY[i] = direction.y;
+	dirZ[i] = direction.z;
+}
+
 void BoidsSimulation_CPU::initBoidSimulation(unsigned int numBoids) {
 	setAnimationName("boids");
 	// use a dedicated thread for the boids simulation which is not synchronized with the graphics thread,
 	// i.e. it can be slower or faster than the graphics thread.
 	setSynchronized(false);
+	numBoids_ = numBoids;
+	state_[0].resize(numBoids);
+	state_[1].resize(numBoids);
+	neighborOffset_.assign(numBoids, 0u);
+	neighborCount_.assign(numBoids, 0u);
 
 	coherenceWeight_ = ref_ptr<ShaderInput1f>::alloc("coherenceWeight");
 	coherenceWeight_->setUniformData(1.0f);
@@ -159,6 +222,7 @@ void BoidsSimulation_CPU::loadSettings(LoadingContext &ctx, scene::SceneInputNod
 	if (input.hasAttribute("separation-weight")) {
 		setSeparationWeight(input.getValue<float>("separation-weight", 0.5f));
 	}
+	setUseThreading(input.getValue<bool>("use-threading", true));
 
 	if (input.hasAttribute("height-map")) {
 		auto heightMap = ctx.scene()->getResource<Texture2D>(input.getValue("height-map"));
@@ -225,107 +289,400 @@ Vec2f BoidsSimulation_CPU::computeUV(const Vec3f &boidPosition, const Vec3f &map
 }
 
 void BoidsSimulation_CPU::animate(double dt) {
-	auto dt_f = static_cast<float>(dt) * 0.001f;
+	// read the simulation parameters once per step
+	updateParameters(static_cast<float>(dt) * 0.001f);
 	// advance boids simulation
-	simulateBoids(dt_f);
+	simulateBoids();
 	// update boids model transformation using the boids data
+	auto &state = state_[stateIndex_];
+	auto jobs = numJobs();
 	if (tf_.get()) {
 		auto &tfInput = tf_->get();
 		auto tfData = tfInput->mapClientData<Mat4f>(ShaderData::READ | ShaderData::WRITE);
-		for (GLuint i = 0; i < tfInput->numInstances(); ++i) {
-			auto &d = boidData_[i];
-			// calculate boid matrix, also need to compute rotation from velocity, model z
-			//       should point in the direction of velocity.
-			if (d.velocity.length() > 0.001f) {
-				// Convert the normalized direction vector to Euler angles
-				boidRotation_.setEuler(
-						atan2(-d.direction.x, d.direction.z) + baseOrientation_,
-						asin(-d.direction.y),
-						0.0f);
-				tfData.w[i] = boidRotation_.calculateMatrix();
-				tfData.w[i].scale(boidsScale_);
-				tfData.w[i].translate(d.position);
-			} else {
-				tfData.w[i] = tfData.r[i];
+		parallelFor(jobs, [&](unsigned int jobIndex) {
+			Quaternion boidRotation;
+			auto begin = numBoids_ * jobIndex / jobs;
+			auto end = numBoids_ * (jobIndex + 1) / jobs;
+			for (auto i = begin; i < end; ++i) {
+				// calculate boid matrix, also need to compute rotation from velocity, model z
+				//       should point in the direction of velocity.
+				if (state.velocity(i).length() > 0.001f) {
+					// Convert the normalized direction vector to Euler angles
+					boidRotation.setEuler(
+							atan2(-state.dirX[i], state.dirZ[i]) + baseOrientation_,
+							asin(-state.dirY[i]),
+							0.0f);
+					tfData.w[i] = boidRotation.calculateMatrix();
+					tfData.w[i].scale(boidsScale_);
+					tfData.w[i].translate(state.position(i));
+				} else {
+					tfData.w[i] = tfData.r[i];
+				}
 			}
-		}
+		});
 	} else if (position_.get()) {
-		auto positionData = position_->mapClientData<Vec3f>(ShaderData::WRITE);
-		// TODO: rather use memcpy
-		for (GLuint i = 0; i < position_->numInstances(); ++i) {
-			positionData.w[i] = boidData_[i].position;
+		// fill a staging buffer, and exchange it with the current data of the input.
+		// this way readers of the positions are only blocked for the pointer swap.
+		if (positionStaging_ && positionStagingSize_ != position_->inputSize()) {
+			// the positions were resized, the buffer cannot be exchanged anymore
+			position_->freeClientBuffer(positionStaging_);
+			positionStaging_ = nullptr;
+		}
+		if (!positionStaging_) {
+			positionStaging_ = position_->allocateClientBuffer();
+			positionStagingSize_ = position_->inputSize();
+		}
+		auto *positionData = reinterpret_cast<Vec3f *>(positionStaging_);
+		parallelFor(jobs, [&](unsigned int jobIndex) {
+			auto begin = numBoids_ * jobIndex / jobs;
+			auto end = numBoids_ * (jobIndex + 1) / jobs;
+			for (auto i = begin; i < end; ++i) {
+				positionData[i] = state.position(i);
+			}
+		});
+		auto *previous = position_->exchangeClientData(positionStaging_);
+		if (previous) {
+			positionStaging_ = previous;
+		} else {
+			// rejected because the positions were resized in the meantime,
+			// they are written again with a new buffer in the next step.
+			position_->freeClientBuffer(positionStaging_);
+			positionStaging_ = nullptr;
 		}
 	}
 	// recompute neighborhood relationships of all boids
-	auto maxDistance = visualRange_->getVertex(0);
-	auto maxNeighbours = maxNumNeighbors_->getVertex(0);
-	for (size_t i = 0; i < boidData_.size(); i++) {
-		auto &b1 = boidData_[i];
-		unsigned int numNeighbors = 0;
-		for (size_t j = i + 1; j < boidData_.size(); j++) {
-			auto &b2 = boidData_[j];
-			auto distance = (b1.position - b2.position).length();
-			if (distance < maxDistance.r) {
-				b1.neighbors.push_back(&b2);
-				b2.neighbors.push_back(&b1);
-				numNeighbors++;
-				if (numNeighbors >= maxNeighbours.r) {
-					break;
+	updateNeighbors();
+}
+
+void BoidsSimulation_CPU::updateParameters(float dt) {
+	params_.dt = dt;
+	params_.maxNumNeighbors = maxNumNeighbors_->getVertex(0).r;
+	params_.maxBoidSpeed = maxBoidSpeed_->getVertex(0).r;
+	params_.maxAngularSpeed = maxAngularSpeed_->getVertex(0).r;
+	params_.coherenceWeight = coherenceWeight_->getVertex(0).r;
+	params_.alignmentWeight = alignmentWeight_->getVertex(0).r;
+	params_.separationWeight = separationWeight_->getVertex(0).r;
+	params_.avoidanceDistance = avoidanceDistance_->getVertex(0).r;
+	params_.visualRange = visualRange_->getVertex(0).r;
+	params_.lookAheadDistance = lookAheadDistance_->getVertex(0).r;
+	params_.repulsionFactor = repulsionFactor_->getVertex(0).r;
+
+	auto entityPosition = [](const SimulationEntity &entity) {
+		auto pos = Vec3f::zero();
+		if (entity.pos.get()) {
+			pos = entity.pos->getVertex(0).r;
+		}
+		if (entity.tf.get()) {
+			pos += entity.tf->getVertex(0).r.position();
+		}
+		return pos;
+	};
+	params_.attractors.resize(attractors_.size());
+	for (size_t i = 0; i < attractors_.size(); ++i) {
+		params_.attractors[i] = entityPosition(attractors_[i]);
+	}
+	params_.dangers.resize(dangers_.size());
+	for (size_t i = 0; i < dangers_.size(); ++i) {
+		params_.dangers[i] = entityPosition(dangers_[i]);
+	}
+}
+
+unsigned int BoidsSimulation_CPU::numJobs() const {
+	if (!useThreading_) {
+		return 1u;
+	}
+	auto numJobs = (numBoids_ + BOIDS_MIN_JOB_SIZE - 1) / BOIDS_MIN_JOB_SIZE;
+	return std::max(1u, std::min(numJobs, jobSystem_->concurrency()));
+}
+
+void BoidsSimulation_CPU::parallelFor(unsigned int numJobs, const std::function<void(unsigned int)> &job) {
+	// the calling thread executes jobs until all jobs are done
+	jobSystem_->parallelFor(numJobs, 1, job);
+}
+
+Vec3f BoidsSimulation_CPU::randomDirection(const BoidData &boid, unsigned int salt) const {
+	unsigned int h = boid.index * 0x9e3779b1u ^ (stepCounter_ * 0x85ebca77u + salt);
+	auto x = boidRandom(h);
+	auto y = boidRandom(h);
+	auto z = boidRandom(h);
+	return {x, y, z};
+}
+
+void BoidsSimulation_CPU::updateGrid(float cellSize) {
+	auto &state = state_[stateIndex_];
+	// use a power of two number of buckets, at least the number of boids
+	unsigned int numBuckets = BOIDS_GRID_MIN_BUCKETS;
+	while (numBuckets < numBoids_) { numBuckets <<= 1u; }
+	auto mask = numBuckets - 1u;
+
+	// count the boids per bucket
+	boidCells_.resize(numBoids_);
+	cellStart_.assign(numBuckets + 1, 0u);
+	for (unsigned int i = 0; i < numBoids_; ++i) {
+		auto bucket = boidCellHash(
+				boidCellCoord(state.posX[i], cellSize),
+				boidCellCoord(state.posY[i], cellSize),
+				boidCellCoord(state.posZ[i], cellSize), mask);
+		boidCells_[i] = bucket;
+		cellStart_[bucket + 1] += 1;
+	}
+	for (unsigned int i = 0; i < numBuckets; ++i) {
+		cellStart_[i + 1] += cellStart_[i];
+	}
+	// sort boid indices by bucket, boids within a bucket remain in ascending order
+	cellBoids_.resize(numBoids_);
+	neighborCursor_.assign(cellStart_.begin(), cellStart_.end() - 1);
+	for (unsigned int i = 0; i < numBoids_; ++i) {
+		cellBoids_[neighborCursor_[boidCells_[i]]++] = i;
+	}
+}
+
+void BoidsSimulation_CPU::collectNeighbors(unsigned int jobIndex, unsigned int begin, unsigned int end) {
+	auto &state = state_[stateIndex_];
+	auto &job = neighborJobs_[jobIndex];
+	auto maxDistance = params_.visualRange;
+	auto maxDistanceSq = maxDistance * maxDistance;
+	auto maxNeighbours = params_.maxNumNeighbors;
+	auto mask = static_cast<unsigned int>(cellStart_.size() - 2);
+	unsigned int buckets[27];
+	unsigned int numBuckets = 0;
+	int lastX = 0, lastY = 0, lastZ = 0;
+	job.targets.clear();
+
+	// collect neighbor pairs (i,j) with j>i in the 27 cells around each boid.
+	// Only the maxNeighbours lowest indices j are kept which is the same set of
+	// pairs a brute force search over all j>i would produce.
+	// Boids are visited in the order of the grid such that subsequent boids
+	// mostly share the same cells.
+	for (auto l = begin; l < end; ++l) {
+		auto i = cellBoids_[l];
+		auto firstIndex = job.targets.size();
+		auto px = state.posX[i], py = state.posY[i], pz = state.posZ[i];
+		int x = boidCellCoord(px, maxDistance);
+		int y = boidCellCoord(py, maxDistance);
+		int z = boidCellCoord(pz, maxDistance);
+		if (numBuckets == 0 || x != lastX || y != lastY || z != lastZ) {
+			numBuckets = 0;
+			for (int dx = -1; dx <= 1; ++dx) {
+				for (int dy = -1; dy <= 1; ++dy) {
+					for (int dz = -1; dz <= 1; ++dz) {
+						auto bucket = boidCellHash(x + dx, y + dy, z + dz, mask);
+						// different cells may map to the same bucket, visit each bucket only once
+						if (std::find(buckets, buckets + numBuckets, bucket) == buckets + numBuckets) {
+							buckets[numBuckets++] = bucket;
+						}
+					}
+				}
+			}
+			lastX = x;
+			lastY = y;
+			lastZ = z;
+		}
+
+		for (unsigned int k = 0; k < numBuckets; ++k) {
+			for (auto m = cellStart_[buckets[k]]; m < cellStart_[buckets[k] + 1]; ++m) {
+				auto j = cellBoids_[m];
+				if (j <= i) continue;
+				auto dx = px - state.posX[j];
+				auto dy = py - state.posY[j];
+				auto dz = pz - state.posZ[j];
+				if (dx * dx + dy * dy + dz * dz < maxDistanceSq) {
+					job.targets.push_back(j);
 				}
 			}
 		}
+		auto first = job.targets.begin() + static_cast<long>(firstIndex);
+		if (static_cast<unsigned int>(job.targets.end() - first) > maxNeighbours) {
+			std::nth_element(first, first + maxNeighbours, job.targets.end());
+			job.targets.resize(firstIndex + maxNeighbours);
+			first = job.targets.begin() + static_cast<long>(firstIndex);
+		}
+		std::sort(first, job.targets.end());
+		pairJob_[i] = jobIndex;
+		pairOffsets_[i] = static_cast<unsigned int>(firstIndex);
+		pairCounts_[i] = static_cast<unsigned int>(job.targets.end() - first);
 	}
 }
 
-void BoidsSimulation_CPU::simulateBoids(float dt) {
-	for (auto &d: boidData_) {
-		simulateBoid(d, dt);
-		d.neighbors.clear();
+void BoidsSimulation_CPU::updateNeighbors() {
+	std::fill(neighborOffset_.begin(), neighborOffset_.end(), 0u);
+	std::fill(neighborCount_.begin(), neighborCount_.end(), 0u);
+	neighborIndices_.clear();
+	if (params_.visualRange <= 0.0f || params_.maxNumNeighbors == 0 || numBoids_ < 2) {
+		return;
+	}
+	updateGrid(params_.visualRange);
+
+	// search the pairs in parallel, each job handles a contiguous range of the grid
+	auto jobs = numJobs();
+	neighborJobs_.resize(jobs);
+	pairJob_.resize(numBoids_);
+	pairOffsets_.resize(numBoids_);
+	pairCounts_.resize(numBoids_);
+	parallelFor(jobs, [this, jobs](unsigned int jobIndex) {
+		collectNeighbors(jobIndex,
+						 numBoids_ * jobIndex / jobs,
+						 numBoids_ * (jobIndex + 1) / jobs);
+	});
+
+	// count the pairs on both sides
+	for (unsigned int i = 0; i < numBoids_; ++i) {
+		auto *targets = neighborJobs_[pairJob_[i]].targets.data() + pairOffsets_[i];
+		neighborCount_[i] += pairCounts_[i];
+		for (unsigned int k = 0; k < pairCounts_[i]; ++k) {
+			neighborCount_[targets[k]] += 1;
+		}
 	}
+	// assign the neighbor ranges of the boids in the flat array
+	unsigned int offset = 0;
+	for (unsigned int i = 0; i < numBoids_; ++i) {
+		neighborOffset_[i] = offset;
+		offset += neighborCount_[i];
+	}
+	neighborIndices_.resize(offset);
+	// fill the ranges in the same order as pairs would be pushed with a brute force search
+	neighborCursor_.assign(neighborOffset_.begin(), neighborOffset_.end());
+	for (unsigned int i = 0; i < numBoids_; ++i) {
+		auto *targets = neighborJobs_[pairJob_[i]].targets.data() + pairOffsets_[i];
+		for (unsigned int k = 0; k < pairCounts_[i]; ++k) {
+			auto j = targets[k];
+			neighborIndices_[neighborCursor_[i]++] = j;
+			neighborIndices_[neighborCursor_[j]++] = i;
+		}
+	}
+}
+
+void BoidsSimulation_CPU::simulateBoids() {
+	auto &in = state_[stateIndex_];
+	auto &out = state_[1 - stateIndex_];
+	auto jobs = numJobs();
+	parallelFor(jobs, [&](unsigned int jobIndex) {
+		auto begin = numBoids_ * jobIndex / jobs;
+		auto end = numBoids_ * (jobIndex + 1) / jobs;
+		for (auto i = begin; i < end; ++i) {
+			simulateBoid(in, out, i);
+		}
+	});
+	// the next state becomes the current state
+	stateIndex_ = 1 - stateIndex_;
+	stepCounter_ += 1;
 }
 
-void BoidsSimulation_CPU::simulateBoid(BoidData &boid, float dt) {
+void BoidsSimulation_CPU::accumulateNeighbors(
+		const BoidState &in,
+		const BoidData &boid,
+		Vec3f &avgPosition,
+		Vec3f &avgVelocity,
+		Vec3f &separation) const {
+	auto *neighbors = neighborIndices_.data() + neighborOffset_[boid.index];
+	auto numNeighbors = neighborCount_[boid.index];
+	auto avoidanceDistance = params_.avoidanceDistance;
+	unsigned int n = 0;
+	// accumulate a single neighbor
+	auto accumulate = [&](unsigned int k) {
+		auto j = neighbors[k];
+		auto neighborPosition = in.position(j);
+		avgPosition += neighborPosition;
+		avgVelocity += in.velocity(j);
+		auto boidDirection = boid.position - neighborPosition;
+		float distance = boidDirection.length();
+		if (distance < 0.001f) {
+			boidDirection = randomDirection(boid, 3u + k);
+			boidDirection.normalize();
+			distance = 0.0f;
+		} else {
+			boidDirection /= distance * distance;
+		}
+		if (distance < avoidanceDistance) {
+			separation += boidDirection;
+		}
+	};
+#if defined(__SSE2__)
+	// accumulate batches of four neighbors
+	auto gather = [neighbors](const std::vector<float> &v, unsigned int k) {
+		return _mm_set_ps(v[neighbors[k + 3]], v[neighbors[k + 2]], v[neighbors[k + 1]], v[neighbors[k]]);
+	};
+	const __m128 bx = _mm_set1_ps(boid.position.x);
+	const __m128 by = _mm_set1_ps(boid.position.y);
+	const __m128 bz = _mm_set1_ps(boid.position.z);
+	const __m128 minDistanceSq = _mm_set1_ps(0.001f * 0.001f);
+	const __m128 avoidance = _mm_set1_ps(avoidanceDistance);
+	__m128 sumPX = _mm_setzero_ps(), sumPY = _mm_setzero_ps(), sumPZ = _mm_setzero_ps();
+	__m128 sumVX = _mm_setzero_ps(), sumVY = _mm_setzero_ps(), sumVZ = _mm_setzero_ps();
+	__m128 sepX = _mm_setzero_ps(), sepY = _mm_setzero_ps(), sepZ = _mm_setzero_ps();
+	for (; n + 4 <= numNeighbors; n += 4) {
+		__m128 px = gather(in.posX, n);
+		__m128 py = gather(in.posY, n);
+		__m128 pz = gather(in.posZ, n);
+		__m128 dx = _mm_sub_ps(bx, px);
+		__m128 dy = _mm_sub_ps(by, py);
+		__m128 dz = _mm_sub_ps(bz, pz);
+		__m128 distanceSq = _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		if (_mm_movemask_ps(_mm_cmplt_ps(distanceSq, minDistanceSq)) != 0) {
+			// coincident boids need a random direction, handle the batch without SIMD
+			for (unsigned int k = n; k < n + 4; ++k) { accumulate(k); }
+			continue;
+		}
+		sumPX = _mm_add_ps(sumPX, px);
+		sumPY = _mm_add_ps(sumPY, py);
+		sumPZ = _mm_add_ps(sumPZ, pz);
+		sumVX = _mm_add_ps(sumVX, gather(in.velX, n));
+		sumVY = _mm_add_ps(sumVY, gather(in.velY, n));
+		sumVZ = _mm_add_ps(sumVZ, gather(in.velZ, n));
+		// direction scaled by the inverse squared distance, only for neighbors in avoidance distance
+		__m128 isClose = _mm_cmplt_ps(_mm_sqrt_ps(distanceSq), avoidance);
+		__m128 scale = _mm_and_ps(isClose, _mm_div_ps(_mm_set1_ps(1.0f), distanceSq));
+		sepX = _mm_add_ps(sepX, _mm_mul_ps(dx, scale));
+		sepY = _mm_add_ps(sepY, _mm_mul_ps(dy, scale));
+		sepZ = _mm_add_ps(sepZ, _mm_mul_ps(dz, scale));
+	}
+	auto sum = [](__m128 v) {
+		float x[4];
+		_mm_storeu_ps(x, v);
+		return (x[0] + x[1]) + (x[2] + x[3]);
+	};
+	avgPosition += Vec3f(sum(sumPX), sum(sumPY), sum(sumPZ));
+	avgVelocity += Vec3f(sum(sumVX), sum(sumVY), sum(sumVZ));
+	separation += Vec3f(sum(sepX), sum(sepY), sum(sepZ));
+#endif
+	// remaining neighbors that do not fill a batch
+	for (; n < numNeighbors; ++n) {
+		accumulate(n);
+	}
+}
+
+void BoidsSimulation_CPU::simulateBoid(const BoidState &in, BoidState &out, unsigned int i) const {
+	BoidData boid;
+	boid.index = i;
+	boid.position = in.position(i);
+	boid.velocity = in.velocity(i);
+	boid.direction = in.direction(i);
 	boid.force = Vec3f::zero();
 	// a boid is lost if it is outside the bounds
 	bool isBoidLost = !bounds_.contains(boid.position);
-	if (boid.neighbors.empty()) {
+	auto numNeighbors = neighborCount_[i];
+	if (numNeighbors == 0) {
 		// a boid without neighbors is lost
 		isBoidLost = true;
 	} else {
 		// simulate the boid using the three rules of boids
-		avgPosition_ = Vec3f::zero();
-		avgVelocity_ = Vec3f::zero();
-		separation_ = Vec3f::zero();
-		for (auto neighbor: boid.neighbors) {
-			avgPosition_ += neighbor->position;
-			avgVelocity_ += neighbor->velocity;
-			boidDirection_ = boid.position - neighbor->position;
-			float distance = boidDirection_.length();
-			if (distance < 0.001f) {
-				boidDirection_ = Vec3f::random();
-				// avoid "jumping" up
-				//boidDirection_.y = -abs(boidDirection_.y);
-				boidDirection_.normalize();
-				distance = 0.0f;
-			} else {
-				boidDirection_ /= distance * distance;
-			}
-			if (distance < avoidanceDistance_->getVertex(0).r) {
-				separation_ += boidDirection_;
-			}
-		}
-		avgPosition_ /= static_cast<float>(boid.neighbors.size());
-		avgVelocity_ /= static_cast<float>(boid.neighbors.size());
+		auto avgPosition = Vec3f::zero();
+		auto avgVelocity = Vec3f::zero();
+		auto separation = Vec3f::zero();
+		accumulateNeighbors(in, boid, avgPosition, avgVelocity, separation);
+		avgPosition /= static_cast<float>(numNeighbors);
+		avgVelocity /= static_cast<float>(numNeighbors);
 		boid.force +=
-				separation_ * separationWeight_->getVertex(0).r +
-				(avgVelocity_ - boid.velocity) * alignmentWeight_->getVertex(0).r +
-				(avgPosition_ - boid.position) * coherenceWeight_->getVertex(0).r;
+				separation * params_.separationWeight +
+				(avgVelocity - boid.velocity) * params_.alignmentWeight +
+				(avgPosition - boid.position) * params_.coherenceWeight;
 	}
 
 	// put some restrictions on the boid's velocity.
 	// a boid that cannot avoid collisions is considered lost.
-	isBoidLost = !avoidCollisions(boid, dt) || isBoidLost;
-	auto isInDanger = !dangers_.empty() && !avoidDanger(boid);
+	isBoidLost = !avoidCollisions(boid) || isBoidLost;
+	auto isInDanger = !params_.dangers.empty() && !avoidDanger(boid);
 	if (!isInDanger) {
 		// note: ignore attractors if in danger
 		attract(boid);
@@ -333,37 +690,39 @@ void BoidsSimulation_CPU::simulateBoid(BoidData &boid, float dt) {
 	// drift towards home if lost
 	if (isBoidLost) { homesickness(boid); }
 
-	boid.position += boid.velocity * dt;
-	boid.velocity += boid.force * dt;
+	boid.position += boid.velocity * params_.dt;
+	boid.velocity += boid.force * params_.dt;
 	limitVelocity(boid);
 
 	boid.direction = boid.velocity;
 	boid.direction.normalize();
+	out.set(i, boid.position, boid.velocity, boid.direction);
 }
 
-void BoidsSimulation_CPU::limitVelocity(BoidData &boid) {
+void BoidsSimulation_CPU::limitVelocity(BoidData &boid) const {
 	// limit translation speed
-	auto maxSpeed = maxBoidSpeed_->getVertex(0).r;
+	auto maxSpeed = params_.maxBoidSpeed;
 	if (boid.velocity.length() > maxSpeed) {
 		boid.velocity.normalize();
 		boid.velocity *= maxSpeed;
 	}
 
 	// limit angular speed
-	auto maxAngularSpeed = maxAngularSpeed_->getVertex(0).r;
-	boidDirection_ = boid.velocity;
-	boidDirection_.normalize();
-	auto angle = acos(boidDirection_.dot(boid.direction));
+	auto maxAngularSpeed = params_.maxAngularSpeed;
+	auto boidDirection = boid.velocity;
+	boidDirection.normalize();
+	auto angle = acos(boidDirection.dot(boid.direction));
 	if (angle > maxAngularSpeed) {
-		auto axis = boidDirection_.cross(boid.direction);
+		auto axis = boidDirection.cross(boid.direction);
 		axis.normalize();
-		boidRotation_.setAxisAngle(axis, maxAngularSpeed);
-		auto newDirection = boidRotation_.rotate(boid.direction);
+		Quaternion boidRotation;
+		boidRotation.setAxisAngle(axis, maxAngularSpeed);
+		auto newDirection = boidRotation.rotate(boid.direction);
 		boid.velocity = newDirection * boid.velocity.length();
 	}
 }
 
-void BoidsSimulation_CPU::homesickness(BoidData &boid) {
+void BoidsSimulation_CPU::homesickness(BoidData &boid) const {
 	// a boid seems to have lost track, and wants to go home!
 	// first find closest home point...
 	const Vec3f *closestHomePoint = &Vec3f::zero();
@@ -381,14 +740,14 @@ void BoidsSimulation_CPU::homesickness(BoidData &boid) {
 		minDistance = (boid.position - *closestHomePoint).length();
 	}
 	// second steer towards the closest home point ...
-	boidDirection_ = *closestHomePoint - boid.position;
+	auto boidDirection = *closestHomePoint - boid.position;
 	if (minDistance < 0.001f) {
-		boidDirection_ = Vec3f::random();
+		boidDirection = randomDirection(boid, 0u);
 	} else {
-		boidDirection_ /= minDistance;
+		boidDirection /= minDistance;
 	}
-	auto repulsionFactor = repulsionFactor_->getVertex(0).r * separationWeight_->getVertex(0).r;
-	boid.force += boidDirection_ * repulsionFactor * 0.1;
+	auto repulsionFactor = params_.repulsionFactor * params_.separationWeight;
+	boid.force += boidDirection * repulsionFactor * 0.1;
 }
 
 void BoidsSimulation_CPU::addObject(ObjectType objectType, const ref_ptr<ShaderInputMat4> &tf,
@@ -405,28 +764,23 @@ void BoidsSimulation_CPU::addObject(ObjectType objectType, const ref_ptr<ShaderI
 	if (!entity) { return; }
 	entity->tf = tf;
 	entity->pos = offset;
+	if (tf.get()) addReadDependency(tf.get());
+	if (offset.get()) addReadDependency(offset.get());
 }
 
-bool BoidsSimulation_CPU::avoidDanger(BoidData &boid) {
-	auto maxDistance = visualRange_->getVertex(0).r;
+bool BoidsSimulation_CPU::avoidDanger(BoidData &boid) const {
+	auto maxDistance = params_.visualRange;
 	bool isInDanger = false;
-	for (auto &danger: dangers_) {
-		auto dir = Vec3f::zero();
-		if (danger.pos.get()) {
-			dir = danger.pos.get()->getVertex(0).r;
-		}
-		if (danger.tf.get()) {
-			dir += danger.tf.get()->getVertex(0).r.position();
-		}
-		dir -= boid.position;
+	for (auto &danger: params_.dangers) {
+		auto dir = danger - boid.position;
 		auto distance = dir.length();
 		if (distance < maxDistance) {
 			if (distance < 0.001f) {
-				dir = Vec3f::random();
+				dir = randomDirection(boid, 1u);
 			} else {
 				dir /= distance;
 			}
-			auto repulsionFactor = repulsionFactor_->getVertex(0).r * separationWeight_->getVertex(0).r;
+			auto repulsionFactor = params_.repulsionFactor * params_.separationWeight;
 			boid.force += dir * repulsionFactor;
 			isInDanger = true;
 		}
@@ -434,32 +788,25 @@ bool BoidsSimulation_CPU::avoidDanger(BoidData &boid) {
 	return !isInDanger;
 }
 
-void BoidsSimulation_CPU::attract(BoidData &boid) {
-	auto maxDistance = visualRange_->getVertex(0).r * 100; // TODO: parameter
-	for (auto &attractor: attractors_) {
-		auto dir = Vec3f::zero();
-		if (attractor.pos.get()) {
-			dir = attractor.pos.get()->getVertex(0).r;
-		}
-		if (attractor.tf.get()) {
-			dir += attractor.tf.get()->getVertex(0).r.position();
-		}
-		dir -= boid.position;
+void BoidsSimulation_CPU::attract(BoidData &boid) const {
+	auto maxDistance = params_.visualRange * 100; // TODO: parameter
+	for (auto &attractor: params_.attractors) {
+		auto dir = attractor - boid.position;
 		auto distance = dir.length();
 		if (distance < maxDistance && distance > 0.001f) {
-			auto attractionFactor = repulsionFactor_->getVertex(0).r * separationWeight_->getVertex(0).r;
+			auto attractionFactor = params_.repulsionFactor * params_.separationWeight;
 			boid.force += dir * attractionFactor / distance;
 		}
 	}
 }
 
-bool BoidsSimulation_CPU::avoidCollisions(BoidData &boid, float dt) {
-	auto repulsionFactor = repulsionFactor_->getVertex(0).r * separationWeight_->getVertex(0).r;
-	auto avoidDistance = avoidanceDistance_->getVertex(0).r;
+bool BoidsSimulation_CPU::avoidCollisions(BoidData &boid) const {
+	auto repulsionFactor = params_.repulsionFactor * params_.separationWeight;
+	auto avoidDistance = params_.avoidanceDistance;
 	auto avoidDistanceHalf = avoidDistance * 0.5f;
-	auto nextVelocity = boid.velocity + boid.force * dt;
+	auto nextVelocity = boid.velocity + boid.force * params_.dt;
 	nextVelocity.normalize();
-	auto lookAhead = boid.position + nextVelocity * lookAheadDistance_->getVertex(0).r;
+	auto lookAhead = boid.position + nextVelocity * params_.lookAheadDistance;
 	bool isCollisionFree = true;
 
 	////////////////
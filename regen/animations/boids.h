@@ -12,6 +12,7 @@
 #include "regen/shapes/quad-tree.h"
 #include "regen/scene/scene-input.h"
 #include "regen/scene/scene-loader.h"
+#include "regen/utility/job-system.h"
 #include <regen/textures/texture-2d.h>
 
 namespace regen {
@@ -22,6 +23,9 @@ namespace regen {
 	 * which can be too much for huge number of boids.
 	 * But for a few hundred or a couple of thousand boids it should be fine.
 	 * For massive number of boids a GPU implementation is recommended.
+	 * The boid state is stored in structure-of-arrays form and double buffered,
+	 * each step reads the previous state and writes the next one such that
+	 * the boids can be simulated in parallel.
 	 */
 	class BoidsSimulation_CPU : public Animation {
 	public:
@@ -42,7 +46,7 @@ namespace regen {
 		 */
 		explicit BoidsSimulation_CPU(const ref_ptr<ShaderInput3f> &position);
 
-		~BoidsSimulation_CPU() override = default;
+		~BoidsSimulation_CPU() override;
 
 		static ref_ptr<BoidsSimulation_CPU> load(LoadingContext &ctx, scene::SceneInputNode &input, const ref_ptr<ShaderInput3f> &position);
 
@@ -106,6 +110,14 @@ namespace regen {
 		 */
 		void setMaxNumNeighbors(unsigned int num) { maxNumNeighbors_->setVertex(0, num); }
 
+		/**
+		 * Enable or disable multithreaded simulation.
+		 * If enabled, the boids are split into chunks that are simulated
+		 * in separate jobs of the job system.
+		 * @param useThreading true to enable multithreading.
+		 */
+		void setUseThreading(bool useThreading) { useThreading_ = useThreading; }
+
 		/**
 		 * Set the maximum speed of the boids.
 		 * @param speed the maximum speed.
@@ -167,6 +179,9 @@ namespace regen {
 	protected:
 		ref_ptr<ModelTransformation> tf_;
 		ref_ptr<ShaderInput3f> position_;
+		// buffer exchanged with the client data of position_, and its size
+		byte *positionStaging_ = nullptr;
+		unsigned int positionStagingSize_ = 0;
 		float baseOrientation_ = 0.0f;
 		Bounds<Vec3f> bounds_;
 		Vec3f boidsScale_;
@@ -197,40 +212,121 @@ namespace regen {
 		ref_ptr<ShaderInput1f> lookAheadDistance_;
 		ref_ptr<ShaderInput1f> repulsionFactor_;
 
+		// per-step snapshot of the simulation parameters, the shader inputs
+		// are read only once per step and not for each boid.
+		struct BoidParameters {
+			float dt = 0.0f;
+			unsigned int maxNumNeighbors = 0;
+			float maxBoidSpeed = 0.0f;
+			float maxAngularSpeed = 0.0f;
+			float coherenceWeight = 0.0f;
+			float alignmentWeight = 0.0f;
+			float separationWeight = 0.0f;
+			float avoidanceDistance = 0.0f;
+			float visualRange = 0.0f;
+			float lookAheadDistance = 0.0f;
+			float repulsionFactor = 0.0f;
+			std::vector<Vec3f> attractors;
+			std::vector<Vec3f> dangers;
+		};
+		BoidParameters params_;
+
+		// boid state in structure-of-arrays form
+		struct BoidState {
+			std::vector<float> posX, posY, posZ;
+			std::vector<float> velX, velY, velZ;
+			// normalized velocity
+			std::vector<float> dirX, dirY, dirZ;
+
+			void resize(unsigned int numBoids);
+
+			Vec3f position(unsigned int i) const { return {posX[i], posY[i], posZ[i]}; }
+
+			Vec3f velocity(unsigned int i) const { return {velX[i], velY[i], velZ[i]}; }
+
+			Vec3f direction(unsigned int i) const { return {dirX[i], dirY[i], dirZ[i]}; }
+
+			void set(unsigned int i, const Vec3f &position, const Vec3f &velocity, const Vec3f &direction);
+		};
+		// double buffered state, state_[stateIndex_] is the current state
+		BoidState state_[2];
+		unsigned int stateIndex_ = 0;
+		unsigned int numBoids_ = 0;
+		unsigned int stepCounter_ = 0;
+
+		// working copy of one boid while it is simulated
 		struct BoidData {
-			//ref_ptr<BoundingSphere> shape;
+			unsigned int index;
 			Vec3f position;
-			Vec3f force;
 			Vec3f velocity;
-			Vec3f direction = Vec3f::front(); // normalized velocity
-			std::vector<const BoidData *> neighbors;
+			Vec3f direction;
+			Vec3f force;
+		};
+
+		// range of neighbor indices of each boid in neighborIndices_
+		std::vector<unsigned int> neighborOffset_;
+		std::vector<unsigned int> neighborCount_;
+		// flat array of neighbor indices of all boids
+		std::vector<unsigned int> neighborIndices_;
+
+		// spatial hash grid with cell size equal to the visual range,
+		// it is rebuilt each step with a counting sort.
+		std::vector<unsigned int> boidCells_;
+		std::vector<unsigned int> cellStart_;
+		std::vector<unsigned int> cellBoids_;
+		std::vector<unsigned int> neighborCursor_;
+		// neighbor pairs (i,j) with i<j collected by the jobs of the neighborhood search,
+		// the targets j of boid i are stored in the job that has processed i.
+		struct NeighborJob {
+			std::vector<unsigned int> targets;
 		};
-		std::vector<BoidData> boidData_;
+		std::vector<unsigned int> pairJob_;
+		std::vector<unsigned int> pairOffsets_;
+		std::vector<unsigned int> pairCounts_;
+		std::vector<NeighborJob> neighborJobs_;
 
-		Vec3f avgPosition_ = Vec3f::zero();
-		Vec3f avgVelocity_ = Vec3f::zero();
-		Vec3f separation_ = Vec3f::zero();
-		Vec3f boidDirection_ = Vec3f::front();
-		Quaternion boidRotation_;
+		JobSystem *jobSystem_;
+		bool useThreading_ = true;
 
 		void initBoidSimulation(unsigned int);
 
-		void simulateBoids(float dt);
+		void updateParameters(float dt);
+
+		void simulateBoids();
+
+		void simulateBoid(const BoidState &in, BoidState &out, unsigned int i) const;
+
+		void accumulateNeighbors(
+				const BoidState &in,
+				const BoidData &boid,
+				Vec3f &avgPosition,
+				Vec3f &avgVelocity,
+				Vec3f &separation) const;
+
+		void updateGrid(float cellSize);
+
+		void updateNeighbors();
+
+		void collectNeighbors(unsigned int jobIndex, unsigned int begin, unsigned int end);
+
+		unsigned int numJobs() const;
+
+		void parallelFor(unsigned int numJobs, const std::function<void(unsigned int)> &job);
 
-		void simulateBoid(BoidData &boid, float dt);
+		Vec3f randomDirection(const BoidData &boid, unsigned int salt) const;
 
 		static Vec2f computeUV(const Vec3f &boidPosition, const Vec3f &mapCenter, const Vec2f &mapSize);
 
 		// simulation restrictions
-		void limitVelocity(BoidData &boid);
+		void limitVelocity(BoidData &boid) const;
 
-		void homesickness(BoidData &boid);
+		void homesickness(BoidData &boid) const;
 
-		bool avoidCollisions(BoidData &boid, float dt);
+		bool avoidCollisions(BoidData &boid) const;
 
-		bool avoidDanger(BoidData &boid);
+		bool avoidDanger(BoidData &boid) const;
 
-		void attract(BoidData &boid);
+		void attract(BoidData &boid) const;
 	};
 
 	std::ostream &operator<<(std::ostream &out, const BoidsSimulation_CPU::ObjectType &v);
@@ -29,6 +29,12 @@ Bones::Bones(GLuint numBoneWeights, GLuint numBones)
 	shaderDefine("NUM_BONES_PER_MESH", REGEN_STRING(numBones));
 }
 
+Bones::~Bones() {
+	for (auto &skeleton: skeletons_) {
+		skeleton->removeBoneTarget(boneMatrices_.get());
+	}
+}
+
 void Bones::setBones(const std::list<ref_ptr<AnimationNode> > &bones) {
 	GL_ERROR_LOG();
 	RenderState *rs = RenderState::get();
@@ -70,8 +76,21 @@ void Bones::setBones(const std::list<ref_ptr<AnimationNode> > &bones) {
 	glAnimate(rs, 0.0f);
 }
 
+void Bones::attachSkeleton(const ref_ptr<Skeleton> &skeleton,
+						   const std::list<ref_ptr<AnimationNode> > &bones,
+						   GLuint firstBone) {
+	if (boneMatrices_.get() == nullptr) {
+		REGEN_WARN("Bones must be set before attaching a skeleton.");
+		return;
+	}
+	skeleton->addBoneTarget(boneMatrices_, bones, firstBone);
+	skeletons_.push_back(skeleton);
+}
+
 void Bones::animate(GLdouble dt) {
 	if (bufferSize_ <= 0) return;
+	// the bone matrices are written by the skeletons
+	if (!skeletons_.empty()) return;
 	auto mapped = boneMatrices_->mapClientData<Mat4f>(ShaderData::WRITE);
 	auto *boneMatrixData_ = mapped.w;
 
@@ -28,11 +28,24 @@ namespace regen {
 		 */
 		Bones(GLuint numBoneWeights, GLuint numBones);
 
+		~Bones() override;
+
 		/**
 		 * @param bones  the bone list
 		 */
 		void setBones(const std::list<ref_ptr<AnimationNode> > &bones);
 
+		/**
+		 * Let a skeleton write the matrices of some of the bones directly
+		 * into the bone matrix buffer. Must be called after setBones().
+		 * @param skeleton the skeleton of the bones.
+		 * @param bones the bones, must be part of the skeleton.
+		 * @param firstBone index of the first bone in the bone list.
+		 */
+		void attachSkeleton(const ref_ptr<Skeleton> &skeleton,
+							const std::list<ref_ptr<AnimationNode> > &bones,
+							GLuint firstBone);
+
 		/**
 		 * @return maximum number of weights influencing a single bone.
 		 */
@@ -46,6 +59,7 @@ namespace regen {
 
 	protected:
 		std::list<ref_ptr<AnimationNode> > bones_;
+		std::vector<ref_ptr<Skeleton> > skeletons_;
 		ref_ptr<ShaderInput1i> numBoneWeights_;
 		GLuint bufferSize_;
 
@@ -0,0 +1,85 @@
+#ifndef REGEN_TICK_INTERPOLATION_H_
+#define REGEN_TICK_INTERPOLATION_H_
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace regen {
+	/**
+	 * \brief Receives a call after each step of the synchronized animations.
+	 * In fixed-timestep mode, a step is a fixed tick, and multiple ticks
+	 * may be made per frame to catch up with the real time.
+	 * Listeners use this to keep the state of the last two ticks, such that
+	 * the render thread can blend between them.
+	 */
+	class TickListener {
+	public:
+		virtual ~TickListener() = default;
+
+		/**
+		 * Called by the animation thread after each tick.
+		 */
+		virtual void onTick() = 0;
+	};
+
+	/**
+	 * \brief The values of the last two ticks.
+	 * Values are pushed by the animation thread, and blended by the render thread.
+	 */
+	template<typename T>
+	class TickSnapshot {
+	public:
+		/**
+		 * Push the values of the current tick, the values of the last tick
+		 * become the previous values.
+		 * @param values the values.
+		 * @param count the number of values.
+		 */
+		void push(const T *values, unsigned int count) {
+			std::lock_guard<std::mutex> lock(mutex_);
+			previous_.swap(current_);
+			current_.assign(values, values + count);
+			if (previous_.size() != current_.size()) {
+				// nothing to blend with
+				previous_ = current_;
+			}
+		}
+
+		/**
+		 * Set the values of the current and the previous tick.
+		 * @param values the values.
+		 * @param count the number of values.
+		 */
+		void reset(const T *values, unsigned int count) {
+			std::lock_guard<std::mutex> lock(mutex_);
+			current_.assign(values, values + count);
+			previous_ = current_;
+		}
+
+		/**
+		 * Blend between the previous and the current values.
+		 * @param alpha the blend factor, 0 for the previous and 1 for the current values.
+		 * @param out the blended values.
+		 * @param count the maximum number of values to blend.
+		 * @param blend the blend function, called with previous value, current value and alpha.
+		 * @return the number of blended values.
+		 */
+		template<typename BlendFunc>
+		unsigned int blend(double alpha, T *out, unsigned int count, const BlendFunc &blend) const {
+			std::lock_guard<std::mutex> lock(mutex_);
+			auto numValues = std::min(count, static_cast<unsigned int>(current_.size()));
+			for (unsigned int i = 0; i < numValues; ++i) {
+				out[i] = blend(previous_[i], current_[i], alpha);
+			}
+			return numValues;
+		}
+
+	protected:
+		mutable std::mutex mutex_;
+		std::vector<T> previous_;
+		std::vector<T> current_;
+	};
+} // namespace
+
+#endif /* REGEN_TICK_INTERPOLATION_H_ */
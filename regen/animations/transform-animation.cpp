@@ -6,6 +6,7 @@ using namespace regen;
 TransformAnimation::TransformAnimation(const ref_ptr<ShaderInputMat4> &in)
 		: Animation(false, true),
 		  in_(in) {
+	addWriteDependency(in_.get());
 	auto currentTransform = in_->getVertex(0);
 	it_ = frames_.end();
 	dt_ = 0.0;
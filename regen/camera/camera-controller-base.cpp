@@ -13,6 +13,8 @@ void CameraControllerBase::computeMatrices(const Vec3f &pos, const Vec3f &dir) {
 	viewInv_ = view_.lookAtInverse();
 	viewproj_ = view_ * cam_->projection()->getVertex(0).r;
 	viewprojInv_ = cam_->projectionInverse()->getVertex(0).r * viewInv_;
+	// note: the frustum follows the simulated pose, also if the pose is interpolated for rendering.
+	//       this way culling on the animation thread never reads a frustum that is being written.
 	cam_->frustum()[0].update(pos, dir);
 }
 
@@ -20,25 +22,31 @@ void CameraControllerBase::updateCamera(const Vec3f &pos, const Vec3f &dir, GLdo
 	velocity_ = (lastPosition_ - pos) / dt;
 	lastPosition_ = pos;
 
+	if (cam_->isInterpolated()) {
+		// the render thread blends the pose and updates the matrices
+		cam_->setSimulatedPose(pos, dir);
+		cam_->velocity()->setVertex(0, velocity_);
+	} else {
 #ifdef SYNCHRONIZE_WITH_UBO
-	// Make sure the UBO does not update its data while we are writing to it.
-	// this ensures GL always has consistent camera uniforms available.
-	// That a single uniform is not crumbled is already ensured by ShaderInput.
-	// Probably, this UBO lock is not necessary when changes in the camera are not super huge,
-	// and frame rate high. But needs more experiments to be certain....
-	auto ubo = cam_->cameraBlock()->ubo();
-	ubo->lock();
+		// Make sure the UBO does not update its data while we are writing to it.
+		// this ensures GL always has consistent camera uniforms available.
+		// That a single uniform is not crumbled is already ensured by ShaderInput.
+		// Probably, this UBO lock is not necessary when changes in the camera are not super huge,
+		// and frame rate high. But needs more experiments to be certain....
+		auto ubo = cam_->cameraBlock()->ubo();
+		ubo->lock();
 #endif
-	cam_->position()->setVertex(0, pos);
-	cam_->direction()->setVertex(0, dir);
-	cam_->velocity()->setVertex(0, velocity_);
-	cam_->view()->setVertex(0, view_);
-	cam_->viewInverse()->setVertex(0, viewInv_);
-	cam_->viewProjection()->setVertex(0, viewproj_);
-	cam_->viewProjectionInverse()->setVertex(0, viewprojInv_);
+		cam_->position()->setVertex(0, pos);
+		cam_->direction()->setVertex(0, dir);
+		cam_->velocity()->setVertex(0, velocity_);
+		cam_->view()->setVertex(0, view_);
+		cam_->viewInverse()->setVertex(0, viewInv_);
+		cam_->viewProjection()->setVertex(0, viewproj_);
+		cam_->viewProjectionInverse()->setVertex(0, viewprojInv_);
 #ifdef SYNCHRONIZE_WITH_UBO
-	ubo->unlock();
+		ubo->unlock();
 #endif
+	}
 
 	if (cam_->isAudioListener()) {
 		AudioListener::set3f(AL_POSITION, pos);
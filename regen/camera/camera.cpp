@@ -14,6 +14,7 @@
 #include "regen/application.h"
 #include "regen/meshes/mesh-vector.h"
 #include <regen/shapes/spatial-index.h>
+#include <regen/animations/animation-manager.h>
 
 using namespace regen;
 
@@ -97,6 +98,12 @@ Camera::Camera(unsigned int numLayer)
 	setInput(cameraBlock_);
 }
 
+Camera::~Camera() {
+	if (isInterpolated_) {
+		AnimationManager::get().removeTickListener(this);
+	}
+}
+
 void Camera::setPerspective(float aspect, float fov, float near, float far) {
 	bool hasLayeredProjection = proj_->numArrayElements() > 1;
 	if (hasLayeredProjection) {
@@ -197,9 +204,12 @@ void Camera::updateViewProjection(unsigned int projectionIndex, unsigned int vie
 						 view_->getVertex(viewIndex).r * proj_->getVertex(projectionIndex).r);
 	viewProjInv_->setVertex(maxIndex,
 							projInv_->getVertex(projectionIndex).r * viewInv_->getVertex(viewIndex).r);
-	frustum_[maxIndex].update(
-			position()->getVertexClamped(maxIndex).r,
-			direction()->getVertexClamped(maxIndex).r);
+	if (!isInterpolated_) {
+		// else the frustum follows the simulated pose on the animation thread
+		frustum_[maxIndex].update(
+				position()->getVertexClamped(maxIndex).r,
+				direction()->getVertexClamped(maxIndex).r);
+	}
 }
 
 void Camera::set_isAudioListener(GLboolean isAudioListener) {
@@ -237,6 +247,73 @@ void Camera::updatePose() {
 	}
 }
 
+void Camera::setInterpolated(bool isInterpolated) {
+	if (isInterpolated == isInterpolated_) return;
+	if (isInterpolated) {
+		setSimulatedPose(position_->getVertex(0).r, direction_->getVertex(0).r);
+		{
+			std::lock_guard<std::mutex> lock(simulatedPoseMut_);
+			poseTicks_.reset(&simulatedPose_, 1);
+		}
+		lastBlendFactor_ = -1.0;
+		isInterpolated_ = true;
+		AnimationManager::get().addTickListener(this);
+	} else {
+		AnimationManager::get().removeTickListener(this);
+		isInterpolated_ = false;
+	}
+}
+
+void Camera::setSimulatedPose(const Vec3f &position, const Vec3f &direction) {
+	std::lock_guard<std::mutex> lock(simulatedPoseMut_);
+	simulatedPose_.position = position;
+	simulatedPose_.direction = direction;
+}
+
+void Camera::onTick() {
+	std::lock_guard<std::mutex> lock(simulatedPoseMut_);
+	poseTicks_.push(&simulatedPose_, 1);
+}
+
+static Vec3f blendDirection(const Vec3f &a, const Vec3f &b, double alpha) {
+	if (a.dot(b) > 0.9999f) {
+		// math::slerp is not defined for (almost) equal directions
+		auto dir = math::lerp(a, b, alpha);
+		dir.normalize();
+		return dir;
+	}
+	return math::slerp(a, b, alpha);
+}
+
+void Camera::updateInterpolation() {
+	auto &animations = AnimationManager::get();
+	auto tickCount = animations.tickCount();
+	auto alpha = animations.interpolationFactor();
+	// the camera is enabled multiple times per frame, blend only once per frame
+	if (tickCount == lastBlendTick_ && alpha == lastBlendFactor_) return;
+	lastBlendTick_ = tickCount;
+	lastBlendFactor_ = alpha;
+
+	Pose pose;
+	auto numBlended = poseTicks_.blend(alpha, &pose, 1, [](const Pose &a, const Pose &b, double alpha) {
+		return Pose{
+				math::lerp(a.position, b.position, alpha),
+				blendDirection(a.direction, b.direction, alpha)};
+	});
+	if (numBlended > 0) {
+		position_->setVertex(0, pose.position);
+		direction_->setVertex(0, pose.direction);
+		updateCamera();
+	}
+}
+
+void Camera::enable(RenderState *rs) {
+	if (isInterpolated_) {
+		updateInterpolation();
+	}
+	HasInputState::enable(rs);
+}
+
 void Camera::attachToPosition(const ref_ptr<ShaderInput3f> &attachedPosition) {
 	attachedPosition_ = attachedPosition;
 	attachedTransform_ = {};
@@ -559,6 +636,7 @@ ref_ptr<Camera> Camera::createCamera(LoadingContext &ctx, scene::SceneInputNode
 		auto dir = input.getValue<Vec3f>("direction", Vec3f(0.0f, 0.0f, 1.0f));
 		dir.normalize();
 		cam->direction()->setVertex(0, dir);
+		cam->setInterpolated(input.getValue<bool>("interpolate", false));
 
 		if (camType == "ortho" || camType == "orthographic" || camType == "orthogonal") {
 			auto width = input.getValue<GLfloat>("width", 10.0f);
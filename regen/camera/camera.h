@@ -16,12 +16,13 @@
 #include <regen/states/model-transformation.h>
 #include <regen/gl-types/shader-input-container.h>
 #include "regen/gl-types/uniform-block.h"
+#include "regen/animations/tick-interpolation.h"
 
 namespace regen {
 	/**
 	 * \brief Camera with projection and view matrix.
 	 */
-	class Camera : public HasInputState {
+	class Camera : public HasInputState, public TickListener {
 	public:
 		static constexpr const char *TYPE_NAME = "Camera";
 
@@ -31,6 +32,8 @@ namespace regen {
 		 */
 		explicit Camera(unsigned int numLayer);
 
+		~Camera() override;
+
 		static ref_ptr<Camera> load(LoadingContext &ctx, scene::SceneInputNode &input);
 
 		static ref_ptr<Camera> createCamera(LoadingContext &ctx, scene::SceneInputNode &input);
@@ -267,6 +270,35 @@ namespace regen {
 		 */
 		void updatePose();
 
+		/**
+		 * Blend the camera pose between the last two animation ticks on the render thread.
+		 * Camera controllers then set the pose with setSimulatedPose() instead of
+		 * writing to the camera uniforms.
+		 * Only the camera uniforms are blended, the frustum follows the simulated pose
+		 * and is updated by the camera controller on the animation thread.
+		 * @param isInterpolated true to enable interpolation.
+		 */
+		void setInterpolated(bool isInterpolated);
+
+		/**
+		 * @return true if the camera pose is interpolated.
+		 */
+		bool isInterpolated() const { return isInterpolated_; }
+
+		/**
+		 * Set the pose of the camera computed by an animation.
+		 * The pose is applied to the camera uniforms when the camera is enabled.
+		 * @param position the camera position.
+		 * @param direction the camera direction.
+		 */
+		void setSimulatedPose(const Vec3f &position, const Vec3f &direction);
+
+		// Override
+		void enable(RenderState *rs) override;
+
+		// Override
+		void onTick() override;
+
 	protected:
 		unsigned int numLayer_ = 1;
 		bool isOmni_ = false;
@@ -297,6 +329,19 @@ namespace regen {
 		ref_ptr<ShaderInputMat4> attachedTransform_;
 		ref_ptr<ShaderInput3f> attachedPosition_;
 		bool isAttachedToPosition_ = false;
+
+		struct Pose {
+			Vec3f position;
+			Vec3f direction;
+		};
+		bool isInterpolated_ = false;
+		Pose simulatedPose_;
+		std::mutex simulatedPoseMut_;
+		TickSnapshot<Pose> poseTicks_;
+		unsigned int lastBlendTick_ = 0u;
+		double lastBlendFactor_ = -1.0;
+
+		void updateInterpolation();
 		ref_ptr<Animation> cameraMotion_;
 
 		virtual bool updateView();
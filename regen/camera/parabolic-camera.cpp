@@ -50,7 +50,9 @@ void ParabolicCamera::setNormal(const Vec3f &normal) {
 void ParabolicCamera::updateViewProjection(unsigned int projectionIndex, unsigned int viewIndex) {
 	viewProj_->setVertex(viewIndex, view_->getVertex(viewIndex).r);
 	viewProjInv_->setVertex(viewIndex, viewInv_->getVertex(viewIndex).r);
-	frustum_[viewIndex].update(
-		position()->getVertex(0).r,
-		direction()->getVertex(viewIndex).r);
+	if (!isInterpolated_) {
+		frustum_[viewIndex].update(
+			position()->getVertex(0).r,
+			direction()->getVertex(viewIndex).r);
+	}
 }
@@ -0,0 +1,91 @@
+#include <algorithm>
+
+#include "dirty-ranges.h"
+
+using namespace regen;
+
+void DirtyRanges::add(unsigned int begin, unsigned int end) {
+	if (isFull_ || begin >= end) return;
+	// find the first range that does not end before the new range begins
+	auto it = std::lower_bound(ranges_.begin(), ranges_.end(), begin,
+							   [this](const Range &r, unsigned int x) { return r.end + mergeGap_ < x; });
+	if (it == ranges_.end() || end + mergeGap_ < it->begin) {
+		ranges_.insert(it, Range{begin, end});
+	} else {
+		// merge with all ranges that overlap the new range
+		it->begin = std::min(it->begin, begin);
+		auto last = it + 1;
+		while (last != ranges_.end() && last->begin <= end + mergeGap_) {
+			end = std::max(end, last->end);
+			++last;
+		}
+		it->end = std::max(it->end, end);
+		ranges_.erase(it + 1, last);
+	}
+	while (ranges_.size() > MAX_RANGES) {
+		// merge the two closest ranges
+		auto closest = ranges_.begin();
+		for (auto r = ranges_.begin() + 1; r + 1 != ranges_.end(); ++r) {
+			if ((r + 1)->begin - r->end < (closest + 1)->begin - closest->end) {
+				closest = r;
+			}
+		}
+		closest->end = (closest + 1)->end;
+		ranges_.erase(closest + 1);
+	}
+}
+
+void DirtyRanges::addAll() {
+	isFull_ = true;
+	ranges_.clear();
+}
+
+void DirtyRanges::clear() {
+	isFull_ = false;
+	ranges_.clear();
+}
+
+unsigned int DirtyRanges::numBytes(unsigned int dataSize) const {
+	if (isFull_) return dataSize;
+	unsigned int numBytes = 0u;
+	for (auto &r: ranges_) {
+		if (r.begin >= dataSize) break;
+		numBytes += std::min(r.end, dataSize) - r.begin;
+	}
+	return numBytes;
+}
+
+bool DirtyRanges::isPartial(unsigned int dataSize, float threshold) const {
+	if (isFull_ || ranges_.empty()) return false;
+	return static_cast<float>(numBytes(dataSize)) <= threshold * static_cast<float>(dataSize);
+}
+
+void DirtyRangeLog::push(unsigned int stamp, unsigned int begin, unsigned int end) {
+	entries_[nextEntry_] = Entry{stamp, DirtyRanges::Range{begin, end}};
+	nextEntry_ = (nextEntry_ + 1) % LOG_SIZE;
+	numEntries_ = std::min(numEntries_ + 1, LOG_SIZE);
+}
+
+bool DirtyRangeLog::collect(unsigned int fromStamp, unsigned int toStamp, DirtyRanges &ranges) const {
+	// note: unsigned arithmetic, such that stamps may wrap around
+	unsigned int numWrites = toStamp - fromStamp;
+	if (numWrites == 0) return true;
+	if (numWrites > numEntries_) {
+		ranges.addAll();
+		return false;
+	}
+	unsigned int numFound = 0;
+	for (unsigned int i = 0; i < numEntries_; ++i) {
+		auto &entry = entries_[i];
+		if (entry.stamp - fromStamp - 1u < numWrites) {
+			ranges.add(entry.range.begin, entry.range.end);
+			numFound += 1;
+		}
+	}
+	if (numFound != numWrites) {
+		// some writes were not logged, or are not in the log anymore
+		ranges.addAll();
+		return false;
+	}
+	return true;
+}
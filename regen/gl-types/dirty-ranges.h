@@ -0,0 +1,133 @@
+#ifndef REGEN_DIRTY_RANGES_H_
+#define REGEN_DIRTY_RANGES_H_
+
+#include <array>
+#include <vector>
+
+namespace regen {
+	/**
+	 * \brief A set of modified byte ranges of client data.
+	 * Overlapping and close ranges are coalesced, and the number of ranges is bounded
+	 * such that the ranges can be uploaded with a few calls.
+	 */
+	class DirtyRanges {
+	public:
+		/**
+		 * \brief A range of bytes [begin, end).
+		 */
+		struct Range {
+			/** the first byte of the range. */
+			unsigned int begin;
+			/** the byte after the last byte of the range. */
+			unsigned int end;
+		};
+		/**
+		 * The maximum number of ranges, the closest ranges are merged beyond.
+		 */
+		static constexpr unsigned int MAX_RANGES = 16;
+
+		/**
+		 * @param mergeGap ranges with at most this many bytes in between are merged.
+		 */
+		explicit DirtyRanges(unsigned int mergeGap = 0u) : mergeGap_(mergeGap) {}
+
+		/**
+		 * Add a modified range.
+		 * @param begin the first byte of the range.
+		 * @param end the byte after the last byte of the range.
+		 */
+		void add(unsigned int begin, unsigned int end);
+
+		/**
+		 * Mark all data as modified.
+		 */
+		void addAll();
+
+		/**
+		 * Remove all ranges.
+		 */
+		void clear();
+
+		/**
+		 * @return true if no data was modified.
+		 */
+		bool empty() const { return !isFull_ && ranges_.empty(); }
+
+		/**
+		 * @return true if all data was modified.
+		 */
+		bool isFull() const { return isFull_; }
+
+		/**
+		 * @return the ranges sorted by offset, empty if all data was modified.
+		 */
+		const std::vector<Range> &ranges() const { return ranges_; }
+
+		/**
+		 * @param dataSize the size of the data in bytes.
+		 * @return the number of modified bytes.
+		 */
+		unsigned int numBytes(unsigned int dataSize) const;
+
+		/**
+		 * @param dataSize the size of the data in bytes.
+		 * @param threshold the maximum fraction of the data that is uploaded partially.
+		 * @return true if only the ranges should be uploaded, else all data should be uploaded.
+		 */
+		bool isPartial(unsigned int dataSize, float threshold) const;
+
+	protected:
+		std::vector<Range> ranges_;
+		unsigned int mergeGap_;
+		bool isFull_ = false;
+	};
+
+	/**
+	 * \brief A log of the byte ranges modified by the most recent writes of client data.
+	 * Each write is identified by the data stamp it has produced.
+	 * Readers of the data remember the stamp of their last upload,
+	 * and use the log to find the ranges modified since then.
+	 * Note that the log is not thread-safe.
+	 */
+	class DirtyRangeLog {
+	public:
+		/**
+		 * The number of writes that are remembered.
+		 */
+		static constexpr unsigned int LOG_SIZE = 32;
+
+		/**
+		 * Remember the range modified by a write.
+		 * @param stamp the stamp of the write.
+		 * @param begin the first byte of the range.
+		 * @param end the byte after the last byte of the range.
+		 */
+		void push(unsigned int stamp, unsigned int begin, unsigned int end);
+
+		/**
+		 * Collect the ranges modified by the writes with a stamp in (fromStamp, toStamp].
+		 * If one of the writes is not in the log anymore, all data is marked as modified.
+		 * @param fromStamp the stamp of the last upload.
+		 * @param toStamp the current stamp.
+		 * @param ranges the collected ranges, not cleared before.
+		 * @return false if all data was marked as modified because writes are missing in the log.
+		 */
+		bool collect(unsigned int fromStamp, unsigned int toStamp, DirtyRanges &ranges) const;
+
+		/**
+		 * Forget all writes.
+		 */
+		void clear() { numEntries_ = 0; }
+
+	protected:
+		struct Entry {
+			unsigned int stamp;
+			DirtyRanges::Range range;
+		};
+		std::array<Entry, LOG_SIZE> entries_;
+		unsigned int nextEntry_ = 0;
+		unsigned int numEntries_ = 0;
+	};
+} // namespace
+
+#endif /* REGEN_DIRTY_RANGES_H_ */
@@ -1,12 +1,17 @@
+#include <algorithm>
+#include <functional>
+#include <thread>
+
 #include "shader-data.h"
 #include "shader-input.h"
+#include <regen/utility/string-util.h>
 
 using namespace regen;
 
 ShaderDataRaw_rw::ShaderDataRaw_rw(ShaderInput *input, int mapMode) :
 	input(input), mapMode(mapMode) {
 	if (input) {
-		auto mapped = input->mapClientData(mapMode);
+		auto mapped = input->mapClientData(mapMode, localData);
 		r = mapped.r;
 		w = mapped.w;
 		r_index = mapped.r_index;
@@ -20,8 +25,10 @@ ShaderDataRaw_rw::ShaderDataRaw_rw(ShaderInput *input, int mapMode) :
 }
 
 ShaderDataRaw_rw::~ShaderDataRaw_rw() {
-	if (w_index >= 0) {
-		input->unmapClientData(ShaderData::WRITE, w_index);
+	if (w_index == ShaderInput::LOCK_FREE_SLOT) {
+		input->writeLockFreeEnd(w);
+	} else if (w_index >= 0) {
+		unmapWrite();
 	}
 	if (r_index >= 0 && r_index != w_index) {
 		input->unmapClientData(ShaderData::READ, r_index);
@@ -29,8 +36,11 @@ ShaderDataRaw_rw::~ShaderDataRaw_rw() {
 }
 
 void ShaderDataRaw_rw::unmap() {
-	if (w_index >= 0) {
-		input->unmapClientData(ShaderData::WRITE, w_index);
+	if (w_index == ShaderInput::LOCK_FREE_SLOT) {
+		input->writeLockFreeEnd(w);
+		w_index = -1;
+	} else if (w_index >= 0) {
+		unmapWrite();
 		w_index = -1;
 	}
 	if (r_index >= 0 && r_index != w_index) {
@@ -40,10 +50,39 @@ void ShaderDataRaw_rw::unmap() {
 }
 
 
+void ShaderDataRaw_rw::unmapWrite() {
+	if ((mapMode & ShaderData::INDEX) != 0 && dirtyBegin < dirtyEnd) {
+		input->unmapClientData(ShaderData::WRITE, w_index, dirtyBegin, dirtyEnd);
+	} else {
+		// the full data is considered as written
+		input->unmapClientData(ShaderData::WRITE, w_index);
+	}
+}
+
+void ShaderDataRaw_rw::discard() {
+	if (w_index >= 0) {
+		input->discardClientWrite(w_index);
+		w_index = -1;
+	}
+	if (r_index >= 0) {
+		input->unmapClientData(ShaderData::READ, r_index);
+		r_index = -1;
+	}
+}
+
+void ShaderDataRaw_rw::markDirty(unsigned int offset, unsigned int size) {
+	if (dirtyBegin < dirtyEnd) {
+		dirtyBegin = std::min(dirtyBegin, offset);
+		dirtyEnd = std::max(dirtyEnd, offset + size);
+	} else {
+		dirtyBegin = offset;
+		dirtyEnd = offset + size;
+	}
+}
 
 ShaderDataRaw_ro::ShaderDataRaw_ro(const ShaderInput *input, int mapMode) :
 	input(input), mapMode(mapMode) {
-	auto mapped = input->mapClientData(mapMode);
+	auto mapped = input->mapClientData(mapMode, localData);
 	r = mapped.r;
 	r_index = mapped.r_index;
 }
@@ -60,3 +99,115 @@ void ShaderDataRaw_ro::unmap() {
 		r_index = -1;
 	}
 }
+
+
+ShaderDataBorrow::ShaderDataBorrow(ShaderInput *input, const byte *data) :
+	input(input) {
+	original = input->beginBorrow(data, localData, slotIndex);
+}
+
+ShaderDataBorrow::~ShaderDataBorrow() {
+	restore();
+}
+
+void ShaderDataBorrow::restore() {
+	if (slotIndex >= 0) {
+		input->endBorrow(slotIndex, original);
+		slotIndex = -1;
+	}
+}
+
+ShaderDataGroup::ShaderDataGroup(std::initializer_list<Entry> entries) {
+	if (entries.size() > MAX_INPUTS) {
+		throw Error(REGEN_STRING("A group can map at most " << MAX_INPUTS <<
+				" inputs, but " << entries.size() << " were given."));
+	}
+	for (auto &entry: entries) {
+		// an input mapped twice could wait for its own lock
+		for (unsigned int i = 0; i < numEntries_ && entry.input; ++i) {
+			if (entries_[i].input == entry.input) {
+				throw Error(REGEN_STRING("Input '" << entry.input->name() << "' appears twice in a group."));
+			}
+		}
+		entries_[numEntries_] = entry;
+		order_[numEntries_] = numEntries_;
+		hasWrites_ = hasWrites_ || (entry.input && (entry.mapMode & ShaderData::WRITE) != 0);
+		numEntries_ += 1;
+	}
+	// a fixed global order avoids deadlocks between groups, the address of the input is used.
+	std::sort(order_.begin(), order_.begin() + numEntries_, [this](unsigned int a, unsigned int b) {
+		return std::less<const ShaderInput *>()(entries_[a].input, entries_[b].input);
+	});
+	map();
+}
+
+ShaderDataGroup::~ShaderDataGroup() {
+	unmap();
+}
+
+void ShaderDataGroup::map() {
+	std::array<unsigned int, MAX_INPUTS> versions{};
+	while (true) {
+		// wait until no group commit of the inputs is in progress
+		bool isCommitting = false;
+		for (unsigned int i = 0; i < numEntries_; ++i) {
+			auto *in = entries_[i].input;
+			if (!in) continue;
+			versions[i] = in->groupVersion_.load();
+			isCommitting = isCommitting || (in->groupCommits_.load() != 0);
+		}
+		if (isCommitting) {
+			std::this_thread::yield();
+			continue;
+		}
+		for (unsigned int j = 0; j < numEntries_; ++j) {
+			auto i = order_[j];
+			if (!entries_[i].input) continue;
+			mappings_[i].emplace(const_cast<ShaderInput *>(entries_[i].input), entries_[i].mapMode);
+		}
+		// the mapping is consistent if no group commit has happened in the meantime
+		bool isConsistent = true;
+		for (unsigned int i = 0; i < numEntries_; ++i) {
+			auto *in = entries_[i].input;
+			if (!in) continue;
+			isConsistent = isConsistent &&
+					in->groupCommits_.load() == 0 &&
+					in->groupVersion_.load() == versions[i];
+		}
+		if (isConsistent) return;
+		// release in reverse order, writes are not committed
+		for (unsigned int j = numEntries_; j > 0; --j) {
+			auto i = order_[j - 1];
+			if (!mappings_[i].has_value()) continue;
+			mappings_[i]->discard();
+			mappings_[i].reset();
+		}
+		std::this_thread::yield();
+	}
+}
+
+void ShaderDataGroup::unmap() {
+	if (numEntries_ == 0) return;
+	if (hasWrites_) {
+		// mark the commit as in progress, such that groups do not map a partial commit
+		for (unsigned int i = 0; i < numEntries_; ++i) {
+			auto *in = entries_[i].input;
+			if (in && (entries_[i].mapMode & ShaderData::WRITE) != 0) {
+				in->groupCommits_.fetch_add(1);
+			}
+		}
+	}
+	for (unsigned int j = numEntries_; j > 0; --j) {
+		mappings_[order_[j - 1]].reset();
+	}
+	if (hasWrites_) {
+		for (unsigned int i = 0; i < numEntries_; ++i) {
+			auto *in = entries_[i].input;
+			if (in && (entries_[i].mapMode & ShaderData::WRITE) != 0) {
+				in->groupVersion_.fetch_add(1);
+				in->groupCommits_.fetch_sub(1);
+			}
+		}
+	}
+	numEntries_ = 0;
+}
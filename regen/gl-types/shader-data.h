@@ -2,6 +2,13 @@
 #ifndef SHADER_INPUT_DATA_H_
 #define SHADER_INPUT_DATA_H_
 
+#include <array>
+#include <optional>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <cassert>
+
 namespace regen::ShaderData {
 	/**
 	 * Flags for client data read/write access.
@@ -12,6 +19,12 @@ namespace regen::ShaderData {
 		// indicates that only a single vertex is mapped
 		INDEX = 1 << 2
 	};
+
+	/**
+	 * Client data up to this size in bytes is accessed without locks.
+	 * The mapping copies the data, so it fits a single 4x4 matrix.
+	 */
+	static constexpr unsigned int MAX_LOCK_FREE_SIZE = 64;
 }
 
 namespace regen {
@@ -43,6 +56,15 @@ namespace regen {
 		 */
 		void unmap();
 
+		/**
+		 * Mark a range of the data as written, such that only the written ranges are uploaded.
+		 * Only used for mappings with the INDEX flag, else all data is considered as written.
+		 * If not called, all data is considered as written.
+		 * @param offset the offset of the range in bytes.
+		 * @param size the size of the range in bytes.
+		 */
+		void markDirty(unsigned int offset, unsigned int size);
+
 		/**
 		 * The mapped data for reading.
 		 */
@@ -56,6 +78,18 @@ namespace regen {
 		int r_index;
 		int w_index;
 		const int mapMode;
+		// bounds of the written bytes, empty if not marked
+		unsigned int dirtyBegin = 0u;
+		unsigned int dirtyEnd = 0u;
+
+		void unmapWrite();
+
+		// release the mapping without committing the writes
+		void discard();
+
+		friend class ShaderDataGroup;
+		// copy of small client data, see ShaderData::MAX_LOCK_FREE_SIZE
+		alignas(16) byte localData[ShaderData::MAX_LOCK_FREE_SIZE];
 
 		friend class ShaderInput;
 	};
@@ -90,6 +124,8 @@ namespace regen {
 		const ShaderInput *input;
 		int r_index;
 		const int mapMode;
+		// copy of small client data, see ShaderData::MAX_LOCK_FREE_SIZE
+		alignas(16) byte localData[ShaderData::MAX_LOCK_FREE_SIZE];
 
 		friend class ShaderInput;
 	};
@@ -119,6 +155,15 @@ namespace regen {
 		 */
 		void unmap() { rawData.unmap(); }
 
+		/**
+		 * Mark elements as written, see ShaderDataRaw_rw::markDirty.
+		 * @param index the index of the first element.
+		 * @param count the number of elements.
+		 */
+		void markDirty(unsigned int index, unsigned int count = 1u) {
+			rawData.markDirty(index * sizeof(T), count * sizeof(T));
+		}
+
 		/**
 		 * Create a null data object.
 		 * @return a null data object.
@@ -193,6 +238,7 @@ namespace regen {
 				: rawData(input, mapMode | ShaderData::INDEX),
 				  r(((const T *) rawData.r)[vertexIndex]),
 				  w(((T *) rawData.w)[vertexIndex]) {
+			rawData.markDirty(vertexIndex * sizeof(T), sizeof(T));
 		}
 
 		// do not allow copying
@@ -254,6 +300,126 @@ namespace regen {
 		friend class ShaderInput;
 	};
 
+	/**
+	 * Temporarily uses a caller-owned buffer as the client data of shader input,
+	 * without copying it. The original data is restored when the borrow ends.
+	 * While borrowed, readers read from the buffer, and writers wait
+	 * until the borrow ends. This includes writers of lock-free data, and resizes of the data. The buffer must have at least inputSize() bytes,
+	 * and must stay valid until the borrow ends.
+	 * The borrowing thread must not hold a mapping of the input when the borrow begins or ends.
+	 */
+	struct ShaderDataBorrow {
+		/**
+		 * Default constructor.
+		 * @param input the shader input.
+		 * @param data the borrowed data.
+		 */
+		ShaderDataBorrow(ShaderInput *input, const byte *data);
+
+		~ShaderDataBorrow();
+
+		// do not allow copying
+		ShaderDataBorrow(const ShaderDataBorrow &) = delete;
+
+		/**
+		 * Restore the original data. Do not use the input with the borrowed data after calling this method.
+		 */
+		void restore();
+
+	private:
+		ShaderInput *input;
+		byte *original;
+		int slotIndex;
+		// copy of small client data, see ShaderData::MAX_LOCK_FREE_SIZE
+		alignas(16) byte localData[ShaderData::MAX_LOCK_FREE_SIZE];
+
+		friend class ShaderInput;
+	};
+
+	/**
+	 * \brief Maps the client data of multiple shader inputs at once.
+	 * The inputs are mapped in a fixed global order, such that groups of the same inputs
+	 * cannot deadlock each other. The writes of a group are committed together when it is unmapped,
+	 * and a group only maps data in between group commits of its inputs.
+	 * Hence, inputs that are only written with groups are consistent with each other in a group.
+	 * Each input must appear at most once in a group, null inputs are not mapped.
+	 */
+	class ShaderDataGroup {
+	public:
+		/**
+		 * The maximum number of inputs in a group.
+		 */
+		static constexpr unsigned int MAX_INPUTS = 8;
+
+		/**
+		 * \brief The inputs of a group are invalid.
+		 */
+		class Error : public std::runtime_error {
+		public:
+			/**
+			 * @param msg the error message.
+			 */
+			explicit Error(const std::string &msg) : std::runtime_error(msg) {}
+		};
+
+		/**
+		 * \brief An input of the group.
+		 */
+		struct Entry {
+			/** the shader input, may be null. */
+			const ShaderInput *input;
+			/** the mapping mode, i.e. a bitwise combination of MappingMode flags. */
+			int mapMode;
+		};
+
+		/**
+		 * Default constructor.
+		 * Inputs with the WRITE flag must not be const.
+		 * Throws an Error if there are more than MAX_INPUTS entries, or if an input appears twice.
+		 * @param entries the inputs, at most MAX_INPUTS.
+		 */
+		ShaderDataGroup(std::initializer_list<Entry> entries);
+
+		~ShaderDataGroup();
+
+		// do not allow copying
+		ShaderDataGroup(const ShaderDataGroup &) = delete;
+
+		/**
+		 * Unmap the data of all inputs, and commit the writes.
+		 * Do not read or write after calling this method.
+		 */
+		void unmap();
+
+		/**
+		 * @param i the index of the input in the group.
+		 * @return the mapped data for reading, null if the input is null.
+		 */
+		template<typename T> const T *r(unsigned int i) const {
+			assert(i < numEntries_);
+			return mappings_[i].has_value() ? reinterpret_cast<const T *>(mappings_[i]->r) : nullptr;
+		}
+
+		/**
+		 * @param i the index of the input in the group.
+		 * @return the mapped data for writing, null if the input is null or not mapped for writing.
+		 */
+		template<typename T> T *w(unsigned int i) const {
+			assert(i < numEntries_);
+			return mappings_[i].has_value() ? reinterpret_cast<T *>(mappings_[i]->w) : nullptr;
+		}
+
+	private:
+		std::array<std::optional<ShaderDataRaw_rw>, MAX_INPUTS> mappings_;
+		std::array<Entry, MAX_INPUTS> entries_;
+		// indices of the entries in the global mapping order
+		std::array<unsigned int, MAX_INPUTS> order_;
+		unsigned int numEntries_ = 0;
+		bool hasWrites_ = false;
+
+		void map();
+	};
+
 	/**
 	 * A low-level interface for read/write access to client data of shader input.
 	 */
@@ -9,6 +9,7 @@
 #include <regen/utility/logging.h>
 #include <regen/animations/animation.h>
 #include <stack>
+#include <thread>
 
 #include "shader-input.h"
 #include "uniform-block.h"
@@ -87,10 +88,14 @@ ShaderInput::ShaderInput(const ShaderInput &o)
 		  active_(o.active_) {
 	enableAttribute_ = &ShaderInput::enableAttributef;
 	enableUniform_ = o.enableUniform_;
+	allowLockFree_ = o.allowLockFree_;
+	partialUploadThreshold_ = o.partialUploadThreshold_;
 	// copy client data, if any
 	if (o.hasClientData()) {
-		dataSlots_[0] = new byte[inputSize_];
-		auto mapped = o.mapClientData(ShaderData::READ);
+		slotSize_ = inputSize_;
+		arenaTag_ = AlignedArena::currentTag();
+		dataSlots_[0] = allocateSlot();
+		auto mapped = o.mapClientDataRaw(ShaderData::READ);
 		std::memcpy(dataSlots_[0], mapped.r, inputSize_);
 	}
 }
@@ -113,7 +118,7 @@ void ShaderInput::set_numArrayElements(GLsizei v) {
 }
 
 unsigned int ShaderInput::stamp() const {
-	return dataStamp_.load(std::memory_order_relaxed);
+	return dataStamp_.load(std::memory_order_acquire);
 }
 
 int ShaderInput::lastDataSlot() const {
@@ -128,8 +133,9 @@ void ShaderInput::set_buffer(GLuint buffer, const VBOReference &it) {
 
 void ShaderInput::enableAttribute(GLint loc) const {
 	if (requiresReUpload_) {
-		writeServerData();
+		// reset the flag first, such that writes during the upload are not missed
 		requiresReUpload_ = false;
+		writeServerData();
 	}
 	(this->*(this->enableAttribute_))(loc);
 }
@@ -213,7 +219,8 @@ void ShaderInput::readUnlock(int dataSlot) const {
 	slotLock.writerQ.notify_one();
 }
 
-void ShaderInput::writeUnlock(int dataSlot, bool hasDataChanged) const {
+void ShaderInput::writeUnlock(int dataSlot, bool hasDataChanged,
+		unsigned int dirtyBegin, unsigned int dirtyEnd) const {
 	auto &slotLock = slotLocks_[dataSlot];
 	std::unique_lock<std::mutex> lk(slotLock.lock);
 	--slotLock.waitingWriters;
@@ -227,8 +234,12 @@ void ShaderInput::writeUnlock(int dataSlot, bool hasDataChanged) const {
 		// consecutive reads will be done from this slot, next write will be done to the other slot.
 		// If the write operation did not change the data, the stamp is not incremented,
 		// and the last slot is not updated.
-		dataStamp_.fetch_add(1, std::memory_order_relaxed);
+		// NOTE: the slot is switched before the stamp is incremented, such that
+		//       a reader that has seen the new stamp also reads the new data.
 		lastDataSlot_.exchange(dataSlot, std::memory_order_relaxed);
+		std::lock_guard<std::mutex> dirtyLock(dirtyLock_);
+		auto stamp = dataStamp_.fetch_add(1, std::memory_order_release) + 1;
+		dirtyLog_.push(stamp, dirtyBegin, std::min(dirtyEnd, inputSize_));
 		if (hasServerData()) {
 			requiresReUpload_ = true;
 		}
@@ -244,6 +255,15 @@ void ShaderInput::writeUnlock(int dataSlot, bool hasDataChanged) const {
 }
 
 void ShaderInput::writeLockAll() const {
+	// note: the data cannot be reallocated while it is borrowed
+	beginClientWrite();
+	lockFreeWriteLock_.lock();
+	// note: sequentially consistent, such that either lock-free readers see the odd sequence,
+	//       or the reader count is seen here. The data may be reallocated once no reader copies it anymore.
+	lockFreeSeq_.fetch_add(1);
+	while (numLockFreeReaders_.load() != 0) {
+		std::this_thread::yield();
+	}
 	writeLock(1);
 	writeLock(0);
 }
@@ -251,6 +271,9 @@ void ShaderInput::writeLockAll() const {
 void ShaderInput::writeUnlockAll(bool hasDataChanged) const {
 	writeUnlock(1, false);
 	writeUnlock(0, hasDataChanged);
+	lockFreeSeq_.fetch_add(1, std::memory_order_release);
+	lockFreeWriteLock_.unlock();
+	endClientWrite();
 }
 
 void ShaderInput::allocateSecondSlot() const {
@@ -259,7 +282,7 @@ void ShaderInput::allocateSecondSlot() const {
 	// need to lock the slot 1 for the memcpy below, to avoid that any mapping happens in between.
 	std::unique_lock<std::mutex> lk(slotLocks_[1].lock);
 	if (dataSlots_[1] == nullptr) {
-		auto data_w = new byte[inputSize_];
+		auto data_w = allocateSlot();
 		std::memcpy(data_w, data_r, inputSize_);
 		dataSlots_[1] = data_w;
 	}
@@ -267,10 +290,85 @@ void ShaderInput::allocateSecondSlot() const {
 	readUnlock(0);
 }
 
-MappedData ShaderInput::mapClientData(int mapMode) const {
-	int r_index = lastDataSlot();
+bool ShaderInput::readLockFree(byte *localData) const {
+	// seqlock read: copy the data, and retry if a write was committed in the meantime.
+	while (true) {
+		// the reader is counted while the sequence is even, so the data cannot be reallocated
+		// until it is done copying, see writeLockAll.
+		numLockFreeReaders_.fetch_add(1);
+		auto seq0 = lockFreeSeq_.load();
+		if ((seq0 & 1u) != 0) {
+			// a write is committed right now, it only copies a few bytes.
+			numLockFreeReaders_.fetch_sub(1, std::memory_order_release);
+			std::this_thread::yield();
+			continue;
+		}
+		if (!isLockFree() || !hasClientData()) {
+			// the data was resized since the caller has checked isLockFree()
+			numLockFreeReaders_.fetch_sub(1, std::memory_order_release);
+			return false;
+		}
+		std::memcpy(localData, dataSlots_[0], inputSize_);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		bool isConsistent = (lockFreeSeq_.load(std::memory_order_relaxed) == seq0);
+		numLockFreeReaders_.fetch_sub(1, std::memory_order_release);
+		if (isConsistent) {
+			return true;
+		}
+	}
+}
+
+byte *ShaderInput::writeLockFreeBegin(byte *localData) const {
+	// writers are serialized, but they do not wait for readers.
+	// only writers modify the data, so it can be copied without checking the sequence.
+	beginClientWrite();
+	lockFreeWriteLock_.lock();
+	if (!isLockFree() || !hasClientData()) {
+		// the data was resized since the caller has checked isLockFree()
+		lockFreeWriteLock_.unlock();
+		endClientWrite();
+		return nullptr;
+	}
+	std::memcpy(localData, dataSlots_[0], inputSize_);
+	return localData;
+}
+
+void ShaderInput::writeLockFreeEnd(const byte *localData) const {
+	commitLockFree(localData);
+	lockFreeWriteLock_.unlock();
+	endClientWrite();
+}
+
+void ShaderInput::commitLockFree(const byte *localData) const {
+	auto seq = lockFreeSeq_.load(std::memory_order_relaxed);
+	lockFreeSeq_.store(seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	std::memcpy(dataSlots_[0], localData, inputSize_);
+	lockFreeSeq_.store(seq + 2, std::memory_order_release);
+	dataStamp_.fetch_add(1, std::memory_order_relaxed);
+	if (hasServerData()) {
+		requiresReUpload_ = true;
+	}
+}
+
+MappedData ShaderInput::mapClientData(int mapMode, byte *localData) const {
+	if (isLockFree() && hasClientData()) {
+		// small data is copied into the mapping, see readLockFree
+		if ((mapMode & ShaderData::WRITE) != 0) {
+			auto data = writeLockFreeBegin(localData);
+			if (data) {
+				return {data, -1, data, LOCK_FREE_SLOT};
+			}
+		} else if (readLockFree(localData)) {
+			return {localData, -1};
+		}
+		// else the data was resized in the meantime, and it is mapped with slot locks below.
+	}
+	int r_index;
 
 	if ((mapMode & ShaderData::WRITE) != 0) {
+		beginClientWrite();
+		r_index = lastDataSlot();
 		// NOTE: assuming we can only have two slots, which makes sense IMO, then
 		// if read slot=0, then write slot=1, else write slot=0
 		int w_index = (int) (r_index == 0);
@@ -338,6 +436,7 @@ MappedData ShaderInput::mapClientData(int mapMode) const {
 			return {data_r, r_index, data_w, w_index};
 		}
 	} else {
+		r_index = lastDataSlot();
 		// read only. the case of reading at index is not handled differently here.
 		if (hasTwoSlots()) {
 			auto readData = readLock(r_index);
@@ -360,14 +459,162 @@ MappedData ShaderInput::mapClientData(int mapMode) const {
 	}
 }
 
-void ShaderInput::unmapClientData(int mapMode, int slotIndex) const {
+void ShaderInput::unmapClientData(int mapMode, int slotIndex,
+		unsigned int dirtyBegin, unsigned int dirtyEnd) const {
 	if ((mapMode & ShaderData::WRITE) != 0) {
-		writeUnlock(slotIndex, true);
+		writeUnlock(slotIndex, true, dirtyBegin, dirtyEnd);
+		endClientWrite();
 	} else {
 		readUnlock(slotIndex);
 	}
 }
 
+void ShaderInput::discardClientWrite(int slotIndex) const {
+	if (slotIndex == LOCK_FREE_SLOT) {
+		lockFreeWriteLock_.unlock();
+		endClientWrite();
+	} else {
+		// the active slot is not switched, and the stamp is not incremented.
+		writeUnlock(slotIndex, false);
+		endClientWrite();
+	}
+}
+
+void ShaderInput::beginClientWrite() const {
+	std::unique_lock<std::mutex> lk(borrowLock_);
+	while (isBorrowed_) {
+		borrowQ_.wait(lk);
+	}
+	++numClientWriters_;
+}
+
+void ShaderInput::endClientWrite() const {
+	std::unique_lock<std::mutex> lk(borrowLock_);
+	--numClientWriters_;
+	if (numClientWriters_ == 0 && isBorrowed_) {
+		// a borrow waits for the pending writers
+		borrowQ_.notify_all();
+	}
+}
+
+byte *ShaderInput::exchangeClientData(byte *data) {
+	byte previous[ShaderData::MAX_LOCK_FREE_SIZE];
+	if (isLockFree() && writeLockFreeBegin(previous)) {
+		if (!isCurrentClientBuffer(data)) {
+			discardClientWrite(LOCK_FREE_SLOT);
+			REGEN_WARN("Buffer exchanged with '" << name_ << "' does not have the size of the data.");
+			return nullptr;
+		}
+		// small data is swapped by copying, the buffers keep their owners.
+		auto size = inputSize_;
+		writeLockFreeEnd(data);
+		std::memcpy(data, previous, size);
+		return data;
+	}
+	beginClientWrite();
+	// note: the data cannot be resized until endClientWrite
+	if (!isCurrentClientBuffer(data)) {
+		endClientWrite();
+		REGEN_WARN("Buffer exchanged with '" << name_ << "' does not have the size of the data.");
+		return nullptr;
+	}
+	while (true) {
+		int dataSlot = lastDataSlot();
+		// waits for readers of the previous data
+		byte *previous = writeLock(dataSlot);
+		if (lastDataSlot() != dataSlot) {
+			// another slot was written in the meantime
+			writeUnlock(dataSlot, false);
+			continue;
+		}
+		{
+			std::unique_lock<std::mutex> lk(slotLocks_[dataSlot].lock);
+			dataSlots_[dataSlot] = data;
+		}
+		writeUnlock(dataSlot, true);
+		endClientWrite();
+		{
+			// the caller owns the previous slot now
+			std::lock_guard<std::mutex> lk(clientBufferLock_);
+			for (auto &buffer: clientBuffers_) {
+				if (buffer.data == data) {
+					buffer.data = previous;
+					break;
+				}
+			}
+		}
+		return previous;
+	}
+}
+
+byte *ShaderInput::beginBorrow(const byte *data, byte *localData, int &slotIndex) {
+	{
+		std::unique_lock<std::mutex> lk(borrowLock_);
+		while (isBorrowed_) {
+			borrowQ_.wait(lk);
+		}
+		// no new writers from here on, wait for the pending ones.
+		// this includes lock-free writers and resizes of the data. readers are not blocked.
+		isBorrowed_ = true;
+		while (numClientWriters_ != 0) {
+			borrowQ_.wait(lk);
+		}
+	}
+	if (isLockFree()) {
+		// small data is copied, the previous data is kept in the borrow.
+		std::lock_guard<std::mutex> lk(lockFreeWriteLock_);
+		std::memcpy(localData, dataSlots_[0], inputSize_);
+		commitLockFree(data);
+		slotIndex = LOCK_FREE_SLOT;
+		return localData;
+	}
+	// the active slot cannot change anymore until the borrow ends.
+	int dataSlot = lastDataSlot();
+	byte *original;
+	{
+		// readers that still have the original data mapped keep reading it.
+		std::unique_lock<std::mutex> lk(slotLocks_[dataSlot].lock);
+		original = dataSlots_[dataSlot];
+		dataSlots_[dataSlot] = const_cast<byte *>(data);
+	}
+	dataStamp_.fetch_add(1, std::memory_order_relaxed);
+	if (hasServerData()) {
+		requiresReUpload_ = true;
+	}
+	slotIndex = dataSlot;
+	return original;
+}
+
+void ShaderInput::endBorrow(int slotIndex, byte *original) {
+	if (slotIndex == LOCK_FREE_SLOT) {
+		// no writer has modified the data in the meantime
+		std::lock_guard<std::mutex> lk(lockFreeWriteLock_);
+		commitLockFree(original);
+	} else {
+		auto &slotLock = slotLocks_[slotIndex];
+		{
+			std::unique_lock<std::mutex> lk(slotLock.lock);
+			// wait until the borrowed data is not read anymore
+			++slotLock.waitingWriters;
+			while (slotLock.activeReaders != 0) {
+				slotLock.writerQ.wait(lk);
+			}
+			--slotLock.waitingWriters;
+			dataSlots_[slotIndex] = original;
+			slotLock.readerQ.notify_all();
+		}
+		dataStamp_.fetch_add(1, std::memory_order_relaxed);
+		if (hasServerData()) {
+			requiresReUpload_ = true;
+		}
+	}
+	{
+		std::unique_lock<std::mutex> lk(borrowLock_);
+		isBorrowed_ = false;
+		borrowQ_.notify_all();
+	}
+}
+
 void ShaderInput::writeVertex(GLuint index, const byte *data) {
 	auto mapped = mapClientDataRaw(ShaderData::WRITE | ShaderData::INDEX);
 	// NOTE: it is maybe a bit confusing, but the semantics of writeVertex is currently
@@ -376,9 +623,11 @@ void ShaderInput::writeVertex(GLuint index, const byte *data) {
 	//       For uniform array data, it is assumed that data is one array element.
 	if (isVertexAttribute_) {
 		std::memcpy(mapped.w + index * elementSize_, data, elementSize_);
+		mapped.markDirty(index * elementSize_, elementSize_);
 	} else {
 		auto arrayElementSize = dataTypeBytes_ * valsPerElement_;
 		std::memcpy(mapped.w + index * arrayElementSize, data, arrayElementSize);
+		mapped.markDirty(index * arrayElementSize, arrayElementSize);
 	}
 }
 
@@ -386,25 +635,64 @@ void ShaderInput::deallocateClientData() {
 	for (int i = 0; i < 2; ++i) {
 		std::unique_lock<std::mutex> lk(slotLocks_[i].lock);
 		if (dataSlots_[i]) {
-			delete[] dataSlots_[i];
+			freeSlot(dataSlots_[i]);
 			dataSlots_[i] = nullptr;
 		}
 	}
 }
 
-void ShaderInput::reallocateClientData(size_t size) {
-	{
-		std::unique_lock<std::mutex> lk(slotLocks_[0].lock);
-		if (dataSlots_[0]) {
-			delete[] dataSlots_[0];
+byte *ShaderInput::allocateSlot() const {
+	return static_cast<byte *>(AlignedArena::get().allocate(slotSize_, arenaTag_));
+}
+
+void ShaderInput::freeSlot(byte *slot) const {
+	AlignedArena::get().deallocate(slot, slotSize_, arenaTag_);
+}
+
+byte *ShaderInput::allocateClientBuffer() const {
+	std::lock_guard<std::mutex> lk(clientBufferLock_);
+	auto *data = allocateSlot();
+	clientBuffers_.push_back({data, slotSize_, arenaTag_});
+	return data;
+}
+
+void ShaderInput::freeClientBuffer(byte *data) const {
+	std::lock_guard<std::mutex> lk(clientBufferLock_);
+	for (auto it = clientBuffers_.begin(); it != clientBuffers_.end(); ++it) {
+		if (it->data == data) {
+			// note: the buffer is freed with its own size, the data may have been resized since
+			AlignedArena::get().deallocate(data, it->size, it->tag);
+			clientBuffers_.erase(it);
+			return;
+		}
+	}
+	REGEN_WARN("Buffer freed by '" << name_ << "' was not allocated by it.");
+}
+
+bool ShaderInput::isCurrentClientBuffer(const byte *data) const {
+	std::lock_guard<std::mutex> lk(clientBufferLock_);
+	for (auto &buffer: clientBuffers_) {
+		if (buffer.data == data) {
+			return buffer.size == slotSize_ && buffer.tag == arenaTag_;
 		}
-		dataSlots_[0] = new byte[size];
 	}
+	return false;
+}
+
+void ShaderInput::reallocateClientData(size_t size) {
 	{
-		std::unique_lock<std::mutex> lk(slotLocks_[1].lock);
+		std::unique_lock<std::mutex> lk0(slotLocks_[0].lock);
+		std::unique_lock<std::mutex> lk1(slotLocks_[1].lock);
+		// note: slots are freed with the size and tag they were allocated with
+		freeSlot(dataSlots_[0]);
+		freeSlot(dataSlots_[1]);
+		// buffers allocated before are not exchanged anymore
+		std::lock_guard<std::mutex> bufferLock(clientBufferLock_);
+		slotSize_ = size;
+		arenaTag_ = AlignedArena::currentTag();
+		dataSlots_[0] = allocateSlot();
 		if (dataSlots_[1]) {
-			delete[] dataSlots_[1];
-			dataSlots_[1] = new byte[size];
+			dataSlots_[1] = allocateSlot();
 		}
 	}
 }
@@ -465,7 +753,7 @@ bool ShaderInput::writeClientData_(const byte *data) {
 
 void ShaderInput::writeServerData(GLuint index) const {
 	if (!hasClientData() || !hasServerData()) return;
-	auto mappedClientData = mapClientData(ShaderData::READ);
+	auto mappedClientData = mapClientDataRaw(ShaderData::READ);
 	auto clientData = mappedClientData.r;
 	auto subDataStart = clientData + elementSize_ * index;
 
@@ -480,30 +768,85 @@ void ShaderInput::writeServerData(GLuint index) const {
 
 void ShaderInput::writeServerData() const {
 	if (!hasClientData() || !hasServerData()) return;
-	if (bufferStamp_ == stamp()) return;
-	auto mappedClientData = mapClientData(ShaderData::READ);
-	auto clientData = mappedClientData.r;
-	auto count = std::max(numVertices_, numInstances_);
-
+	// NOTE: the stamp is read before the data, the data may be newer which is uploaded again next time.
+	auto currentStamp = stamp();
+	if (bufferStamp_ == currentStamp) return;
+	uploadRanges_.clear();
+	collectDirtyRanges(bufferStamp_, currentStamp, uploadRanges_);
+	bool isPartial = uploadRanges_.isPartial(inputSize_, partialUploadThreshold_);
+
+	auto mappedClientData = mapClientDataRaw(ShaderData::READ);
 	RenderState::get()->copyWriteBuffer().push(buffer_);
+	if (isPartial) {
+		for (auto &range: uploadRanges_.ranges()) {
+			uploadRange(mappedClientData.r, range.begin, std::min(range.end, inputSize_));
+		}
+		countUpload(uploadRanges_.numBytes(inputSize_), true);
+	} else {
+		uploadRange(mappedClientData.r, 0u, inputSize_);
+		countUpload(inputSize_, false);
+	}
+	RenderState::get()->copyWriteBuffer().pop();
+
+	bufferStamp_ = currentStamp;
+}
+
+void ShaderInput::uploadRange(const byte *clientData, unsigned int begin, unsigned int end) const {
+	if (begin >= end) return;
 	if (stride_ == elementSize_) {
-		glBufferSubData(GL_COPY_WRITE_BUFFER, offset_, inputSize_, clientData);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, offset_ + begin, end - begin, clientData + begin);
 	} else {
-		GLuint offset = offset_;
-		for (GLuint i = 0; i < count; ++i) {
+		// interleaved data, upload each element that intersects the range
+		GLuint firstElement = begin / elementSize_;
+		GLuint lastElement = (end - 1) / elementSize_;
+		GLuint offset = offset_ + firstElement * stride_;
+		clientData += firstElement * elementSize_;
+		for (GLuint i = firstElement; i <= lastElement; ++i) {
 			glBufferSubData(GL_COPY_WRITE_BUFFER, offset, elementSize_, clientData);
 			offset += stride_;
 			clientData += elementSize_;
 		}
 	}
-	RenderState::get()->copyWriteBuffer().pop();
+}
 
-	bufferStamp_ = stamp();
+bool ShaderInput::collectDirtyRanges(unsigned int fromStamp, unsigned int toStamp, DirtyRanges &ranges) const {
+	std::lock_guard<std::mutex> lk(dirtyLock_);
+	return dirtyLog_.collect(fromStamp, toStamp, ranges);
+}
+
+namespace regen {
+	// upload counters of the current frame, and the statistics of the last frame
+	static std::atomic<unsigned long> numUploadedBytes_ = 0;
+	static std::atomic<unsigned int> numPartialUploads_ = 0;
+	static std::atomic<unsigned int> numFullUploads_ = 0;
+	static ShaderInput::UploadStatistics lastFrameUploads_;
+	static std::mutex lastFrameUploadsLock_;
+}
+
+void ShaderInput::countUpload(unsigned int numBytes, bool isPartial) {
+	numUploadedBytes_.fetch_add(numBytes, std::memory_order_relaxed);
+	if (isPartial) {
+		numPartialUploads_.fetch_add(1, std::memory_order_relaxed);
+	} else {
+		numFullUploads_.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+ShaderInput::UploadStatistics ShaderInput::uploadStatistics() {
+	std::lock_guard<std::mutex> lk(lastFrameUploadsLock_);
+	return lastFrameUploads_;
+}
+
+void ShaderInput::nextUploadFrame() {
+	std::lock_guard<std::mutex> lk(lastFrameUploadsLock_);
+	lastFrameUploads_.numBytes = numUploadedBytes_.exchange(0, std::memory_order_relaxed);
+	lastFrameUploads_.numPartialUploads = numPartialUploads_.exchange(0, std::memory_order_relaxed);
+	lastFrameUploads_.numFullUploads = numFullUploads_.exchange(0, std::memory_order_relaxed);
 }
 
 void ShaderInput::readServerData() {
 	if (!hasServerData()) return;
-	auto mappedClientData = mapClientData(ShaderData::WRITE);
+	auto mappedClientData = mapClientDataRaw(ShaderData::WRITE);
 	auto clientData = mappedClientData.w;
 
 	RenderState::get()->arrayBuffer().push(buffer());
@@ -630,10 +973,14 @@ ref_ptr<ShaderInput> ShaderInput::copy(const ref_ptr<ShaderInput> &in, GLboolean
 	cp->isConstant_ = in->isConstant_;
 	cp->transpose_ = in->transpose_;
 	cp->forceArray_ = in->forceArray_;
+	cp->allowLockFree_ = in->allowLockFree_;
+	cp->partialUploadThreshold_ = in->partialUploadThreshold_;
 	if (in->hasClientData()) {
 		// allocate memory for one slot, copy most recent data
-		auto mapped = in->mapClientData(ShaderData::READ);
-		cp->dataSlots_[0] = new byte[cp->inputSize_];
+		auto mapped = in->mapClientDataRaw(ShaderData::READ);
+		cp->slotSize_ = cp->inputSize_;
+		cp->arenaTag_ = AlignedArena::currentTag();
+		cp->dataSlots_[0] = cp->allocateSlot();
 		std::memcpy(cp->dataSlots_[0], mapped.r, cp->inputSize_);
 	}
 	return cp;
@@ -11,10 +11,14 @@
 #include <string>
 #include <map>
 #include <atomic>
+#include <limits>
+#include <vector>
 
 #include <regen/gl-types/vbo.h>
 #include <regen/gl-types/gl-enum.h>
 #include <regen/gl-types/shader-data.h>
+#include <regen/gl-types/dirty-ranges.h>
+#include <regen/utility/aligned-arena.h>
 #include <regen/utility/ref-ptr.h>
 #include <regen/utility/stack.h>
 #include <regen/utility/string-util.h>
@@ -295,6 +299,23 @@ namespace regen {
 		 */
 		auto forceArray() const { return forceArray_; }
 
+		/**
+		 * Client data of uniforms with at most ShaderData::MAX_LOCK_FREE_SIZE bytes
+		 * is by default accessed without locks: readers copy the data, and retry in case
+		 * a write was committed in the meantime. Writers are serialized, but never
+		 * wait for readers.
+		 * Must not be changed while the data is mapped.
+		 * @param v false to use the slot locks also for small data.
+		 */
+		void set_allowLockFree(bool v) { allowLockFree_ = v; }
+
+		/**
+		 * @return true if the client data is accessed without locks.
+		 */
+		bool isLockFree() const {
+			return allowLockFree_ && !isVertexAttribute_ && inputSize_ <= ShaderData::MAX_LOCK_FREE_SIZE;
+		}
+
 		/**
 		 * Allocates RAM for the attribute and does a memcpy
 		 * if the data pointer is not null.
@@ -362,6 +383,41 @@ namespace regen {
 		template<typename T> ShaderVertex_ro<T> mapClientVertex(int mapMode, unsigned int vertexIndex) const
 		{ return {this, mapMode, vertexIndex}; }
 
+		/**
+		 * Use a caller-owned buffer as client data until the returned object is destroyed.
+		 * The buffer is not copied, and must have at least inputSize() bytes.
+		 * Writers, including lock-free writers and resizes of the data, wait until the borrow ends.
+		 * @param data the borrowed data.
+		 * @return the borrow, restores the original data when destroyed.
+		 */
+		ShaderDataBorrow borrowClientData(const byte *data) { return {this, data}; }
+
+		/**
+		 * Replace the current client data with the given buffer, without copying it.
+		 * The buffer must have been allocated with allocateClientBuffer(), and is owned
+		 * by this input afterwards. The previous buffer is returned, and is owned by the caller,
+		 * it must be freed with freeClientBuffer().
+		 * Buffers allocated before the data was resized are rejected, the caller keeps them.
+		 * Waits until the previous buffer is not read anymore.
+		 * @param data the new data.
+		 * @return the previous data, or null if the buffer was rejected.
+		 */
+		byte *exchangeClientData(byte *data);
+
+		/**
+		 * Allocate a buffer that can be exchanged with the client data.
+		 * The buffer has the size of the client data, and is aligned to 64 bytes.
+		 * @return the buffer.
+		 */
+		byte *allocateClientBuffer() const;
+
+		/**
+		 * Free a buffer allocated with allocateClientBuffer(), or returned by exchangeClientData().
+		 * Buffers allocated before the data was resized can be freed too.
+		 * @param data the buffer.
+		 */
+		void freeClientBuffer(byte *data) const;
+
 		/**
 		 * Writes client data at index.
 		 * Note that it is more efficient to map the data and write directly to it
@@ -393,10 +449,62 @@ namespace regen {
 
 		/**
 		 * Write this attribute to the GL server.
+		 * Only the ranges written since the last upload are uploaded if they are
+		 * small enough, see partialUploadThreshold().
 		 * @param rs The RenderState.
 		 */
 		void writeServerData() const;
 
+		/**
+		 * Collect the byte ranges of client data written between two stamps.
+		 * All data is marked as modified if the writes are not known anymore.
+		 * @param fromStamp the stamp of the last upload.
+		 * @param toStamp the current stamp.
+		 * @param ranges the collected ranges.
+		 * @return false if all data was marked as modified.
+		 */
+		bool collectDirtyRanges(unsigned int fromStamp, unsigned int toStamp, DirtyRanges &ranges) const;
+
+		/**
+		 * @param threshold the maximum fraction of the data that is uploaded partially,
+		 * if more data was written, all data is uploaded with a single call.
+		 */
+		void set_partialUploadThreshold(float threshold) { partialUploadThreshold_ = threshold; }
+
+		/**
+		 * @return the maximum fraction of the data that is uploaded partially.
+		 */
+		float partialUploadThreshold() const { return partialUploadThreshold_; }
+
+		/**
+		 * \brief Statistics of client data uploads to the GL server.
+		 */
+		struct UploadStatistics {
+			/** the number of uploaded bytes. */
+			unsigned long numBytes = 0;
+			/** the number of uploads of written ranges. */
+			unsigned int numPartialUploads = 0;
+			/** the number of uploads of all data. */
+			unsigned int numFullUploads = 0;
+		};
+
+		/**
+		 * Count an upload of client data.
+		 * @param numBytes the number of uploaded bytes.
+		 * @param isPartial true if only written ranges were uploaded.
+		 */
+		static void countUpload(unsigned int numBytes, bool isPartial);
+
+		/**
+		 * @return the upload statistics of the last frame.
+		 */
+		static UploadStatistics uploadStatistics();
+
+		/**
+		 * Start counting the uploads of the next frame.
+		 */
+		static void nextUploadFrame();
+
 		/**
 		 * Returns true if this attribute is allocated in RAM
 		 * or if it was uploaded to GL already.
@@ -488,6 +596,38 @@ namespace regen {
 		mutable std::array<SlotLock,2> slotLocks_;
 		mutable std::atomic<int> lastDataSlot_ = 0;
 		mutable std::atomic<unsigned int> dataStamp_ = 0;
+		// sequence counter of lock-free data, odd while a write is committed
+		mutable std::atomic<unsigned int> lockFreeSeq_ = 0;
+		mutable std::mutex lockFreeWriteLock_;
+		// number of lock-free readers copying the data, a resize waits until there are none
+		mutable std::atomic<unsigned int> numLockFreeReaders_ = 0;
+		bool allowLockFree_ = true;
+		// slot index of mapped lock-free data
+		static constexpr int LOCK_FREE_SLOT = 2;
+		// writers of client data wait while the data is borrowed
+		mutable std::mutex borrowLock_;
+		mutable std::condition_variable borrowQ_;
+		mutable int numClientWriters_ = 0;
+		bool isBorrowed_ = false;
+		// ranges written by the most recent writes, and the stamps they have produced
+		mutable std::mutex dirtyLock_;
+		mutable DirtyRangeLog dirtyLog_;
+		mutable DirtyRanges uploadRanges_;
+		float partialUploadThreshold_ = 0.5f;
+		// slots are allocated from the aligned arena, with this size and tag
+		size_t slotSize_ = 0;
+		unsigned int arenaTag_ = AlignedArena::DEFAULT_TAG;
+		// buffers owned by callers for exchanging the data, with the size and tag they were allocated with
+		struct ClientBuffer {
+			byte *data;
+			size_t size;
+			unsigned int tag;
+		};
+		mutable std::mutex clientBufferLock_;
+		mutable std::vector<ClientBuffer> clientBuffers_;
+		// number of group commits in progress, and number of completed group commits
+		mutable std::atomic<unsigned int> groupCommits_ = 0;
+		mutable std::atomic<unsigned int> groupVersion_ = 0;
 
 		bool isConstant_;
 		bool isUniformBlock_;
@@ -497,9 +637,29 @@ namespace regen {
 
 		void (ShaderInput::*enableAttribute_)(GLint loc) const;
 
-		MappedData mapClientData(int mapMode) const;
+		MappedData mapClientData(int mapMode, byte *localData) const;
 
-		void unmapClientData(int mapMode, int slotIndex) const;
+		bool readLockFree(byte *localData) const;
+
+		byte *writeLockFreeBegin(byte *localData) const;
+
+		void writeLockFreeEnd(const byte *localData) const;
+
+		void commitLockFree(const byte *localData) const;
+
+		byte *beginBorrow(const byte *data, byte *localData, int &slotIndex);
+
+		void endBorrow(int slotIndex, byte *original);
+
+		void discardClientWrite(int slotIndex) const;
+
+		void beginClientWrite() const;
+
+		void endClientWrite() const;
+
+		void unmapClientData(int mapMode, int slotIndex,
+				unsigned int dirtyBegin = 0u,
+				unsigned int dirtyEnd = std::numeric_limits<unsigned int>::max()) const;
 
 		const byte* readLock(int slotIndex) const;
 
@@ -511,10 +671,14 @@ namespace regen {
 
 		byte* writeLockTry(int slotIndex) const;
 
-		void writeUnlock(int slotIndex, bool hasDataChanged) const;
+		void writeUnlock(int slotIndex, bool hasDataChanged,
+				unsigned int dirtyBegin = 0u,
+				unsigned int dirtyEnd = std::numeric_limits<unsigned int>::max()) const;
 
 		void writeLockAll() const;
 
+		void uploadRange(const byte *clientData, unsigned int begin, unsigned int end) const;
+
 		void writeUnlockAll(bool hasDataChanged) const;
 
 		bool hasTwoSlots() const { return dataSlots_[1] != nullptr; }
@@ -523,12 +687,20 @@ namespace regen {
 
 		void allocateSecondSlot() const;
 
+		byte *allocateSlot() const;
+
+		void freeSlot(byte *slot) const;
+
+		bool isCurrentClientBuffer(const byte *data) const;
+
 		void reallocateClientData(size_t size);
 
 		bool writeClientData_(const byte *data);
 
 		friend struct ShaderDataRaw_rw;
 		friend struct ShaderDataRaw_ro;
+		friend struct ShaderDataBorrow;
+		friend class ShaderDataGroup;
 
 		//void (ShaderInput::*enableUniform_)(GLint loc) const;
 		std::function<void(GLint)> enableUniform_;
@@ -614,6 +786,7 @@ namespace regen {
 		void setVertex(GLuint i, const ValueType &val) {
 			auto mapped = mapClientData<ValueType>(ShaderData::WRITE | ShaderData::INDEX);
 			mapped.w[i] = val;
+			mapped.markDirty(i);
 		}
 
 		/**
@@ -114,6 +114,38 @@ void UBO::updateAlignedData(UBO_Input &uboInput) {
 	}
 }
 
+void UBO::updateInput(UBO_Input &uboInput) {
+	auto &in = uboInput.input;
+	// NOTE: the stamp is read before the data, the data may be newer which is uploaded again next time.
+	auto currentStamp = in->stamp();
+	updateAlignedData(uboInput);
+	if (uboInput.alignedData) {
+		// padded array elements are always uploaded completely.
+		glBufferSubData(GL_UNIFORM_BUFFER, uboInput.offset, uboInput.alignedSize, uboInput.alignedData);
+		ShaderInput::countUpload(uboInput.alignedSize, false);
+	} else {
+		auto inputSize = in->inputSize();
+		dirtyRanges_.clear();
+		in->collectDirtyRanges(uboInput.lastStamp, currentStamp, dirtyRanges_);
+		auto mapped = in->mapClientDataRaw(ShaderData::READ);
+		if (dirtyRanges_.isPartial(inputSize, in->partialUploadThreshold())) {
+			for (auto &range: dirtyRanges_.ranges()) {
+				auto end = std::min(range.end, inputSize);
+				if (range.begin >= end) continue;
+				glBufferSubData(GL_UNIFORM_BUFFER,
+								uboInput.offset + range.begin,
+								end - range.begin,
+								mapped.r + range.begin);
+			}
+			ShaderInput::countUpload(dirtyRanges_.numBytes(inputSize), true);
+		} else {
+			glBufferSubData(GL_UNIFORM_BUFFER, uboInput.offset, inputSize, mapped.r);
+			ShaderInput::countUpload(inputSize, false);
+		}
+	}
+	uboInput.lastStamp = currentStamp;
+}
+
 void UBO::update(bool forceUpdate) {
 	bool needUpdate = forceUpdate || needsUpdate();
 	if (!needUpdate) { return; }
@@ -132,26 +164,39 @@ void UBO::update(bool forceUpdate) {
 		requiresResize_ = GL_FALSE;
 	}
 
+	if (!forceUpdate) {
+		// only some inputs have changed, upload them individually.
+		for (auto &uboInput: uboInputs_) {
+			if (uboInput.input->stamp() != uboInput.lastStamp && uboInput.input->hasClientData()) {
+				updateInput(uboInput);
+			}
+		}
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		stamp_ += 1;
+		return;
+	}
+
 	void *bufferData = glMapBuffer(GL_UNIFORM_BUFFER, GL_WRITE_ONLY);
 	if (bufferData) {
 		for (auto &uboInput: uboInputs_) {
-			if (forceUpdate || uboInput.input->stamp() != uboInput.lastStamp) {
-				if (!uboInput.input->hasClientData()) {
-					continue;
-				}
-				// copy the data to the buffer.
-				updateAlignedData(uboInput);
-				if (uboInput.alignedData) {
-					memcpy(static_cast<char *>(bufferData) + uboInput.offset,
-						   uboInput.alignedData, uboInput.alignedSize);
-				} else {
-					auto mapped = uboInput.input->mapClientDataRaw(ShaderData::READ);
-					memcpy(static_cast<char *>(bufferData) + uboInput.offset,
-						   mapped.r,
-						   uboInput.input->inputSize());
-				}
-				uboInput.lastStamp = uboInput.input->stamp();
+			if (!uboInput.input->hasClientData()) {
+				continue;
+			}
+			auto currentStamp = uboInput.input->stamp();
+			// copy the data to the buffer.
+			updateAlignedData(uboInput);
+			if (uboInput.alignedData) {
+				memcpy(static_cast<char *>(bufferData) + uboInput.offset,
+					   uboInput.alignedData, uboInput.alignedSize);
+				ShaderInput::countUpload(uboInput.alignedSize, false);
+			} else {
+				auto mapped = uboInput.input->mapClientDataRaw(ShaderData::READ);
+				memcpy(static_cast<char *>(bufferData) + uboInput.offset,
+					   mapped.r,
+					   uboInput.input->inputSize());
+				ShaderInput::countUpload(uboInput.input->inputSize(), false);
 			}
+			uboInput.lastStamp = currentStamp;
 		}
 		glUnmapBuffer(GL_UNIFORM_BUFFER);
 	} else {
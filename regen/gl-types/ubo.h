@@ -94,12 +94,15 @@ namespace regen {
 		GLboolean requiresResize_;
 		GLuint stamp_;
 		std::mutex mutex_;
+		DirtyRanges dirtyRanges_;
 
 		GLboolean needsUpdate() const;
 
 		void computePaddedSize();
 
 		static void updateAlignedData(UBO_Input &uboInput);
+
+		void updateInput(UBO_Input &uboInput);
 	};
 } // namespace
 
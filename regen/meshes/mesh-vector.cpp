@@ -363,6 +363,7 @@ ref_ptr<MeshVector> MeshVector::createAssetMeshes(LoadingContext &ctx, scene::Sc
 
 		if (useAnimation) {
 			std::list<ref_ptr<AnimationNode> > meshBones;
+			std::vector<std::list<ref_ptr<AnimationNode> > > instanceBones;
 			GLuint numBoneWeights = importer->numBoneWeights(mesh.get());
 			GLuint numBones = 0u;
 
@@ -371,6 +372,7 @@ ref_ptr<MeshVector> MeshVector::createAssetMeshes(LoadingContext &ctx, scene::Sc
 				std::list<ref_ptr<AnimationNode> > ibonNodes =
 						importer->loadMeshBones(mesh.get(), it->get());
 				meshBones.insert(meshBones.end(), ibonNodes.begin(), ibonNodes.end());
+				instanceBones.push_back(ibonNodes);
 				numBones = ibonNodes.size();
 			}
 
@@ -379,6 +381,12 @@ ref_ptr<MeshVector> MeshVector::createAssetMeshes(LoadingContext &ctx, scene::Sc
 			if (!meshBones.empty()) {
 				ref_ptr<Bones> bonesState = ref_ptr<Bones>::alloc(numBoneWeights, numBones);
 				bonesState->setBones(meshBones);
+				// let the node animations write the bone matrices directly
+				GLuint firstBone = 0u;
+				for (GLuint j = 0u; j < nodeAnims.size(); ++j) {
+					bonesState->attachSkeleton(nodeAnims[j]->skeleton(), instanceBones[j], firstBone);
+					firstBone += instanceBones[j].size();
+				}
 				bonesState->setAnimationName(REGEN_STRING("bones-" << input.getName()));
 				bonesState->startAnimation();
 				mesh->joinStates(bonesState);
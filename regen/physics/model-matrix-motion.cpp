@@ -26,6 +26,8 @@ void ModelMatrixMotion::setWorldTransform(const btTransform &worldTrans) {
 	auto regenData = modelMatrix_->mapClientData<Mat4f>(ShaderData::WRITE | ShaderData::INDEX);
 	auto &regenMat = regenData.w[index_];
 	worldTrans.getOpenGLMatrix((btScalar*) &regenMat.x);
+	// only the matrix of this body is uploaded
+	regenData.markDirty(index_);
 }
 
 
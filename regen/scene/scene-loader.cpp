@@ -17,6 +17,7 @@
 #include <regen/scene/mesh-processor.h>
 #include <regen/scene/loadable-input.h>
 #include <regen/scene/shader-define-processor.h>
+#include <regen/utility/aligned-arena.h>
 
 using namespace regen::scene;
 using namespace regen;
@@ -177,6 +178,8 @@ int SceneLoader::putNamedObject(const ref_ptr<StateNode> &obj) {
 }
 
 ref_ptr<Resource> SceneLoader::getResource(const std::string &category, const std::string &name) {
+	// client data allocated while loading the resource is accounted to its category
+	AlignedArena::Scope arenaScope(category);
 	if (category == "FBO") {
 		return resources_->getFBO(this, name);
 	} else if (category == "UBO") {
@@ -256,6 +259,7 @@ void SceneLoader::processNode(
 												  nodeCategory << "' and node name '" << nodeName << "'.");
 		return;
 	}
+	AlignedArena::Scope arenaScope(nodeCategory);
 	processor->processInput(this, *input.get(), parent);
 }
 
@@ -269,6 +273,7 @@ void SceneLoader::processState(
 		REGEN_WARN("No Processor registered for node category '" << nodeCategory << "'.");
 		return;
 	}
+	AlignedArena::Scope arenaScope(nodeCategory);
 	processor->processInput(this, *input.get(), parentNode, parent);
 }
 
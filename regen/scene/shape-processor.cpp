@@ -408,7 +408,22 @@ void ShapeProcessor::processInput(
 	if (shapeMode == "index") {
 		// add shape to spatial index
 		auto spatialIndex = getSpatialIndex(scene, input);
-		if (spatialIndex.get()) {
+		if (spatialIndex.get() && numInstances > 1 && input.getValue<bool>("batched", false)) {
+			// one volume for all instances that is culled in batches
+			auto shape = createShape(input, mesh, parts);
+			if (!shape.get()) {
+				REGEN_WARN("Skipping shape node " << input.getDescription() << " without shape.");
+				return;
+			}
+			shape->setName(input.getName());
+			if (transform.get()) {
+				shape->setTransform(transform, 0);
+			}
+			if (offset.get()) {
+				shape->setTransform(offset, 0);
+			}
+			spatialIndex->insertInstanced(ref_ptr<InstancedBoundingVolume>::alloc(shape, numInstances));
+		} else if (spatialIndex.get()) {
 			for (GLuint i = 0; i < numInstances; ++i) {
 				auto shape = createShape(input, mesh, parts);
 				if (!shape.get()) {
@@ -0,0 +1,490 @@
+#include "aabb-tree.h"
+#include "bounding-sphere.h"
+#include "bounding-box.h"
+#include "frustum.h"
+
+using namespace regen;
+
+static inline float surfaceArea(const Bounds<Vec3f> &b) {
+	auto d = b.max - b.min;
+	return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+static inline Bounds<Vec3f> combine(const Bounds<Vec3f> &a, const Bounds<Vec3f> &b) {
+	Bounds<Vec3f> c = a;
+	c.extend(b);
+	return c;
+}
+
+static inline bool containsBounds(const Bounds<Vec3f> &outer, const Bounds<Vec3f> &inner) {
+	return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+		   outer.max.x >= inner.max.x && outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+}
+
+static inline Bounds<Vec3f> fatten(const Bounds<Vec3f> &b, float margin) {
+	return {b.min - Vec3f(margin), b.max + Vec3f(margin)};
+}
+
+namespace regen {
+	/**
+	 * Conservative intersection test between a query shape and node bounds.
+	 * The exact test is only done for the items in leaf nodes.
+	 */
+	class AABBTreeQuery {
+	public:
+		explicit AABBTreeQuery(const BoundingShape &shape)
+				: shape_(shape),
+				  bounds_(Vec3f(0), Vec3f(0)) {
+			switch (shape.shapeType()) {
+				case BoundingShapeType::FRUSTUM:
+					planes_ = static_cast<const Frustum &>(shape).planes;
+					break;
+				case BoundingShapeType::SPHERE: {
+					auto &sphere = static_cast<const BoundingSphere &>(shape);
+					center_ = sphere.getCenterPosition();
+					radius_ = sphere.radius();
+					break;
+				}
+				case BoundingShapeType::BOX:
+					bounds_ = AABBTree::computeBounds(shape);
+					break;
+			}
+		}
+
+		bool intersects(const Bounds<Vec3f> &b) const {
+			switch (shape_.shapeType()) {
+				case BoundingShapeType::FRUSTUM:
+					for (int i = 0; i < 6; ++i) {
+						auto &n = planes_[i].normal;
+						// the box corner with maximum plane distance.
+						// note: plane distance is positive on the opposite side of the normal.
+						Vec3f p(n.x >= 0.0f ? b.min.x : b.max.x,
+								n.y >= 0.0f ? b.min.y : b.max.y,
+								n.z >= 0.0f ? b.min.z : b.max.z);
+						if (planes_[i].distance(p) < 0.0f) return false;
+					}
+					return true;
+				case BoundingShapeType::SPHERE: {
+					// distance between sphere center and closest point in the box
+					Vec3f d(
+							std::max(0.0f, std::max(b.min.x - center_.x, center_.x - b.max.x)),
+							std::max(0.0f, std::max(b.min.y - center_.y, center_.y - b.max.y)),
+							std::max(0.0f, std::max(b.min.z - center_.z, center_.z - b.max.z)));
+					return d.dot(d) <= radius_ * radius_;
+				}
+				case BoundingShapeType::BOX:
+					return b.min.x <= bounds_.max.x && b.max.x >= bounds_.min.x &&
+						   b.min.y <= bounds_.max.y && b.max.y >= bounds_.min.y &&
+						   b.min.z <= bounds_.max.z && b.max.z >= bounds_.min.z;
+			}
+			return true;
+		}
+
+	protected:
+		const BoundingShape &shape_;
+		const Plane *planes_ = nullptr;
+		Vec3f center_;
+		float radius_ = 0.0f;
+		Bounds<Vec3f> bounds_;
+	};
+}
+
+Bounds<Vec3f> AABBTree::computeBounds(const BoundingShape &shape) {
+	switch (shape.shapeType()) {
+		case BoundingShapeType::SPHERE: {
+			auto &sphere = static_cast<const BoundingSphere &>(shape);
+			auto center = sphere.getCenterPosition();
+			auto radius = Vec3f(sphere.radius());
+			return {center - radius, center + radius};
+		}
+		case BoundingShapeType::BOX: {
+			auto *vertices = static_cast<const BoundingBox &>(shape).boxVertices();
+			Bounds<Vec3f> bounds(vertices[0], vertices[0]);
+			for (int i = 1; i < 8; ++i) {
+				bounds.min.setMin(vertices[i]);
+				bounds.max.setMax(vertices[i]);
+			}
+			return bounds;
+		}
+		case BoundingShapeType::FRUSTUM: {
+			auto *points = static_cast<const Frustum &>(shape).points;
+			Bounds<Vec3f> bounds(points[0], points[0]);
+			for (int i = 1; i < 8; ++i) {
+				bounds.min.setMin(points[i]);
+				bounds.max.setMax(points[i]);
+			}
+			return bounds;
+		}
+	}
+	return {Vec3f(0), Vec3f(0)};
+}
+
+static const BoundingShape &initShape(const ref_ptr<BoundingShape> &shape) {
+	shape->updateTransform(false);
+	return *shape.get();
+}
+
+AABBTree::Item::Item(const ref_ptr<BoundingShape> &shape) :
+		shape(shape),
+		bounds(computeBounds(initShape(shape))) {
+}
+
+AABBTree::AABBTree()
+		: SpatialIndex() {
+}
+
+int AABBTree::allocateNode() {
+	int index;
+	if (freeList_ == NULL_NODE) {
+		index = static_cast<int>(nodes_.size());
+		nodes_.emplace_back();
+	} else {
+		index = freeList_;
+		freeList_ = nodes_[index].parent;
+		nodes_[index] = Node();
+	}
+	nodes_[index].height = 0;
+	numNodes_ += 1;
+	return index;
+}
+
+void AABBTree::freeNode(int node) {
+	// note: free nodes are chained through the parent index
+	nodes_[node].parent = freeList_;
+	nodes_[node].height = -1;
+	freeList_ = node;
+	numNodes_ -= 1;
+}
+
+void AABBTree::insert(const ref_ptr<BoundingShape> &shape) {
+	auto itemIndex = static_cast<unsigned int>(items_.size());
+	items_.emplace_back(shape);
+	itemIndex_[shape.get()] = itemIndex;
+
+	int leaf = allocateNode();
+	nodes_[leaf].bounds = fatten(items_.back().bounds, margin_);
+	nodes_[leaf].item = static_cast<int>(itemIndex);
+	items_.back().node = leaf;
+	insertLeaf(leaf);
+
+	addToIndex(shape);
+}
+
+void AABBTree::remove(const ref_ptr<BoundingShape> &shape) {
+	auto it = itemIndex_.find(shape.get());
+	if (it == itemIndex_.end()) {
+		REGEN_WARN("Shape not found in AABB tree.");
+		return;
+	}
+	auto itemIndex = it->second;
+	itemIndex_.erase(it);
+
+	auto leaf = items_[itemIndex].node;
+	removeLeaf(leaf);
+	freeNode(leaf);
+	// swap-remove the item, and update the index of the moved item
+	if (itemIndex + 1 != items_.size()) {
+		items_[itemIndex] = std::move(items_.back());
+		nodes_[items_[itemIndex].node].item = static_cast<int>(itemIndex);
+		itemIndex_[items_[itemIndex].shape.get()] = itemIndex;
+	}
+	items_.pop_back();
+
+	removeFromIndex(shape);
+}
+
+void AABBTree::insertLeaf(int leaf) {
+	if (root_ == NULL_NODE) {
+		root_ = leaf;
+		nodes_[root_].parent = NULL_NODE;
+		return;
+	}
+
+	// find the best sibling for the new leaf using the surface area heuristic
+	auto leafBounds = nodes_[leaf].bounds;
+	int index = root_;
+	while (!nodes_[index].isLeaf()) {
+		auto &node = nodes_[index];
+		int child0 = node.children[0];
+		int child1 = node.children[1];
+
+		float area = surfaceArea(node.bounds);
+		float combinedArea = surfaceArea(combine(node.bounds, leafBounds));
+		// cost of creating a new parent for this node and the new leaf
+		float cost = 2.0f * combinedArea;
+		// minimum cost of pushing the leaf further down the tree
+		float inheritanceCost = 2.0f * (combinedArea - area);
+
+		float childCost[2];
+		for (int i = 0; i < 2; ++i) {
+			auto &child = nodes_[node.children[i]];
+			float newArea = surfaceArea(combine(leafBounds, child.bounds));
+			if (child.isLeaf()) {
+				childCost[i] = newArea + inheritanceCost;
+			} else {
+				childCost[i] = (newArea - surfaceArea(child.bounds)) + inheritanceCost;
+			}
+		}
+
+		// descend according to the minimum cost
+		if (cost < childCost[0] && cost < childCost[1]) {
+			break;
+		}
+		index = (childCost[0] < childCost[1]) ? child0 : child1;
+	}
+	int sibling = index;
+
+	// create a new parent for sibling and leaf.
+	// note: allocation may invalidate node references
+	int newParent = allocateNode();
+	int oldParent = nodes_[sibling].parent;
+	nodes_[newParent].parent = oldParent;
+	nodes_[newParent].bounds = combine(leafBounds, nodes_[sibling].bounds);
+	nodes_[newParent].height = nodes_[sibling].height + 1;
+	nodes_[newParent].children[0] = sibling;
+	nodes_[newParent].children[1] = leaf;
+	nodes_[sibling].parent = newParent;
+	nodes_[leaf].parent = newParent;
+	if (oldParent != NULL_NODE) {
+		auto &parent = nodes_[oldParent];
+		parent.children[parent.children[0] == sibling ? 0 : 1] = newParent;
+	} else {
+		root_ = newParent;
+	}
+
+	// walk back up the tree fixing heights and bounds
+	refit(nodes_[leaf].parent);
+}
+
+void AABBTree::removeLeaf(int leaf) {
+	if (leaf == root_) {
+		root_ = NULL_NODE;
+		return;
+	}
+	int parent = nodes_[leaf].parent;
+	int grandParent = nodes_[parent].parent;
+	int sibling = nodes_[parent].children[0] == leaf ?
+				  nodes_[parent].children[1] : nodes_[parent].children[0];
+
+	// replace the parent with the sibling
+	if (grandParent != NULL_NODE) {
+		auto &gp = nodes_[grandParent];
+		gp.children[gp.children[0] == parent ? 0 : 1] = sibling;
+		nodes_[sibling].parent = grandParent;
+		freeNode(parent);
+		refit(grandParent);
+	} else {
+		root_ = sibling;
+		nodes_[sibling].parent = NULL_NODE;
+		freeNode(parent);
+	}
+	nodes_[leaf].parent = NULL_NODE;
+}
+
+void AABBTree::refit(int index) {
+	while (index != NULL_NODE) {
+		index = balance(index);
+		auto &node = nodes_[index];
+		auto &child0 = nodes_[node.children[0]];
+		auto &child1 = nodes_[node.children[1]];
+		node.height = 1 + std::max(child0.height, child1.height);
+		node.bounds = combine(child0.bounds, child1.bounds);
+		index = node.parent;
+	}
+}
+
+int AABBTree::balance(int iA) {
+	// perform a left or right rotation if node A is imbalanced
+	auto &A = nodes_[iA];
+	if (A.isLeaf() || A.height < 2) {
+		return iA;
+	}
+	int iB = A.children[0];
+	int iC = A.children[1];
+	auto &B = nodes_[iB];
+	auto &C = nodes_[iC];
+	int balance = C.height - B.height;
+
+	if (balance > 1) {
+		// rotate C up
+		int iF = C.children[0];
+		int iG = C.children[1];
+		auto &F = nodes_[iF];
+		auto &G = nodes_[iG];
+		// swap A and C
+		C.children[0] = iA;
+		C.parent = A.parent;
+		A.parent = iC;
+		// A's old parent should point to C
+		if (C.parent != NULL_NODE) {
+			auto &parent = nodes_[C.parent];
+			parent.children[parent.children[0] == iA ? 0 : 1] = iC;
+		} else {
+			root_ = iC;
+		}
+		// keep the higher child of C, move the other one to A
+		if (F.height > G.height) {
+			C.children[1] = iF;
+			A.children[1] = iG;
+			G.parent = iA;
+			A.bounds = combine(B.bounds, G.bounds);
+			C.bounds = combine(A.bounds, F.bounds);
+			A.height = 1 + std::max(B.height, G.height);
+			C.height = 1 + std::max(A.height, F.height);
+		} else {
+			C.children[1] = iG;
+			A.children[1] = iF;
+			F.parent = iA;
+			A.bounds = combine(B.bounds, F.bounds);
+			C.bounds = combine(A.bounds, G.bounds);
+			A.height = 1 + std::max(B.height, F.height);
+			C.height = 1 + std::max(A.height, G.height);
+		}
+		return iC;
+	}
+	if (balance < -1) {
+		// rotate B up
+		int iD = B.children[0];
+		int iE = B.children[1];
+		auto &D = nodes_[iD];
+		auto &E = nodes_[iE];
+		// swap A and B
+		B.children[0] = iA;
+		B.parent = A.parent;
+		A.parent = iB;
+		// A's old parent should point to B
+		if (B.parent != NULL_NODE) {
+			auto &parent = nodes_[B.parent];
+			parent.children[parent.children[0] == iA ? 0 : 1] = iB;
+		} else {
+			root_ = iB;
+		}
+		// keep the higher child of B, move the other one to A
+		if (D.height > E.height) {
+			B.children[1] = iD;
+			A.children[0] = iE;
+			E.parent = iA;
+			A.bounds = combine(C.bounds, E.bounds);
+			B.bounds = combine(A.bounds, D.bounds);
+			A.height = 1 + std::max(C.height, E.height);
+			B.height = 1 + std::max(A.height, D.height);
+		} else {
+			B.children[1] = iE;
+			A.children[0] = iD;
+			D.parent = iA;
+			A.bounds = combine(C.bounds, D.bounds);
+			B.bounds = combine(A.bounds, E.bounds);
+			A.height = 1 + std::max(C.height, D.height);
+			B.height = 1 + std::max(A.height, E.height);
+		}
+		return iB;
+	}
+	return iA;
+}
+
+void AABBTree::update(float dt) {
+	bool hasChanged;
+	for (auto &item: items_) {
+		hasChanged = item.shape->updateGeometry();
+		hasChanged = item.shape->updateTransform(hasChanged) || hasChanged;
+		if (!hasChanged) {
+			continue;
+		}
+		item.bounds = computeBounds(*item.shape.get());
+		// nothing to do if the item is still inside of its fat bounds
+		if (containsBounds(nodes_[item.node].bounds, item.bounds)) {
+			continue;
+		}
+		// else re-insert the leaf with new fat bounds
+		removeLeaf(item.node);
+		nodes_[item.node].bounds = fatten(item.bounds, margin_);
+		insertLeaf(item.node);
+		numReinserts_ += 1;
+	}
+
+	// make the visibility computations
+	updateVisibility();
+}
+
+template<typename Visitor>
+void AABBTree::traverse(const BoundingShape &shape, const Visitor &visitor) const {
+	if (root_ == NULL_NODE) return;
+	AABBTreeQuery query(shape);
+
+	std::vector<int> stack;
+	stack.reserve(64);
+	stack.push_back(root_);
+	while (!stack.empty()) {
+		auto &node = nodes_[stack.back()];
+		stack.pop_back();
+		if (!query.intersects(node.bounds)) {
+			continue;
+		}
+		if (node.isLeaf()) {
+			auto &item = items_[node.item];
+			if (item.shape->hasIntersectionWith(shape)) {
+				// visitor returns false to stop the traversal
+				if (!visitor(*item.shape.get())) return;
+			}
+		} else {
+			stack.push_back(node.children[0]);
+			stack.push_back(node.children[1]);
+		}
+	}
+}
+
+bool AABBTree::hasIntersection(const BoundingShape &shape) {
+	bool hasIntersection = false;
+	traverse(shape, [&hasIntersection](const BoundingShape &) {
+		hasIntersection = true;
+		return false;
+	});
+	return hasIntersection;
+}
+
+int AABBTree::numIntersections(const BoundingShape &shape) {
+	int count = 0;
+	traverse(shape, [&count](const BoundingShape &) {
+		count++;
+		return true;
+	});
+	return count;
+}
+
+void AABBTree::foreachIntersection(
+		const BoundingShape &shape,
+		const std::function<void(const BoundingShape &)> &callback) {
+	traverse(shape, [&callback](const BoundingShape &b_shape) {
+		callback(b_shape);
+		return true;
+	});
+}
+
+void AABBTree::debugDraw(DebugInterface &debug) const {
+	if (root_ == NULL_NODE) return;
+	static const Vec3f leafColor(0, 1, 0);
+	static const Vec3f nodeColor(1, 0, 0);
+
+	std::vector<int> stack;
+	stack.push_back(root_);
+	while (!stack.empty()) {
+		auto &node = nodes_[stack.back()];
+		stack.pop_back();
+		auto &color = node.isLeaf() ? leafColor : nodeColor;
+		auto &min = node.bounds.min;
+		auto &max = node.bounds.max;
+		// draw the 12 edges of the box
+		for (int i = 0; i < 4; ++i) {
+			// corners of the bottom and top face in counter-clockwise order
+			Vec3f a((i == 1 || i == 2) ? max.x : min.x, min.y, (i >= 2) ? max.z : min.z);
+			Vec3f b((i == 0 || i == 1) ? max.x : min.x, min.y, (i == 1 || i == 2) ? max.z : min.z);
+			debug.drawLine(a, b, color);
+			debug.drawLine(Vec3f(a.x, max.y, a.z), Vec3f(b.x, max.y, b.z), color);
+			debug.drawLine(a, Vec3f(a.x, max.y, a.z), color);
+		}
+		if (!node.isLeaf()) {
+			stack.push_back(node.children[0]);
+			stack.push_back(node.children[1]);
+		}
+	}
+}
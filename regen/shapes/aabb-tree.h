@@ -0,0 +1,154 @@
+#ifndef REGEN_AABB_TREE_H_
+#define REGEN_AABB_TREE_H_
+
+#include <vector>
+#include <regen/shapes/spatial-index.h>
+#include <regen/shapes/bounds.h>
+
+namespace regen {
+	/**
+	 * A dynamic AABB tree (bounding volume hierarchy) for spatial indexing.
+	 * In contrast to the quad trees, the tree is fully 3D, and does not
+	 * require a fixed subdivision of space.
+	 * Each leaf stores one item with a "fat" bounding box that is larger than
+	 * the item, such that small movements of the item do not require changes in the tree.
+	 * If an item leaves its fat box, only its leaf is re-inserted, and the tree is
+	 * re-balanced with tree rotations along the path to the root.
+	 */
+	class AABBTree : public SpatialIndex {
+	public:
+		static constexpr int NULL_NODE = -1;
+
+		/**
+		 * An item in the tree, i.e. a shape with its world space bounding box.
+		 */
+		struct Item {
+			ref_ptr<BoundingShape> shape;
+			// tight world space bounds of the shape
+			Bounds<Vec3f> bounds;
+			// index of the leaf node of the item
+			int node = NULL_NODE;
+
+			explicit Item(const ref_ptr<BoundingShape> &shape);
+		};
+
+		/**
+		 * A node in the tree.
+		 * Leaf nodes store an item, internal nodes always have two children.
+		 */
+		struct Node {
+			// fat bounds for leaves, union of the children bounds for internal nodes
+			Bounds<Vec3f> bounds = Bounds<Vec3f>(Vec3f(0), Vec3f(0));
+			// parent node, or next free node if the node is not in use
+			int parent = NULL_NODE;
+			int children[2] = {NULL_NODE, NULL_NODE};
+			// leaf = 0, free node = -1
+			int height = -1;
+			// index of the item in the item array, only valid for leaves
+			int item = NULL_NODE;
+
+			bool isLeaf() const { return children[0] == NULL_NODE; }
+		};
+
+		AABBTree();
+
+		~AABBTree() override = default;
+
+		/**
+		 * @brief Set the margin that is added to the bounds of items in leaf nodes
+		 * A larger margin means less re-insertions of moving items, but more
+		 * overlap between nodes.
+		 * @param margin The margin
+		 */
+		void setMargin(float margin) { margin_ = margin; }
+
+		/**
+		 * @brief Get the margin that is added to the bounds of items in leaf nodes
+		 * @return The margin
+		 */
+		auto margin() const { return margin_; }
+
+		/**
+		 * @brief Get the number of nodes in the tree
+		 * @return The number of nodes
+		 */
+		auto numNodes() const { return numNodes_; }
+
+		/**
+		 * @brief Get the number of items in the tree
+		 * @return The number of items
+		 */
+		auto numItems() const { return static_cast<unsigned int>(items_.size()); }
+
+		/**
+		 * @brief Get the height of the tree
+		 * @return The height, i.e. the number of edges from root to the deepest leaf
+		 */
+		int height() const { return root_ == NULL_NODE ? 0 : nodes_[root_].height; }
+
+		/**
+		 * @brief Get the number of leaves that were re-inserted because
+		 * their item moved outside of the fat bounds.
+		 * @return The number of re-inserted leaves
+		 */
+		auto numReinserts() const { return numReinserts_; }
+
+		/**
+		 * @brief Compute the world space bounding box of a shape
+		 * @param shape The shape
+		 * @return The bounding box
+		 */
+		static Bounds<Vec3f> computeBounds(const BoundingShape &shape);
+
+		// override SpatialIndex::insert
+		void insert(const ref_ptr<BoundingShape> &shape) override;
+
+		// override SpatialIndex::remove
+		void remove(const ref_ptr<BoundingShape> &shape) override;
+
+		// override SpatialIndex::update
+		void update(float dt) override;
+
+		// override SpatialIndex::hasIntersection
+		bool hasIntersection(const BoundingShape &shape) override;
+
+		// override SpatialIndex::numIntersections
+		int numIntersections(const BoundingShape &shape) override;
+
+		// override SpatialIndex::foreachIntersection
+		void foreachIntersection(
+				const BoundingShape &shape,
+				const std::function<void(const BoundingShape &)> &callback) override;
+
+		// override SpatialIndex
+		void debugDraw(DebugInterface &debug) const override;
+
+	protected:
+		std::vector<Node> nodes_;
+		std::vector<Item> items_;
+		// maps shapes to their index in items_
+		std::map<const BoundingShape *, unsigned int> itemIndex_;
+		int root_ = NULL_NODE;
+		int freeList_ = NULL_NODE;
+		unsigned int numNodes_ = 0;
+		unsigned int numReinserts_ = 0;
+		float margin_ = 0.5f;
+
+		int allocateNode();
+
+		void freeNode(int node);
+
+		void insertLeaf(int leaf);
+
+		void removeLeaf(int leaf);
+
+		int balance(int node);
+
+		void refit(int node);
+
+		template<typename Visitor>
+		void traverse(const BoundingShape &shape, const Visitor &visitor) const;
+	};
+} // namespace
+
+#endif /* REGEN_AABB_TREE_H_ */
@@ -73,12 +73,16 @@ unsigned int BoundingShape::transformStamp() const {
 
 Vec3f BoundingShape::translation() const {
 	if (transform_.get()) {
-		auto p = transform_->get()->getVertex(transformIndex_);
 		if (modelOffset_.get()) {
-			return p.r.position() + modelOffset_->getVertex(modelOffsetIndex_).r;
+			// map both inputs at once, such that they are consistent with each other
+			ShaderDataGroup mapped({
+				{transform_->get().get(), ShaderData::READ | ShaderData::INDEX},
+				{modelOffset_.get(), ShaderData::READ | ShaderData::INDEX}});
+			return mapped.r<Mat4f>(0)[transformIndex_].position() +
+				   mapped.r<Vec3f>(1)[modelOffsetIndex_];
 		}
 		else {
-			return p.r.position();
+			return transform_->get()->getVertex(transformIndex_).r.position();
 		}
 	}
 	else if (modelOffset_.get()) {
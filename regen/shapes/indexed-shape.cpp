@@ -1,3 +1,4 @@
+#include <algorithm>
 #include "indexed-shape.h"
 
 using namespace regen;
@@ -35,3 +36,24 @@ void IndexedShape::unmapInstanceIDs_internal() {
 unsigned int *IndexedShape::mappedInstanceIDs() {
 	return mappedInstanceIDs_->mapped.w;
 }
+
+void IndexedShape::nextEpoch() {
+	u_epoch_ += 1;
+	if (u_epoch_ == 0) {
+		// the epoch counter wrapped around, reset all stamps
+		std::fill(u_instanceEpochs_.begin(), u_instanceEpochs_.end(), 0u);
+		u_epoch_ = 1;
+	}
+}
+
+bool IndexedShape::markInstance(unsigned int instanceID) {
+	if (instanceID >= u_instanceEpochs_.size()) {
+		u_instanceEpochs_.resize(std::max(instanceID + 1, shape_->numInstances()), 0u);
+	}
+	auto &stamp = u_instanceEpochs_[instanceID];
+	if (stamp == u_epoch_) {
+		return false;
+	}
+	stamp = u_epoch_;
+	return true;
+}
@@ -54,15 +54,43 @@ namespace regen {
 		unsigned int instanceCount_ = 1;
 		ref_ptr <ShaderInput1ui> visibleVec_;
 
-		std::set<unsigned int> u_visibleSet_;
+		// epoch of the last visibility update that added an instance, indexed by instance ID.
+		// used to avoid adding an instance twice if it is visible in multiple camera shapes.
+		std::vector<unsigned int> u_instanceEpochs_;
+		unsigned int u_epoch_ = 0;
 		unsigned int u_instanceCount_ = 0;
 		bool u_visible_ = false;
+		// version and stamp of the shape when the visibility was computed, used to skip
+		// the computation if neither the shape nor the camera has changed.
+		uint64_t u_cacheVersion_ = 0;
+		uint64_t u_cacheStamp_ = 0;
+		bool u_hasCache_ = false;
+		bool u_isDirty_ = true;
 
 		struct ShapeDistance {
-			const BoundingShape *shape;
+			unsigned int instanceID;
+			// squared distance to the camera
 			float distance;
 		};
-		std::vector<ShapeDistance> instanceDistances_;
+		// Result of one traversal of the index, i.e. the intersection test
+		// with one camera shape. Traversals may run in parallel, each one writes
+		// only into its own slot, results are merged afterwards.
+		struct Traversal {
+			bool visible = false;
+			std::vector<ShapeDistance> instances;
+			// output of the batched culling of instanced volumes
+			std::vector<unsigned int> visibleIDs;
+		};
+		std::vector<Traversal> u_traversals_;
+		// the sorted instances of the last update, and the shape stamp when they were sorted.
+		// each camera shape has its own sorted run, u_sortedRuns_ holds the end of each run.
+		std::vector<ShapeDistance> u_sortedInstances_;
+		std::vector<unsigned int> u_sortedRuns_;
+		std::vector<ShapeDistance> u_sortBuffer_;
+		std::vector<ShapeDistance> u_mergeBuffer_;
+		uint64_t u_sortVersion_ = 0;
+		uint64_t u_sortStamp_ = 0;
+		bool u_hasSortOrder_ = false;
 
 		struct MappedData {
 			explicit MappedData(const ref_ptr <ShaderInput1ui> &visibleVec);
@@ -77,6 +105,10 @@ namespace regen {
 
 		unsigned int *mappedInstanceIDs();
 
+		void nextEpoch();
+
+		bool markInstance(unsigned int instanceID);
+
 		friend class SpatialIndex;
 	};
 } // namespace
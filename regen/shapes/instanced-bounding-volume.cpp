@@ -0,0 +1,456 @@
+#include <regen/utility/logging.h>
+#include <cmath>
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "instanced-bounding-volume.h"
+#include "bounding-box.h"
+#include "bounding-sphere.h"
+
+using namespace regen;
+
+namespace {
+	/**
+	 * Scalar batch of one instance, used as fallback and for the remaining instances
+	 * that do not fill a SIMD batch.
+	 */
+	struct ScalarBatch {
+		using Value = float;
+		using Mask = bool;
+		static constexpr unsigned int WIDTH = 1;
+
+		static Value load(const float *p) { return *p; }
+
+		static Value set(float v) { return v; }
+
+		static Value add(Value a, Value b) { return a + b; }
+
+		static Value sub(Value a, Value b) { return a - b; }
+
+		static Value mul(Value a, Value b) { return a * b; }
+
+		static Value max(Value a, Value b) { return a > b ? a : b; }
+
+		static Value abs(Value a) { return std::abs(a); }
+
+		static Mask greaterEqual(Value a, Value b) { return a >= b; }
+
+		static Mask lessEqual(Value a, Value b) { return a <= b; }
+
+		static Mask both(Mask a, Mask b) { return a && b; }
+
+		static Mask all() { return true; }
+
+		static int bits(Mask m) { return m ? 1 : 0; }
+	};
+
+#if defined(__AVX__)
+	/**
+	 * Batch of 8 instances using AVX instructions.
+	 */
+	struct SimdBatch {
+		using Value = __m256;
+		using Mask = __m256;
+		static constexpr unsigned int WIDTH = 8;
+
+		static Value load(const float *p) { return _mm256_loadu_ps(p); }
+
+		static Value set(float v) { return _mm256_set1_ps(v); }
+
+		static Value add(Value a, Value b) { return _mm256_add_ps(a, b); }
+
+		static Value sub(Value a, Value b) { return _mm256_sub_ps(a, b); }
+
+		static Value mul(Value a, Value b) { return _mm256_mul_ps(a, b); }
+
+		static Value max(Value a, Value b) { return _mm256_max_ps(a, b); }
+
+		static Value abs(Value a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+
+		static Mask greaterEqual(Value a, Value b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+
+		static Mask lessEqual(Value a, Value b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+
+		static Mask both(Mask a, Mask b) { return _mm256_and_ps(a, b); }
+
+		static Mask all() { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+
+		static int bits(Mask m) { return _mm256_movemask_ps(m); }
+	};
+#elif defined(__SSE2__)
+	/**
+	 * Batch of 4 instances using SSE instructions.
+	 */
+	struct SimdBatch {
+		using Value = __m128;
+		using Mask = __m128;
+		static constexpr unsigned int WIDTH = 4;
+
+		static Value load(const float *p) { return _mm_loadu_ps(p); }
+
+		static Value set(float v) { return _mm_set1_ps(v); }
+
+		static Value add(Value a, Value b) { return _mm_add_ps(a, b); }
+
+		static Value sub(Value a, Value b) { return _mm_sub_ps(a, b); }
+
+		static Value mul(Value a, Value b) { return _mm_mul_ps(a, b); }
+
+		static Value max(Value a, Value b) { return _mm_max_ps(a, b); }
+
+		static Value abs(Value a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+
+		static Mask greaterEqual(Value a, Value b) { return _mm_cmpge_ps(a, b); }
+
+		static Mask lessEqual(Value a, Value b) { return _mm_cmple_ps(a, b); }
+
+		static Mask both(Mask a, Mask b) { return _mm_and_ps(a, b); }
+
+		static Mask all() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+
+		static int bits(Mask m) { return _mm_movemask_ps(m); }
+	};
+#else
+	using SimdBatch = ScalarBatch;
+#endif
+}
+
+// a plane in the form a*x + b*y + c*z + d, positive inside of the frustum
+struct CullPlane {
+	float a, b, c, d;
+};
+
+static inline unsigned int writeVisible(int bits, unsigned int first, unsigned int *visibleIDs, unsigned int count) {
+	while (bits != 0) {
+		visibleIDs[count++] = first + __builtin_ctz(static_cast<unsigned int>(bits));
+		bits &= bits - 1;
+	}
+	return count;
+}
+
+template<typename Batch>
+static unsigned int cullSpheresFrustum(
+		const CullPlane *planes,
+		const float *x, const float *y, const float *z, const float *r,
+		unsigned int begin, unsigned int end,
+		unsigned int *visibleIDs, unsigned int count) {
+	typename Batch::Value a[6], b[6], c[6], d[6];
+	for (int k = 0; k < 6; ++k) {
+		a[k] = Batch::set(planes[k].a);
+		b[k] = Batch::set(planes[k].b);
+		c[k] = Batch::set(planes[k].c);
+		d[k] = Batch::set(planes[k].d);
+	}
+	const auto zero = Batch::set(0.0f);
+	unsigned int i = begin;
+	for (; i + Batch::WIDTH <= end; i += Batch::WIDTH) {
+		auto px = Batch::load(x + i);
+		auto py = Batch::load(y + i);
+		auto pz = Batch::load(z + i);
+		auto negRadius = Batch::sub(zero, Batch::load(r + i));
+		auto mask = Batch::all();
+		for (int k = 0; k < 6; ++k) {
+			auto dist = Batch::add(
+					Batch::add(Batch::mul(a[k], px), Batch::mul(b[k], py)),
+					Batch::add(Batch::mul(c[k], pz), d[k]));
+			mask = Batch::both(mask, Batch::greaterEqual(dist, negRadius));
+		}
+		count = writeVisible(Batch::bits(mask), i, visibleIDs, count);
+	}
+	return count;
+}
+
+template<typename Batch>
+static unsigned int cullBoxesFrustum(
+		const CullPlane *planes,
+		const float *x, const float *y, const float *z,
+		const float *ex, const float *ey, const float *ez,
+		unsigned int begin, unsigned int end,
+		unsigned int *visibleIDs, unsigned int count) {
+	typename Batch::Value a[6], b[6], c[6], d[6];
+	typename Batch::Value absA[6], absB[6], absC[6];
+	for (int k = 0; k < 6; ++k) {
+		a[k] = Batch::set(planes[k].a);
+		b[k] = Batch::set(planes[k].b);
+		c[k] = Batch::set(planes[k].c);
+		d[k] = Batch::set(planes[k].d);
+		absA[k] = Batch::set(std::abs(planes[k].a));
+		absB[k] = Batch::set(std::abs(planes[k].b));
+		absC[k] = Batch::set(std::abs(planes[k].c));
+	}
+	const auto zero = Batch::set(0.0f);
+	unsigned int i = begin;
+	for (; i + Batch::WIDTH <= end; i += Batch::WIDTH) {
+		auto px = Batch::load(x + i);
+		auto py = Batch::load(y + i);
+		auto pz = Batch::load(z + i);
+		auto hx = Batch::load(ex + i);
+		auto hy = Batch::load(ey + i);
+		auto hz = Batch::load(ez + i);
+		auto mask = Batch::all();
+		for (int k = 0; k < 6; ++k) {
+			// distance of the box corner that is farthest inside of the plane
+			auto dist = Batch::add(
+					Batch::add(Batch::mul(a[k], px), Batch::mul(b[k], py)),
+					Batch::add(Batch::mul(c[k], pz), d[k]));
+			auto projectedExtent = Batch::add(
+					Batch::add(Batch::mul(absA[k], hx), Batch::mul(absB[k], hy)),
+					Batch::mul(absC[k], hz));
+			mask = Batch::both(mask, Batch::greaterEqual(Batch::add(dist, projectedExtent), zero));
+		}
+		count = writeVisible(Batch::bits(mask), i, visibleIDs, count);
+	}
+	return count;
+}
+
+template<typename Batch>
+static unsigned int cullSpheresSphere(
+		const Vec3f &center, float radius,
+		const float *x, const float *y, const float *z, const float *r,
+		unsigned int begin, unsigned int end,
+		unsigned int *visibleIDs, unsigned int count) {
+	const auto cx = Batch::set(center.x);
+	const auto cy = Batch::set(center.y);
+	const auto cz = Batch::set(center.z);
+	const auto cr = Batch::set(radius);
+	unsigned int i = begin;
+	for (; i + Batch::WIDTH <= end; i += Batch::WIDTH) {
+		auto dx = Batch::sub(Batch::load(x + i), cx);
+		auto dy = Batch::sub(Batch::load(y + i), cy);
+		auto dz = Batch::sub(Batch::load(z + i), cz);
+		auto sumRadius = Batch::add(Batch::load(r + i), cr);
+		auto distSq = Batch::add(Batch::add(Batch::mul(dx, dx), Batch::mul(dy, dy)), Batch::mul(dz, dz));
+		auto mask = Batch::lessEqual(distSq, Batch::mul(sumRadius, sumRadius));
+		count = writeVisible(Batch::bits(mask), i, visibleIDs, count);
+	}
+	return count;
+}
+
+template<typename Batch>
+static unsigned int cullBoxesSphere(
+		const Vec3f &center, float radius,
+		const float *x, const float *y, const float *z,
+		const float *ex, const float *ey, const float *ez,
+		unsigned int begin, unsigned int end,
+		unsigned int *visibleIDs, unsigned int count) {
+	const auto cx = Batch::set(center.x);
+	const auto cy = Batch::set(center.y);
+	const auto cz = Batch::set(center.z);
+	const auto radiusSq = Batch::set(radius * radius);
+	const auto zero = Batch::set(0.0f);
+	unsigned int i = begin;
+	for (; i + Batch::WIDTH <= end; i += Batch::WIDTH) {
+		// distance of the sphere center to the box along each axis
+		auto dx = Batch::max(Batch::sub(Batch::abs(Batch::sub(Batch::load(x + i), cx)), Batch::load(ex + i)), zero);
+		auto dy = Batch::max(Batch::sub(Batch::abs(Batch::sub(Batch::load(y + i), cy)), Batch::load(ey + i)), zero);
+		auto dz = Batch::max(Batch::sub(Batch::abs(Batch::sub(Batch::load(z + i), cz)), Batch::load(ez + i)), zero);
+		auto distSq = Batch::add(Batch::add(Batch::mul(dx, dx), Batch::mul(dy, dy)), Batch::mul(dz, dz));
+		auto mask = Batch::lessEqual(distSq, radiusSq);
+		count = writeVisible(Batch::bits(mask), i, visibleIDs, count);
+	}
+	return count;
+}
+
+InstancedBoundingVolume::InstancedBoundingVolume(const ref_ptr<BoundingShape> &prototype, unsigned int numInstances)
+		: prototype_(prototype),
+		  numInstances_(numInstances > 0u ? numInstances : prototype->numInstances()),
+		  isSphere_(!prototype->isBox()),
+		  bounds_(Vec3f(0.0f), Vec3f(0.0f)),
+		  boundsCenter_(0.0f),
+		  baseCenter_(0.0f),
+		  baseExtent_(0.0f) {
+	if (prototype->isFrustum()) {
+		REGEN_WARN("Frustum shapes are approximated with a sphere in instanced volume '" << prototype->name() << "'.");
+	}
+	centerX_.resize(numInstances_, 0.0f);
+	centerY_.resize(numInstances_, 0.0f);
+	centerZ_.resize(numInstances_, 0.0f);
+	radius_.resize(numInstances_, 0.0f);
+	if (!isSphere_) {
+		extentX_.resize(numInstances_, 0.0f);
+		extentY_.resize(numInstances_, 0.0f);
+		extentZ_.resize(numInstances_, 0.0f);
+	}
+	update(true);
+}
+
+unsigned int InstancedBoundingVolume::batchSize() {
+	return SimdBatch::WIDTH;
+}
+
+void InstancedBoundingVolume::updateBase() {
+	auto &shape = *prototype_.get();
+	// the local center is the center position of the prototype without its translation
+	baseCenter_ = shape.getCenterPosition() - shape.translation();
+	if (shape.isBox()) {
+		auto &box = (const BoundingBox &) shape;
+		baseCenter_ = (box.bounds().max + box.bounds().min) * 0.5f;
+		baseExtent_ = (box.bounds().max - box.bounds().min) * 0.5f;
+		baseRadius_ = baseExtent_.length();
+	} else if (shape.isSphere()) {
+		baseRadius_ = ((const BoundingSphere &) shape).radius();
+	} else {
+		auto &frustum = (const Frustum &) shape;
+		baseCenter_ = Vec3f::zero();
+		baseRadius_ = static_cast<float>(frustum.far);
+	}
+}
+
+bool InstancedBoundingVolume::update(bool forceUpdate) {
+	auto &shape = *prototype_.get();
+	auto geometryChanged = shape.updateGeometry();
+	auto stamp = shape.transformStamp();
+	if (!forceUpdate && !geometryChanged && stamp == lastTransformStamp_) {
+		return false;
+	}
+	lastTransformStamp_ = stamp;
+	updateBase();
+
+	// map the instance data once for all instances
+	auto &transform = shape.transform();
+	auto &modelOffset = shape.modelOffset();
+	std::optional<ShaderData_rw<Mat4f>> tfData;
+	std::optional<ShaderData_rw<Vec3f>> offsetData;
+	unsigned int numTransforms = 0u, numOffsets = 0u;
+	if (transform.get()) {
+		tfData.emplace(transform->get().get(), ShaderData::READ);
+		numTransforms = transform->get()->numInstances();
+	}
+	if (modelOffset.get()) {
+		offsetData.emplace(modelOffset.get(), ShaderData::READ);
+		numOffsets = modelOffset->numInstances();
+	}
+	const bool isOBB = !isSphere_ && ((const BoundingBox &) shape).isOBB();
+
+	for (unsigned int i = 0; i < numInstances_; ++i) {
+		Vec3f center = baseCenter_;
+		Vec3f extent = baseExtent_;
+		if (offsetData.has_value()) {
+			center += offsetData->r[numOffsets > 1 ? i : 0];
+		}
+		if (tfData.has_value()) {
+			auto &tf = tfData->r[numTransforms > 1 ? i : 0];
+			if (isOBB) {
+				// world space box of the rotated box
+				Vec3f axes[3] = {
+						(tf ^ Vec4f(Vec3f::right(), 0.0f)).xyz_(),
+						(tf ^ Vec4f(Vec3f::up(), 0.0f)).xyz_(),
+						(tf ^ Vec4f(Vec3f::front(), 0.0f)).xyz_()};
+				center = (tf ^ Vec4f(center, 0.0f)).xyz_();
+				extent = Vec3f(
+						std::abs(axes[0].x) * baseExtent_.x + std::abs(axes[1].x) * baseExtent_.y +
+						std::abs(axes[2].x) * baseExtent_.z,
+						std::abs(axes[0].y) * baseExtent_.x + std::abs(axes[1].y) * baseExtent_.y +
+						std::abs(axes[2].y) * baseExtent_.z,
+						std::abs(axes[0].z) * baseExtent_.x + std::abs(axes[1].z) * baseExtent_.y +
+						std::abs(axes[2].z) * baseExtent_.z);
+			}
+			center += tf.position();
+		}
+		centerX_[i] = center.x;
+		centerY_[i] = center.y;
+		centerZ_[i] = center.z;
+		if (isSphere_) {
+			radius_[i] = baseRadius_;
+		} else {
+			extentX_[i] = extent.x;
+			extentY_[i] = extent.y;
+			extentZ_[i] = extent.z;
+			radius_[i] = extent.length();
+		}
+	}
+	updateBounds();
+	return true;
+}
+
+void InstancedBoundingVolume::updateBounds() {
+	if (numInstances_ == 0) {
+		bounds_ = Bounds<Vec3f>(Vec3f(0.0f), Vec3f(0.0f));
+		boundsCenter_ = Vec3f(0.0f);
+		boundsRadius_ = 0.0f;
+		return;
+	}
+	Vec3f min(std::numeric_limits<float>::max());
+	Vec3f max(std::numeric_limits<float>::lowest());
+	for (unsigned int i = 0; i < numInstances_; ++i) {
+		Vec3f extent = isSphere_ ? Vec3f(radius_[i]) : Vec3f(extentX_[i], extentY_[i], extentZ_[i]);
+		min.setMin(center(i) - extent);
+		max.setMax(center(i) + extent);
+	}
+	bounds_ = Bounds<Vec3f>(min, max);
+	boundsCenter_ = (min + max) * 0.5f;
+	boundsRadius_ = (max - boundsCenter_).length();
+}
+
+unsigned int InstancedBoundingVolume::cull(const BoundingShape &shape, unsigned int *visibleIDs) const {
+	if (shape.isFrustum()) {
+		return cullFrustum((const Frustum &) shape, visibleIDs);
+	} else if (shape.isSphere()) {
+		return cullSphere(shape.getCenterPosition(), ((const BoundingSphere &) shape).radius(), visibleIDs);
+	} else {
+		auto &box = (const BoundingBox &) shape;
+		auto radius = ((box.bounds().max - box.bounds().min) * 0.5f).length();
+		return cullSphere(shape.getCenterPosition(), radius, visibleIDs);
+	}
+}
+
+unsigned int InstancedBoundingVolume::cullFrustum(const Frustum &frustum, unsigned int *visibleIDs) const {
+	if (numInstances_ == 0 || !frustum.hasIntersectionWithSphere(boundsCenter_, boundsRadius_)) {
+		return 0u;
+	}
+	// Plane::distance(p) = n*(q-p), i.e. a*x+b*y+c*z+d with (a,b,c)=-n and d=n*q
+	CullPlane planes[6];
+	for (int k = 0; k < 6; ++k) {
+		auto &n = frustum.planes[k].normal;
+		planes[k] = {-n.x, -n.y, -n.z, n.dot(frustum.planes[k].point)};
+	}
+	// full batches with SIMD, the remaining instances with the scalar kernel
+	const unsigned int numBatched = numInstances_ - numInstances_ % SimdBatch::WIDTH;
+	unsigned int count;
+	if (isSphere_) {
+		count = cullSpheresFrustum<SimdBatch>(planes,
+				centerX_.data(), centerY_.data(), centerZ_.data(), radius_.data(),
+				0u, numBatched, visibleIDs, 0u);
+		count = cullSpheresFrustum<ScalarBatch>(planes,
+				centerX_.data(), centerY_.data(), centerZ_.data(), radius_.data(),
+				numBatched, numInstances_, visibleIDs, count);
+	} else {
+		count = cullBoxesFrustum<SimdBatch>(planes,
+				centerX_.data(), centerY_.data(), centerZ_.data(),
+				extentX_.data(), extentY_.data(), extentZ_.data(),
+				0u, numBatched, visibleIDs, 0u);
+		count = cullBoxesFrustum<ScalarBatch>(planes,
+				centerX_.data(), centerY_.data(), centerZ_.data(),
+				extentX_.data(), extentY_.data(), extentZ_.data(),
+				numBatched, numInstances_, visibleIDs, count);
+	}
+	return count;
+}
+
+unsigned int InstancedBoundingVolume::cullSphere(const Vec3f &center, float radius, unsigned int *visibleIDs) const {
+	if (numInstances_ == 0 || (center - boundsCenter_).length() > radius + boundsRadius_) {
+		return 0u;
+	}
+	const unsigned int numBatched = numInstances_ - numInstances_ % SimdBatch::WIDTH;
+	unsigned int count;
+	if (isSphere_) {
+		count = cullSpheresSphere<SimdBatch>(center, radius,
+				centerX_.data(), centerY_.data(), centerZ_.data(), radius_.data(),
+				0u, numBatched, visibleIDs, 0u);
+		count = cullSpheresSphere<ScalarBatch>(center, radius,
+				centerX_.data(), centerY_.data(), centerZ_.data(), radius_.data(),
+				numBatched, numInstances_, visibleIDs, count);
+	} else {
+		count = cullBoxesSphere<SimdBatch>(center, radius,
+				centerX_.data(), centerY_.data(), centerZ_.data(),
+				extentX_.data(), extentY_.data(), extentZ_.data(),
+				0u, numBatched, visibleIDs, 0u);
+		count = cullBoxesSphere<ScalarBatch>(center, radius,
+				centerX_.data(), centerY_.data(), centerZ_.data(),
+				extentX_.data(), extentY_.data(), extentZ_.data(),
+				numBatched, numInstances_, visibleIDs, count);
+	}
+	return count;
+}
@@ -0,0 +1,144 @@
+#ifndef REGEN_INSTANCED_BOUNDING_VOLUME_H_
+#define REGEN_INSTANCED_BOUNDING_VOLUME_H_
+
+#include <vector>
+#include <regen/shapes/bounding-shape.h>
+#include <regen/shapes/frustum.h>
+
+namespace regen {
+	/**
+	 * @brief Bounding volumes of all instances of an instanced shape.
+	 * The instance volumes are stored in structure-of-arrays form, i.e. one array
+	 * per coordinate, such that they can be tested in batches of 4 (SSE) or 8 (AVX)
+	 * instances against a frustum or a sphere.
+	 * The volume is created from a prototype shape that defines the shape type,
+	 * mesh, parts and transform of the instances.
+	 * Sphere prototypes are stored as center and radius, box prototypes as world space
+	 * axis aligned box, i.e. center and half extent.
+	 */
+	class InstancedBoundingVolume {
+	public:
+		/**
+		 * @brief Construct a new instanced bounding volume
+		 * @param prototype The shape of the first instance, its transform is used for all instances.
+		 * @param numInstances The number of instances, by default the number of instances of the prototype.
+		 */
+		explicit InstancedBoundingVolume(const ref_ptr<BoundingShape> &prototype, unsigned int numInstances = 0u);
+
+		/**
+		 * @brief Get the prototype shape
+		 * @return The prototype shape
+		 */
+		auto &prototype() const { return prototype_; }
+
+		/**
+		 * @brief Get the name of the shape
+		 * @return The name
+		 */
+		const std::string &name() const { return prototype_->name(); }
+
+		/**
+		 * @brief Get the number of instances
+		 * @return The number of instances
+		 */
+		auto numInstances() const { return numInstances_; }
+
+		/**
+		 * @brief Check if the instances are bounded by spheres
+		 * @return True for spheres, false for boxes
+		 */
+		auto isSphere() const { return isSphere_; }
+
+		/**
+		 * @brief Get the center position of an instance
+		 * @param instanceID The instance ID
+		 * @return The center position
+		 */
+		Vec3f center(unsigned int instanceID) const {
+			return {centerX_[instanceID], centerY_[instanceID], centerZ_[instanceID]};
+		}
+
+		/**
+		 * @brief Get the radius of an instance, i.e. of the bounding sphere of a box
+		 * @param instanceID The instance ID
+		 * @return The radius
+		 */
+		float radius(unsigned int instanceID) const { return radius_[instanceID]; }
+
+		/**
+		 * @brief Get the world space bounds of all instances
+		 * @return The bounds
+		 */
+		auto &bounds() const { return bounds_; }
+
+		/**
+		 * @brief Update the instance volumes if the transform or geometry has changed
+		 * Note: the instance data is mapped only once for all instances.
+		 * @param forceUpdate Update even if nothing has changed
+		 * @return True if the volumes have changed
+		 */
+		bool update(bool forceUpdate = false);
+
+		/**
+		 * @brief Test all instances against a shape
+		 * Frustum and sphere shapes are supported, other shapes are
+		 * approximated with their bounding sphere.
+		 * @param shape The shape
+		 * @param visibleIDs Output array for IDs of intersecting instances, must have numInstances() elements
+		 * @return The number of intersecting instances
+		 */
+		unsigned int cull(const BoundingShape &shape, unsigned int *visibleIDs) const;
+
+		/**
+		 * @brief Test all instances against a frustum
+		 * @param frustum The frustum
+		 * @param visibleIDs Output array for IDs of intersecting instances, must have numInstances() elements
+		 * @return The number of intersecting instances
+		 */
+		unsigned int cullFrustum(const Frustum &frustum, unsigned int *visibleIDs) const;
+
+		/**
+		 * @brief Test all instances against a sphere
+		 * @param center The center of the sphere
+		 * @param radius The radius of the sphere
+		 * @param visibleIDs Output array for IDs of intersecting instances, must have numInstances() elements
+		 * @return The number of intersecting instances
+		 */
+		unsigned int cullSphere(const Vec3f &center, float radius, unsigned int *visibleIDs) const;
+
+		/**
+		 * @brief Get the number of instances that are tested in one batch
+		 * @return 8 with AVX, 4 with SSE, else 1
+		 */
+		static unsigned int batchSize();
+
+	protected:
+		ref_ptr<BoundingShape> prototype_;
+		unsigned int numInstances_;
+		bool isSphere_;
+		// SoA instance data
+		std::vector<float> centerX_;
+		std::vector<float> centerY_;
+		std::vector<float> centerZ_;
+		std::vector<float> radius_;
+		// half extents, only used for boxes
+		std::vector<float> extentX_;
+		std::vector<float> extentY_;
+		std::vector<float> extentZ_;
+		// union of all instance volumes
+		Bounds<Vec3f> bounds_;
+		Vec3f boundsCenter_;
+		float boundsRadius_ = 0.0f;
+		// local volume of the prototype
+		Vec3f baseCenter_;
+		Vec3f baseExtent_;
+		float baseRadius_ = 0.0f;
+		unsigned int lastTransformStamp_ = 0u;
+
+		void updateBase();
+
+		void updateBounds();
+	};
+} // namespace
+
+#endif /* REGEN_INSTANCED_BOUNDING_VOLUME_H_ */
@@ -0,0 +1,402 @@
+#include <limits>
+
+#include "linear-quad-tree.h"
+
+// upper bound for the depth, 16 bit per coordinate would fit into the Morton code,
+// but all nodes are allocated, so the node array grows with 4^depth.
+#define LINEAR_QUAD_TREE_MAX_DEPTH 12
+#define LINEAR_QUAD_TREE_SQUARED
+
+using namespace regen;
+
+// spread the lower 16 bits of v such that there is a zero bit between each of them
+static inline unsigned int spreadBits(unsigned int v) {
+	v &= 0x0000ffff;
+	v = (v | (v << 8u)) & 0x00ff00ff;
+	v = (v | (v << 4u)) & 0x0f0f0f0f;
+	v = (v | (v << 2u)) & 0x33333333;
+	v = (v | (v << 1u)) & 0x55555555;
+	return v;
+}
+
+// inverse of spreadBits
+static inline unsigned int compactBits(unsigned int v) {
+	v &= 0x55555555;
+	v = (v | (v >> 1u)) & 0x33333333;
+	v = (v | (v >> 2u)) & 0x0f0f0f0f;
+	v = (v | (v >> 4u)) & 0x00ff00ff;
+	v = (v | (v >> 8u)) & 0x0000ffff;
+	return v;
+}
+
+static inline unsigned int mortonCode(unsigned int x, unsigned int y) {
+	return spreadBits(x) | (spreadBits(y) << 1u);
+}
+
+static const BoundingShape &initShape(const ref_ptr<BoundingShape> &shape) {
+	shape->updateTransform(false);
+	return *shape.get();
+}
+
+LinearQuadTree::Item::Item(const ref_ptr<BoundingShape> &shape) :
+		shape(shape),
+		projection(initShape(shape)) {
+}
+
+LinearQuadTree::LinearQuadTree()
+		: SpatialIndex(),
+		  bounds_(Vec2f(0), Vec2f(0)) {
+	setMaxDepth(8);
+}
+
+void LinearQuadTree::setMaxDepth(unsigned int depth) {
+	maxDepth_ = std::min(depth, static_cast<unsigned int>(LINEAR_QUAD_TREE_MAX_DEPTH));
+	// level L starts at (4^L - 1) / 3
+	levelOffsets_.resize(maxDepth_ + 2);
+	levelOffsets_[0] = 0;
+	for (unsigned int level = 1; level < levelOffsets_.size(); ++level) {
+		levelOffsets_[level] = levelOffsets_[level - 1] + (1u << (2u * (level - 1)));
+	}
+	nodes_.resize(levelOffsets_.back());
+	// enforce re-assignment of items to nodes in next update
+	usedDepth_ = maxDepth_ + 1;
+}
+
+unsigned int LinearQuadTree::numNodes() const {
+	unsigned int count = 0;
+	for (unsigned int i = 0; i < levelOffsets_[usedDepth_ + 1]; ++i) {
+		if (nodes_[i].numItems > 0) {
+			count++;
+		}
+	}
+	return count;
+}
+
+void LinearQuadTree::insert(const ref_ptr<BoundingShape> &shape) {
+	newItems_.emplace_back(shape);
+	addToIndex(shape);
+}
+
+void LinearQuadTree::remove(const ref_ptr<BoundingShape> &shape) {
+	auto it = itemIndex_.find(shape.get());
+	if (it == itemIndex_.end()) {
+		auto jt = std::find_if(newItems_.begin(), newItems_.end(),
+							   [&shape](const Item &item) { return item.shape.get() == shape.get(); });
+		if (jt == newItems_.end()) {
+			REGEN_WARN("Shape not found in quad tree.");
+			return;
+		}
+		newItems_.erase(jt);
+		removeFromIndex(shape);
+		return;
+	}
+	// swap with the last item to keep the item array packed.
+	// note: the node lists are patched as well, queries may happen before the next update.
+	auto index = it->second;
+	auto lastIndex = static_cast<unsigned int>(items_.size() - 1);
+	unlinkItem(index);
+	if (index != lastIndex) {
+		auto *lastEntry = findNodeEntry(lastIndex);
+		if (lastEntry) *lastEntry = index;
+		items_[index] = std::move(items_[lastIndex]);
+		itemIndex_[items_[index].shape.get()] = index;
+	}
+	items_.pop_back();
+	itemIndex_.erase(it);
+	isDirty_ = true;
+	removeFromIndex(shape);
+}
+
+unsigned int *LinearQuadTree::findNodeEntry(unsigned int itemIndex) {
+	// items are not assigned to nodes before the first update after setMaxDepth
+	if (usedDepth_ > maxDepth_) return nullptr;
+	auto &node = nodes_[items_[itemIndex].node];
+	if (node.firstItem + node.numItems > itemIndices_.size()) return nullptr;
+	auto *entries = itemIndices_.data() + node.firstItem;
+	for (unsigned int i = 0; i < node.numItems; ++i) {
+		if (entries[i] == itemIndex) return entries + i;
+	}
+	return nullptr;
+}
+
+void LinearQuadTree::unlinkItem(unsigned int itemIndex) {
+	auto *entry = findNodeEntry(itemIndex);
+	if (!entry) return;
+	auto nodeIndex = items_[itemIndex].node;
+	auto &node = nodes_[nodeIndex];
+	// swap with the last entry of the node, the gap is closed by the next rebuild
+	node.numItems -= 1;
+	*entry = itemIndices_[node.firstItem + node.numItems];
+	// update the subtree counts of the node and all of its ancestors
+	unsigned int level = usedDepth_;
+	while (levelOffsets_[level] > nodeIndex) level -= 1;
+	auto morton = nodeIndex - levelOffsets_[level];
+	while (true) {
+		nodes_[levelOffsets_[level] + morton].numSubtreeItems -= 1;
+		if (level == 0) break;
+		level -= 1;
+		morton >>= 2u;
+	}
+}
+
+unsigned int LinearQuadTree::computeNode(const Item &item) const {
+	auto itemBounds = item.projection.bounds();
+	auto itemSize = std::max(
+			itemBounds.max.x - itemBounds.min.x,
+			itemBounds.max.y - itemBounds.min.y);
+	// find the deepest level where the cells are still at least as large as the item
+	auto cellSize = bounds_.max.x - bounds_.min.x;
+	unsigned int level = 0;
+	while (level < usedDepth_ && cellSize * 0.5f >= itemSize) {
+		cellSize *= 0.5f;
+		level += 1;
+	}
+	// the cell that contains the center of the item
+	auto center = itemBounds.center();
+	auto maxCell = static_cast<float>((1u << level) - 1u);
+	auto x = (cellSize > 0.0f ? std::floor((center.x - bounds_.min.x) / cellSize) : 0.0f);
+	auto y = (cellSize > 0.0f ? std::floor((center.y - bounds_.min.y) / cellSize) : 0.0f);
+	x = std::clamp(x, 0.0f, maxCell);
+	y = std::clamp(y, 0.0f, maxCell);
+	return levelOffsets_[level] + mortonCode(
+			static_cast<unsigned int>(x),
+			static_cast<unsigned int>(y));
+}
+
+Bounds<Vec2f> LinearQuadTree::nodeBounds(unsigned int level, unsigned int morton) const {
+	auto cellSize = (bounds_.max.x - bounds_.min.x) / static_cast<float>(1u << level);
+	auto x = static_cast<float>(compactBits(morton));
+	auto y = static_cast<float>(compactBits(morton >> 1u));
+	// loose bounds: the cell extended by half of its size on each side
+	Vec2f min(
+			bounds_.min.x + (x - 0.5f) * cellSize,
+			bounds_.min.y + (y - 0.5f) * cellSize);
+	return {min, min + Vec2f(cellSize * 2.0f)};
+}
+
+void LinearQuadTree::rebuild() {
+	auto numUsedNodes = levelOffsets_[usedDepth_ + 1];
+	for (unsigned int i = 0; i < numUsedNodes; ++i) {
+		nodes_[i] = Node();
+	}
+	// counting sort of the items by node index
+	for (auto &item: items_) {
+		nodes_[item.node].numItems += 1;
+	}
+	unsigned int offset = 0;
+	for (unsigned int i = 0; i < numUsedNodes; ++i) {
+		auto &node = nodes_[i];
+		node.firstItem = offset;
+		node.numSubtreeItems = node.numItems;
+		offset += node.numItems;
+		// note: numItems is used as insertion cursor below
+		node.numItems = 0;
+	}
+	itemIndices_.resize(items_.size());
+	for (unsigned int i = 0; i < items_.size(); ++i) {
+		auto &node = nodes_[items_[i].node];
+		itemIndices_[node.firstItem + node.numItems] = i;
+		node.numItems += 1;
+	}
+	// accumulate subtree counts bottom-up
+	for (unsigned int level = usedDepth_; level > 0; --level) {
+		auto numLevelNodes = 1u << (2u * level);
+		auto *levelNodes = &nodes_[levelOffsets_[level]];
+		auto *parentNodes = &nodes_[levelOffsets_[level - 1]];
+		for (unsigned int morton = 0; morton < numLevelNodes; ++morton) {
+			parentNodes[morton >> 2u].numSubtreeItems += levelNodes[morton].numSubtreeItems;
+		}
+	}
+	isDirty_ = false;
+}
+
+void LinearQuadTree::update(float dt) {
+	static auto maxFloat = Vec2f(std::numeric_limits<float>::lowest());
+	static auto minFloat = Vec2f(std::numeric_limits<float>::max());
+	Bounds<Vec2f> newBounds(minFloat, maxFloat);
+	bool hasChanged;
+
+	if (!items_.empty()) {
+		// never shrink the root node
+		newBounds.extend(bounds_);
+	}
+	// go through all items and update their geometry and transform, and the new bounds
+	std::vector<unsigned int> changedItems;
+	for (unsigned int i = 0; i < items_.size(); ++i) {
+		auto &item = items_[i];
+		hasChanged = item.shape->updateGeometry();
+		hasChanged = item.shape->updateTransform(hasChanged) || hasChanged;
+		if (hasChanged) {
+			item.projection.update(*item.shape.get());
+			changedItems.push_back(i);
+		}
+		newBounds.extend(item.projection.bounds());
+	}
+	// move new items into the item array
+	for (auto &item: newItems_) {
+		hasChanged = item.shape->updateGeometry();
+		hasChanged = item.shape->updateTransform(hasChanged) || hasChanged;
+		if (hasChanged) {
+			item.projection.update(*item.shape.get());
+		}
+		newBounds.extend(item.projection.bounds());
+		auto index = static_cast<unsigned int>(items_.size());
+		itemIndex_[item.shape.get()] = index;
+		changedItems.push_back(index);
+		items_.push_back(std::move(item));
+	}
+	newItems_.clear();
+
+	if (!items_.empty()) {
+#ifdef LINEAR_QUAD_TREE_SQUARED
+		// make the bounds square
+		newBounds.min.x = std::min(newBounds.min.x, newBounds.min.y);
+		newBounds.min.y = newBounds.min.x;
+		newBounds.max.x = std::max(newBounds.max.x, newBounds.max.y);
+		newBounds.max.y = newBounds.max.x;
+#endif
+		if (newBounds != bounds_ || usedDepth_ > maxDepth_) {
+			// the cells have changed, all items must be re-assigned
+			bounds_ = newBounds;
+			auto cellSize = bounds_.max.x - bounds_.min.x;
+			usedDepth_ = 0;
+			while (usedDepth_ < maxDepth_ && cellSize * 0.5f >= minNodeSize_) {
+				cellSize *= 0.5f;
+				usedDepth_ += 1;
+			}
+			for (auto &item: items_) {
+				item.node = computeNode(item);
+			}
+			isDirty_ = true;
+		} else {
+			// only re-assign items that have changed
+			for (auto i: changedItems) {
+				auto &item = items_[i];
+				auto node = computeNode(item);
+				if (node != item.node || i >= itemIndices_.size()) {
+					item.node = node;
+					isDirty_ = true;
+				}
+			}
+		}
+	}
+	if (isDirty_) {
+		rebuild();
+	}
+
+	// make the visibility computations
+	updateVisibility();
+}
+
+bool LinearQuadTree::hasIntersection(const BoundingShape &shape) {
+	int count = 0;
+	foreachIntersection(shape, [&count](const BoundingShape &) {
+		count++;
+	});
+	return count > 0;
+}
+
+int LinearQuadTree::numIntersections(const BoundingShape &shape) {
+	int count = 0;
+	foreachIntersection(shape, [&count](const BoundingShape &) {
+		count++;
+	});
+	return count;
+}
+
+void LinearQuadTree::foreachIntersection(
+		const BoundingShape &shape,
+		const std::function<void(const BoundingShape &)> &callback) {
+	if (items_.empty() || nodes_[0].numSubtreeItems == 0) return;
+	// project the shape onto the xz-plane for faster intersection tests
+	// with the quad tree nodes.
+	OrthogonalProjection shape_projection(shape);
+
+	// note: each node pushes at most 4 children, and the stack is processed depth first.
+	struct StackEntry {
+		unsigned int level;
+		unsigned int morton;
+	};
+	std::array<StackEntry, 3 * LINEAR_QUAD_TREE_MAX_DEPTH + 4> stack;
+	unsigned int stackSize = 0;
+	stack[stackSize++] = {0u, 0u};
+
+	while (stackSize > 0) {
+		auto [level, morton] = stack[--stackSize];
+		auto &node = nodes_[levelOffsets_[level] + morton];
+		// 2D intersection test with the xz-projection
+		if (!shape_projection.intersects(nodeBounds(level, morton))) {
+			continue;
+		}
+		// 3D intersection test with the shapes in the node.
+		// note: each item is stored in exactly one node, so no need to check for duplicates.
+		auto *itemIndex = itemIndices_.data() + node.firstItem;
+		for (unsigned int i = 0; i < node.numItems; ++i) {
+			auto &item = items_[itemIndex[i]];
+			if (item.shape->hasIntersectionWith(shape)) {
+				callback(*item.shape.get());
+			}
+		}
+		// add non-empty children to the stack
+		if (level < usedDepth_ && node.numSubtreeItems > node.numItems) {
+			auto *children = &nodes_[levelOffsets_[level + 1] + (morton << 2u)];
+			for (unsigned int k = 0; k < 4; ++k) {
+				if (children[k].numSubtreeItems > 0) {
+					stack[stackSize++] = {level + 1, (morton << 2u) | k};
+				}
+			}
+		}
+	}
+}
+
+static inline Vec3f toVec3(const Vec2f &v, float y) {
+	return {v.x, y, v.y};
+}
+
+void LinearQuadTree::debugDraw(DebugInterface &debug) const {
+	if (items_.empty()) return;
+	static const float drawHeight = 5.5f;
+	Vec3f lineColor(1, 0, 0);
+
+	// draw the cells of non-empty nodes
+	for (unsigned int level = 0; level <= usedDepth_; ++level) {
+		auto numLevelNodes = 1u << (2u * level);
+		auto cellSize = (bounds_.max.x - bounds_.min.x) / static_cast<float>(1u << level);
+		for (unsigned int morton = 0; morton < numLevelNodes; ++morton) {
+			if (nodes_[levelOffsets_[level] + morton].numSubtreeItems == 0) {
+				continue;
+			}
+			auto x = static_cast<float>(compactBits(morton));
+			auto y = static_cast<float>(compactBits(morton >> 1u));
+			Vec2f min(bounds_.min.x + x * cellSize, bounds_.min.y + y * cellSize);
+			Vec2f max = min + Vec2f(cellSize);
+			debug.drawLine(toVec3(min, drawHeight), toVec3(Vec2f(max.x, min.y), drawHeight), lineColor);
+			debug.drawLine(toVec3(Vec2f(max.x, min.y), drawHeight), toVec3(max, drawHeight), lineColor);
+			debug.drawLine(toVec3(max, drawHeight), toVec3(Vec2f(min.x, max.y), drawHeight), lineColor);
+			debug.drawLine(toVec3(Vec2f(min.x, max.y), drawHeight), toVec3(min, drawHeight), lineColor);
+		}
+	}
+
+	// draw 2d projections of the shapes
+	lineColor = Vec3f(0, 1, 0);
+	const GLfloat h = 5.1f;
+	for (auto &item: items_) {
+		auto &projection = item.projection;
+		auto &points = projection.points;
+		switch (projection.type) {
+			case OrthogonalProjection::Type::CIRCLE: {
+				auto radius = std::sqrt(points[1].x);
+				debug.drawCircle(toVec3(points[0], h), radius, lineColor);
+				break;
+			}
+			default:
+				for (size_t i = 0; i < points.size(); i++) {
+					debug.drawLine(
+							toVec3(points[i], h),
+							toVec3(points[(i + 1) % points.size()], h),
+							lineColor);
+				}
+				break;
+		}
+	}
+}
@@ -0,0 +1,140 @@
+#ifndef REGEN_LINEAR_QUAD_TREE_H_
+#define REGEN_LINEAR_QUAD_TREE_H_
+
+#include <vector>
+#include <regen/shapes/spatial-index.h>
+#include <regen/shapes/bounds.h>
+#include <regen/shapes/orthogonal-projection.h>
+
+namespace regen {
+	/**
+	 * A linear (pointer-less) quad tree for spatial indexing.
+	 * All nodes of a complete quad tree with fixed depth are stored in one contiguous
+	 * array, nodes of one level are addressed by the Morton code of their cell.
+	 * Each item is assigned to exactly one node: the deepest node whose cell is at least
+	 * as large as the item, and which contains the center of the item.
+	 * Node bounds are "loose", i.e. extended by half of the cell size on each side,
+	 * such that they fully contain all items assigned to them.
+	 * Items of a node are stored in a packed index array that is rebuilt
+	 * with a counting sort whenever the assignment of items to nodes changes.
+	 */
+	class LinearQuadTree : public SpatialIndex {
+	public:
+		/**
+		 * An item in the quad tree, i.e. a shape with its orthogonal projection.
+		 */
+		struct Item {
+			ref_ptr<BoundingShape> shape;
+			OrthogonalProjection projection;
+			// index of the node in the node array
+			unsigned int node = 0;
+
+			explicit Item(const ref_ptr<BoundingShape> &shape);
+		};
+
+		/**
+		 * A node in the quad tree.
+		 * Nodes do not store their bounds, these are computed from level and Morton code.
+		 */
+		struct Node {
+			// index of first item in the packed item array
+			unsigned int firstItem = 0;
+			// number of items assigned to this node
+			unsigned int numItems = 0;
+			// number of items assigned to this node and all of its descendants
+			unsigned int numSubtreeItems = 0;
+		};
+
+		LinearQuadTree();
+
+		~LinearQuadTree() override = default;
+
+		/**
+		 * @brief Set the minimum size of a node
+		 * @param size The minimum size
+		 */
+		void setMinNodeSize(float size) { minNodeSize_ = size; }
+
+		/**
+		 * @brief Set the maximum depth of the tree
+		 * Note that all nodes up to this depth are allocated, i.e. (4^(depth+1)-1)/3 nodes.
+		 * @param depth The maximum depth, must be in the range [0, 12]
+		 */
+		void setMaxDepth(unsigned int depth);
+
+		/**
+		 * @brief Get the maximum depth of the tree
+		 * @return The maximum depth
+		 */
+		auto maxDepth() const { return maxDepth_; }
+
+		/**
+		 * @brief Get the bounds of the root node
+		 * @return The bounds
+		 */
+		auto &bounds() const { return bounds_; }
+
+		/**
+		 * @brief Get the number of nodes in the quad tree that contain items
+		 * @return The number of nodes
+		 */
+		unsigned int numNodes() const;
+
+		/**
+		 * @brief Get the number of items in the quad tree
+		 * @return The number of items
+		 */
+		auto numItems() const { return static_cast<unsigned int>(items_.size()); }
+
+		// override SpatialIndex::insert
+		void insert(const ref_ptr<BoundingShape> &shape) override;
+
+		// override SpatialIndex::remove
+		void remove(const ref_ptr<BoundingShape> &shape) override;
+
+		// override SpatialIndex::update
+		void update(float dt) override;
+
+		// override SpatialIndex::hasIntersection
+		bool hasIntersection(const BoundingShape &shape) override;
+
+		// override SpatialIndex::numIntersections
+		int numIntersections(const BoundingShape &shape) override;
+
+		// override SpatialIndex::foreachIntersection
+		void foreachIntersection(
+				const BoundingShape &shape,
+				const std::function<void(const BoundingShape &)> &callback) override;
+
+		// override SpatialIndex
+		void debugDraw(DebugInterface &debug) const override;
+
+	protected:
+		std::vector<Node> nodes_;
+		std::vector<Item> items_;
+		std::vector<Item> newItems_;
+		// item indices sorted by node
+		std::vector<unsigned int> itemIndices_;
+		// maps shapes to their index in items_
+		std::map<const BoundingShape *, unsigned int> itemIndex_;
+		// index of first node of each level in nodes_
+		std::vector<unsigned int> levelOffsets_;
+		unsigned int maxDepth_ = 0;
+		unsigned int usedDepth_ = 0;
+		float minNodeSize_ = 0.1f;
+		Bounds<Vec2f> bounds_;
+		bool isDirty_ = false;
+
+		unsigned int computeNode(const Item &item) const;
+
+		Bounds<Vec2f> nodeBounds(unsigned int level, unsigned int morton) const;
+
+		void rebuild();
+
+		unsigned int *findNodeEntry(unsigned int itemIndex);
+
+		void unlinkItem(unsigned int itemIndex);
+	};
+} // namespace
+
+#endif /* REGEN_LINEAR_QUAD_TREE_H_ */
@@ -15,6 +15,18 @@ std::pair<float, float> project(const std::vector<Vec2f> &points, const Vec2f &a
 	return {*minIt, *maxIt};
 }
 
+static std::pair<float, float> project(const Bounds<Vec2f> &b, const Vec2f &axis) {
+	std::array<float, 4> projections = {
+		b.min.dot(axis),
+		Vec2f(b.max.x, b.min.y).dot(axis),
+		Vec2f(b.min.x, b.max.y).dot(axis),
+		b.max.dot(axis)
+	};
+
+	auto [minIt, maxIt] = std::minmax_element(projections.begin(), projections.end());
+	return {*minIt, *maxIt};
+}
+
 OrthogonalProjection::OrthogonalProjection(const BoundingShape &shape) {
 	update(shape);
 }
@@ -223,3 +235,36 @@ Bounds<Vec2f> OrthogonalProjection::bounds() const {
 	}
 	return targetBounds;
 }
+
+bool OrthogonalProjection::intersects(const Bounds<Vec2f> &box) const {
+	switch (type) {
+		case Type::CIRCLE: {
+			const auto &radiusSqr = points[1].x; // = radius * radius
+			const auto &center = points[0];
+			// Calculate the squared distance from the circle's center to the AABB
+			float sqDist = 0.0f;
+			if (center.x < box.min.x) {
+				sqDist += (box.min.x - center.x) * (box.min.x - center.x);
+			} else if (center.x > box.max.x) {
+				sqDist += (center.x - box.max.x) * (center.x - box.max.x);
+			}
+			if (center.y < box.min.y) {
+				sqDist += (box.min.y - center.y) * (box.min.y - center.y);
+			} else if (center.y > box.max.y) {
+				sqDist += (center.y - box.max.y) * (center.y - box.max.y);
+			}
+			return sqDist < radiusSqr;
+		}
+		case Type::TRIANGLE:
+		case Type::RECTANGLE:
+			// Check for separation along the axes of the shape and the axis-aligned quad
+			for (const auto &axis: axes) {
+				auto [minA, maxA] = project(box, axis.dir);
+				if (maxA < axis.min || axis.max < minA) {
+					return false;
+				}
+			}
+			return true;
+	}
+	return false;
+}
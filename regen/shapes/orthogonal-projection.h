@@ -28,6 +28,13 @@ namespace regen {
 		 */
 		Bounds<Vec2f> bounds() const;
 
+		/**
+		 * Check if the projection intersects with an axis-aligned 2D box.
+		 * @param box The box bounds
+		 * @return true if the projection intersects with the box
+		 */
+		bool intersects(const Bounds<Vec2f> &box) const;
+
 		Type type = Type::CIRCLE;
 		std::vector<Vec2f> points;
 		struct Axis {
@@ -1,15 +1,16 @@
 #include <stack>
+#include <queue>
 #include <chrono>
 #include <limits>
 
 #include "quad-tree.h"
 
-#undef QUAD_TREE_THREADING
 #undef QUAD_TREE_DEBUG
 #define QUAD_TREE_EVER_GROWING
 #define QUAD_TREE_SQUARED
 #define QUAD_TREE_SUBDIVIDE_THRESHOLD 4
 #define QUAD_TREE_COLLAPSE_THRESHOLD 2
+#define QUAD_TREE_MAX_REGROW_STEPS 16
 
 using namespace regen;
 
@@ -306,49 +307,14 @@ bool QuadTree::Node::isLeaf() const {
 	return children[0] == nullptr;
 }
 
-std::pair<float, float> project(const Bounds<Vec2f> &b, const Vec2f &axis) {
-	std::array<float, 4> projections = {
-		b.min.dot(axis),
-		Vec2f(b.max.x, b.min.y).dot(axis),
-		Vec2f(b.min.x, b.max.y).dot(axis),
-		b.max.dot(axis)
-	};
-
-	auto [minIt, maxIt] = std::minmax_element(projections.begin(), projections.end());
-	return {*minIt, *maxIt};
+bool QuadTree::Node::intersects(const OrthogonalProjection &projection) const {
+	return projection.intersects(bounds);
 }
 
-bool QuadTree::Node::intersects(const OrthogonalProjection &projection) const {
-	switch (projection.type) {
-		case OrthogonalProjection::Type::CIRCLE: {
-			const auto &radiusSqr = projection.points[1].x; // = radius * radius
-			const auto &center = projection.points[0];
-			// Calculate the squared distance from the circle's center to the AABB
-			float sqDist = 0.0f;
-			if (center.x < bounds.min.x) {
-				sqDist += (bounds.min.x - center.x) * (bounds.min.x - center.x);
-			} else if (center.x > bounds.max.x) {
-				sqDist += (center.x - bounds.max.x) * (center.x - bounds.max.x);
-			}
-			if (center.y < bounds.min.y) {
-				sqDist += (bounds.min.y - center.y) * (bounds.min.y - center.y);
-			} else if (center.y > bounds.max.y) {
-				sqDist += (center.y - bounds.max.y) * (center.y - bounds.max.y);
-			}
-			return sqDist < radiusSqr;
-		}
-		case OrthogonalProjection::Type::TRIANGLE:
-		case OrthogonalProjection::Type::RECTANGLE:
-			// Check for separation along the axes of the shape and the axis-aligned quad
-			for (const auto &axis: projection.axes) {
-				auto [minA, maxA] = project(bounds, axis.dir);
-				if (maxA < axis.min || axis.max < minA) {
-					return false;
-				}
-			}
-			return true;
-	}
-	return false;
+float QuadTree::Node::distanceSquared(const Vec3f &point) const {
+	float dx = std::max(std::max(bounds.min.x - point.x, point.x - bounds.max.x), 0.0f);
+	float dz = std::max(std::max(bounds.min.y - point.z, point.z - bounds.max.y), 0.0f);
+	return dx * dx + dz * dz;
 }
 
 bool QuadTree::hasIntersection(const BoundingShape &shape) {
@@ -367,69 +333,6 @@ int QuadTree::numIntersections(const BoundingShape &shape) {
 	return count;
 }
 
-#ifdef QUAD_TREE_THREADING
-namespace regen {
-	class QuadTreeWorker : public ThreadPool::Runner {
-	public:
-		using Callback = std::function<void(const BoundingShape &)>;
-
-		ThreadPool *threadPool;
-		const BoundingShape *shape;
-		const OrthogonalProjection *projection;
-		const QuadTree::Node *node;
-		std::set<const QuadTree::Item *> *visited;
-		std::mutex *mutex;
-		const Callback &callback;
-		std::vector<std::shared_ptr<QuadTreeWorker>> children_;
-
-		explicit QuadTreeWorker(const Callback &callback)
-				: callback(callback) {
-		}
-
-		~QuadTreeWorker() override = default;
-
-		void run() override {
-			// 2D intersection test with the xz-projection
-			if (!node->intersects(*projection)) {
-				return;
-			}
-			if (node->isLeaf()) {
-				// 3D intersection test with the shapes in the node
-				for (const auto &quadShape: node->shapes) {
-					{
-						std::lock_guard<std::mutex> lock(*mutex);
-						if (visited->find(quadShape) != visited->end()) {
-							continue;
-						}
-						visited->insert(quadShape);
-					}
-					if (quadShape->shape->hasIntersectionWith(*shape)) {
-						callback(*quadShape->shape.get());
-					}
-				}
-			}
-			else {
-				static auto excHandler = [](const std::exception &) {};
-				// Add the children to the stack
-				for (auto &child: node->children) {
-					if (child && (!child->isLeaf() || !child->shapes.empty())) {
-						auto childWorker = std::make_shared<QuadTreeWorker>(callback);
-						childWorker->threadPool = threadPool;
-						childWorker->node = child;
-						childWorker->shape = shape;
-						childWorker->projection = projection;
-						childWorker->visited = visited;
-						childWorker->mutex = mutex;
-						threadPool->pushWork(childWorker, excHandler);
-						children_.push_back(childWorker);
-					}
-				}
-			}
-		}
-	};
-}
-#endif
-
 void QuadTree::foreachIntersection(
 		const BoundingShape &shape,
 		const std::function<void(const BoundingShape &)> &callback) {
@@ -446,40 +349,18 @@ void QuadTree::foreachIntersection(
 	auto t1 = high_resolution_clock::now();
 #endif
 
-	std::set<const Item *> visited;
+	// each query uses its own slot of visited stamps, so multiple queries
+	// can traverse the tree at the same time.
+	QuerySlots::Query query(querySlots_);
+	if (query.needsReset()) {
+		for (auto &it: items_) {
+			it.second->visited[query.slot()] = 0u;
+		}
+	}
 	// project the shape onto the xz-plane for faster intersection tests
 	// with the quad tree nodes.
 	OrthogonalProjection shape_projection(shape);
 
-#ifdef QUAD_TREE_THREADING
-	std::mutex mutex;
-	//std::atomic<unsigned int> jobCounter(1);
-	//auto runner = std::make_shared<ThreadPool::LambdaRunner>([&](const ThreadPool::LambdaRunner::StopChecker&) {
-	//	intersect2D(shape, shape_projection, root_, jobCounter, visited, mutex, callback);
-	//});
-	//threadPool_.pushWork(runner, [](const std::exception &) {});
-	auto firstWorker = std::make_shared<QuadTreeWorker>(callback);
-	firstWorker->threadPool = &threadPool_;
-	firstWorker->node = root_;
-	firstWorker->shape = &shape;
-	firstWorker->projection = &shape_projection;
-	firstWorker->visited = &visited;
-	firstWorker->mutex = &mutex;
-	threadPool_.pushWork(firstWorker, [](const std::exception &) {});
-
-	std::stack<QuadTreeWorker*> stack;
-	stack.push(firstWorker.get());
-	while (!stack.empty()) {
-		auto *worker = stack.top();
-		stack.pop();
-		if (!worker->isTerminated()) {
-			worker->join();
-		}
-		for (auto &child: worker->children_) {
-			stack.push(child.get());
-		}
-	}
-#else
 	std::stack<Node *> stack;
 	stack.push(root_);
 
@@ -506,10 +387,10 @@ void QuadTree::foreachIntersection(
 		if (node->isLeaf()) {
 			// 3D intersection test with the shapes in the node
 			for (const auto &quadShape: node->shapes) {
-				if (visited.find(quadShape) != visited.end()) {
+				// skip items that were already visited by this query
+				if (!query.visit(quadShape->visited)) {
 					continue;
 				}
-				visited.insert(quadShape);
 #ifdef QUAD_TREE_DEBUG
 				num3DTests++;
 #endif
@@ -526,7 +407,6 @@ void QuadTree::foreachIntersection(
 			}
 		}
 	}
-#endif
 
 #ifdef QUAD_TREE_DEBUG
 	auto t2 = high_resolution_clock::now();
@@ -544,6 +424,132 @@ void QuadTree::foreachIntersection(
 #endif
 }
 
+static inline float distanceSquared(const Vec3f &a, const Vec3f &b) {
+	auto d = a - b;
+	return d.dot(d);
+}
+
+void QuadTree::foreachWithinRadius(
+		const Vec3f &point, float radius,
+		const std::function<void(const BoundingShape &)> &callback) {
+	if (!root_) return;
+	QuerySlots::Query query(querySlots_);
+	if (query.needsReset()) {
+		for (auto &it: items_) {
+			it.second->visited[query.slot()] = 0u;
+		}
+	}
+	// the center of an item is within the bounds of at least one node of the item,
+	// so nodes farther away than the radius can be skipped.
+	const float radiusSq = radius * radius;
+	std::stack<Node *> stack;
+	stack.push(root_);
+	while (!stack.empty()) {
+		Node *node = stack.top();
+		stack.pop();
+		if (node->distanceSquared(point) > radiusSq) {
+			continue;
+		}
+		if (node->isLeaf()) {
+			for (const auto &quadShape: node->shapes) {
+				if (!query.visit(quadShape->visited)) {
+					continue;
+				}
+				if (distanceSquared(quadShape->shape->getCenterPosition(), point) <= radiusSq) {
+					callback(*quadShape->shape.get());
+				}
+			}
+		} else {
+			for (auto &child: node->children) {
+				if (child) {
+					stack.push(child);
+				}
+			}
+		}
+	}
+}
+
+void QuadTree::kNearest(
+		const Vec3f &point, unsigned int k,
+		std::vector<Neighbor> &result,
+		float maxDistance) {
+	NearestHeap heap(result, k, maxDistance);
+	if (!root_ || k == 0) {
+		heap.finish();
+		return;
+	}
+	QuerySlots::Query query(querySlots_);
+	if (query.needsReset()) {
+		for (auto &it: items_) {
+			it.second->visited[query.slot()] = 0u;
+		}
+	}
+	// best-first search, nodes are visited in order of their distance to the point,
+	// and the search stops when the next node is farther away than the k-th nearest shape.
+	using NodeDistance = std::pair<float, Node *>;
+	std::priority_queue<NodeDistance, std::vector<NodeDistance>, std::greater<>> queue;
+	queue.emplace(root_->distanceSquared(point), root_);
+	while (!queue.empty()) {
+		auto [nodeDistance, node] = queue.top();
+		queue.pop();
+		if (nodeDistance > heap.boundSq()) {
+			break;
+		}
+		if (node->isLeaf()) {
+			for (const auto &quadShape: node->shapes) {
+				if (!query.visit(quadShape->visited)) {
+					continue;
+				}
+				heap.push(quadShape->shape.get(),
+						  distanceSquared(quadShape->shape->getCenterPosition(), point));
+			}
+		} else {
+			for (auto &child: node->children) {
+				if (child) {
+					auto childDistance = child->distanceSquared(point);
+					if (childDistance <= heap.boundSq()) {
+						queue.emplace(childDistance, child);
+					}
+				}
+			}
+		}
+	}
+	heap.finish();
+}
+
+bool QuadTree::regrow(const Bounds<Vec2f> &bounds) {
+	// wrap the root node as a child into a new root node of double size,
+	// until the root node contains the bounds.
+	for (unsigned int i = 0; i < QUAD_TREE_MAX_REGROW_STEPS; ++i) {
+		auto &rootBounds = root_->bounds;
+		if (rootBounds.min.x <= bounds.min.x && rootBounds.min.y <= bounds.min.y &&
+			rootBounds.max.x >= bounds.max.x && rootBounds.max.y >= bounds.max.y) {
+			return true;
+		}
+		auto rootSize = rootBounds.max - rootBounds.min;
+		if (rootSize.x <= 0.0f || rootSize.y <= 0.0f) {
+			// cannot grow a degenerate root node
+			return false;
+		}
+		// grow towards the side where the bounds exceed the root node
+		bool growNegX = bounds.min.x < rootBounds.min.x;
+		bool growNegY = bounds.min.y < rootBounds.min.y;
+		Vec2f newMin(
+				growNegX ? rootBounds.min.x - rootSize.x : rootBounds.min.x,
+				growNegY ? rootBounds.min.y - rootSize.y : rootBounds.min.y);
+		auto *newRoot = createNode(newMin, newMin + rootSize * 2.0f);
+		subdivide(newRoot);
+		// replace the child in the quadrant of the old root node by the old root node
+		int quadrant = growNegX ? (growNegY ? 2 : 1) : (growNegY ? 3 : 0);
+		freeNode(newRoot->children[quadrant]);
+		newRoot->children[quadrant] = root_;
+		root_->parent = newRoot;
+		root_ = newRoot;
+		numRegrows_ += 1;
+	}
+	return false;
+}
+
 void QuadTree::update(float dt) {
 	static auto maxFloat = Vec2f(std::numeric_limits<float>::lowest());
 	static auto minFloat = Vec2f(std::numeric_limits<float>::max());
@@ -586,12 +592,21 @@ void QuadTree::update(float dt) {
 	newBounds_.max.x = std::max(newBounds_.max.x, newBounds_.max.y);
 	newBounds_.max.y = newBounds_.max.x;
 #endif
-	// if bounds have changed, re-initialize the tree
-	auto reInit = (root_ == nullptr || newBounds_ != root_->bounds);
+	auto reInit = (root_ == nullptr);
+	if (!reInit && newBounds_ != root_->bounds) {
+#ifdef QUAD_TREE_EVER_GROWING
+		// if bounds have grown, wrap the existing tree into a larger root node
+		reInit = !regrow(newBounds_);
+#else
+		// if bounds have changed, re-initialize the tree
+		reInit = true;
+#endif
+	}
 	if (reInit) {
 		// free the root node and start all over
 		if(root_) freeNode(root_);
 		root_ = createNode(newBounds_.min, newBounds_.max);
+		numRebuilds_ += 1;
 
 		for (auto &it: items_) {
 			auto &item = it.second;
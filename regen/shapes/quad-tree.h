@@ -6,6 +6,7 @@
 #include <regen/shapes/spatial-index.h>
 #include <regen/shapes/bounds.h>
 #include <regen/shapes/orthogonal-projection.h>
+#include <regen/shapes/query-slots.h>
 
 namespace regen {
 	/**
@@ -25,6 +26,8 @@ namespace regen {
 			ref_ptr<BoundingShape> shape;
 			OrthogonalProjection projection;
 			std::vector<Node *> nodes;
+			// items may appear in multiple nodes, the stamps mark items visited by a query
+			QuerySlots::Stamps visited{};
 
 			explicit Item(const ref_ptr<BoundingShape> &shape);
 
@@ -49,6 +52,12 @@ namespace regen {
 			bool isLeaf() const;
 
 			bool intersects(const OrthogonalProjection &projection) const;
+
+			/**
+			 * @param point A point
+			 * @return The squared distance of the point to the node bounds on the xz-plane
+			 */
+			float distanceSquared(const Vec3f &point) const;
 		};
 
 		QuadTree();
@@ -73,6 +82,18 @@ namespace regen {
 		 */
 		void setMinNodeSize(float size) { minNodeSize_ = size; }
 
+		/**
+		 * @brief Get the number of times the tree was rebuilt from scratch
+		 * @return The number of rebuilds
+		 */
+		auto numRebuilds() const { return numRebuilds_; }
+
+		/**
+		 * @brief Get the number of times the root node was wrapped into a larger root node
+		 * @return The number of regrows
+		 */
+		auto numRegrows() const { return numRegrows_; }
+
 		// override SpatialIndex::insert
 		void insert(const ref_ptr<BoundingShape> &shape) override;
 
@@ -93,6 +114,17 @@ namespace regen {
 				const BoundingShape &shape,
 				const std::function<void(const BoundingShape &)> &callback) override;
 
+		// override SpatialIndex::foreachWithinRadius
+		void foreachWithinRadius(
+				const Vec3f &point, float radius,
+				const std::function<void(const BoundingShape &)> &callback) override;
+
+		// override SpatialIndex::kNearest
+		void kNearest(
+				const Vec3f &point, unsigned int k,
+				std::vector<Neighbor> &result,
+				float maxDistance = std::numeric_limits<float>::max()) override;
+
 		// override SpatialIndex
 		void debugDraw(DebugInterface &debug) const override;
 
@@ -105,6 +137,9 @@ namespace regen {
 
 		Bounds<Vec2f> newBounds_;
 		std::vector<Item *> changedItems_;
+		unsigned int numRebuilds_ = 0;
+		unsigned int numRegrows_ = 0;
+		QuerySlots querySlots_;
 
 		QuadTree::Item* getItem(const ref_ptr<BoundingShape> &shape);
 
@@ -124,6 +159,8 @@ namespace regen {
 
 		void subdivide(Node *node);
 
+		bool regrow(const Bounds<Vec2f> &bounds);
+
 		unsigned int numShapes() const;
 
 		friend class QuadTreeTest;
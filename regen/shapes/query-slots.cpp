@@ -0,0 +1,44 @@
+#include <thread>
+
+#include "query-slots.h"
+
+using namespace regen;
+
+QuerySlots::QuerySlots()
+		: usedSlots_(0u) {
+	epochs_.fill(0u);
+}
+
+unsigned int QuerySlots::acquire() {
+	while (true) {
+		auto slots = usedSlots_.load(std::memory_order_relaxed);
+		for (unsigned int slot = 0; slot < MAX_SLOTS; ++slot) {
+			auto mask = 1u << slot;
+			if ((slots & mask) == 0u &&
+				usedSlots_.compare_exchange_weak(slots, slots | mask, std::memory_order_acquire)) {
+				return slot;
+			}
+		}
+		// all slots are in use, wait for a query to finish
+		std::this_thread::yield();
+	}
+}
+
+void QuerySlots::release(unsigned int slot) {
+	usedSlots_.fetch_and(~(1u << slot), std::memory_order_release);
+}
+
+QuerySlots::Query::Query(QuerySlots &slots)
+		: slots_(slots),
+		  slot_(slots.acquire()) {
+	epoch_ = ++slots_.epochs_[slot_];
+	if (epoch_ == 0u) {
+		// the epoch counter wrapped around
+		epoch_ = ++slots_.epochs_[slot_];
+		needsReset_ = true;
+	}
+}
+
+QuerySlots::Query::~Query() {
+	slots_.release(slot_);
+}
@@ -0,0 +1,81 @@
+#ifndef REGEN_QUERY_SLOTS_H_
+#define REGEN_QUERY_SLOTS_H_
+
+#include <array>
+#include <atomic>
+
+namespace regen {
+	/**
+	 * Epoch-stamped visited marking for concurrent queries of a spatial index.
+	 * Items that may be reached multiple times during one query store one stamp
+	 * per slot, an item was visited by a query if its stamp equals the query epoch.
+	 * Each running query owns one of the slots, such that multiple queries
+	 * can visit the same items at the same time.
+	 */
+	class QuerySlots {
+	public:
+		/**
+		 * The maximum number of concurrent queries.
+		 * Additional queries wait until one of the running queries has finished.
+		 */
+		static constexpr unsigned int MAX_SLOTS = 8;
+		/**
+		 * Visited stamps of an item, one per slot.
+		 */
+		using Stamps = std::array<unsigned int, MAX_SLOTS>;
+
+		/**
+		 * A running query, owns a slot until it is destroyed.
+		 */
+		class Query {
+		public:
+			explicit Query(QuerySlots &slots);
+
+			~Query();
+
+			Query(const Query &) = delete;
+
+			/**
+			 * @return The slot of the query.
+			 */
+			auto slot() const { return slot_; }
+
+			/**
+			 * @return true if the epoch counter of the slot wrapped around,
+			 *         in which case the stamps of the slot must be reset to zero.
+			 */
+			auto needsReset() const { return needsReset_; }
+
+			/**
+			 * Mark an item as visited by this query.
+			 * @param stamps The stamps of the item.
+			 * @return true if the item was not visited before.
+			 */
+			bool visit(Stamps &stamps) const {
+				if (stamps[slot_] == epoch_) return false;
+				stamps[slot_] = epoch_;
+				return true;
+			}
+
+		protected:
+			QuerySlots &slots_;
+			unsigned int slot_;
+			unsigned int epoch_;
+			bool needsReset_ = false;
+		};
+
+		QuerySlots();
+
+	protected:
+		// bit mask of slots that are currently in use
+		std::atomic<unsigned int> usedSlots_;
+		// the current epoch of each slot
+		std::array<unsigned int, MAX_SLOTS> epochs_;
+
+		unsigned int acquire();
+
+		void release(unsigned int slot);
+	};
+} // namespace
+
+#endif /* REGEN_QUERY_SLOTS_H_ */
@@ -0,0 +1,269 @@
+#include <cmath>
+
+#include "spatial-hash-grid.h"
+
+// cell coordinates are clamped to this range, e.g. for far away frustum points
+#define SPATIAL_HASH_GRID_MAX_COORD (1 << 30)
+
+using namespace regen;
+
+static inline int cellCoord(float v, float cellSize) {
+	auto c = std::floor(v / cellSize);
+	c = std::max(std::min(c, static_cast<float>(SPATIAL_HASH_GRID_MAX_COORD)),
+				 -static_cast<float>(SPATIAL_HASH_GRID_MAX_COORD));
+	return static_cast<int>(c);
+}
+
+static inline int cellX(SpatialHashGrid::CellKey key) {
+	return static_cast<int>(static_cast<uint32_t>(key >> 32u));
+}
+
+static inline int cellZ(SpatialHashGrid::CellKey key) {
+	return static_cast<int>(static_cast<uint32_t>(key & 0xffffffffu));
+}
+
+static const BoundingShape &initShape(const ref_ptr<BoundingShape> &shape) {
+	shape->updateTransform(false);
+	return *shape.get();
+}
+
+SpatialHashGrid::Item::Item(const ref_ptr<BoundingShape> &shape) :
+		shape(shape),
+		projection(initShape(shape)) {
+}
+
+SpatialHashGrid::SpatialHashGrid(float cellSize)
+		: SpatialIndex(),
+		  cellSize_(cellSize) {
+}
+
+SpatialHashGrid::CellKey SpatialHashGrid::cellKey(int x, int z) {
+	return (static_cast<CellKey>(static_cast<uint32_t>(x)) << 32u) |
+		   static_cast<CellKey>(static_cast<uint32_t>(z));
+}
+
+Bounds<Vec2f> SpatialHashGrid::cellBounds(int x, int z) const {
+	Vec2f min(static_cast<float>(x) * cellSize_, static_cast<float>(z) * cellSize_);
+	return {min, min + Vec2f(cellSize_)};
+}
+
+void SpatialHashGrid::setCellSize(float cellSize) {
+	if (cellSize <= 0.0f) {
+		REGEN_WARN("Invalid cell size " << cellSize << " for spatial hash grid.");
+		return;
+	}
+	cellSize_ = cellSize;
+	// re-assign all items to cells
+	cells_.clear();
+	for (unsigned int i = 0; i < items_.size(); ++i) {
+		computeCells(items_[i].projection, items_[i].cells);
+		addToCells(i, items_[i].cells);
+	}
+}
+
+void SpatialHashGrid::computeCells(const OrthogonalProjection &projection, std::vector<CellKey> &cells) const {
+	auto bounds = projection.bounds();
+	int x0 = cellCoord(bounds.min.x, cellSize_);
+	int z0 = cellCoord(bounds.min.y, cellSize_);
+	int x1 = cellCoord(bounds.max.x, cellSize_);
+	int z1 = cellCoord(bounds.max.y, cellSize_);
+	cells.clear();
+	if (x0 == x1 && z0 == z1) {
+		cells.push_back(cellKey(x0, z0));
+		return;
+	}
+	for (int x = x0; x <= x1; ++x) {
+		for (int z = z0; z <= z1; ++z) {
+			// skip cells in the bounds of the projection that are not covered by it
+			if (projection.intersects(cellBounds(x, z))) {
+				cells.push_back(cellKey(x, z));
+			}
+		}
+	}
+	std::sort(cells.begin(), cells.end());
+}
+
+void SpatialHashGrid::addToCells(unsigned int itemIndex, const std::vector<CellKey> &cells) {
+	for (auto key: cells) {
+		cells_[key].items.push_back(itemIndex);
+	}
+}
+
+void SpatialHashGrid::removeFromCell(unsigned int itemIndex, CellKey key) {
+	auto it = cells_.find(key);
+	if (it == cells_.end()) return;
+	auto &cellItems = it->second.items;
+	auto jt = std::find(cellItems.begin(), cellItems.end(), itemIndex);
+	if (jt != cellItems.end()) {
+		*jt = cellItems.back();
+		cellItems.pop_back();
+	}
+	if (cellItems.empty()) {
+		cells_.erase(it);
+	}
+}
+
+void SpatialHashGrid::updateCells(unsigned int itemIndex) {
+	auto &item = items_[itemIndex];
+	computeCells(item.projection, newCells_);
+	if (newCells_ == item.cells) {
+		return;
+	}
+	// both lists are sorted, walk through them in parallel and only
+	// touch the cells that the item left or entered.
+	auto oldIt = item.cells.begin();
+	auto newIt = newCells_.begin();
+	while (oldIt != item.cells.end() || newIt != newCells_.end()) {
+		if (newIt == newCells_.end() || (oldIt != item.cells.end() && *oldIt < *newIt)) {
+			removeFromCell(itemIndex, *oldIt);
+			++oldIt;
+		} else if (oldIt == item.cells.end() || *newIt < *oldIt) {
+			cells_[*newIt].items.push_back(itemIndex);
+			++newIt;
+		} else {
+			++oldIt;
+			++newIt;
+		}
+	}
+	item.cells.swap(newCells_);
+}
+
+void SpatialHashGrid::insert(const ref_ptr<BoundingShape> &shape) {
+	auto itemIndex = static_cast<unsigned int>(items_.size());
+	auto &item = items_.emplace_back(shape);
+	itemIndex_[shape.get()] = itemIndex;
+	computeCells(item.projection, item.cells);
+	addToCells(itemIndex, item.cells);
+	addToIndex(shape);
+}
+
+void SpatialHashGrid::remove(const ref_ptr<BoundingShape> &shape) {
+	auto it = itemIndex_.find(shape.get());
+	if (it == itemIndex_.end()) {
+		REGEN_WARN("Shape not found in spatial hash grid.");
+		return;
+	}
+	auto itemIndex = it->second;
+	itemIndex_.erase(it);
+	for (auto key: items_[itemIndex].cells) {
+		removeFromCell(itemIndex, key);
+	}
+	// swap-remove the item, and update the index of the moved item in its cells
+	auto lastIndex = static_cast<unsigned int>(items_.size() - 1);
+	if (itemIndex != lastIndex) {
+		items_[itemIndex] = std::move(items_.back());
+		for (auto key: items_[itemIndex].cells) {
+			auto &cellItems = cells_[key].items;
+			std::replace(cellItems.begin(), cellItems.end(), lastIndex, itemIndex);
+		}
+		itemIndex_[items_[itemIndex].shape.get()] = itemIndex;
+	}
+	items_.pop_back();
+	removeFromIndex(shape);
+}
+
+void SpatialHashGrid::update(float dt) {
+	bool hasChanged;
+	for (unsigned int i = 0; i < items_.size(); ++i) {
+		auto &item = items_[i];
+		hasChanged = item.shape->updateGeometry();
+		hasChanged = item.shape->updateTransform(hasChanged) || hasChanged;
+		if (hasChanged) {
+			// update in place, only the cells the item left or entered are changed
+			item.projection.update(*item.shape.get());
+			updateCells(i);
+		}
+	}
+
+	// make the visibility computations
+	updateVisibility();
+}
+
+bool SpatialHashGrid::hasIntersection(const BoundingShape &shape) {
+	return numIntersections(shape) > 0;
+}
+
+int SpatialHashGrid::numIntersections(const BoundingShape &shape) {
+	int count = 0;
+	foreachIntersection(shape, [&count](const BoundingShape &) {
+		count++;
+	});
+	return count;
+}
+
+void SpatialHashGrid::foreachIntersection(
+		const BoundingShape &shape,
+		const std::function<void(const BoundingShape &)> &callback) {
+	if (cells_.empty()) return;
+	OrthogonalProjection shapeProjection(shape);
+	auto bounds = shapeProjection.bounds();
+	int x0 = cellCoord(bounds.min.x, cellSize_);
+	int z0 = cellCoord(bounds.min.y, cellSize_);
+	int x1 = cellCoord(bounds.max.x, cellSize_);
+	int z1 = cellCoord(bounds.max.y, cellSize_);
+	bool isSingleCell = (x0 == x1 && z0 == z1);
+
+	QuerySlots::Query query(querySlots_);
+	if (query.needsReset()) {
+		for (auto &item: items_) {
+			item.visited[query.slot()] = 0u;
+		}
+	}
+	auto visitCell = [&](const Cell &cell, int x, int z) {
+		// 2D intersection test of the query projection with the cell
+		if (!isSingleCell && !shapeProjection.intersects(cellBounds(x, z))) {
+			return;
+		}
+		for (auto itemIndex: cell.items) {
+			auto &item = items_[itemIndex];
+			if (!query.visit(item.visited)) {
+				continue;
+			}
+			if (item.shape->hasIntersectionWith(shape)) {
+				callback(*item.shape.get());
+			}
+		}
+	};
+
+	// note: the range may span the whole clamped coordinate range, which does not fit into int
+	auto numRangeCells =
+			static_cast<uint64_t>(static_cast<int64_t>(x1) - x0 + 1) *
+			static_cast<uint64_t>(static_cast<int64_t>(z1) - z0 + 1);
+	if (numRangeCells <= cells_.size()) {
+		// look up the cells in the range of the query
+		for (int x = x0; x <= x1; ++x) {
+			for (int z = z0; z <= z1; ++z) {
+				auto it = cells_.find(cellKey(x, z));
+				if (it != cells_.end()) {
+					visitCell(it->second, x, z);
+				}
+			}
+		}
+	} else {
+		// the query range has more cells than the grid, iterate over the grid instead
+		for (auto &pair: cells_) {
+			int x = cellX(pair.first);
+			int z = cellZ(pair.first);
+			if (x >= x0 && x <= x1 && z >= z0 && z <= z1) {
+				visitCell(pair.second, x, z);
+			}
+		}
+	}
+}
+
+inline Vec3f toVec3(const Vec2f &v, float y) {
+	return {v.x, y, v.y};
+}
+
+void SpatialHashGrid::debugDraw(DebugInterface &debug) const {
+	static const float drawHeight = 5.5f;
+	Vec3f lineColor(1, 0, 0);
+	// draw the non-empty cells
+	for (auto &pair: cells_) {
+		auto b = cellBounds(cellX(pair.first), cellZ(pair.first));
+		debug.drawLine(toVec3(b.min, drawHeight), toVec3(Vec2f(b.max.x, b.min.y), drawHeight), lineColor);
+		debug.drawLine(toVec3(Vec2f(b.max.x, b.min.y), drawHeight), toVec3(b.max, drawHeight), lineColor);
+		debug.drawLine(toVec3(b.max, drawHeight), toVec3(Vec2f(b.min.x, b.max.y), drawHeight), lineColor);
+		debug.drawLine(toVec3(Vec2f(b.min.x, b.max.y), drawHeight), toVec3(b.min, drawHeight), lineColor);
+	}
+}
@@ -0,0 +1,123 @@
+#ifndef REGEN_SPATIAL_HASH_GRID_H_
+#define REGEN_SPATIAL_HASH_GRID_H_
+
+#include <vector>
+#include <unordered_map>
+#include <regen/shapes/spatial-index.h>
+#include <regen/shapes/bounds.h>
+#include <regen/shapes/orthogonal-projection.h>
+#include <regen/shapes/query-slots.h>
+
+namespace regen {
+	/**
+	 * A uniform grid on the xz-plane for spatial indexing.
+	 * Only non-empty cells are stored, in a hash map keyed by the integer
+	 * cell coordinates, so the grid has no fixed extent.
+	 * Each item is stored in all cells covered by its orthogonal projection.
+	 * Moving items are updated in place, i.e. only the cells they leave and enter
+	 * are touched. This works best for many small, similarly sized objects,
+	 * where the cell size should be in the order of the object size.
+	 */
+	class SpatialHashGrid : public SpatialIndex {
+	public:
+		using CellKey = uint64_t;
+
+		/**
+		 * An item in the grid, i.e. a shape with its orthogonal projection.
+		 */
+		struct Item {
+			ref_ptr<BoundingShape> shape;
+			OrthogonalProjection projection;
+			// sorted keys of the cells covered by the item
+			std::vector<CellKey> cells;
+			// items may appear in multiple cells, the stamps mark items visited by a query
+			QuerySlots::Stamps visited{};
+
+			explicit Item(const ref_ptr<BoundingShape> &shape);
+		};
+
+		/**
+		 * A cell in the grid.
+		 */
+		struct Cell {
+			// indices of the items in the cell
+			std::vector<unsigned int> items;
+		};
+
+		explicit SpatialHashGrid(float cellSize = 10.0f);
+
+		~SpatialHashGrid() override = default;
+
+		/**
+		 * @brief Set the size of the grid cells
+		 * Note: changing the cell size re-assigns all items to cells.
+		 * @param cellSize The cell size
+		 */
+		void setCellSize(float cellSize);
+
+		/**
+		 * @brief Get the size of the grid cells
+		 * @return The cell size
+		 */
+		auto cellSize() const { return cellSize_; }
+
+		/**
+		 * @brief Get the number of cells that were allocated for items
+		 * @return The number of cells
+		 */
+		auto numCells() const { return static_cast<unsigned int>(cells_.size()); }
+
+		/**
+		 * @brief Get the number of items in the grid
+		 * @return The number of items
+		 */
+		auto numItems() const { return static_cast<unsigned int>(items_.size()); }
+
+		// override SpatialIndex::insert
+		void insert(const ref_ptr<BoundingShape> &shape) override;
+
+		// override SpatialIndex::remove
+		void remove(const ref_ptr<BoundingShape> &shape) override;
+
+		// override SpatialIndex::update
+		void update(float dt) override;
+
+		// override SpatialIndex::hasIntersection
+		bool hasIntersection(const BoundingShape &shape) override;
+
+		// override SpatialIndex::numIntersections
+		int numIntersections(const BoundingShape &shape) override;
+
+		// override SpatialIndex::foreachIntersection
+		void foreachIntersection(
+				const BoundingShape &shape,
+				const std::function<void(const BoundingShape &)> &callback) override;
+
+		// override SpatialIndex
+		void debugDraw(DebugInterface &debug) const override;
+
+	protected:
+		float cellSize_;
+		std::vector<Item> items_;
+		// maps shapes to their index in items_
+		std::map<const BoundingShape *, unsigned int> itemIndex_;
+		std::unordered_map<CellKey, Cell> cells_;
+		QuerySlots querySlots_;
+		// temporary storage for cell coverage computation
+		std::vector<CellKey> newCells_;
+
+		static CellKey cellKey(int x, int z);
+
+		Bounds<Vec2f> cellBounds(int x, int z) const;
+
+		void computeCells(const OrthogonalProjection &projection, std::vector<CellKey> &cells) const;
+
+		void addToCells(unsigned int itemIndex, const std::vector<CellKey> &cells);
+
+		void removeFromCell(unsigned int itemIndex, CellKey key);
+
+		void updateCells(unsigned int itemIndex);
+	};
+} // namespace
+
+#endif /* REGEN_SPATIAL_HASH_GRID_H_ */
@@ -1,17 +1,32 @@
 #include <regen/utility/logging.h>
 #include <algorithm>
+#include <iterator>
 
 #include "spatial-index.h"
 #include "quad-tree.h"
+#include "linear-quad-tree.h"
+#include "aabb-tree.h"
+#include "spatial-hash-grid.h"
+#include "regen/utility/radix-sort.h"
+
+// a camera traverses the index if more than 1/ratio of the shapes have changed,
+// else the changed shapes are tested directly.
+#define SPATIAL_INDEX_DIRECT_TEST_RATIO 4
 
 using namespace regen;
 
+static inline float distanceSquared(const Vec3f &a, const Vec3f &b) {
+	auto d = a - b;
+	return d.dot(d);
+}
+
 SpatialIndex::SpatialIndex()
-		: threadPool_(std::max(2u, std::thread::hardware_concurrency()) - 2u) {
+		: jobSystem_(&JobSystem::get()) {
 }
 
 void SpatialIndex::addToIndex(const ref_ptr<BoundingShape> &shape) {
 	shapes_[shape->name()].push_back(shape);
+	shapeVersions_[shape->name()] += 1;
 	for (auto &ic: cameras_) {
 		createIndexShape(ic.second, shape);
 	}
@@ -23,6 +38,7 @@ void SpatialIndex::removeFromIndex(const ref_ptr<BoundingShape> &shape) {
 		auto jt = std::find(it->second.begin(), it->second.end(), shape);
 		if (jt != it->second.end()) {
 			it->second.erase(jt);
+			shapeVersions_[shape->name()] += 1;
 		}
 	}
 }
@@ -86,84 +102,367 @@ ref_ptr<BoundingShape> SpatialIndex::getShape(std::string_view shapeID) const {
 	return {};
 }
 
-void SpatialIndex::updateVisibility(IndexCamera &ic, const BoundingShape &camera_shape, bool isMultiShape) {
-	if (ic.sortInstances) {
-		for (auto &pair: ic.shapes) {
-			pair.second->instanceDistances_.clear();
+void SpatialIndex::parallelFor(unsigned int numJobs, const std::function<void(unsigned int)> &job) {
+	if (!useThreading_ || numJobs < 2) {
+		for (unsigned int i = 0; i < numJobs; ++i) {
+			job(i);
+		}
+		return;
+	}
+	// the calling thread executes jobs until all jobs are done
+	jobSystem_->parallelFor(numJobs, 1, job);
+}
+
+void SpatialIndex::traverseCamera(const CameraTraversal &traversal) {
+	if (!traversal.isFullTraversal) {
+		traverseDirtyShapes(traversal);
+		traverseInstanced(traversal);
+		return;
+	}
+	auto &ic = *traversal.camera;
+	foreachIntersection(*traversal.shape, [&](const BoundingShape &b_shape) {
+		// note: find instead of operator[] as the map must not be modified concurrently
+		auto it = ic.shapes.find(b_shape.name());
+		if (it == ic.shapes.end()) return;
+		if (!it->second->u_isDirty_) return;
+		auto &result = it->second->u_traversals_[traversal.index];
+		result.visible = true;
+		if (b_shape.numInstances() > 1) {
+			float d = ic.sortInstances ? distanceSquared(b_shape.getCenterPosition(), ic.position) : 0.0f;
+			result.instances.push_back({b_shape.instanceID(), d});
+		}
+	});
+	traverseInstanced(traversal);
+}
+
+void SpatialIndex::traverseDirtyShapes(const CameraTraversal &traversal) {
+	// only few shapes have changed, test them directly instead of traversing the index
+	auto &ic = *traversal.camera;
+	for (auto *index_shape: ic.dirtyShapes) {
+		auto &shapeName = index_shape->shape()->name();
+		if (isInstanced(shapeName)) continue;
+		auto it = shapes_.find(shapeName);
+		if (it == shapes_.end()) continue;
+		auto &result = index_shape->u_traversals_[traversal.index];
+		for (auto &b_shape: it->second) {
+			if (!b_shape->hasIntersectionWith(*traversal.shape)) continue;
+			result.visible = true;
+			if (b_shape->numInstances() > 1) {
+				float d = ic.sortInstances ? distanceSquared(b_shape->getCenterPosition(), ic.position) : 0.0f;
+				result.instances.push_back({b_shape->instanceID(), d});
+			}
+		}
+	}
+}
+
+void SpatialIndex::traverseInstanced(const CameraTraversal &traversal) {
+	// instanced volumes are not part of the index structure, all instances
+	// are tested in batches instead.
+	auto &ic = *traversal.camera;
+	for (auto &volume: instancedVolumes_) {
+		auto it = ic.shapes.find(volume->name());
+		if (it == ic.shapes.end()) continue;
+		if (!it->second->u_isDirty_) continue;
+		auto &result = it->second->u_traversals_[traversal.index];
+		result.visibleIDs.resize(volume->numInstances());
+		auto numVisible = volume->cull(*traversal.shape, result.visibleIDs.data());
+		if (numVisible == 0) continue;
+		result.visible = true;
+		for (unsigned int i = 0; i < numVisible; ++i) {
+			auto instanceID = result.visibleIDs[i];
+			float d = ic.sortInstances ? distanceSquared(volume->center(instanceID), ic.position) : 0.0f;
+			result.instances.push_back({instanceID, d});
+		}
+	}
+}
+
+bool SpatialIndex::isInstanced(std::string_view shapeName) const {
+	for (auto &volume: instancedVolumes_) {
+		if (volume->name() == shapeName) return true;
+	}
+	return false;
+}
+
+void SpatialIndex::mergeTraversals(IndexCamera &ic) {
+	for (auto &pair: ic.shapes) {
+		auto &index_shape = pair.second;
+		// cached shapes keep the result of the last update
+		if (!index_shape->u_isDirty_) continue;
+		// keep instance IDs mapped for writing during the merge
+		index_shape->mapInstanceIDs_internal();
+		auto mapped_data = index_shape->mappedInstanceIDs();
+		// note: first element is the number of visible instances
+		mapped_data[0] = 0;
+		index_shape->u_instanceCount_ = 0;
+		index_shape->u_visible_ = false;
+
+		// re-use the previous order if neither the camera nor the instances have moved much.
+		// note: two epochs are needed, so the previous order is not used close to an epoch wrap.
+		if (ic.sortInstances && !ic.needsSort &&
+			index_shape->u_hasSortOrder_ &&
+			index_shape->u_sortedRuns_.size() == ic.numTraversals &&
+			index_shape->u_sortVersion_ == index_shape->u_cacheVersion_ &&
+			index_shape->u_sortStamp_ == index_shape->u_cacheStamp_ &&
+			index_shape->u_epoch_ < std::numeric_limits<unsigned int>::max() - 2u) {
+			mergeWithPreviousOrder(ic, *index_shape.get(), mapped_data);
+		} else {
+			mergeSorted(ic, *index_shape.get(), mapped_data);
 		}
+		mapped_data[0] = index_shape->u_instanceCount_;
 
-		auto camPos = ic.camera->position()->getVertex(0);
-		foreachIntersection(camera_shape, [&](const BoundingShape &b_shape) {
-			//std::lock_guard<std::mutex> lock(mutex_);
-			auto &index_shape = ic.shapes[b_shape.name()];
-			index_shape->u_visible_ = true;
+		index_shape->unmapInstanceIDs_internal();
+		index_shape->visible_ = index_shape->u_visible_;
+		index_shape->instanceCount_ = index_shape->u_instanceCount_;
+	}
+}
 
-			if (b_shape.numInstances() > 1) {
-				if (isMultiShape) {
-					// make sure we don't add the same instance twice
-					auto [_, inserted] = index_shape->u_visibleSet_.insert(b_shape.instanceID());
-					if (!inserted) return;
+void SpatialIndex::mergeSorted(IndexCamera &ic, IndexedShape &shape, unsigned int *mappedData) {
+	const bool isMultiShape = ic.numTraversals > 1;
+	if (isMultiShape) {
+		shape.nextEpoch();
+	}
+	if (ic.sortInstances) {
+		shape.u_sortedInstances_.clear();
+		shape.u_sortedRuns_.clear();
+		shape.u_sortVersion_ = shape.u_cacheVersion_;
+		shape.u_sortStamp_ = shape.u_cacheStamp_;
+		shape.u_hasSortOrder_ = true;
+	}
+	// merge in order of the camera shapes, the result is the same as if
+	// the camera shapes were traversed one after the other.
+	for (unsigned int i = 0; i < ic.numTraversals; ++i) {
+		auto &traversal = shape.u_traversals_[i];
+		auto &instances = traversal.instances;
+		shape.u_visible_ = shape.u_visible_ || traversal.visible;
+		if (isMultiShape) {
+			// make sure we don't add the same instance twice
+			unsigned int numUnique = 0;
+			for (auto &instance: instances) {
+				if (shape.markInstance(instance.instanceID)) {
+					instances[numUnique++] = instance;
 				}
-				float d = (b_shape.getCenterPosition() - camPos.r).length();
-				index_shape->instanceDistances_.push_back({&b_shape, d});
 			}
-		});
-		for (auto &pair: ic.shapes) {
-			auto &index_shape = pair.second;
-			auto &distances = index_shape->instanceDistances_;
-			if (distances.empty()) {
-				continue;
+			instances.resize(numUnique);
+		}
+		if (ic.sortInstances) {
+			radixSort(instances, shape.u_sortBuffer_, [](const IndexedShape::ShapeDistance &x) {
+				return x.distance;
+			});
+			shape.u_sortedInstances_.insert(shape.u_sortedInstances_.end(), instances.begin(), instances.end());
+			shape.u_sortedRuns_.push_back(shape.u_sortedInstances_.size());
+		}
+		for (auto &instance: instances) {
+			shape.u_instanceCount_ += 1;
+			mappedData[shape.u_instanceCount_] = instance.instanceID;
+		}
+	}
+}
+
+void SpatialIndex::mergeWithPreviousOrder(IndexCamera &ic, IndexedShape &shape, unsigned int *mappedData) {
+	// mark all visible instances with the first epoch
+	shape.nextEpoch();
+	const auto visibleEpoch = shape.u_epoch_;
+	for (unsigned int i = 0; i < ic.numTraversals; ++i) {
+		auto &traversal = shape.u_traversals_[i];
+		shape.u_visible_ = shape.u_visible_ || traversal.visible;
+		for (auto &instance: traversal.instances) {
+			shape.markInstance(instance.instanceID);
+		}
+	}
+	// the second epoch marks instances that were added to the result
+	shape.nextEpoch();
+	auto &epochs = shape.u_instanceEpochs_;
+	auto isVisible = [&](unsigned int instanceID) {
+		return instanceID < epochs.size() && epochs[instanceID] == visibleEpoch;
+	};
+
+	// the previous order consists of one sorted run per camera shape,
+	// each run is merged with the instances that became visible in the camera shape.
+	// the result is the same as with mergeSorted, except for instances that moved
+	// to another camera shape, they stay in the run where they were before.
+	auto &previous = shape.u_sortedInstances_;
+	auto &merged = shape.u_mergeBuffer_;
+	auto &added = shape.u_sortBuffer_;
+	merged.clear();
+	unsigned int runBegin = 0;
+	for (unsigned int i = 0; i < ic.numTraversals; ++i) {
+		auto runEnd = shape.u_sortedRuns_[i];
+		// keep the instances that are still visible in the previous order
+		unsigned int keptEnd = runBegin;
+		for (unsigned int j = runBegin; j < runEnd; ++j) {
+			if (isVisible(previous[j].instanceID)) {
+				shape.markInstance(previous[j].instanceID);
+				previous[keptEnd++] = previous[j];
 			}
-			std::sort(distances.begin(), distances.end(),
-					  [](const IndexedShape::ShapeDistance &a, const IndexedShape::ShapeDistance &b) {
-						  return a.distance < b.distance;
-					  });
-			auto mapped_data = index_shape->mappedInstanceIDs();
-			for (auto &distance: distances) {
-				index_shape->u_instanceCount_ += 1;
-				mapped_data[index_shape->u_instanceCount_] = distance.shape->instanceID();
-				mapped_data[0] = index_shape->u_instanceCount_;
+		}
+		// sort the instances that became visible, and merge them with the previous order
+		auto &instances = shape.u_traversals_[i].instances;
+		added.clear();
+		for (auto &instance: instances) {
+			if (isVisible(instance.instanceID)) {
+				shape.markInstance(instance.instanceID);
+				added.push_back(instance);
 			}
 		}
+		// note: the traversal buffer is not needed anymore, and re-used as scratch buffer
+		radixSort(added, instances, [](const IndexedShape::ShapeDistance &x) {
+			return x.distance;
+		});
+		std::merge(previous.begin() + runBegin, previous.begin() + keptEnd,
+				   added.begin(), added.end(), std::back_inserter(merged),
+				   [](const IndexedShape::ShapeDistance &a, const IndexedShape::ShapeDistance &b) {
+					   return a.distance < b.distance;
+				   });
+		shape.u_sortedRuns_[i] = merged.size();
+		runBegin = runEnd;
+	}
+	previous.swap(merged);
+	for (auto &instance: previous) {
+		shape.u_instanceCount_ += 1;
+		mappedData[shape.u_instanceCount_] = instance.instanceID;
+	}
+}
+
+void SpatialIndex::setSortThreshold(float distance, float angle) {
+	sortDistanceThreshold_ = distance;
+	sortAngleThreshold_ = angle;
+}
+
+void SpatialIndex::updateSortPose(IndexCamera &ic) const {
+	auto direction = ic.camera->direction()->getVertex(0).r;
+	if (sortDistanceThreshold_ <= 0.0f && sortAngleThreshold_ <= 0.0f) {
+		ic.needsSort = true;
+	} else if (!ic.hasSortPose) {
+		ic.needsSort = true;
 	} else {
-		foreachIntersection(camera_shape, [&](const BoundingShape &b_shape) {
-			//std::lock_guard<std::mutex> lock(mutex_);
-			auto &index_shape = ic.shapes[b_shape.name()];
-			auto mapped_data = index_shape->mappedInstanceIDs();
-			index_shape->u_visible_ = true;
-
-			if (b_shape.numInstances() > 1) {
-				if (isMultiShape) {
-					// make sure we don't add the same instance twice
-					auto [_, inserted] = index_shape->u_visibleSet_.insert(b_shape.instanceID());
-					if (!inserted) return;
-				}
-				index_shape->u_instanceCount_ += 1;
-				mapped_data[index_shape->u_instanceCount_] = b_shape.instanceID();
-				mapped_data[0] = index_shape->u_instanceCount_;
+		ic.needsSort =
+				(ic.position - ic.sortPosition).length() > sortDistanceThreshold_ ||
+				direction.dot(ic.sortDirection) < std::cos(sortAngleThreshold_);
+	}
+	if (ic.needsSort) {
+		ic.sortPosition = ic.position;
+		ic.sortDirection = direction;
+		ic.hasSortPose = true;
+	}
+}
+
+void SpatialIndex::insertInstanced(const ref_ptr<InstancedBoundingVolume> &volume) {
+	instancedVolumes_.push_back(volume);
+	addToIndex(volume->prototype());
+}
+
+void SpatialIndex::removeInstanced(const ref_ptr<InstancedBoundingVolume> &volume) {
+	auto it = std::find(instancedVolumes_.begin(), instancedVolumes_.end(), volume);
+	if (it == instancedVolumes_.end()) {
+		REGEN_WARN("Instanced volume '" << volume->name() << "' not found in spatial index.");
+		return;
+	}
+	instancedVolumes_.erase(it);
+	removeFromIndex(volume->prototype());
+}
+
+SpatialIndex::CameraStamps SpatialIndex::cameraStamps(const Camera &camera) {
+	return {
+			camera.stamp(),
+			camera.position()->stamp(),
+			camera.view()->stamp(),
+			camera.projection()->stamp(),
+			camera.viewProjection()->stamp(),
+			camera.far()->stamp()};
+}
+
+void SpatialIndex::updateShapeStamps() {
+	// stamps only increase, so the sum of the stamps of all shapes with
+	// the same name changes if any of the shapes has changed.
+	// note: this only holds as long as no shape was added or removed, which is
+	//       detected by the version of the shape name instead.
+	for (auto &pair: shapes_) {
+		uint64_t stamp = 0;
+		for (auto &shape: pair.second) {
+			stamp += shape->transformStamp();
+			if (shape->mesh().get()) {
+				stamp += shape->mesh()->geometryStamp();
 			}
-		});
+		}
+		shapeStamps_[pair.first] = stamp;
 	}
 }
 
 void SpatialIndex::updateVisibility() {
+	// update the instanced volumes, each in a separate task
+	parallelFor(instancedVolumes_.size(), [this](unsigned int i) {
+		instancedVolumes_[i]->update();
+	});
+	if (useVisibilityCache_ || sortDistanceThreshold_ > 0.0f || sortAngleThreshold_ > 0.0f) {
+		updateShapeStamps();
+	}
+	unsigned int numIndexedShapes = 0;
+	for (auto &pair: shapes_) {
+		numIndexedShapes += pair.second.size();
+	}
+
+	// collect the camera shapes the index is intersected with
+	traversals_.clear();
+	traversedCameras_.clear();
 	for (auto &ic: cameras_) {
-		for (auto &pair: ic.second.shapes) {
-			// keep instance IDs mapped for writing during visibility update
-			pair.second->mapInstanceIDs_internal();
-			// note: first element is the number of visible instances
-			pair.second->mappedInstanceIDs()[0] = 0;
-			pair.second->u_instanceCount_ = 0;
-			pair.second->u_visible_ = false;
-			pair.second->u_visibleSet_.clear();
+		auto &indexCamera = ic.second;
+		auto numTraversals = ic.second.camera->isOmni() ? 1u : ic.first->frustum().size();
+		auto stamps = cameraStamps(*ic.first);
+		bool cameraChanged = !useVisibilityCache_ ||
+							 !indexCamera.hasStamps ||
+							 indexCamera.stamps != stamps ||
+							 indexCamera.numTraversals != numTraversals;
+		indexCamera.stamps = stamps;
+		indexCamera.hasStamps = true;
+
+		// find the shapes whose visibility must be re-computed
+		unsigned int numDirtyShapes = 0;
+		indexCamera.dirtyShapes.clear();
+		for (auto &pair: indexCamera.shapes) {
+			auto &index_shape = pair.second;
+			auto shapeVersion = shapeVersions_[pair.first];
+			auto shapeStamp = shapeStamps_[pair.first];
+			index_shape->u_isDirty_ = cameraChanged ||
+									  !index_shape->u_hasCache_ ||
+									  index_shape->u_cacheVersion_ != shapeVersion ||
+									  index_shape->u_cacheStamp_ != shapeStamp;
+			if (index_shape->u_isDirty_) {
+				index_shape->u_cacheVersion_ = shapeVersion;
+				index_shape->u_cacheStamp_ = shapeStamp;
+				index_shape->u_hasCache_ = useVisibilityCache_;
+				indexCamera.dirtyShapes.push_back(index_shape.get());
+				auto it = shapes_.find(pair.first);
+				if (it != shapes_.end()) {
+					numDirtyShapes += it->second.size();
+				}
+				numCacheMisses_ += 1;
+			} else {
+				numCacheHits_ += 1;
+			}
+		}
+		if (indexCamera.dirtyShapes.empty()) {
+			// nothing has changed, keep the results of the last update
+			continue;
+		}
+		// traverse the index if the camera has changed or many shapes have changed
+		bool isFullTraversal = cameraChanged ||
+							   numDirtyShapes * SPATIAL_INDEX_DIRECT_TEST_RATIO > numIndexedShapes;
+		indexCamera.position = ic.first->position()->getVertex(0).r;
+		if (indexCamera.sortInstances) {
+			updateSortPose(indexCamera);
 		}
 
 		if (ic.second.camera->isOmni()) {
 			// omni camera -> intersection test with bounding sphere
-			BoundingSphere sphereShape(Vec3f::zero(), ic.first->far()->getVertex(0).r);
-			sphereShape.setTransform(ic.first->position());
-			sphereShape.updateTransform(true);
-			updateVisibility(ic.second, sphereShape, false);
+			auto radius = ic.first->far()->getVertex(0).r;
+			if (!indexCamera.sphereShape.get()) {
+				indexCamera.sphereShape = ref_ptr<BoundingSphere>::alloc(Vec3f::zero(), radius);
+				indexCamera.sphereShape->setTransform(ic.first->position());
+			} else {
+				indexCamera.sphereShape->setRadius(radius);
+			}
+			indexCamera.sphereShape->updateTransform(true);
+			traversals_.push_back({&indexCamera, indexCamera.sphereShape.get(), 0u, isFullTraversal});
 		}
 			//else if (ic.second.camera->isSemiOmni()) {
 			//	// TODO: Support half-spheres for culling
@@ -171,17 +470,100 @@ void SpatialIndex::updateVisibility() {
 		else {
 			// spot camera -> intersection test with view frustum
 			auto &frustumShapes = ic.first->frustum();
-			for (auto &frustumShape: frustumShapes) {
-				updateVisibility(ic.second, frustumShape, frustumShapes.size() > 1);
+			for (unsigned int i = 0; i < frustumShapes.size(); ++i) {
+				traversals_.push_back({&indexCamera, &frustumShapes[i], i, isFullTraversal});
 			}
 		}
+		indexCamera.numTraversals = numTraversals;
 
-		for (auto &pair: ic.second.shapes) {
-			pair.second->unmapInstanceIDs_internal();
-			pair.second->visible_ = pair.second->u_visible_;
-			pair.second->instanceCount_ = pair.second->u_instanceCount_;
+		for (auto *index_shape: indexCamera.dirtyShapes) {
+			auto &results = index_shape->u_traversals_;
+			results.resize(indexCamera.numTraversals);
+			for (auto &result: results) {
+				result.visible = false;
+				result.instances.clear();
+			}
 		}
+		traversedCameras_.push_back(&indexCamera);
 	}
+
+	// intersect each camera shape with the index, each in a separate task
+	parallelFor(traversals_.size(), [this](unsigned int i) {
+		traverseCamera(traversals_[i]);
+	});
+	// merge results per camera
+	parallelFor(traversedCameras_.size(), [this](unsigned int i) {
+		mergeTraversals(*traversedCameras_[i]);
+	});
+}
+
+SpatialIndex::NearestHeap::NearestHeap(std::vector<Neighbor> &result, unsigned int k, float maxDistance)
+		: result(result),
+		  k(k),
+		  maxDistanceSq(maxDistance < std::sqrt(std::numeric_limits<float>::max()) ?
+						maxDistance * maxDistance : std::numeric_limits<float>::max()) {
+	result.clear();
+}
+
+static inline bool isCloser(const SpatialIndex::Neighbor &a, const SpatialIndex::Neighbor &b) {
+	return a.distance < b.distance;
+}
+
+float SpatialIndex::NearestHeap::boundSq() const {
+	if (result.size() < k) {
+		return maxDistanceSq;
+	} else {
+		// the root of the max-heap is the farthest of the k nearest shapes
+		return std::min(result.front().distance, maxDistanceSq);
+	}
+}
+
+void SpatialIndex::NearestHeap::push(const BoundingShape *shape, float distanceSq) {
+	if (k == 0 || distanceSq > boundSq()) {
+		return;
+	}
+	if (result.size() == k) {
+		std::pop_heap(result.begin(), result.end(), isCloser);
+		result.back() = {shape, distanceSq};
+	} else {
+		result.push_back({shape, distanceSq});
+	}
+	std::push_heap(result.begin(), result.end(), isCloser);
+}
+
+void SpatialIndex::NearestHeap::finish() {
+	std::sort_heap(result.begin(), result.end(), isCloser);
+	for (auto &neighbor: result) {
+		neighbor.distance = std::sqrt(neighbor.distance);
+	}
+}
+
+void SpatialIndex::foreachWithinRadius(
+		const Vec3f &point, float radius,
+		const std::function<void(const BoundingShape &)> &callback) {
+	const float radiusSq = radius * radius;
+	for (auto &pair: shapes_) {
+		if (isInstanced(pair.first)) continue;
+		for (auto &shape: pair.second) {
+			if (distanceSquared(shape->getCenterPosition(), point) <= radiusSq) {
+				callback(*shape.get());
+			}
+		}
+	}
+}
+
+void SpatialIndex::kNearest(
+		const Vec3f &point, unsigned int k,
+		std::vector<Neighbor> &result,
+		float maxDistance) {
+	NearestHeap heap(result, k, maxDistance);
+	for (auto &pair: shapes_) {
+		if (isInstanced(pair.first)) continue;
+		for (auto &shape: pair.second) {
+			heap.push(shape.get(), distanceSquared(shape->getCenterPosition(), point));
+		}
+	}
+	heap.finish();
 }
 
 void SpatialIndex::createIndexShape(IndexCamera &ic, const ref_ptr<BoundingShape> &shape) {
@@ -205,6 +587,26 @@ ref_ptr<SpatialIndex> SpatialIndex::load(LoadingContext &ctx, scene::SceneInputN
 		//quadTree->setMaxObjectsPerNode(input.getValue<GLuint>("max-objects-per-node", 4u));
 		quadTree->setMinNodeSize(input.getValue<float>("min-node-size", 0.1f));
 		index = quadTree;
+	} else if (indexType == "linear-quadtree") {
+		auto quadTree = ref_ptr<LinearQuadTree>::alloc();
+		quadTree->setMinNodeSize(input.getValue<float>("min-node-size", 0.1f));
+		quadTree->setMaxDepth(input.getValue<GLuint>("max-depth", 8u));
+		index = quadTree;
+	} else if (indexType == "aabb-tree") {
+		auto aabbTree = ref_ptr<AABBTree>::alloc();
+		aabbTree->setMargin(input.getValue<float>("margin", 0.5f));
+		index = aabbTree;
+	} else if (indexType == "grid") {
+		index = ref_ptr<SpatialHashGrid>::alloc(input.getValue<float>("cell-size", 10.0f));
+	} else {
+		REGEN_WARN("Unknown spatial index type '" << indexType << "'.");
+	}
+	if (index.get()) {
+		index->setUseThreading(input.getValue<bool>("use-threading", true));
+		index->setUseVisibilityCache(input.getValue<bool>("use-cache", true));
+		index->setSortThreshold(
+				input.getValue<float>("sort-distance-threshold", 0.0f),
+				input.getValue<float>("sort-angle-threshold", 0.0f) * M_PI / 180.0f);
 	}
 
 	return index;
@@ -3,9 +3,10 @@
 
 #include <regen/shapes/bounding-shape.h>
 #include <regen/shapes/indexed-shape.h>
+#include <regen/shapes/instanced-bounding-volume.h>
 #include <regen/camera/camera.h>
 #include "regen/utility/debug-interface.h"
-#include "regen/utility/ThreadPool.h"
+#include "regen/utility/job-system.h"
 #include <regen/scene/loading-context.h>
 
 namespace regen {
@@ -16,6 +17,15 @@ namespace regen {
 	public:
 		static constexpr const char *TYPE_NAME = "SpatialIndex";
 
+		/**
+		 * @brief A shape found by a nearest neighbour query
+		 */
+		struct Neighbor {
+			const BoundingShape *shape;
+			// distance between the query point and the center of the shape
+			float distance;
+		};
+
 		SpatialIndex();
 
 		~SpatialIndex() override = default;
@@ -78,6 +88,78 @@ namespace regen {
 		 */
 		std::vector<const Camera *> cameras() const;
 
+		/**
+		 * @brief Enable or disable parallel visibility computation
+		 * If enabled, each camera and each frustum split of a camera is
+		 * intersected with the index in a separate job of the job system.
+		 * @param useThreading True to enable parallel visibility computation
+		 */
+		void setUseThreading(bool useThreading) { useThreading_ = useThreading; }
+
+		/**
+		 * @brief Check if parallel visibility computation is enabled
+		 * @return True if enabled, false otherwise
+		 */
+		bool useThreading() const { return useThreading_; }
+
+		/**
+		 * @brief Enable or disable caching of visibility results
+		 * If enabled, the visibility of a shape for a camera is only re-computed
+		 * if the camera or the shape has changed since the last update.
+		 * @param useCache True to enable the visibility cache
+		 */
+		void setUseVisibilityCache(bool useCache) { useVisibilityCache_ = useCache; }
+
+		/**
+		 * @brief Check if caching of visibility results is enabled
+		 * @return True if enabled, false otherwise
+		 */
+		bool useVisibilityCache() const { return useVisibilityCache_; }
+
+		/**
+		 * @brief Get the number of (camera, shape) pairs whose visibility was
+		 * taken from the cache.
+		 * @return The number of cache hits
+		 */
+		auto numCacheHits() const { return numCacheHits_; }
+
+		/**
+		 * @brief Get the number of (camera, shape) pairs whose visibility was re-computed.
+		 * @return The number of cache misses
+		 */
+		auto numCacheMisses() const { return numCacheMisses_; }
+
+		/**
+		 * @brief Set the camera motion that triggers re-sorting of instances
+		 * If the camera moved or rotated less than the thresholds since the last sort,
+		 * and the transforms of the instances did not change, the previous order
+		 * of the instances is re-used. Thresholds of zero sort each update.
+		 * @param distance The distance threshold
+		 * @param angle The angle threshold in radians
+		 */
+		void setSortThreshold(float distance, float angle);
+
+		/**
+		 * @brief Insert all instances of a shape with a batched bounding volume
+		 * The instances are not inserted into the index structure, instead all
+		 * instances are tested in batches against the camera shapes.
+		 * This is faster for shapes with many small instances, e.g. vegetation.
+		 * @param volume The instanced volume
+		 */
+		void insertInstanced(const ref_ptr<InstancedBoundingVolume> &volume);
+
+		/**
+		 * @brief Remove an instanced volume from the index
+		 * @param volume The instanced volume
+		 */
+		void removeInstanced(const ref_ptr<InstancedBoundingVolume> &volume);
+
+		/**
+		 * @brief Get the instanced volumes in the index
+		 * @return The instanced volumes
+		 */
+		auto &instancedVolumes() const { return instancedVolumes_; }
+
 		/**
 		 * @brief Update the index
 		 * @param dt The time delta
@@ -119,6 +201,30 @@ namespace regen {
 				const BoundingShape &shape,
 				const std::function<void(const BoundingShape &)> &callback) = 0;
 
+		/**
+		 * @brief Iterate over all shapes whose center is within a radius of a point
+		 * Note: the default implementation tests all shapes in the index.
+		 * @param point The query point
+		 * @param radius The radius
+		 * @param callback The callback function
+		 */
+		virtual void foreachWithinRadius(
+				const Vec3f &point, float radius,
+				const std::function<void(const BoundingShape &)> &callback);
+
+		/**
+		 * @brief Find the shapes whose centers are closest to a point
+		 * Note: the default implementation tests all shapes in the index.
+		 * @param point The query point
+		 * @param k The maximum number of shapes
+		 * @param result Output vector, the shapes sorted by distance, closest first
+		 * @param maxDistance Shapes farther away than this are ignored
+		 */
+		virtual void kNearest(
+				const Vec3f &point, unsigned int k,
+				std::vector<Neighbor> &result,
+				float maxDistance = std::numeric_limits<float>::max());
+
 		/**
 		 * @brief Draw debug information
 		 * @param debug The debug interface
@@ -126,18 +232,83 @@ namespace regen {
 		virtual void debugDraw(DebugInterface &debug) const = 0;
 
 	protected:
-		ThreadPool threadPool_;
+		JobSystem *jobSystem_;
+		bool useThreading_ = true;
+		bool useVisibilityCache_ = true;
+		unsigned long numCacheHits_ = 0;
+		unsigned long numCacheMisses_ = 0;
+		float sortDistanceThreshold_ = 0.0f;
+		float sortAngleThreshold_ = 0.0f;
+		// camera stamps: camera, position, view, projection, view-projection, far
+		using CameraStamps = std::array<unsigned int, 6>;
 		struct IndexCamera {
 			ref_ptr<Camera> camera;
 			std::map<std::string_view, ref_ptr<IndexedShape>> shapes;
 			bool sortInstances;
+			// camera position at the time of the visibility update
+			Vec3f position;
+			// number of shapes the camera is intersected with, i.e. frustum splits
+			unsigned int numTraversals = 0;
+			// bounding sphere used for omni cameras
+			ref_ptr<BoundingSphere> sphereShape;
+			// camera stamps at the time of the last visibility update
+			CameraStamps stamps{};
+			bool hasStamps = false;
+			// shapes whose visibility must be re-computed
+			std::vector<IndexedShape *> dirtyShapes;
+			// camera pose at the time of the last sort
+			Vec3f sortPosition;
+			Vec3f sortDirection;
+			bool hasSortPose = false;
+			bool needsSort = true;
+		};
+		struct CameraTraversal {
+			IndexCamera *camera;
+			const BoundingShape *shape;
+			unsigned int index;
+			// traverse the index, else only the dirty shapes are tested directly
+			bool isFullTraversal;
 		};
 		std::map<std::string_view, std::vector<ref_ptr<BoundingShape>>> shapes_;
+		// incremented when shapes are added or removed, per shape name
+		std::map<std::string_view, uint64_t> shapeVersions_;
+		// sum of the stamps of all shapes with the same name, computed each update
+		std::map<std::string_view, uint64_t> shapeStamps_;
 		std::map<const Camera *, IndexCamera> cameras_;
+		std::vector<ref_ptr<InstancedBoundingVolume>> instancedVolumes_;
+		std::vector<CameraTraversal> traversals_;
+		std::vector<IndexCamera *> traversedCameras_;
 
 		void updateVisibility();
 
-		void updateVisibility(IndexCamera &camera, const BoundingShape &shape, bool isMultiShape);
+		void updateShapeStamps();
+
+		static CameraStamps cameraStamps(const Camera &camera);
+
+		void traverseCamera(const CameraTraversal &traversal);
+
+		void traverseDirtyShapes(const CameraTraversal &traversal);
+
+		void traverseInstanced(const CameraTraversal &traversal);
+
+		bool isInstanced(std::string_view shapeName) const;
+
+		static void mergeTraversals(IndexCamera &ic);
+
+		static void mergeSorted(IndexCamera &ic, IndexedShape &shape, unsigned int *mappedData);
+
+		static void mergeWithPreviousOrder(IndexCamera &ic, IndexedShape &shape, unsigned int *mappedData);
+
+		void updateSortPose(IndexCamera &ic) const;
+
+		/**
+		 * @brief Run a number of jobs using the job system
+		 * The first job runs on the calling thread, the function returns
+		 * when all jobs are done. Jobs run serially if threading is disabled.
+		 * @param numJobs The number of jobs
+		 * @param job The job function, called with the job index
+		 */
+		void parallelFor(unsigned int numJobs, const std::function<void(unsigned int)> &job);
 
 		/**
 		 * @brief Add a shape to the index
@@ -152,6 +323,35 @@ namespace regen {
 		void removeFromIndex(const ref_ptr<BoundingShape> &shape);
 
 		static void createIndexShape(IndexCamera &ic, const ref_ptr<BoundingShape> &shape);
+
+		/**
+		 * @brief Bounded max-heap of the k nearest shapes found so far
+		 * Distances are squared until the result is finished.
+		 */
+		struct NearestHeap {
+			std::vector<Neighbor> &result;
+			unsigned int k;
+			float maxDistanceSq;
+
+			NearestHeap(std::vector<Neighbor> &result, unsigned int k, float maxDistance);
+
+			/**
+			 * @return The squared distance a shape must be below to be added
+			 */
+			float boundSq() const;
+
+			/**
+			 * @brief Add a shape if it is closer than the current bound
+			 * @param shape The shape
+			 * @param distanceSq The squared distance
+			 */
+			void push(const BoundingShape *shape, float distanceSq);
+
+			/**
+			 * @brief Sort the result by distance and compute the distances
+			 */
+			void finish();
+		};
 	};
 } // namespace
 
@@ -36,7 +36,12 @@ GeometricCulling::GeometricCulling(
 		}
 		instanceData.unmap();
 		state()->joinShaderInput(instanceIDMap_);
+		// each group has space for all instances, such that it can be borrowed by instanceIDMap_
 		lodGroups_.resize(mesh_->numLODs());
+		for (auto &lodGroup : lodGroups_) {
+			lodGroup.resize(numInstances_);
+		}
+		lodGroupSizes_.resize(mesh_->numLODs(), 0u);
 	}
 }
 
@@ -62,6 +67,7 @@ void computeLODGroups_(
 		const ref_ptr<BoundingShape> &shape,
 		const ref_ptr<Camera> &camera,
 		std::vector<std::vector<GLuint>> &lodGroups,
+		std::vector<GLuint> &lodGroupSizes,
 		const unsigned int *mappedData,
 		int begin,
 		int end,
@@ -72,17 +78,21 @@ void computeLODGroups_(
 
 	if (lodGroups.size() == 1) {
 		for (int i = begin; i != end; i += increment) {
-			lodGroups[0].push_back(mappedData[i]);
+			lodGroups[0][lodGroupSizes[0]++] = mappedData[i];
 		}
 	}
 	else if (transform.get() && modelOffset.get()) {
-		auto modelOffsetData = modelOffset->mapClientData<Vec3f>(ShaderData::READ);
-		auto tfData = transform->get()->mapClientData<Mat4f>(ShaderData::READ);
+		// map both inputs at once, such that they are consistent with each other
+		ShaderDataGroup mapped({
+			{transform->get().get(), ShaderData::READ},
+			{modelOffset.get(), ShaderData::READ}});
+		auto *tfData = mapped.r<Mat4f>(0);
+		auto *modelOffsetData = mapped.r<Vec3f>(1);
 		for (int i = begin; i != end; i += increment) {
 			auto lodLevel = mesh->getLODLevel((
-				tfData.r[mappedData[i]].position() +
-				modelOffsetData.r[mappedData[i]] - camPos.r).length());
-			lodGroups[lodLevel].push_back(mappedData[i]);
+				tfData[mappedData[i]].position() +
+				modelOffsetData[mappedData[i]] - camPos.r).length());
+			lodGroups[lodLevel][lodGroupSizes[lodLevel]++] = mappedData[i];
 		}
 	}
 	else if (modelOffset.get()) {
@@ -90,7 +100,7 @@ void computeLODGroups_(
 		for (int i = begin; i != end; i += increment) {
 			auto lodLevel = mesh->getLODLevel((
 				modelOffsetData.r[mappedData[i]] - camPos.r).length());
-			lodGroups[lodLevel].push_back(mappedData[i]);
+			lodGroups[lodLevel][lodGroupSizes[lodLevel]++] = mappedData[i];
 		}
 	}
 	else if (transform.get()) {
@@ -98,20 +108,18 @@ void computeLODGroups_(
 		for (int i = begin; i != end; i += increment) {
 			auto lodLevel = mesh->getLODLevel((
 				tfData.r[mappedData[i]].position() - camPos.r).length());
-			lodGroups[lodLevel].push_back(mappedData[i]);
+			lodGroups[lodLevel][lodGroupSizes[lodLevel]++] = mappedData[i];
 		}
 	}
 	else {
 		for (int i = begin; i != end; i += increment) {
-			lodGroups[0].push_back(mappedData[i]);
+			lodGroups[0][lodGroupSizes[0]++] = mappedData[i];
 		}
 	}
 }
 
 void GeometricCulling::computeLODGroups() {
-	for (auto &lodGroup : lodGroups_) {
-		lodGroup.clear();
-	}
+	std::fill(lodGroupSizes_.begin(), lodGroupSizes_.end(), 0u);
 	auto visible_ids = shapeIndex_->mapInstanceIDs(ShaderData::READ);
 	auto numVisible = visible_ids.r[0];
 	if (numVisible == 0) { return; }
@@ -122,6 +130,7 @@ void GeometricCulling::computeLODGroups() {
 			shapeIndex_->shape(),
 			camera_,
 			lodGroups_,
+			lodGroupSizes_,
 			visible_ids.r+1,
 			static_cast<int>(numVisible) - 1,
 			-1,
@@ -132,6 +141,7 @@ void GeometricCulling::computeLODGroups() {
 			shapeIndex_->shape(),
 			camera_,
 			lodGroups_,
+			lodGroupSizes_,
 			visible_ids.r+1,
 			0,
 			static_cast<int>(numVisible),
@@ -154,25 +164,21 @@ void GeometricCulling::traverseInstanced_(RenderState *rs, unsigned int numVisib
 }
 
 void GeometricCulling::traverseInstanced1(RenderState *rs) {
-	// Shape does not have LOD levels, thus shapeIndex_ instance array can be used directly
-	// TODO: Avoid the copy here and below. Exchanging the data pointers should be enough.
-	//       But shader input does not have an interface for this yet. It manages two data slots.
-	//       So the new operation would need to write-lock one slot, but then exchange the data pointers, plus reversing
-	//       after traversal.
-	auto instance_ids = instanceIDMap_->mapClientData<unsigned int>(ShaderData::WRITE);
+	// Shape does not have LOD levels, thus shapeIndex_ instance array can be used directly.
+	// It stays mapped for reading during the traversal, the spatial index
+	// writes into its second slot in the meantime.
 	auto visible_ids = shapeIndex_->mapInstanceIDs(ShaderData::READ);
 	auto numVisible = visible_ids.r[0];
-	std::memcpy(instance_ids.w, visible_ids.r+1, numVisible * sizeof(unsigned int));
-	visible_ids.unmap();
-	instance_ids.unmap();
+	// the first element is the number of visible instances
+	auto borrowed = instanceIDMap_->borrowClientData(
+			reinterpret_cast<const byte *>(visible_ids.r + 1));
 	traverseInstanced_(rs, numVisible);
 }
 
 void GeometricCulling::traverseInstanced2(RenderState *rs, const unsigned int *visibleInstances, unsigned int numVisible) {
 	// update instanceIDMap_ based on visibility
-	auto instance_ids = instanceIDMap_->mapClientData<unsigned int>(ShaderData::WRITE);
-	std::memcpy(instance_ids.w, visibleInstances, numVisible * sizeof(unsigned int));
-	instance_ids.unmap();
+	auto borrowed = instanceIDMap_->borrowClientData(
+			reinterpret_cast<const byte *>(visibleInstances));
 	traverseInstanced_(rs, numVisible);
 }
 
@@ -205,7 +211,8 @@ void GeometricCulling::traverse(RenderState *rs) {
 
 			for (unsigned int lodLevel=0; lodLevel<mesh_->numLODs(); ++lodLevel) {
 				auto &lodGroup = lodGroups_[lodLevel];
-				if (lodGroup.empty()) { continue; }
+				auto lodGroupSize = lodGroupSizes_[lodLevel];
+				if (lodGroupSize == 0) { continue; }
 				// set the LOD level
 				if (lodGroups_.size() > 1) {
 					mesh_->activateLOD(lodLevel);
@@ -222,7 +229,7 @@ void GeometricCulling::traverse(RenderState *rs) {
 							static_cast<float>(part->numLODs()) / static_cast<float>(mesh_->numLODs()))));
 					}
 				}
-				traverseInstanced2(rs, lodGroup.data(), lodGroup.size());
+				traverseInstanced2(rs, lodGroup.data(), lodGroupSize);
 			}
 			// reset LOD level
 			if (lodGroups_.size() > 1) {
@@ -49,6 +49,7 @@ namespace regen {
 		ref_ptr<ShaderInput1ui> instanceIDMap_;
 		ref_ptr<Mesh> mesh_;
 		std::vector<std::vector<GLuint>> lodGroups_;
+		std::vector<GLuint> lodGroupSizes_;
 
 		void updateMeshLOD();
 
@@ -12,6 +12,7 @@
 #include "regen/textures/texture-2d.h"
 #include "regen/animations/boids.h"
 #include "regen/animations/transform-animation.h"
+#include "regen/animations/animation-manager.h"
 #include "regen/scene/value-generator.h"
 
 using namespace regen;
@@ -30,15 +31,96 @@ ModelTransformation::ModelTransformation()
 	uniforms->addUniform(modelMat_);
 	uniforms->addUniform(velocity_);
 	setInput(uniforms);
+	simulatedMat_ = modelMat_;
 }
 
-const ref_ptr<ShaderInputMat4> &ModelTransformation::get() const { return modelMat_; }
+ModelTransformation::~ModelTransformation() {
+	if (isInterpolated_) {
+		AnimationManager::get().removeTickListener(this);
+	}
+}
+
+const ref_ptr<ShaderInputMat4> &ModelTransformation::get() const { return simulatedMat_; }
+
+static void copyMatrices(const ShaderInputMat4 &src, ShaderInputMat4 &dst) {
+	if (src.numInstances() > 1 && dst.numInstances() != src.numInstances()) {
+		dst.setInstanceData(src.numInstances(), 1, nullptr);
+	}
+	auto numMatrices = std::min(src.numInstances(), dst.numInstances());
+	auto srcData = src.mapClientData<Mat4f>(ShaderData::READ);
+	auto dstData = dst.mapClientData<Mat4f>(ShaderData::WRITE);
+	std::copy(srcData.r, srcData.r + numMatrices, dstData.w);
+}
+
+static Mat4f blendMatrix(const Mat4f &a, const Mat4f &b, double alpha) {
+	// Note: the rotation is blended linearly too, which is accurate enough
+	//       for the small change between two ticks.
+	Mat4f blended;
+	for (int i = 0; i < 16; ++i) {
+		blended.x[i] = math::lerp(a.x[i], b.x[i], alpha);
+	}
+	return blended;
+}
+
+void ModelTransformation::setInterpolated(bool isInterpolated) {
+	if (isInterpolated == isInterpolated_) return;
+	isInterpolated_ = isInterpolated;
+	if (isInterpolated_) {
+		// animations write to a separate matrix from now on
+		simulatedMat_ = ref_ptr<ShaderInputMat4>::alloc("modelMatrix");
+		simulatedMat_->setUniformData(Mat4f::identity());
+		copyMatrices(*modelMat_.get(), *simulatedMat_.get());
+		resetInterpolation();
+		AnimationManager::get().addTickListener(this);
+	} else {
+		AnimationManager::get().removeTickListener(this);
+		copyMatrices(*simulatedMat_.get(), *modelMat_.get());
+		simulatedMat_ = modelMat_;
+	}
+}
+
+void ModelTransformation::resetInterpolation() {
+	if (!isInterpolated_) return;
+	copyMatrices(*simulatedMat_.get(), *modelMat_.get());
+	auto matrices = simulatedMat_->mapClientData<Mat4f>(ShaderData::READ);
+	matrixTicks_.reset(matrices.r, simulatedMat_->numInstances());
+	lastBlendFactor_ = -1.0;
+}
+
+void ModelTransformation::onTick() {
+	auto matrices = simulatedMat_->mapClientData<Mat4f>(ShaderData::READ);
+	matrixTicks_.push(matrices.r, simulatedMat_->numInstances());
+}
+
+void ModelTransformation::updateInterpolation() {
+	auto &animations = AnimationManager::get();
+	auto tickCount = animations.tickCount();
+	auto alpha = animations.interpolationFactor();
+	// the model matrix is enabled multiple times per frame, blend only once per frame
+	if (tickCount == lastBlendTick_ && alpha == lastBlendFactor_) return;
+	lastBlendTick_ = tickCount;
+	lastBlendFactor_ = alpha;
+
+	blendedMatrices_.resize(modelMat_->numInstances());
+	auto numBlended = matrixTicks_.blend(alpha,
+			blendedMatrices_.data(), blendedMatrices_.size(), blendMatrix);
+	if (numBlended > 0) {
+		int mapMode = ShaderData::WRITE;
+		if (numBlended < blendedMatrices_.size()) mapMode |= ShaderData::INDEX;
+		auto matrices = modelMat_->mapClientData<Mat4f>(mapMode);
+		std::copy(blendedMatrices_.begin(), blendedMatrices_.begin() + numBlended, matrices.w);
+		matrices.markDirty(0, numBlended);
+	}
+}
 
 void ModelTransformation::set_audioSource(const ref_ptr<AudioSource> &audioSource) { audioSource_ = audioSource; }
 
 GLboolean ModelTransformation::isAudioSource() const { return audioSource_.get() != nullptr; }
 
 void ModelTransformation::enable(RenderState *rs) {
+	if (isInterpolated_) {
+		updateInterpolation();
+	}
 	if (isAudioSource()) {
 		boost::posix_time::ptime time(
 				boost::posix_time::microsec_clock::local_time());
@@ -462,6 +544,8 @@ ModelTransformation::load(LoadingContext &ctx, scene::SceneInputNode &input, con
 	bool isInstanced = input.getValue<bool>("is-instanced", false);
 	auto numInstances = input.getValue<GLuint>("num-instances", 1u);
 	transform = ref_ptr<ModelTransformation>::alloc();
+	// must be set before animations are created
+	transform->setInterpolated(input.getValue<bool>("interpolate", false));
 
 	// Handle instanced model matrix
 	if (isInstanced && numInstances > 1) {
@@ -471,12 +555,14 @@ ModelTransformation::load(LoadingContext &ctx, scene::SceneInputNode &input, con
 			for (GLuint i = 0; i < numInstances; i += 1) matrices.w[i] = Mat4f::identity();
 		}
 		transformMatrix(scene, input, state, ctx.parent(), transform, numInstances);
+		transform->resetInterpolation();
 		// add data to vbo
-		transform->setInput(transform->get());
+		transform->setInput(transform->renderMatrix());
 	} else {
 		transformMatrix(scene, input, state, ctx.parent(), transform, 1u);
-		if (transform->get()->numInstances() > 1) {
-			transform->setInput(transform->get());
+		transform->resetInterpolation();
+		if (transform->renderMatrix()->numInstances() > 1) {
+			transform->setInput(transform->renderMatrix());
 		}
 	}
 
@@ -12,6 +12,7 @@
 #include <regen/math/quaternion.h>
 #include <regen/gl-types/shader-input-container.h>
 #include <regen/states/state.h>
+#include <regen/animations/tick-interpolation.h>
 
 namespace regen {
 	/**
@@ -19,20 +20,50 @@ namespace regen {
 	 *
 	 * Usually meshes should be defined at origin and then translated
 	 * and rotated to the world position.
+	 *
+	 * If the transformation is interpolated, animations write to a separate
+	 * matrix, and the model matrix used for rendering is blended between
+	 * the last two animation ticks when the state is enabled.
 	 */
-	class ModelTransformation : public State, public HasInput {
+	class ModelTransformation : public State, public HasInput, public TickListener {
 	public:
 		static constexpr const char *TYPE_NAME = "ModelTransformation";
 
 		ModelTransformation();
 
+		~ModelTransformation() override;
+
 		static ref_ptr<ModelTransformation> load(LoadingContext &ctx, scene::SceneInputNode &input, const ref_ptr<State> &state);
 
 		/**
-		 * @return the model transformation matrix.
+		 * @return the model transformation matrix, written by animations.
 		 */
 		const ref_ptr<ShaderInputMat4> &get() const;
 
+		/**
+		 * @return the model transformation matrix used for rendering.
+		 * This is the same as get() unless the transformation is interpolated.
+		 */
+		const ref_ptr<ShaderInputMat4> &renderMatrix() const { return modelMat_; }
+
+		/**
+		 * Blend the matrix used for rendering between the last two animation ticks.
+		 * Must be called before get() is passed to animations.
+		 * @param isInterpolated true to enable interpolation.
+		 */
+		void setInterpolated(bool isInterpolated);
+
+		/**
+		 * @return true if the matrix used for rendering is interpolated.
+		 */
+		bool isInterpolated() const { return isInterpolated_; }
+
+		/**
+		 * Copy the matrix written by animations to the matrix used for rendering,
+		 * without blending. Should be called after the matrix was changed outside of animations.
+		 */
+		void resetInterpolation();
+
 		/**
 		 * @param audioSource the audio source attached to the world position
 		 * of the model.
@@ -48,14 +79,25 @@ namespace regen {
 		// Override
 		void enable(RenderState *rs) override;
 
+		// Override
+		void onTick() override;
+
 	protected:
 		ref_ptr<ShaderInputMat4> modelMat_;
+		ref_ptr<ShaderInputMat4> simulatedMat_;
+		bool isInterpolated_ = false;
+		TickSnapshot<Mat4f> matrixTicks_;
+		std::vector<Mat4f> blendedMatrices_;
+		unsigned int lastBlendTick_ = 0u;
+		double lastBlendFactor_ = -1.0;
 		ref_ptr<ShaderInput3f> velocity_;
 
 		ref_ptr<AudioSource> audioSource_;
 
 		Vec3f lastPosition_;
 		boost::posix_time::ptime lastTime_;
+
+		void updateInterpolation();
 	};
 } // namespace
 
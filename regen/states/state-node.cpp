@@ -122,6 +122,8 @@ void RootNode::init() {
 
 void RootNode::render(GLdouble dt) {
 	GL_ERROR_LOG();
+	// uploads of the last frame happened in render() and postRender()
+	ShaderInput::nextUploadFrame();
 	RenderState::get()->setDeltaTime(dt);
 	traverse(RenderState::get());
 	GL_ERROR_LOG();
@@ -0,0 +1,153 @@
+#include <new>
+
+#include "aligned-arena.h"
+
+using namespace regen;
+
+// blocks up to this size are rounded to a multiple of the alignment,
+// larger blocks are rounded to one of four classes per power of two.
+#define REGEN_ARENA_LINEAR_CLASS_SIZE 512
+#define REGEN_ARENA_NUM_LINEAR_CLASSES (REGEN_ARENA_LINEAR_CLASS_SIZE / REGEN_ARENA_ALIGNMENT)
+#define REGEN_ARENA_LINEAR_CLASS_BITS 9
+
+thread_local unsigned int AlignedArena::currentTag_ = AlignedArena::DEFAULT_TAG;
+
+static constexpr std::align_val_t arenaAlignment{REGEN_ARENA_ALIGNMENT};
+
+static unsigned int log2Floor(size_t x) {
+	unsigned int n = 0;
+	while (x >>= 1) ++n;
+	return n;
+}
+
+AlignedArena::Scope::Scope(std::string_view tagName) {
+	previousTag_ = currentTag_;
+	currentTag_ = AlignedArena::get().tag(tagName);
+}
+
+AlignedArena::Scope::~Scope() {
+	currentTag_ = previousTag_;
+}
+
+AlignedArena::AlignedArena() {
+	sizeClasses_.resize(sizeClass(REGEN_ARENA_MAX_CLASS_SIZE) + 1);
+	tagNames_.emplace_back("default");
+	statistics_.emplace_back();
+}
+
+AlignedArena::~AlignedArena() {
+	for (auto *chunk: chunks_) {
+		::operator delete(chunk, arenaAlignment);
+	}
+}
+
+AlignedArena &AlignedArena::get() {
+	static auto *arena = new AlignedArena();
+	return *arena;
+}
+
+unsigned int AlignedArena::currentTag() {
+	return currentTag_;
+}
+
+unsigned int AlignedArena::sizeClass(size_t size) {
+	if (size <= REGEN_ARENA_LINEAR_CLASS_SIZE) {
+		return size == 0 ? 0u : static_cast<unsigned int>((size - 1) / REGEN_ARENA_ALIGNMENT);
+	}
+	// size is in (2^k, 2^(k+1)]
+	auto k = log2Floor(size - 1);
+	size_t step = (size_t(1) << k) / 4;
+	auto sub = static_cast<unsigned int>((size - (size_t(1) << k) + step - 1) / step);
+	return REGEN_ARENA_NUM_LINEAR_CLASSES + (k - REGEN_ARENA_LINEAR_CLASS_BITS) * 4 + (sub - 1);
+}
+
+size_t AlignedArena::blockSize(size_t size) {
+	if (size > REGEN_ARENA_MAX_CLASS_SIZE) {
+		return (size + REGEN_ARENA_ALIGNMENT - 1) & ~size_t(REGEN_ARENA_ALIGNMENT - 1);
+	}
+	auto sizeIndex = sizeClass(size);
+	if (sizeIndex < REGEN_ARENA_NUM_LINEAR_CLASSES) {
+		return (sizeIndex + 1) * REGEN_ARENA_ALIGNMENT;
+	}
+	sizeIndex -= REGEN_ARENA_NUM_LINEAR_CLASSES;
+	size_t base = size_t(1) << (sizeIndex / 4 + REGEN_ARENA_LINEAR_CLASS_BITS);
+	return base + (sizeIndex % 4 + 1) * (base / 4);
+}
+
+unsigned int AlignedArena::tag(std::string_view tagName) {
+	std::lock_guard<std::mutex> lk(lock_);
+	for (unsigned int i = 0; i < tagNames_.size(); ++i) {
+		if (tagNames_[i] == tagName) return i;
+	}
+	tagNames_.emplace_back(tagName);
+	statistics_.emplace_back();
+	return static_cast<unsigned int>(tagNames_.size() - 1);
+}
+
+std::string AlignedArena::tagName(unsigned int tag) const {
+	std::lock_guard<std::mutex> lk(lock_);
+	return tag < tagNames_.size() ? tagNames_[tag] : std::string();
+}
+
+void *AlignedArena::allocate(size_t size, unsigned int tag) {
+	auto numBytes = blockSize(size);
+	std::lock_guard<std::mutex> lk(lock_);
+	auto &stats = statistics_[tag < statistics_.size() ? tag : DEFAULT_TAG];
+	stats.numBlocks += 1;
+	stats.numBytes += size;
+	stats.numReservedBytes += numBytes;
+
+	if (size > REGEN_ARENA_MAX_CLASS_SIZE) {
+		return ::operator new(numBytes, arenaAlignment);
+	}
+	auto &blocks = sizeClasses_[sizeClass(size)];
+	if (blocks.freeList) {
+		auto *block = blocks.freeList;
+		blocks.freeList = block->next;
+		return block;
+	}
+	if (blocks.chunkBegin + numBytes > blocks.chunkEnd) {
+		// the remainder of the previous chunk is lost, it is smaller than a block
+		auto *chunk = static_cast<std::byte *>(::operator new(REGEN_ARENA_CHUNK_SIZE, arenaAlignment));
+		chunks_.push_back(chunk);
+		blocks.chunkBegin = chunk;
+		blocks.chunkEnd = chunk + REGEN_ARENA_CHUNK_SIZE;
+	}
+	auto *block = blocks.chunkBegin;
+	blocks.chunkBegin += numBytes;
+	return block;
+}
+
+void AlignedArena::deallocate(void *block, size_t size, unsigned int tag) {
+	if (!block) return;
+	auto numBytes = blockSize(size);
+	std::lock_guard<std::mutex> lk(lock_);
+	auto &stats = statistics_[tag < statistics_.size() ? tag : DEFAULT_TAG];
+	stats.numBlocks -= 1;
+	stats.numBytes -= size;
+	stats.numReservedBytes -= numBytes;
+
+	if (size > REGEN_ARENA_MAX_CLASS_SIZE) {
+		::operator delete(block, arenaAlignment);
+		return;
+	}
+	auto &blocks = sizeClasses_[sizeClass(size)];
+	auto *freeBlock = static_cast<FreeBlock *>(block);
+	freeBlock->next = blocks.freeList;
+	blocks.freeList = freeBlock;
+}
+
+AlignedArena::Statistics AlignedArena::statistics(unsigned int tag) const {
+	std::lock_guard<std::mutex> lk(lock_);
+	return tag < statistics_.size() ? statistics_[tag] : Statistics();
+}
+
+std::vector<AlignedArena::Statistics> AlignedArena::statistics() const {
+	std::lock_guard<std::mutex> lk(lock_);
+	return statistics_;
+}
+
+size_t AlignedArena::numChunkBytes() const {
+	std::lock_guard<std::mutex> lk(lock_);
+	return chunks_.size() * REGEN_ARENA_CHUNK_SIZE;
+}
@@ -0,0 +1,156 @@
+#ifndef REGEN_ALIGNED_ARENA_H_
+#define REGEN_ALIGNED_ARENA_H_
+
+#include <mutex>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+// alignment of all blocks, a cache line such that SIMD loads and stores are safe
+#define REGEN_ARENA_ALIGNMENT 64
+// blocks up to this size are allocated from size classes
+#define REGEN_ARENA_MAX_CLASS_SIZE (64 * 1024)
+// size of the chunks that are carved into blocks of one size class
+#define REGEN_ARENA_CHUNK_SIZE (256 * 1024)
+
+namespace regen {
+	/**
+	 * @brief Allocates memory blocks with 64 byte alignment from size classes.
+	 * Block sizes are rounded up to a size class, blocks of one class are carved
+	 * from larger chunks such that blocks allocated in sequence are adjacent in memory.
+	 * Freed blocks are reused by the next allocation of the same class, chunks are not
+	 * returned to the system. Blocks larger than the largest size class are allocated individually.
+	 * Allocations are counted per tag, e.g. per subsystem of a scene.
+	 * The tag of allocations is set per thread with a Scope.
+	 */
+	class AlignedArena {
+	public:
+		/**
+		 * @brief Allocation statistics of a tag.
+		 */
+		struct Statistics {
+			/** the number of allocated blocks. */
+			size_t numBlocks = 0;
+			/** the number of requested bytes. */
+			size_t numBytes = 0;
+			/** the number of bytes reserved for the blocks, including the size class rounding. */
+			size_t numReservedBytes = 0;
+		};
+
+		/**
+		 * @brief Sets the tag of allocations in the current thread while it exists.
+		 */
+		class Scope {
+		public:
+			/**
+			 * @param tagName the name of the tag.
+			 */
+			explicit Scope(std::string_view tagName);
+
+			~Scope();
+
+			Scope(const Scope &) = delete;
+
+		protected:
+			unsigned int previousTag_;
+		};
+
+		/** the tag of allocations outside of any scope. */
+		static constexpr unsigned int DEFAULT_TAG = 0;
+
+		AlignedArena();
+
+		~AlignedArena();
+
+		AlignedArena(const AlignedArena &) = delete;
+
+		/**
+		 * Note that the arena is never destroyed, such that static objects may free blocks on exit.
+		 * @return the arena shared by the engine.
+		 */
+		static AlignedArena &get();
+
+		/**
+		 * @return the tag of allocations in the current thread.
+		 */
+		static unsigned int currentTag();
+
+		/**
+		 * @param size a block size in bytes.
+		 * @return the size of the size class of the block, or the aligned size of a large block.
+		 */
+		static size_t blockSize(size_t size);
+
+		/**
+		 * @param size a block size in bytes, at most REGEN_ARENA_MAX_CLASS_SIZE.
+		 * @return the index of the size class.
+		 */
+		static unsigned int sizeClass(size_t size);
+
+		/**
+		 * @param tagName the name of a tag.
+		 * @return the tag, it is created if it does not exist yet.
+		 */
+		unsigned int tag(std::string_view tagName);
+
+		/**
+		 * @param tag a tag.
+		 * @return the name of the tag.
+		 */
+		std::string tagName(unsigned int tag) const;
+
+		/**
+		 * Allocate a block.
+		 * @param size the size in bytes.
+		 * @param tag the tag of the allocation.
+		 * @return a block with 64 byte alignment.
+		 */
+		void *allocate(size_t size, unsigned int tag = DEFAULT_TAG);
+
+		/**
+		 * Free a block.
+		 * @param block the block, may be null.
+		 * @param size the size that was passed to allocate.
+		 * @param tag the tag that was passed to allocate.
+		 */
+		void deallocate(void *block, size_t size, unsigned int tag = DEFAULT_TAG);
+
+		/**
+		 * @param tag a tag.
+		 * @return the allocation statistics of the tag.
+		 */
+		Statistics statistics(unsigned int tag) const;
+
+		/**
+		 * @return the allocation statistics of all tags, indexed by tag.
+		 */
+		std::vector<Statistics> statistics() const;
+
+		/**
+		 * @return the number of bytes allocated for chunks.
+		 */
+		size_t numChunkBytes() const;
+
+	protected:
+		struct FreeBlock {
+			FreeBlock *next;
+		};
+		struct SizeClass {
+			// freed blocks of this class
+			FreeBlock *freeList = nullptr;
+			// the unused remainder of the last chunk
+			std::byte *chunkBegin = nullptr;
+			std::byte *chunkEnd = nullptr;
+		};
+		std::vector<SizeClass> sizeClasses_;
+		std::vector<std::byte *> chunks_;
+		std::vector<std::string> tagNames_;
+		std::vector<Statistics> statistics_;
+		mutable std::mutex lock_;
+
+		static thread_local unsigned int currentTag_;
+	};
+} // namespace
+
+#endif /* REGEN_ALIGNED_ARENA_H_ */
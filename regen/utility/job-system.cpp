@@ -0,0 +1,238 @@
+#include "job-system.h"
+#include "logging.h"
+
+// number of attempts to find a job before an idle worker goes to sleep
+#define REGEN_JOB_SYSTEM_SPIN_COUNT 64
+
+using namespace regen;
+
+static std::atomic<uint64_t> nextSystemID_{1u};
+
+JobSystem &JobSystem::get() {
+	static JobSystem jobSystem;
+	return jobSystem;
+}
+
+unsigned int JobSystem::defaultNumWorkers() {
+	return std::max(2u, std::thread::hardware_concurrency()) - 1u;
+}
+
+JobSystem::JobSystem(unsigned int numWorkers)
+		: systemID_(nextSystemID_.fetch_add(1u)) {
+	numWorkers = std::min(numWorkers, static_cast<unsigned int>(REGEN_JOB_SYSTEM_MAX_CONTEXTS / 2));
+	workers_.reserve(numWorkers);
+	for (unsigned int i = 0; i < numWorkers; ++i) {
+		workers_.emplace_back(&JobSystem::workerLoop, this, i);
+	}
+}
+
+JobSystem::~JobSystem() {
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex_);
+		isRunning_.store(false);
+	}
+	sleepCond_.notify_all();
+	for (auto &worker: workers_) {
+		worker.join();
+	}
+	// release the jobs that were never executed
+	auto numContexts = numContexts_.load(std::memory_order_acquire);
+	for (uint32_t i = 0; i < numContexts; ++i) {
+		for (uint32_t j = 0; j < REGEN_JOB_QUEUE_SIZE; ++j) {
+			auto &job = contexts_[i]->jobs[j];
+			if (!job.isFree.load(std::memory_order_acquire)) {
+				job.destroy(job);
+			}
+		}
+	}
+}
+
+JobSystem::Deque::Deque()
+		: buffer_(new std::atomic<Job *>[REGEN_JOB_QUEUE_SIZE]) {
+}
+
+bool JobSystem::Deque::push(Job *job) {
+	auto b = bottom_.load(std::memory_order_relaxed);
+	auto t = top_.load(std::memory_order_acquire);
+	if (b - t >= REGEN_JOB_QUEUE_SIZE) {
+		return false;
+	}
+	buffer_[b & (REGEN_JOB_QUEUE_SIZE - 1)].store(job, std::memory_order_relaxed);
+	// publish the job to the stealing threads
+	bottom_.store(b + 1, std::memory_order_release);
+	return true;
+}
+
+JobSystem::Job *JobSystem::Deque::pop() {
+	auto b = bottom_.load(std::memory_order_relaxed) - 1;
+	bottom_.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	auto t = top_.load(std::memory_order_relaxed);
+	if (t > b) {
+		// the deque is empty
+		bottom_.store(b + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+	Job *job = buffer_[b & (REGEN_JOB_QUEUE_SIZE - 1)].load(std::memory_order_relaxed);
+	if (t == b) {
+		// last job in the deque, race against the stealing threads
+		if (!top_.compare_exchange_strong(t, t + 1,
+				std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			job = nullptr;
+		}
+		bottom_.store(b + 1, std::memory_order_relaxed);
+	}
+	return job;
+}
+
+JobSystem::Job *JobSystem::Deque::steal() {
+	auto t = top_.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	auto b = bottom_.load(std::memory_order_acquire);
+	if (t >= b) {
+		return nullptr;
+	}
+	Job *job = buffer_[t & (REGEN_JOB_QUEUE_SIZE - 1)].load(std::memory_order_relaxed);
+	if (!top_.compare_exchange_strong(t, t + 1,
+			std::memory_order_seq_cst, std::memory_order_relaxed)) {
+		// another thread was faster
+		return nullptr;
+	}
+	return job;
+}
+
+JobSystem::Context *JobSystem::context() {
+	// each thread caches its context of the last job system it has used
+	thread_local uint64_t cachedSystemID = 0u;
+	thread_local Context *cachedContext = nullptr;
+	if (cachedSystemID == systemID_) {
+		return cachedContext;
+	}
+	auto *ctx = registerContext();
+	cachedSystemID = systemID_;
+	cachedContext = ctx;
+	return ctx;
+}
+
+JobSystem::Context *JobSystem::registerContext() {
+	std::lock_guard<std::mutex> lock(contextMutex_);
+	auto threadID = std::this_thread::get_id();
+	auto numContexts = numContexts_.load(std::memory_order_relaxed);
+	for (uint32_t i = 0; i < numContexts; ++i) {
+		if (contexts_[i]->threadID == threadID) {
+			return contexts_[i].get();
+		}
+	}
+	if (numContexts == REGEN_JOB_SYSTEM_MAX_CONTEXTS) {
+		REGEN_WARN("Too many threads use the job system, jobs will be executed immediately.");
+		return nullptr;
+	}
+	auto &ctx = contexts_[numContexts];
+	ctx = std::make_unique<Context>();
+	ctx->jobs.reset(new Job[REGEN_JOB_QUEUE_SIZE]);
+	ctx->threadID = threadID;
+	ctx->randomState = 2654435761u * (numContexts + 1u);
+	// publish the context to the stealing threads
+	numContexts_.store(numContexts + 1, std::memory_order_release);
+	return ctx.get();
+}
+
+JobSystem::Job *JobSystem::allocateJob(Context &ctx) {
+	auto &job = ctx.jobs[ctx.nextJob & (REGEN_JOB_QUEUE_SIZE - 1)];
+	if (!job.isFree.load(std::memory_order_acquire)) {
+		// the slot is still in use, all slots are in use if the ring wrapped around
+		return nullptr;
+	}
+	ctx.nextJob += 1;
+	job.isFree.store(false, std::memory_order_relaxed);
+	return &job;
+}
+
+void JobSystem::submit(Context &ctx, Job *job) {
+	if (!ctx.deque.push(job)) {
+		execute(job);
+		return;
+	}
+	numQueuedJobs_.fetch_add(1);
+	if (numSleepingWorkers_.load() > 0) {
+		std::lock_guard<std::mutex> lock(sleepMutex_);
+		sleepCond_.notify_one();
+	}
+}
+
+JobSystem::Job *JobSystem::nextJob(Context &ctx) {
+	Job *job = ctx.deque.pop();
+	if (!job) {
+		// try to steal a job from another thread, start at a random victim
+		auto numContexts = numContexts_.load(std::memory_order_acquire);
+		ctx.randomState ^= ctx.randomState << 13u;
+		ctx.randomState ^= ctx.randomState >> 17u;
+		ctx.randomState ^= ctx.randomState << 5u;
+		auto first = ctx.randomState % numContexts;
+		for (uint32_t i = 0; i < numContexts && !job; ++i) {
+			auto *victim = contexts_[(first + i) % numContexts].get();
+			if (victim != &ctx) {
+				job = victim->deque.steal();
+			}
+		}
+	}
+	if (job) {
+		numQueuedJobs_.fetch_sub(1);
+	}
+	return job;
+}
+
+void JobSystem::execute(Job *job) {
+	auto *counter = job->counter;
+	try {
+		job->invoke(*job);
+	}
+	catch (const std::exception &e) {
+		REGEN_WARN("Job error: " << e.what());
+	}
+	catch (...) {
+		REGEN_WARN("Unknown job error.");
+	}
+	job->destroy(*job);
+	job->isFree.store(true, std::memory_order_release);
+	if (counter) {
+		counter->count_.fetch_sub(1u, std::memory_order_acq_rel);
+	}
+}
+
+void JobSystem::wait(Counter &counter) {
+	auto *ctx = context();
+	while (!counter.isDone()) {
+		Job *job = ctx ? nextJob(*ctx) : nullptr;
+		if (job) {
+			execute(job);
+		} else {
+			// the remaining jobs are executed by other threads
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::workerLoop(unsigned int) {
+	auto *ctx = context();
+	if (!ctx) return;
+	unsigned int numIdle = 0;
+	while (isRunning_.load(std::memory_order_relaxed)) {
+		Job *job = nextJob(*ctx);
+		if (job) {
+			execute(job);
+			numIdle = 0;
+		} else if (++numIdle < REGEN_JOB_SYSTEM_SPIN_COUNT) {
+			std::this_thread::yield();
+		} else {
+			// sleep until a job is submitted
+			std::unique_lock<std::mutex> lock(sleepMutex_);
+			numSleepingWorkers_.fetch_add(1);
+			sleepCond_.wait(lock, [this] {
+				return numQueuedJobs_.load() > 0 || !isRunning_.load();
+			});
+			numSleepingWorkers_.fetch_sub(1);
+			numIdle = 0;
+		}
+	}
+}
@@ -0,0 +1,223 @@
+#ifndef REGEN_JOB_SYSTEM_H_
+#define REGEN_JOB_SYSTEM_H_
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <memory>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+// size of the inline storage of a job, larger callables are allocated on the heap
+#define REGEN_JOB_STORAGE_SIZE 64
+// number of jobs that can be queued per thread, must be a power of two
+#define REGEN_JOB_QUEUE_SIZE 4096
+// maximum number of threads that can submit jobs, including the workers
+#define REGEN_JOB_SYSTEM_MAX_CONTEXTS 64
+
+namespace regen {
+	/**
+	 * @brief A job system with work stealing.
+	 * Each thread that submits jobs owns a lock-free deque, it pushes and pops
+	 * jobs at the bottom of its deque, while other threads steal jobs from the top.
+	 * Jobs are allocated from a per-thread ring of job slots, and small callables
+	 * are stored inline in the slot such that submitting a job does not allocate memory.
+	 * Waiting for a counter does not block the calling thread, instead it executes
+	 * jobs until the counter has reached zero.
+	 * Note: if a job queue is full, jobs are executed immediately by the submitting thread.
+	 */
+	class JobSystem {
+	public:
+		/**
+		 * @brief Counts the number of unfinished jobs of a group.
+		 */
+		class Counter {
+		public:
+			Counter() = default;
+
+			Counter(const Counter &) = delete;
+
+			/**
+			 * @return true if all jobs of the group have finished.
+			 */
+			bool isDone() const { return count_.load(std::memory_order_acquire) == 0; }
+
+		protected:
+			std::atomic<uint32_t> count_{0u};
+
+			friend class JobSystem;
+		};
+
+		/**
+		 * @param numWorkers number of worker threads, the threads that wait for jobs
+		 * execute jobs as well.
+		 */
+		explicit JobSystem(unsigned int numWorkers = defaultNumWorkers());
+
+		~JobSystem();
+
+		JobSystem(const JobSystem &) = delete;
+
+		/**
+		 * @return the job system shared by the engine.
+		 */
+		static JobSystem &get();
+
+		/**
+		 * @return the default number of worker threads, one less than the number of cores.
+		 */
+		static unsigned int defaultNumWorkers();
+
+		/**
+		 * @return the number of worker threads.
+		 */
+		auto numWorkers() const { return static_cast<unsigned int>(workers_.size()); }
+
+		/**
+		 * @return the number of threads that execute jobs, i.e. workers plus the waiting thread.
+		 */
+		auto concurrency() const { return numWorkers() + 1u; }
+
+		/**
+		 * Submit a job.
+		 * @param fn the job function, it is called without arguments.
+		 * @param counter optional counter that is incremented, and decremented once the job has finished.
+		 */
+		template<typename F>
+		void run(F &&fn, Counter *counter = nullptr) {
+			using Fn = typename std::decay<F>::type;
+			auto *ctx = context();
+			Job *job = ctx ? allocateJob(*ctx) : nullptr;
+			if (!job) {
+				// no free job slot, execute the job immediately
+				fn();
+				return;
+			}
+			if constexpr (sizeof(Fn) <= REGEN_JOB_STORAGE_SIZE &&
+						  alignof(Fn) <= alignof(std::max_align_t)) {
+				new(job->storage) Fn(std::forward<F>(fn));
+				job->invoke = [](Job &j) { (*std::launder(reinterpret_cast<Fn *>(j.storage)))(); };
+				job->destroy = [](Job &j) { std::launder(reinterpret_cast<Fn *>(j.storage))->~Fn(); };
+			} else {
+				new(job->storage) Fn *(new Fn(std::forward<F>(fn)));
+				job->invoke = [](Job &j) { (**std::launder(reinterpret_cast<Fn **>(j.storage)))(); };
+				job->destroy = [](Job &j) { delete *std::launder(reinterpret_cast<Fn **>(j.storage)); };
+			}
+			job->counter = counter;
+			if (counter) {
+				counter->count_.fetch_add(1u, std::memory_order_relaxed);
+			}
+			submit(*ctx, job);
+		}
+
+		/**
+		 * Wait until all jobs of a counter have finished.
+		 * The calling thread executes jobs while waiting.
+		 * @param counter the counter.
+		 */
+		void wait(Counter &counter);
+
+		/**
+		 * Call a function for each index in [0, count), and wait until all calls have returned.
+		 * @param count the number of indices.
+		 * @param grainSize the number of indices processed by one job.
+		 * @param fn the function, called with the index.
+		 */
+		template<typename F>
+		void parallelFor(unsigned int count, unsigned int grainSize, const F &fn) {
+			if (grainSize == 0) grainSize = 1;
+			if (count <= grainSize || workers_.empty()) {
+				for (unsigned int i = 0; i < count; ++i) {
+					fn(i);
+				}
+				return;
+			}
+			Counter counter;
+			// the calling thread processes the first range itself
+			for (unsigned int begin = grainSize; begin < count; begin += grainSize) {
+				auto end = std::min(count, begin + grainSize);
+				run([&fn, begin, end]() {
+					for (unsigned int i = begin; i < end; ++i) {
+						fn(i);
+					}
+				}, &counter);
+			}
+			for (unsigned int i = 0; i < grainSize; ++i) {
+				fn(i);
+			}
+			wait(counter);
+		}
+
+	protected:
+		struct Job {
+			void (*invoke)(Job &) = nullptr;
+			void (*destroy)(Job &) = nullptr;
+			Counter *counter = nullptr;
+			std::atomic<bool> isFree{true};
+			alignas(std::max_align_t) unsigned char storage[REGEN_JOB_STORAGE_SIZE];
+		};
+
+		/**
+		 * Chase-Lev work stealing deque with fixed capacity.
+		 * Only the owner thread pushes and pops, other threads steal.
+		 */
+		class Deque {
+		public:
+			Deque();
+
+			bool push(Job *job);
+
+			Job *pop();
+
+			Job *steal();
+
+		protected:
+			std::atomic<int64_t> top_{0};
+			std::atomic<int64_t> bottom_{0};
+			std::unique_ptr<std::atomic<Job *>[]> buffer_;
+		};
+
+		struct Context {
+			Deque deque;
+			std::unique_ptr<Job[]> jobs;
+			uint32_t nextJob = 0u;
+			uint32_t randomState = 0u;
+			std::thread::id threadID;
+		};
+
+		std::vector<std::thread> workers_;
+		std::unique_ptr<Context> contexts_[REGEN_JOB_SYSTEM_MAX_CONTEXTS];
+		std::atomic<uint32_t> numContexts_{0u};
+		std::mutex contextMutex_;
+		uint64_t systemID_;
+
+		// number of jobs in the deques, used to put idle workers to sleep
+		std::atomic<int32_t> numQueuedJobs_{0};
+		std::atomic<uint32_t> numSleepingWorkers_{0u};
+		std::atomic<bool> isRunning_{true};
+		std::mutex sleepMutex_;
+		std::condition_variable sleepCond_;
+
+		Context *context();
+
+		Context *registerContext();
+
+		Job *allocateJob(Context &ctx);
+
+		void submit(Context &ctx, Job *job);
+
+		Job *nextJob(Context &ctx);
+
+		void execute(Job *job);
+
+		void workerLoop(unsigned int workerIndex);
+	};
+} // namespace
+
+#endif /* REGEN_JOB_SYSTEM_H_ */
@@ -0,0 +1,95 @@
+#ifndef REGEN_MPSC_QUEUE_H_
+#define REGEN_MPSC_QUEUE_H_
+
+#include <atomic>
+#include <thread>
+#include <utility>
+
+namespace regen {
+	/**
+	 * @brief A lock-free multi-producer single-consumer queue.
+	 * Pushing is wait-free and can be done from any thread, popping must
+	 * only be done by one thread at a time (e.g. the owner of a mutex).
+	 * Elements are popped in the order in which their push operations
+	 * have linearized, i.e. in order per producer thread.
+	 */
+	template<typename T>
+	class MPSCQueue {
+	public:
+		MPSCQueue() : head_(&stub_), tail_(&stub_) {}
+
+		~MPSCQueue() {
+			T value;
+			while (pop(value)) {}
+			if (tail_ != &stub_) {
+				delete tail_;
+			}
+		}
+
+		MPSCQueue(const MPSCQueue &) = delete;
+
+		/**
+		 * Push an element, can be called by any thread.
+		 * @param value the element.
+		 */
+		void push(T value) {
+			auto *node = new Node(std::move(value));
+			// swap the head, then link the previous head to the new node.
+			// A consumer may observe the swapped head before the link is established.
+			auto *prev = head_.exchange(node, std::memory_order_acq_rel);
+			prev->next.store(node, std::memory_order_release);
+		}
+
+		/**
+		 * Pop an element, must only be called by the consumer thread.
+		 * If a producer is just about to link a node, the consumer waits for
+		 * the link to be established, such that elements pushed before the call
+		 * are always popped.
+		 * @param value set to the popped element.
+		 * @return false if the queue is empty.
+		 */
+		bool pop(T &value) {
+			Node *tail = tail_;
+			Node *next = tail->next.load(std::memory_order_acquire);
+			while (next == nullptr) {
+				if (head_.load(std::memory_order_acquire) == tail) {
+					return false;
+				}
+				// a producer has swapped the head but not linked the node yet
+				std::this_thread::yield();
+				next = tail->next.load(std::memory_order_acquire);
+			}
+			value = std::move(next->value);
+			// the popped node becomes the new stub node
+			tail_ = next;
+			if (tail != &stub_) {
+				delete tail;
+			}
+			return true;
+		}
+
+		/**
+		 * Must only be called by the consumer thread.
+		 * @return true if there are no elements in the queue, the result is only a hint
+		 * if producers push concurrently.
+		 */
+		bool empty() const {
+			return head_.load(std::memory_order_acquire) == tail_;
+		}
+
+	protected:
+		struct Node {
+			Node() = default;
+
+			explicit Node(T &&v) : value(std::move(v)) {}
+
+			std::atomic<Node *> next{nullptr};
+			T value;
+		};
+		Node stub_;
+		std::atomic<Node *> head_;
+		Node *tail_;
+	};
+} // namespace
+
+#endif /* REGEN_MPSC_QUEUE_H_ */
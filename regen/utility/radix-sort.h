@@ -0,0 +1,82 @@
+#ifndef REGEN_RADIX_SORT_H_
+#define REGEN_RADIX_SORT_H_
+
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+// below this size, a comparison sort is faster than the radix sort
+#define REGEN_RADIX_SORT_MIN_SIZE 64
+
+namespace regen {
+	/**
+	 * @brief Map a float to an unsigned integer with the same order.
+	 * @param f The float
+	 * @return The integer key
+	 */
+	inline uint32_t radixSortKey(float f) {
+		uint32_t bits;
+		std::memcpy(&bits, &f, sizeof(bits));
+		// flip all bits of negative numbers, and the sign bit of positive numbers
+		return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+	}
+
+	/**
+	 * @brief Sort elements by a float key with a stable LSD radix sort.
+	 * The sort makes four passes over 8 bits of the key each, passes where all
+	 * keys have the same byte are skipped.
+	 * Small arrays are sorted with a comparison sort instead.
+	 * @param data The elements, sorted in place
+	 * @param tmp Scratch buffer, it is resized to the size of data and can be re-used
+	 * @param key Function that returns the float key of an element
+	 */
+	template<typename T, typename KeyFunc>
+	void radixSort(std::vector<T> &data, std::vector<T> &tmp, const KeyFunc &key) {
+		const size_t n = data.size();
+		if (n < REGEN_RADIX_SORT_MIN_SIZE) {
+			std::stable_sort(data.begin(), data.end(), [&key](const T &a, const T &b) {
+				return key(a) < key(b);
+			});
+			return;
+		}
+		tmp.resize(n);
+
+		// compute the histograms of all four passes at once
+		uint32_t counts[4][256] = {};
+		for (size_t i = 0; i < n; ++i) {
+			auto k = radixSortKey(key(data[i]));
+			counts[0][k & 0xffu] += 1;
+			counts[1][(k >> 8u) & 0xffu] += 1;
+			counts[2][(k >> 16u) & 0xffu] += 1;
+			counts[3][k >> 24u] += 1;
+		}
+
+		T *src = data.data();
+		T *dst = tmp.data();
+		for (uint32_t pass = 0; pass < 4; ++pass) {
+			auto &count = counts[pass];
+			const uint32_t shift = pass * 8u;
+			// skip the pass if all elements have the same byte
+			if (count[(radixSortKey(key(src[0])) >> shift) & 0xffu] == n) {
+				continue;
+			}
+			uint32_t offsets[256];
+			uint32_t offset = 0;
+			for (uint32_t b = 0; b < 256; ++b) {
+				offsets[b] = offset;
+				offset += count[b];
+			}
+			for (size_t i = 0; i < n; ++i) {
+				auto b = (radixSortKey(key(src[i])) >> shift) & 0xffu;
+				dst[offsets[b]++] = src[i];
+			}
+			std::swap(src, dst);
+		}
+		if (src != data.data()) {
+			data.swap(tmp);
+		}
+	}
+} // namespace
+
+#endif /* REGEN_RADIX_SORT_H_ */
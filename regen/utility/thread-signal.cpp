@@ -0,0 +1,107 @@
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "thread-signal.h"
+
+using namespace regen;
+
+static inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+	_mm_pause();
+#else
+	std::this_thread::yield();
+#endif
+}
+
+void ThreadSignal::notify() {
+	state_.store(1u, std::memory_order_seq_cst);
+	// only make a syscall if the waiting thread is blocked
+	if (numSleeping_.load(std::memory_order_seq_cst) > 0) {
+		wake();
+	}
+}
+
+void ThreadSignal::wait() {
+	switch (mode_.load(std::memory_order_relaxed)) {
+		case SPIN_SLEEP:
+			while (!tryWait()) {
+				std::this_thread::sleep_for(std::chrono::microseconds(REGEN_SIGNAL_SPIN_SLEEP));
+			}
+			break;
+		case BLOCKING:
+			if (!tryWait()) block();
+			break;
+		case ADAPTIVE_SPIN: {
+			// spin longer next time if spinning was successful, else spin shorter
+			auto count = spinCount_.load(std::memory_order_relaxed);
+			if (spin(count)) {
+				spinCount_.store(std::min(count * 2u, static_cast<uint32_t>(REGEN_SIGNAL_MAX_SPIN)),
+								 std::memory_order_relaxed);
+			} else {
+				spinCount_.store(std::max(count / 2u, static_cast<uint32_t>(REGEN_SIGNAL_MIN_SPIN)),
+								 std::memory_order_relaxed);
+				block();
+			}
+			break;
+		}
+	}
+}
+
+bool ThreadSignal::spin(uint32_t count) {
+	for (uint32_t i = 0; i < count; ++i) {
+		if (state_.load(std::memory_order_relaxed) != 0u && tryWait()) {
+			return true;
+		}
+		cpuRelax();
+	}
+	return false;
+}
+
+#ifdef __linux__
+static inline void futexWait(std::atomic<uint32_t> *addr, uint32_t expected) {
+	syscall(SYS_futex, reinterpret_cast<uint32_t *>(addr), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+}
+
+static inline void futexWake(std::atomic<uint32_t> *addr) {
+	syscall(SYS_futex, reinterpret_cast<uint32_t *>(addr), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+}
+
+void ThreadSignal::block() {
+	numSleeping_.fetch_add(1u, std::memory_order_seq_cst);
+	while (state_.exchange(0u, std::memory_order_seq_cst) == 0u) {
+		// returns immediately if the signal was set in the meantime
+		futexWait(&state_, 0u);
+	}
+	numSleeping_.fetch_sub(1u, std::memory_order_relaxed);
+}
+
+void ThreadSignal::wake() {
+	futexWake(&state_);
+}
+#else
+void ThreadSignal::block() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	numSleeping_.fetch_add(1u, std::memory_order_seq_cst);
+	cond_.wait(lock, [this] {
+		return state_.exchange(0u, std::memory_order_seq_cst) != 0u;
+	});
+	numSleeping_.fetch_sub(1u, std::memory_order_relaxed);
+}
+
+void ThreadSignal::wake() {
+	{
+		// make sure the waiting thread is either before the predicate check, or waiting
+		std::lock_guard<std::mutex> lock(mutex_);
+	}
+	cond_.notify_one();
+}
+#endif
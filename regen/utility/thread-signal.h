@@ -0,0 +1,99 @@
+#ifndef REGEN_THREAD_SIGNAL_H_
+#define REGEN_THREAD_SIGNAL_H_
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+// sleep time of the SPIN_SLEEP mode in microseconds
+#define REGEN_SIGNAL_SPIN_SLEEP 10
+// bounds of the number of spin iterations of the ADAPTIVE_SPIN mode
+#define REGEN_SIGNAL_MIN_SPIN 16
+#define REGEN_SIGNAL_MAX_SPIN 16384
+
+namespace regen {
+	/**
+	 * @brief An auto-reset event that wakes up one waiting thread.
+	 * A call of notify() sets the signal, and wait() returns once the signal is set
+	 * and resets it. Notifications while the signal is already set are merged.
+	 * On Linux, blocking is implemented with a futex, on other platforms
+	 * a condition variable is used.
+	 */
+	class ThreadSignal {
+	public:
+		/**
+		 * \brief The way a thread waits for the signal.
+		 */
+		enum Mode {
+			/**
+			 * Poll the signal and sleep a few microseconds in between.
+			 * Low latency, but keeps a core busy while waiting.
+			 */
+			SPIN_SLEEP = 0,
+			/**
+			 * Block the thread until the signal is set.
+			 */
+			BLOCKING,
+			/**
+			 * Spin for a bounded number of iterations before blocking.
+			 * The number of iterations adapts to how often spinning was successful recently.
+			 */
+			ADAPTIVE_SPIN
+		};
+
+		explicit ThreadSignal(Mode mode = ADAPTIVE_SPIN) : mode_(mode) {}
+
+		ThreadSignal(const ThreadSignal &) = delete;
+
+		/**
+		 * Set the wait mode, can be changed at any time.
+		 * @param mode the wait mode.
+		 */
+		void setMode(Mode mode) { mode_.store(mode, std::memory_order_relaxed); }
+
+		/**
+		 * @return the wait mode.
+		 */
+		Mode mode() const { return mode_.load(std::memory_order_relaxed); }
+
+		/**
+		 * @return the current number of spin iterations of the ADAPTIVE_SPIN mode.
+		 */
+		uint32_t spinCount() const { return spinCount_.load(std::memory_order_relaxed); }
+
+		/**
+		 * Set the signal, and wake up the waiting thread.
+		 */
+		void notify();
+
+		/**
+		 * Wait until the signal is set, and reset it.
+		 */
+		void wait();
+
+		/**
+		 * Reset the signal if it is set.
+		 * @return true if the signal was set.
+		 */
+		bool tryWait() { return state_.exchange(0u, std::memory_order_acquire) != 0u; }
+
+	protected:
+		std::atomic<uint32_t> state_{0u};
+		std::atomic<uint32_t> numSleeping_{0u};
+		std::atomic<Mode> mode_;
+		std::atomic<uint32_t> spinCount_{REGEN_SIGNAL_MIN_SPIN};
+#ifndef __linux__
+		std::mutex mutex_;
+		std::condition_variable cond_;
+#endif
+
+		bool spin(uint32_t count);
+
+		void block();
+
+		void wake();
+	};
+} // namespace
+
+#endif /* REGEN_THREAD_SIGNAL_H_ */
@@ -0,0 +1,103 @@
+#include "gtest/gtest.h"
+#include "regen/animations/animation-lod.h"
+
+using namespace regen;
+
+// fixture class for testing
+class AnimationLODTest : public ::testing::Test {
+
+};
+
+static unsigned int countSteps(AnimationLOD &lod, unsigned int numSteps) {
+	unsigned int numEvaluated = 0u;
+	for (unsigned int i = 0; i < numSteps; ++i) {
+		if (lod.nextStep()) numEvaluated += 1u;
+	}
+	return numEvaluated;
+}
+
+// visibility is toggled by the test instead of being computed by a spatial index
+class VisibilityStubLOD : public AnimationLOD {
+public:
+	bool visible = true;
+protected:
+	bool isVisible() const override { return visible; }
+};
+
+static void initLOD(AnimationLOD &lod, const Vec3f &objectPosition) {
+	auto cameraPosition = ref_ptr<ShaderInput3f>::alloc("cameraPosition");
+	cameraPosition->setUniformData(Vec3f(0.0f));
+	auto transform = ref_ptr<ShaderInputMat4>::alloc("modelMatrix");
+	auto mat = Mat4f::identity();
+	mat.translate(objectPosition);
+	transform->setUniformData(mat);
+	lod.setCameraPosition(cameraPosition);
+	lod.setTransform(transform);
+	lod.addLevel(50.0f, 4u);
+	lod.addLevel(20.0f, 2u);
+}
+
+static ref_ptr<AnimationLOD> testLOD(const Vec3f &objectPosition) {
+	auto lod = ref_ptr<AnimationLOD>::alloc();
+	initLOD(*lod.get(), objectPosition);
+	return lod;
+}
+
+TEST(AnimationLODTest, LevelsSorted) {
+	auto lod = testLOD(Vec3f(0.0f));
+	ASSERT_EQ(lod->levels().size(), 2u);
+	EXPECT_EQ(lod->levels()[0].distance, 20.0f);
+	EXPECT_EQ(lod->levels()[1].distance, 50.0f);
+}
+
+TEST(AnimationLODTest, NearEveryStep) {
+	auto lod = testLOD(Vec3f(5.0f, 0.0f, 0.0f));
+	EXPECT_EQ(countSteps(*lod.get(), 40), 40u);
+	EXPECT_EQ(lod->currentInterval(), 1u);
+}
+
+TEST(AnimationLODTest, DistanceInterval) {
+	auto mid = testLOD(Vec3f(30.0f, 0.0f, 0.0f));
+	EXPECT_EQ(countSteps(*mid.get(), 40), 20u);
+	EXPECT_EQ(mid->currentInterval(), 2u);
+
+	auto far = testLOD(Vec3f(0.0f, 0.0f, 100.0f));
+	EXPECT_EQ(countSteps(*far.get(), 40), 10u);
+	EXPECT_EQ(far->currentInterval(), 4u);
+}
+
+TEST(AnimationLODTest, NoCamera) {
+	AnimationLOD lod;
+	lod.addLevel(0.0f, 8u);
+	// without camera, the animation is evaluated each step
+	EXPECT_EQ(countSteps(lod, 10), 10u);
+}
+
+TEST(AnimationLODTest, OffscreenInterval) {
+	VisibilityStubLOD lod;
+	initLOD(lod, Vec3f(5.0f, 0.0f, 0.0f));
+	lod.visible = false;
+	// not evaluated at all while off-screen by default
+	EXPECT_EQ(countSteps(lod, 40), 0u);
+	EXPECT_EQ(lod.currentInterval(), 0u);
+	// the off-screen interval replaces the distance interval
+	lod.setOffscreenInterval(5u);
+	EXPECT_EQ(countSteps(lod, 40), 8u);
+	EXPECT_EQ(lod.currentInterval(), 5u);
+}
+
+TEST(AnimationLODTest, BecomesVisible) {
+	VisibilityStubLOD lod;
+	initLOD(lod, Vec3f(0.0f, 0.0f, 100.0f));
+	lod.visible = false;
+	EXPECT_EQ(countSteps(lod, 7), 0u);
+	// evaluated immediately when visible again, then at the distance interval
+	lod.visible = true;
+	EXPECT_TRUE(lod.nextStep());
+	EXPECT_EQ(lod.currentInterval(), 4u);
+	EXPECT_FALSE(lod.nextStep());
+	EXPECT_FALSE(lod.nextStep());
+	EXPECT_FALSE(lod.nextStep());
+	EXPECT_TRUE(lod.nextStep());
+	EXPECT_EQ(countSteps(lod, 40), 10u);
+}
@@ -0,0 +1,323 @@
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <functional>
+#include "gtest/gtest.h"
+#include "regen/animations/animation-manager.h"
+
+using namespace regen;
+
+// fixture class for testing
+class AnimationManagerTest : public ::testing::Test {
+
+};
+
+class CountingAnimation : public Animation {
+public:
+	explicit CountingAnimation(bool isIndependent) : Animation(false, true) {
+		setIndependent(isIndependent);
+	}
+
+	void animate(GLdouble dt) override { numSteps += 1; }
+
+	std::atomic<unsigned int> numSteps{0};
+};
+
+// renders frames such that the animation thread makes steps
+class FrameDriver {
+public:
+	FrameDriver() : thread_([this]() {
+		while (!isDone_.load()) {
+			AnimationManager::get().nextFrame();
+			std::this_thread::sleep_for(std::chrono::microseconds(50));
+		}
+	}) {
+		AnimationManager::get().resume(false);
+	}
+
+	~FrameDriver() {
+		AnimationManager::get().pause(true);
+		isDone_.store(true);
+		thread_.join();
+	}
+
+	void waitForSteps(const CountingAnimation &anim, unsigned int numSteps) const {
+		auto start = anim.numSteps.load();
+		for (int i = 0; i < 10000 && anim.numSteps.load() < start + numSteps; ++i) {
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+	}
+
+protected:
+	std::atomic<bool> isDone_{false};
+	std::thread thread_;
+};
+
+TEST(AnimationManagerTest, AddRemoveStress) {
+	FrameDriver driver;
+	// animations that stay alive during the test
+	std::vector<std::unique_ptr<CountingAnimation>> persistent;
+	for (unsigned int i = 0; i < 8; ++i) {
+		persistent.emplace_back(new CountingAnimation(i % 2 == 0));
+		persistent.back()->startAnimation();
+	}
+
+	const unsigned int numThreads = 4;
+	const unsigned int numAnimationsPerThread = 1000;
+	std::atomic<unsigned int> numAnimatedAfterRelease(0);
+	std::vector<std::thread> threads;
+	for (unsigned int t = 0; t < numThreads; ++t) {
+		threads.emplace_back([&numAnimatedAfterRelease, t]() {
+			std::vector<std::unique_ptr<CountingAnimation>> batch;
+			auto removeBatch = [&]() {
+				for (auto &anim: batch) {
+					anim->stopAnimation();
+					AnimationManager::get().releaseAnimation(anim.get());
+					// the animation must not be animated anymore once released
+					auto numSteps = anim->numSteps.load();
+					std::this_thread::yield();
+					if (anim->numSteps.load() != numSteps) {
+						numAnimatedAfterRelease += 1;
+					}
+				}
+				batch.clear();
+			};
+			for (unsigned int i = 0; i < numAnimationsPerThread; ++i) {
+				batch.emplace_back(new CountingAnimation((i + t) % 3 == 0));
+				batch.back()->startAnimation();
+				if (batch.size() == 16) removeBatch();
+			}
+			removeBatch();
+		});
+	}
+	for (auto &thread: threads) {
+		thread.join();
+	}
+	EXPECT_EQ(numAnimatedAfterRelease.load(), 0u);
+
+	// the persistent animations are still animated
+	for (auto &anim: persistent) {
+		auto numSteps = anim->numSteps.load();
+		driver.waitForSteps(*anim.get(), 2);
+		EXPECT_GT(anim->numSteps.load(), numSteps);
+	}
+	for (auto &anim: persistent) {
+		anim->stopAnimation();
+		AnimationManager::get().releaseAnimation(anim.get());
+	}
+}
+
+TEST(AnimationManagerTest, RemoveDuringStep) {
+	FrameDriver driver;
+	// an animation that stops and starts another animation from within the step
+	class ToggleAnimation : public CountingAnimation {
+	public:
+		explicit ToggleAnimation(CountingAnimation *other) : CountingAnimation(true), other_(other) {}
+
+		void animate(GLdouble dt) override {
+			CountingAnimation::animate(dt);
+			if (other_->isRunning()) {
+				other_->stopAnimation();
+			} else {
+				other_->startAnimation();
+			}
+		}
+
+	protected:
+		CountingAnimation *other_;
+	};
+	CountingAnimation toggled(true);
+	ToggleAnimation toggle(&toggled);
+	toggled.startAnimation();
+	toggle.startAnimation();
+	driver.waitForSteps(toggle, 20);
+	toggle.stopAnimation();
+	AnimationManager::get().releaseAnimation(&toggle);
+	toggled.stopAnimation();
+	AnimationManager::get().releaseAnimation(&toggled);
+	EXPECT_GE(toggle.numSteps.load(), 20u);
+	EXPECT_GT(toggled.numSteps.load(), 0u);
+	EXPECT_LT(toggled.numSteps.load(), toggle.numSteps.load());
+}
+
+TEST(AnimationManagerTest, FixedTimestep) {
+	class TimestepAnimation : public CountingAnimation {
+	public:
+		TimestepAnimation() : CountingAnimation(true) {}
+
+		void animate(GLdouble dt) override {
+			CountingAnimation::animate(dt);
+			if (dt != 2.0) numInvalidSteps += 1;
+		}
+
+		std::atomic<unsigned int> numInvalidSteps{0};
+	};
+	class CountingTickListener : public TickListener {
+	public:
+		void onTick() override { numTicks += 1; }
+
+		std::atomic<unsigned int> numTicks{0};
+	};
+	auto &manager = AnimationManager::get();
+	// 500 ticks per second, i.e. 2ms per tick
+	manager.setFixedTimestep(500.0, 4u);
+	EXPECT_TRUE(manager.isFixedTimestep());
+	EXPECT_DOUBLE_EQ(manager.tickInterval(), 2.0);
+
+	CountingTickListener listener;
+	manager.addTickListener(&listener);
+	FrameDriver driver;
+	TimestepAnimation anim;
+	anim.startAnimation();
+	auto tickCount = manager.tickCount();
+	driver.waitForSteps(anim, 20);
+	anim.stopAnimation();
+	manager.releaseAnimation(&anim);
+	manager.removeTickListener(&listener);
+	manager.setFixedTimestep(0.0);
+
+	EXPECT_GE(anim.numSteps.load(), 20u);
+	EXPECT_EQ(anim.numInvalidSteps.load(), 0u);
+	EXPECT_GE(manager.tickCount() - tickCount, 20u);
+	EXPECT_GE(listener.numTicks.load(), 20u);
+	auto alpha = manager.interpolationFactor();
+	EXPECT_GE(alpha, 0.0);
+	EXPECT_LE(alpha, 1.0);
+	EXPECT_FALSE(manager.isFixedTimestep());
+}
+
+TEST(AnimationManagerTest, TickSnapshot) {
+	TickSnapshot<float> snapshot;
+	float values[2] = {1.0f, 2.0f};
+	snapshot.reset(values, 2);
+	values[0] = 3.0f;
+	values[1] = 6.0f;
+	snapshot.push(values, 2);
+	auto lerp = [](float a, float b, double alpha) {
+		return static_cast<float>(a * (1.0 - alpha) + b * alpha);
+	};
+	float blended[2];
+	EXPECT_EQ(snapshot.blend(0.5, blended, 2, lerp), 2u);
+	EXPECT_FLOAT_EQ(blended[0], 2.0f);
+	EXPECT_FLOAT_EQ(blended[1], 4.0f);
+	// a different number of values cannot be blended with the previous tick
+	snapshot.push(values, 1);
+	EXPECT_EQ(snapshot.blend(0.0, blended, 2, lerp), 1u);
+	EXPECT_FLOAT_EQ(blended[0], 3.0f);
+}
+
+TEST(AnimationManagerTest, DependencyConflict) {
+	auto resource = ref_ptr<ShaderInput1f>::alloc("resource");
+	auto other = ref_ptr<ShaderInput1f>::alloc("other");
+	CountingAnimation undeclared(false);
+	CountingAnimation independent(true), independent2(true);
+	CountingAnimation writer(false), writer2(false), reader(false), reader2(false), otherWriter(false);
+	writer.addWriteDependency(resource.get());
+	writer2.addWriteDependency(resource.get());
+	reader.addReadDependency(resource.get());
+	reader2.addReadDependency(resource.get());
+	otherWriter.addWriteDependency(other.get());
+
+	// animations without declared dependencies conflict with all others
+	EXPECT_FALSE(undeclared.isParallelizable());
+	EXPECT_TRUE(undeclared.hasDependencyConflict(independent));
+	EXPECT_TRUE(independent.hasDependencyConflict(undeclared));
+	EXPECT_TRUE(writer.isParallelizable());
+	EXPECT_TRUE(reader.isParallelizable());
+
+	EXPECT_FALSE(independent.hasDependencyConflict(independent2));
+	EXPECT_FALSE(independent.hasDependencyConflict(writer));
+	EXPECT_TRUE(writer.hasDependencyConflict(writer2));
+	EXPECT_TRUE(writer.hasDependencyConflict(reader));
+	EXPECT_TRUE(reader.hasDependencyConflict(writer));
+	EXPECT_FALSE(reader.hasDependencyConflict(reader2));
+	EXPECT_FALSE(writer.hasDependencyConflict(otherWriter));
+	EXPECT_FALSE(otherWriter.hasDependencyConflict(reader));
+}
+
+// waits until the condition holds, returns false after a timeout
+static bool waitFor(const std::function<bool()> &condition, std::chrono::milliseconds timeout) {
+	auto deadline = std::chrono::steady_clock::now() + timeout;
+	while (!condition()) {
+		if (std::chrono::steady_clock::now() > deadline) return false;
+		std::this_thread::yield();
+	}
+	return true;
+}
+
+TEST(AnimationManagerTest, ParallelGroups) {
+	struct Probe {
+		std::atomic<unsigned int> numWriters{0};
+		std::atomic<unsigned int> maxWriters{0};
+		std::atomic<bool> isIndependentActive{false};
+		std::atomic<unsigned int> numOverlaps{0};
+	} probe;
+	// writers wait for the independent animation, which only shows up
+	// if it is animated concurrently, i.e. in a different group.
+	class WriterAnimation : public CountingAnimation {
+	public:
+		WriterAnimation(Probe &probe, const ShaderInput *resource)
+				: CountingAnimation(false), probe_(probe) {
+			addWriteDependency(resource);
+		}
+
+		void animate(GLdouble dt) override {
+			CountingAnimation::animate(dt);
+			auto numWriters = probe_.numWriters.fetch_add(1u) + 1u;
+			auto maxWriters = probe_.maxWriters.load();
+			while (numWriters > maxWriters && !probe_.maxWriters.compare_exchange_weak(maxWriters, numWriters)) {}
+			waitFor([this]() { return probe_.isIndependentActive.load(); }, std::chrono::milliseconds(20));
+			probe_.numWriters.fetch_sub(1u);
+		}
+
+	protected:
+		Probe &probe_;
+	};
+	class IndependentAnimation : public CountingAnimation {
+	public:
+		explicit IndependentAnimation(Probe &probe)
+				: CountingAnimation(true), probe_(probe) {}
+
+		void animate(GLdouble dt) override {
+			CountingAnimation::animate(dt);
+			probe_.isIndependentActive.store(true);
+			if (waitFor([this]() { return probe_.numWriters.load() > 0u; }, std::chrono::milliseconds(20))) {
+				probe_.numOverlaps.fetch_add(1u);
+			}
+			probe_.isIndependentActive.store(false);
+		}
+
+	protected:
+		Probe &probe_;
+	};
+	auto &manager = AnimationManager::get();
+	auto resource = ref_ptr<ShaderInput1f>::alloc("resource");
+	WriterAnimation writer1(probe, resource.get());
+	WriterAnimation writer2(probe, resource.get());
+	IndependentAnimation independent(probe);
+	{
+		FrameDriver driver;
+		writer1.startAnimation();
+		writer2.startAnimation();
+		independent.startAnimation();
+		EXPECT_TRUE(waitFor([&]() {
+			return probe.numOverlaps.load() > 0u && writer1.numSteps.load() > 4u;
+		}, std::chrono::milliseconds(5000)));
+	}
+	// the manager is paused, so the times belong to the same step
+	auto criticalPath = manager.criticalPathTime();
+	auto stepTime = manager.stepTime();
+	writer1.stopAnimation();
+	writer2.stopAnimation();
+	independent.stopAnimation();
+	manager.releaseAnimation(&writer1);
+	manager.releaseAnimation(&writer2);
+	manager.releaseAnimation(&independent);
+
+	// the writers are in one group and never overlap
+	EXPECT_EQ(probe.maxWriters.load(), 1u);
+	EXPECT_GT(probe.numOverlaps.load(), 0u);
+	EXPECT_GT(criticalPath, 0.0);
+	EXPECT_LE(criticalPath, stepTime);
+}
@@ -0,0 +1,138 @@
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include "gtest/gtest.h"
+#include "regen/animations/animation-scheduler.h"
+
+using namespace regen;
+
+// fixture class for testing
+class AnimationSchedulerTest : public ::testing::Test {
+
+};
+
+class TimedAnimation : public Animation {
+public:
+	TimedAnimation(float frameRate, unsigned int stepMilliseconds) : Animation(false, true),
+																	 stepMilliseconds_(stepMilliseconds) {
+		setSynchronized(false);
+		desiredFrameRate_ = frameRate;
+	}
+
+	void animate(GLdouble dt) override {
+		isInStep = true;
+		if (stepMilliseconds_ > 0) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(stepMilliseconds_));
+		}
+		numSteps += 1;
+		isInStep = false;
+	}
+
+	std::atomic<unsigned int> numSteps{0};
+	std::atomic<bool> isInStep{false};
+
+protected:
+	unsigned int stepMilliseconds_;
+};
+
+// waits until the condition holds, returns false after a timeout
+static bool waitFor(const std::function<bool()> &condition,
+					std::chrono::milliseconds timeout = std::chrono::milliseconds(5000)) {
+	auto deadline = std::chrono::steady_clock::now() + timeout;
+	while (!condition()) {
+		if (std::chrono::steady_clock::now() > deadline) return false;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return true;
+}
+
+TEST(AnimationSchedulerTest, DesiredFrameRate) {
+	AnimationScheduler scheduler(2);
+	TimedAnimation anim(100.0f, 0);
+	auto t0 = std::chrono::steady_clock::now();
+	scheduler.add(&anim);
+	EXPECT_TRUE(waitFor([&anim]() { return anim.numSteps.load() >= 11u; }));
+	auto elapsed = std::chrono::steady_clock::now() - t0;
+	scheduler.remove(&anim);
+	// deadlines are never earlier than one period after the previous one,
+	// so 11 steps take at least 10 periods. A busy machine only makes it slower.
+	EXPECT_GE(elapsed, std::chrono::milliseconds(100));
+}
+
+TEST(AnimationSchedulerTest, MoreAnimationsThanWorkers) {
+	AnimationScheduler scheduler(2);
+	std::vector<std::unique_ptr<TimedAnimation>> animations;
+	for (unsigned int i = 0; i < 32; ++i) {
+		animations.emplace_back(new TimedAnimation(100.0f, 0));
+		scheduler.add(animations.back().get());
+	}
+	// all animations are stepped, none is starved by the others
+	EXPECT_TRUE(waitFor([&animations]() {
+		for (auto &anim: animations) {
+			if (anim->numSteps.load() < 2u) return false;
+		}
+		return true;
+	}));
+	for (auto &anim: animations) {
+		scheduler.remove(anim.get());
+		EXPECT_GE(anim->numSteps.load(), 2u);
+	}
+}
+
+TEST(AnimationSchedulerTest, Overruns) {
+	AnimationScheduler scheduler(2);
+	// takes longer than the frame time
+	TimedAnimation slow(200.0f, 10);
+	TimedAnimation fast(100.0f, 0);
+	scheduler.add(&slow);
+	scheduler.add(&fast);
+	AnimationScheduler::Statistics slowStats, fastStats;
+	// the slow animation does not block the fast one as there is a second worker
+	EXPECT_TRUE(waitFor([&]() {
+		return scheduler.statistics(&slow, slowStats) && scheduler.statistics(&fast, fastStats) &&
+			   slowStats.numOverruns > 0u && fastStats.numSteps >= 5u;
+	}));
+	scheduler.remove(&slow);
+	scheduler.remove(&fast);
+	EXPECT_FALSE(scheduler.statistics(&slow, slowStats));
+
+	EXPECT_GT(slowStats.numSteps, 0u);
+	EXPECT_GT(slowStats.numOverruns, 0u);
+	EXPECT_GE(slowStats.averageStepTime, 9.0);
+	EXPECT_GE(fastStats.numSteps, 5u);
+}
+
+TEST(AnimationSchedulerTest, RemoveWaitsForStep) {
+	AnimationScheduler scheduler(1);
+	TimedAnimation anim(1000.0f, 5);
+	scheduler.add(&anim);
+	for (unsigned int i = 0; i < 10; ++i) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		scheduler.remove(&anim);
+		EXPECT_FALSE(anim.isInStep.load());
+		auto numSteps = anim.numSteps.load();
+		std::this_thread::sleep_for(std::chrono::milliseconds(6));
+		EXPECT_EQ(anim.numSteps.load(), numSteps);
+		scheduler.add(&anim);
+	}
+	scheduler.remove(&anim);
+}
+
+TEST(AnimationSchedulerTest, Pause) {
+	AnimationScheduler scheduler(1);
+	TimedAnimation anim(1000.0f, 0);
+	scheduler.add(&anim);
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	scheduler.setPaused(true);
+	// a step may still be in progress
+	std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	auto numSteps = anim.numSteps.load();
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	EXPECT_EQ(anim.numSteps.load(), numSteps);
+	scheduler.setPaused(false);
+	EXPECT_TRUE(waitFor([&]() { return anim.numSteps.load() > numSteps; }));
+	scheduler.remove(&anim);
+}
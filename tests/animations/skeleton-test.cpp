@@ -0,0 +1,147 @@
+#include <random>
+#include "gtest/gtest.h"
+#include "regen/animations/animation-node.h"
+
+using namespace regen;
+
+// fixture class for testing
+class SkeletonTest : public ::testing::Test {
+
+};
+
+static Mat4f randomAffine(std::mt19937 &gen) {
+	std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+	Mat4f m;
+	for (GLuint i = 0; i < 12; ++i) m.x[i] = dis(gen);
+	m.x[12] = 0.0f;
+	m.x[13] = 0.0f;
+	m.x[14] = 0.0f;
+	m.x[15] = 1.0f;
+	return m;
+}
+
+static Skeleton::TRS randomTRS(std::mt19937 &gen) {
+	std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+	Skeleton::TRS trs;
+	trs.rotation = Quaternion(dis(gen), dis(gen), dis(gen), dis(gen));
+	trs.rotation.normalize();
+	trs.scaling = Vec3f(1.0f + 0.5f * dis(gen), 1.0f + 0.5f * dis(gen), 1.0f + 0.5f * dis(gen));
+	trs.translation = Vec3f(dis(gen), dis(gen), dis(gen));
+	return trs;
+}
+
+// the matrix that NodeAnimation computed for a channel before TRS transforms were used
+static Mat4f channelMatrix(const Skeleton::TRS &trs) {
+	Mat4f m = trs.rotation.calculateMatrix();
+	m.scale(trs.scaling);
+	m.x[3] = trs.translation.x;
+	m.x[7] = trs.translation.y;
+	m.x[11] = trs.translation.z;
+	return m;
+}
+
+static void expectNear(const Mat4f &a, const Mat4f &b) {
+	for (GLuint i = 0; i < 16; ++i) {
+		EXPECT_NEAR(a.x[i], b.x[i], 1e-4f) << "component " << i;
+	}
+}
+
+struct TestTree {
+	ref_ptr<AnimationNode> root;
+	std::vector<ref_ptr<AnimationNode> > nodes;
+	std::list<ref_ptr<AnimationNode> > bones;
+	std::vector<Skeleton::TRS> channels;
+};
+
+static TestTree makeTree(std::mt19937 &gen, GLuint numNodes) {
+	TestTree tree;
+	tree.root = ref_ptr<AnimationNode>::alloc("root", ref_ptr<AnimationNode>());
+	tree.root->set_localTransform(randomAffine(gen));
+	tree.root->calculateGlobalTransform();
+	tree.nodes.push_back(tree.root);
+	for (GLuint i = 1; i < numNodes; ++i) {
+		std::uniform_int_distribution<GLuint> parentDis(0, i - 1);
+		auto &parent = tree.nodes[parentDis(gen)];
+		auto node = ref_ptr<AnimationNode>::alloc(REGEN_STRING("node" << i), parent);
+		node->set_localTransform(randomAffine(gen));
+		node->calculateGlobalTransform();
+		parent->addChild(node);
+		tree.nodes.push_back(node);
+		// every second node is animated, every third node is a bone
+		if (i % 2 == 0) {
+			node->set_channelIndex(static_cast<GLint>(tree.channels.size()));
+			tree.channels.push_back(randomTRS(gen));
+		}
+		if (i % 3 == 0) {
+			node->set_boneOffsetMatrix(randomAffine(gen));
+			tree.bones.push_back(node);
+		}
+	}
+	return tree;
+}
+
+TEST(SkeletonTest, TopologicalOrder) {
+	std::mt19937 gen(42);
+	auto tree = makeTree(gen, 64);
+	Skeleton skeleton(tree.root);
+	ASSERT_EQ(skeleton.numNodes(), 64u);
+	EXPECT_EQ(skeleton.parents()[0], -1);
+	for (GLuint i = 1; i < skeleton.numNodes(); ++i) {
+		EXPECT_GE(skeleton.parents()[i], 0);
+		EXPECT_LT(skeleton.parents()[i], static_cast<GLint>(i));
+	}
+	for (auto &node: tree.nodes) {
+		auto index = skeleton.nodeIndex(node.get());
+		ASSERT_GE(index, 0);
+		if (node->parent().get()) {
+			EXPECT_EQ(skeleton.parents()[index], skeleton.nodeIndex(node->parent().get()));
+		}
+	}
+}
+
+TEST(SkeletonTest, SameAsNodeTree) {
+	std::mt19937 gen(7);
+	auto tree = makeTree(gen, 100);
+	std::vector<Mat4f> channelMatrices;
+	for (auto &trs: tree.channels) channelMatrices.push_back(channelMatrix(trs));
+
+	// reference: the recursive update of the node tree
+	tree.root->updateTransforms(channelMatrices);
+	std::vector<Mat4f> expectedGlobal, expectedBones;
+	for (auto &node: tree.nodes) expectedGlobal.push_back(node->globalTransform());
+	for (auto &bone: tree.bones) expectedBones.push_back(bone->boneTransformationMatrix());
+
+	Skeleton skeleton(tree.root);
+	auto boneMatrices = ref_ptr<ShaderInputMat4>::alloc("boneMatrices", tree.bones.size() + 2);
+	boneMatrices->set_forceArray(GL_TRUE);
+	boneMatrices->setUniformUntyped();
+	skeleton.addBoneTarget(boneMatrices, tree.bones, 2u);
+	skeleton.update(tree.channels.data(), tree.channels.size());
+
+	for (GLuint i = 1; i < tree.nodes.size(); ++i) {
+		expectNear(skeleton.globalTransforms()[skeleton.nodeIndex(tree.nodes[i].get())], expectedGlobal[i]);
+	}
+	auto mapped = boneMatrices->mapClientData<Mat4f>(ShaderData::READ);
+	for (GLuint i = 0; i < expectedBones.size(); ++i) {
+		expectNear(mapped.r[2 + i], expectedBones[i]);
+	}
+}
+
+TEST(SkeletonTest, UpdatesNodesWithoutTarget) {
+	// two identical trees, one is updated by the skeleton
+	std::mt19937 gen0(13), gen1(13);
+	auto expected = makeTree(gen0, 32);
+	auto tree = makeTree(gen1, 32);
+	std::vector<Mat4f> channelMatrices;
+	for (auto &trs: expected.channels) channelMatrices.push_back(channelMatrix(trs));
+	expected.root->updateTransforms(channelMatrices);
+
+	Skeleton skeleton(tree.root);
+	skeleton.update(tree.channels.data(), tree.channels.size());
+	auto it = expected.bones.begin();
+	for (auto &bone: tree.bones) {
+		expectNear(bone->globalTransform(), (*it)->globalTransform());
+		expectNear(bone->boneTransformationMatrix(), (*it)->boneTransformationMatrix());
+		++it;
+	}
+}
@@ -0,0 +1,173 @@
+#include "gtest/gtest.h"
+#include "regen/gl-types/dirty-ranges.h"
+#include "regen/gl-types/shader-input.h"
+
+using namespace regen;
+
+// fixture class for testing
+class DirtyRangesTest : public ::testing::Test {
+
+};
+
+TEST(DirtyRangesTest, Coalesce) {
+	DirtyRanges ranges;
+	EXPECT_TRUE(ranges.empty());
+	ranges.add(64, 128);
+	ranges.add(256, 320);
+	ranges.add(0, 16);
+	ASSERT_EQ(ranges.ranges().size(), 3u);
+	EXPECT_EQ(ranges.ranges()[0].begin, 0u);
+	EXPECT_EQ(ranges.ranges()[1].begin, 64u);
+	EXPECT_EQ(ranges.ranges()[2].begin, 256u);
+	// adjacent and overlapping ranges are merged
+	ranges.add(128, 192);
+	ranges.add(100, 260);
+	ASSERT_EQ(ranges.ranges().size(), 2u);
+	EXPECT_EQ(ranges.ranges()[1].begin, 64u);
+	EXPECT_EQ(ranges.ranges()[1].end, 320u);
+	EXPECT_EQ(ranges.numBytes(1024), 16u + 256u);
+	// empty ranges are ignored
+	ranges.add(500, 500);
+	EXPECT_EQ(ranges.ranges().size(), 2u);
+}
+
+TEST(DirtyRangesTest, MergeGap) {
+	DirtyRanges ranges(16);
+	ranges.add(0, 64);
+	ranges.add(80, 96);
+	ranges.add(128, 192);
+	ASSERT_EQ(ranges.ranges().size(), 2u);
+	EXPECT_EQ(ranges.ranges()[0].end, 96u);
+}
+
+TEST(DirtyRangesTest, MaxRanges) {
+	DirtyRanges ranges;
+	for (unsigned int i = 0; i < 2 * DirtyRanges::MAX_RANGES; ++i) {
+		// every third range is closer to its predecessor
+		auto begin = i * 100 + 20 - (i % 3 == 0 ? 10 : 0);
+		ranges.add(begin, i * 100 + 30);
+	}
+	EXPECT_EQ(ranges.ranges().size(), DirtyRanges::MAX_RANGES);
+	// the ranges still cover all added ranges
+	for (unsigned int i = 0; i < 2 * DirtyRanges::MAX_RANGES; ++i) {
+		bool isCovered = false;
+		for (auto &r: ranges.ranges()) {
+			isCovered = isCovered || (r.begin <= i * 100 + 20 && r.end >= i * 100 + 30);
+		}
+		EXPECT_TRUE(isCovered) << "range " << i;
+	}
+}
+
+TEST(DirtyRangesTest, Threshold) {
+	DirtyRanges ranges;
+	EXPECT_FALSE(ranges.isPartial(1000, 0.5f));
+	ranges.add(0, 100);
+	EXPECT_TRUE(ranges.isPartial(1000, 0.5f));
+	ranges.add(500, 1000);
+	EXPECT_FALSE(ranges.isPartial(1000, 0.5f));
+	ranges.clear();
+	ranges.add(0, 100);
+	ranges.addAll();
+	EXPECT_TRUE(ranges.isFull());
+	EXPECT_FALSE(ranges.isPartial(1000, 0.5f));
+	EXPECT_EQ(ranges.numBytes(1000), 1000u);
+	// further ranges do not change anything
+	ranges.add(0, 10);
+	EXPECT_TRUE(ranges.ranges().empty());
+}
+
+TEST(DirtyRangesTest, Log) {
+	DirtyRangeLog log;
+	log.push(1, 0, 64);
+	log.push(2, 128, 192);
+	log.push(3, 64, 128);
+	DirtyRanges ranges;
+	EXPECT_TRUE(log.collect(3, 3, ranges));
+	EXPECT_TRUE(ranges.empty());
+	EXPECT_TRUE(log.collect(1, 3, ranges));
+	ASSERT_EQ(ranges.ranges().size(), 1u);
+	EXPECT_EQ(ranges.ranges()[0].begin, 64u);
+	EXPECT_EQ(ranges.ranges()[0].end, 192u);
+	// stamp 5 was not logged
+	ranges.clear();
+	log.push(4, 0, 8);
+	EXPECT_FALSE(log.collect(3, 5, ranges));
+	EXPECT_TRUE(ranges.isFull());
+	// old writes are forgotten
+	for (unsigned int i = 5; i < 5 + DirtyRangeLog::LOG_SIZE; ++i) {
+		log.push(i, i, i + 1);
+	}
+	ranges.clear();
+	EXPECT_FALSE(log.collect(2, 4 + DirtyRangeLog::LOG_SIZE, ranges));
+	ranges.clear();
+	EXPECT_TRUE(log.collect(4, 4 + DirtyRangeLog::LOG_SIZE, ranges));
+	EXPECT_EQ(ranges.numBytes(1000), DirtyRangeLog::LOG_SIZE);
+}
+
+TEST(DirtyRangesTest, LogStampWrap) {
+	DirtyRangeLog log;
+	auto maxStamp = std::numeric_limits<unsigned int>::max();
+	log.push(maxStamp, 0, 4);
+	log.push(0, 8, 12);
+	DirtyRanges ranges;
+	EXPECT_TRUE(log.collect(maxStamp - 1, 0, ranges));
+	EXPECT_EQ(ranges.ranges().size(), 2u);
+}
+
+TEST(DirtyRangesTest, ShaderInputWrites) {
+	auto in = ref_ptr<ShaderInputMat4>::alloc("in", 100);
+	in->setUniformUntyped();
+	DirtyRanges ranges;
+
+	// single element writes only mark the element
+	auto stamp = in->stamp();
+	in->setVertex(10, Mat4f::identity());
+	{
+		auto mapped = in->mapClientVertex<Mat4f>(ShaderData::WRITE, 20);
+		mapped.w = Mat4f::identity();
+	}
+	EXPECT_EQ(in->stamp(), stamp + 2);
+	EXPECT_TRUE(in->collectDirtyRanges(stamp, in->stamp(), ranges));
+	ASSERT_EQ(ranges.ranges().size(), 2u);
+	EXPECT_EQ(ranges.ranges()[0].begin, 10 * sizeof(Mat4f));
+	EXPECT_EQ(ranges.ranges()[0].end, 11 * sizeof(Mat4f));
+	EXPECT_EQ(ranges.ranges()[1].begin, 20 * sizeof(Mat4f));
+	EXPECT_TRUE(ranges.isPartial(in->inputSize(), in->partialUploadThreshold()));
+
+	// marked elements of an indexed mapping
+	stamp = in->stamp();
+	ranges.clear();
+	{
+		auto mapped = in->mapClientData<Mat4f>(ShaderData::WRITE | ShaderData::INDEX);
+		mapped.w[30] = Mat4f::identity();
+		mapped.w[32] = Mat4f::identity();
+		mapped.markDirty(30);
+		mapped.markDirty(32);
+	}
+	EXPECT_TRUE(in->collectDirtyRanges(stamp, in->stamp(), ranges));
+	ASSERT_EQ(ranges.ranges().size(), 1u);
+	EXPECT_EQ(ranges.ranges()[0].begin, 30 * sizeof(Mat4f));
+	EXPECT_EQ(ranges.ranges()[0].end, 33 * sizeof(Mat4f));
+
+	// full writes mark all data
+	stamp = in->stamp();
+	ranges.clear();
+	{
+		auto mapped = in->mapClientData<Mat4f>(ShaderData::WRITE);
+		mapped.w[0] = Mat4f::identity();
+	}
+	EXPECT_TRUE(in->collectDirtyRanges(stamp, in->stamp(), ranges));
+	EXPECT_EQ(ranges.numBytes(in->inputSize()), in->inputSize());
+	EXPECT_FALSE(ranges.isPartial(in->inputSize(), in->partialUploadThreshold()));
+}
+
+TEST(DirtyRangesTest, LockFreeWritesAreNotLogged) {
+	auto in = ref_ptr<ShaderInput4f>::alloc("in");
+	in->setUniformData(Vec4f(0.0f));
+	ASSERT_TRUE(in->isLockFree());
+	auto stamp = in->stamp();
+	in->setVertex(0, Vec4f(1.0f));
+	DirtyRanges ranges;
+	EXPECT_FALSE(in->collectDirtyRanges(stamp, in->stamp(), ranges));
+	EXPECT_TRUE(ranges.isFull());
+}
@@ -0,0 +1,63 @@
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include "gtest/gtest.h"
+#include "regen/gl-types/shader-input.h"
+
+using namespace regen;
+
+// fixture class for benchmarking
+class ShaderInputBenchmark : public ::testing::Test {
+
+};
+
+#define BENCHMARK_NUM_READERS 3
+#define BENCHMARK_DURATION_MS 200
+
+// concurrent readers and one writer of a single matrix uniform,
+// compares the lock-free access of small data with the slot locks.
+TEST(ShaderInputBenchmark, ConcurrentReadWrite) {
+	for (bool lockFree: {false, true}) {
+		auto in = ref_ptr<ShaderInputMat4>::alloc("modelMatrix");
+		in->set_allowLockFree(lockFree);
+		in->setUniformData(Mat4f::identity());
+
+		std::atomic<bool> isDone(false);
+		std::atomic<uint64_t> numReads(0), numWrites(0);
+		std::vector<std::thread> readers;
+		for (unsigned int i = 0; i < BENCHMARK_NUM_READERS; ++i) {
+			readers.emplace_back([&]() {
+				uint64_t count = 0;
+				float sum = 0.0f;
+				while (!isDone.load(std::memory_order_relaxed)) {
+					sum += in->getVertex(0).r.x[12];
+					count += 1;
+				}
+				numReads += count;
+				// avoid that the reads are optimized away
+				EXPECT_GE(sum, 0.0f);
+			});
+		}
+		std::thread writer([&]() {
+			uint64_t count = 0;
+			while (!isDone.load(std::memory_order_relaxed)) {
+				auto mapped = in->mapClientData<Mat4f>(ShaderData::WRITE);
+				mapped.w[0] = Mat4f::identity();
+				mapped.w[0].x[12] = static_cast<float>(count % 100);
+				count += 1;
+			}
+			numWrites += count;
+		});
+		std::this_thread::sleep_for(std::chrono::milliseconds(BENCHMARK_DURATION_MS));
+		isDone = true;
+		for (auto &reader: readers) reader.join();
+		writer.join();
+
+		auto seconds = BENCHMARK_DURATION_MS / 1000.0;
+		std::cout << (lockFree ? "lock-free" : "slot-locks") << ": " <<
+				  static_cast<double>(numReads.load()) / seconds / 1.0e6 << " M reads/s, " <<
+				  static_cast<double>(numWrites.load()) / seconds / 1.0e6 << " M writes/s" << std::endl;
+	}
+}
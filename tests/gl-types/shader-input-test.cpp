@@ -0,0 +1,323 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "regen/gl-types/shader-input.h"
+
+using namespace regen;
+
+// fixture class for testing
+class ShaderInputTest : public ::testing::Test {
+
+};
+
+TEST(ShaderInputTest, LockFreeSmallData) {
+	auto small = ref_ptr<ShaderInputMat4>::alloc("small");
+	small->setUniformData(Mat4f::identity());
+	EXPECT_TRUE(small->isLockFree());
+
+	auto array = ref_ptr<ShaderInputMat4>::alloc("array", 4);
+	array->setUniformUntyped();
+	EXPECT_FALSE(array->isLockFree());
+
+	auto disabled = ref_ptr<ShaderInput3f>::alloc("disabled");
+	disabled->set_allowLockFree(false);
+	disabled->setUniformData(Vec3f(1.0f));
+	EXPECT_FALSE(disabled->isLockFree());
+}
+
+TEST(ShaderInputTest, LockFreeReadWrite) {
+	auto in = ref_ptr<ShaderInput4f>::alloc("in");
+	in->setUniformData(Vec4f(1.0f, 2.0f, 3.0f, 4.0f));
+	ASSERT_TRUE(in->isLockFree());
+	auto stamp = in->stamp();
+	EXPECT_EQ(in->getVertex(0).r, Vec4f(1.0f, 2.0f, 3.0f, 4.0f));
+	{
+		// partial writes keep the other components
+		auto mapped = in->mapClientData<Vec4f>(ShaderData::READ | ShaderData::WRITE);
+		EXPECT_EQ(mapped.r[0], Vec4f(1.0f, 2.0f, 3.0f, 4.0f));
+		mapped.w[0].y = 5.0f;
+		// not committed before unmap
+		EXPECT_EQ(in->getVertex(0).r.y, 2.0f);
+	}
+	EXPECT_EQ(in->getVertex(0).r, Vec4f(1.0f, 5.0f, 3.0f, 4.0f));
+	EXPECT_GT(in->stamp(), stamp);
+	in->setVertex(0, Vec4f(0.0f));
+	EXPECT_EQ(in->getVertex(0).r, Vec4f(0.0f));
+}
+
+// readers must never see a partially written matrix
+static void testConsistentReads(bool lockFree) {
+	auto in = ref_ptr<ShaderInputMat4>::alloc("in");
+	in->set_allowLockFree(lockFree);
+	in->setUniformData(Mat4f(0.0f));
+	ASSERT_EQ(in->isLockFree(), lockFree);
+
+	std::atomic<bool> isDone(false);
+	std::atomic<unsigned int> numTornReads(0);
+	std::vector<std::thread> readers;
+	for (unsigned int i = 0; i < 3; ++i) {
+		readers.emplace_back([&]() {
+			while (!isDone.load()) {
+				auto mapped = in->getVertex(0);
+				for (unsigned int j = 1; j < 16; ++j) {
+					if (mapped.r.x[j] != mapped.r.x[0]) {
+						numTornReads += 1;
+						break;
+					}
+				}
+			}
+		});
+	}
+	for (unsigned int i = 1; i <= 20000; ++i) {
+		auto mapped = in->mapClientData<Mat4f>(ShaderData::WRITE);
+		for (float &x: mapped.w[0].x) x = static_cast<float>(i);
+	}
+	isDone = true;
+	for (auto &reader: readers) reader.join();
+	EXPECT_EQ(numTornReads.load(), 0u);
+	EXPECT_EQ(in->getVertex(0).r.x[15], 20000.0f);
+}
+
+TEST(ShaderInputTest, ConsistentReads_LockFree) {
+	testConsistentReads(true);
+}
+
+TEST(ShaderInputTest, ConsistentReads_SlotLocks) {
+	testConsistentReads(false);
+}
+
+TEST(ShaderInputTest, ResizeWhileReading) {
+	// the data alternates between lock-free and slot-locked sizes
+	std::vector<unsigned int> data(4 * 1000, 0u);
+	auto in = ref_ptr<ShaderInput1ui>::alloc("in", 4);
+	in->setUniformUntyped(reinterpret_cast<const byte *>(data.data()));
+
+	std::atomic<bool> isDone(false);
+	std::atomic<unsigned int> numReaders(0);
+	std::atomic<unsigned int> numTornReads(0);
+	std::vector<std::thread> readers;
+	for (unsigned int i = 0; i < 3; ++i) {
+		readers.emplace_back([&]() {
+			numReaders += 1;
+			while (!isDone.load()) {
+				auto mapped = in->mapClientData<unsigned int>(ShaderData::READ);
+				for (unsigned int j = 1; j < 4; ++j) {
+					if (mapped.r[j] != mapped.r[0]) {
+						numTornReads += 1;
+						break;
+					}
+				}
+			}
+		});
+	}
+	while (numReaders.load() < readers.size()) {
+		std::this_thread::yield();
+	}
+	for (unsigned int i = 1; i <= 20000; ++i) {
+		std::fill(data.begin(), data.end(), i);
+		auto numInstances = (i % 2 == 0) ? 1u : 1000u;
+		in->setInstanceData(numInstances, 1, reinterpret_cast<const byte *>(data.data()));
+		ASSERT_EQ(in->isLockFree(), numInstances == 1u);
+	}
+	isDone = true;
+	for (auto &reader: readers) reader.join();
+	EXPECT_EQ(numTornReads.load(), 0u);
+	EXPECT_EQ(in->getVertex(3).r, 20000u);
+}
+
+static ref_ptr<ShaderInput1ui> createArray(bool lockFree, unsigned int numElements) {
+	auto in = ref_ptr<ShaderInput1ui>::alloc("in", numElements);
+	in->set_allowLockFree(lockFree);
+	in->setUniformUntyped();
+	auto mapped = in->mapClientData<unsigned int>(ShaderData::WRITE);
+	for (unsigned int i = 0; i < numElements; ++i) mapped.w[i] = i;
+	return in;
+}
+
+static void testBorrow(unsigned int numElements) {
+	auto in = createArray(true, numElements);
+	std::vector<unsigned int> borrowed(numElements, 42u);
+	auto stamp = in->stamp();
+	{
+		auto borrow = in->borrowClientData(reinterpret_cast<const byte *>(borrowed.data()));
+		EXPECT_GT(in->stamp(), stamp);
+		for (unsigned int i = 0; i < numElements; ++i) {
+			EXPECT_EQ(in->getVertex(i).r, 42u);
+		}
+		stamp = in->stamp();
+	}
+	EXPECT_GT(in->stamp(), stamp);
+	for (unsigned int i = 0; i < numElements; ++i) {
+		EXPECT_EQ(in->getVertex(i).r, i);
+	}
+	// the borrowed data was not modified
+	EXPECT_EQ(borrowed[0], 42u);
+}
+
+TEST(ShaderInputTest, Borrow_LockFree) {
+	testBorrow(4);
+}
+
+TEST(ShaderInputTest, Borrow_SlotLocks) {
+	testBorrow(100);
+}
+
+static void testBorrowBlocksWriters(unsigned int numElements, bool resize) {
+	auto in = createArray(true, numElements);
+	std::vector<unsigned int> borrowed(numElements, 42u);
+	std::atomic<bool> isWritten(false);
+	std::thread writer;
+	{
+		auto borrow = in->borrowClientData(reinterpret_cast<const byte *>(borrowed.data()));
+		writer = std::thread([&]() {
+			if (resize) {
+				std::vector<unsigned int> data(2 * numElements, 7u);
+				in->setInstanceData(2, 1, reinterpret_cast<const byte *>(data.data()));
+			} else {
+				in->setVertex(0, 7u);
+			}
+			isWritten = true;
+		});
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		// the writer waits for the end of the borrow, readers do not
+		EXPECT_FALSE(isWritten.load());
+		EXPECT_EQ(in->getVertex(0).r, 42u);
+	}
+	writer.join();
+	// the write is not undone by the end of the borrow
+	EXPECT_EQ(in->getVertex(0).r, 7u);
+	EXPECT_EQ(in->getVertex(1).r, resize ? 7u : 1u);
+	EXPECT_EQ(borrowed[0], 42u);
+}
+
+TEST(ShaderInputTest, BorrowBlocksWriters) {
+	testBorrowBlocksWriters(100, false);
+}
+
+TEST(ShaderInputTest, BorrowBlocksWriters_LockFree) {
+	testBorrowBlocksWriters(4, false);
+}
+
+TEST(ShaderInputTest, BorrowBlocksResize) {
+	testBorrowBlocksWriters(100, true);
+}
+
+static void testExchange(unsigned int numElements) {
+	auto in = createArray(true, numElements);
+	auto *data = in->allocateClientBuffer();
+	auto *typed = reinterpret_cast<unsigned int *>(data);
+	for (unsigned int i = 0; i < numElements; ++i) typed[i] = 2 * i;
+	auto stamp = in->stamp();
+
+	auto *previous = in->exchangeClientData(data);
+	EXPECT_GT(in->stamp(), stamp);
+	for (unsigned int i = 0; i < numElements; ++i) {
+		EXPECT_EQ(in->getVertex(i).r, 2 * i);
+		EXPECT_EQ(reinterpret_cast<unsigned int *>(previous)[i], i);
+	}
+	in->freeClientBuffer(previous);
+}
+
+TEST(ShaderInputTest, Exchange_LockFree) {
+	testExchange(4);
+}
+
+TEST(ShaderInputTest, Exchange_SlotLocks) {
+	testExchange(100);
+}
+
+TEST(ShaderInputTest, MappingGroup) {
+	auto a = createArray(false, 100);
+	auto b = ref_ptr<ShaderInput4f>::alloc("b");
+	b->setUniformData(Vec4f(1.0f));
+	{
+		ShaderDataGroup mapped({
+			{a.get(), ShaderData::READ | ShaderData::WRITE},
+			{nullptr, ShaderData::READ},
+			{b.get(), ShaderData::READ}});
+		EXPECT_EQ(mapped.r<unsigned int>(0)[10], 10u);
+		EXPECT_EQ(mapped.r<Vec4f>(1), nullptr);
+		EXPECT_EQ(mapped.r<Vec4f>(2)[0], Vec4f(1.0f));
+		EXPECT_EQ(mapped.w<Vec4f>(2), nullptr);
+		for (unsigned int i = 0; i < 100; ++i) {
+			mapped.w<unsigned int>(0)[i] = mapped.r<unsigned int>(0)[i] + 1;
+		}
+	}
+	EXPECT_EQ(a->getVertex(10).r, 11u);
+}
+
+TEST(ShaderInputTest, MappingGroup_InvalidEntries) {
+	auto a = createArray(false, 100);
+	// an input must not appear twice
+	EXPECT_THROW(ShaderDataGroup({
+		{a.get(), ShaderData::WRITE},
+		{a.get(), ShaderData::READ}}), ShaderDataGroup::Error);
+	EXPECT_THROW(ShaderDataGroup({
+		{a.get(), ShaderData::READ}, {nullptr, ShaderData::READ}, {nullptr, ShaderData::READ},
+		{nullptr, ShaderData::READ}, {nullptr, ShaderData::READ}, {nullptr, ShaderData::READ},
+		{nullptr, ShaderData::READ}, {nullptr, ShaderData::READ}, {nullptr, ShaderData::READ}}),
+		ShaderDataGroup::Error);
+	// nothing was left mapped
+	a->setVertex(0, 7u);
+	EXPECT_EQ(a->getVertex(0).r, 7u);
+}
+
+// readers of a group must see both inputs written by the same group
+static void testConsistentGroups(bool lockFree) {
+	auto a = ref_ptr<ShaderInputMat4>::alloc("a");
+	auto b = ref_ptr<ShaderInputMat4>::alloc("b");
+	for (auto &in: {a, b}) {
+		in->set_allowLockFree(lockFree);
+		in->setUniformData(Mat4f(0.0f));
+	}
+
+	std::atomic<bool> isDone(false);
+	std::atomic<unsigned int> numTornReads(0);
+	std::vector<std::thread> threads;
+	for (unsigned int i = 0; i < 2; ++i) {
+		threads.emplace_back([&, i]() {
+			while (!isDone.load()) {
+				// inputs are passed in different orders, the group uses a fixed order
+				ShaderDataGroup mapped({
+					{(i == 0 ? a : b).get(), ShaderData::READ},
+					{(i == 0 ? b : a).get(), ShaderData::READ}});
+				if (mapped.r<Mat4f>(0)->x[0] != mapped.r<Mat4f>(1)->x[0]) {
+					numTornReads += 1;
+				}
+			}
+		});
+	}
+	// a second writer with the inputs in the other order
+	threads.emplace_back([&]() {
+		for (unsigned int i = 1; i <= 5000; ++i) {
+			ShaderDataGroup mapped({
+				{b.get(), ShaderData::WRITE},
+				{a.get(), ShaderData::WRITE}});
+			*mapped.w<Mat4f>(0) = Mat4f(-1.0f);
+			*mapped.w<Mat4f>(1) = Mat4f(-1.0f);
+		}
+	});
+	for (unsigned int i = 1; i <= 5000; ++i) {
+		ShaderDataGroup mapped({
+			{a.get(), ShaderData::WRITE},
+			{b.get(), ShaderData::WRITE}});
+		*mapped.w<Mat4f>(0) = Mat4f(static_cast<float>(i));
+		*mapped.w<Mat4f>(1) = Mat4f(static_cast<float>(i));
+	}
+	threads.back().join();
+	threads.pop_back();
+	isDone = true;
+	for (auto &thread: threads) thread.join();
+	EXPECT_EQ(numTornReads.load(), 0u);
+}
+
+TEST(ShaderInputTest, MappingGroup_LockFree) {
+	testConsistentGroups(true);
+}
+
+TEST(ShaderInputTest, MappingGroup_SlotLocks) {
+	testConsistentGroups(false);
+}
@@ -0,0 +1,172 @@
+#include <random>
+#include <cmath>
+#include "gtest/gtest.h"
+#include "regen/shapes/aabb-tree.h"
+#include "regen/shapes/quad-tree.h"
+#include "regen/shapes/bounding-sphere.h"
+#include "regen/shapes/frustum.h"
+
+using namespace regen;
+
+// fixture class for testing
+class AABBTreeTest : public ::testing::Test {
+
+};
+
+struct TestScene {
+	std::vector<ref_ptr<BoundingShape>> shapes;
+	std::vector<ref_ptr<ShaderInput3f>> positions;
+};
+
+/**
+ * Creates spheres at random positions, including random heights,
+ * which is the case the 2D quad tree handles poorly.
+ * Each sphere gets its own position input, such that it can be moved.
+ * Note: shapes cannot be shared between indices as the transform stamp is
+ * consumed by the first index that updates the shape. Instead, scenes created
+ * with the same seed are compared by instance ID.
+ */
+static TestScene randomScene(unsigned int count, unsigned int seed) {
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<float> pos(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> radius(0.1f, 5.0f);
+	TestScene scene;
+	for (unsigned int i = 0; i < count; ++i) {
+		auto position = ref_ptr<ShaderInput3f>::alloc("position");
+		position->setUniformData(Vec3f(pos(gen), pos(gen), pos(gen)));
+		auto sphere = ref_ptr<BoundingSphere>::alloc(Vec3f(0.0f), radius(gen));
+		sphere->setTransform(position);
+		sphere->setName("sphere");
+		sphere->setInstanceID(i);
+		scene.shapes.emplace_back(sphere);
+		scene.positions.emplace_back(position);
+	}
+	return scene;
+}
+
+static std::set<unsigned int> intersections(SpatialIndex &index, const BoundingShape &query) {
+	std::set<unsigned int> result;
+	index.foreachIntersection(query, [&result](const BoundingShape &shape) {
+		// each shape must be reported only once
+		EXPECT_TRUE(result.insert(shape.instanceID()).second);
+	});
+	return result;
+}
+
+static void expectSameIntersections(AABBTree &aabbTree, QuadTree &quadTree, unsigned int seed) {
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<float> pos(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> radius(1.0f, 40.0f);
+	std::uniform_real_distribution<float> angle(0.0f, 2.0f * M_PI);
+	// sphere queries
+	for (unsigned int i = 0; i < 50; ++i) {
+		BoundingSphere query(Vec3f(pos(gen), pos(gen), pos(gen)), radius(gen));
+		EXPECT_EQ(intersections(aabbTree, query), intersections(quadTree, query));
+	}
+	// frustum queries
+	for (unsigned int i = 0; i < 20; ++i) {
+		Frustum query;
+		query.setPerspective(1.0, 45.0, 0.1, 100.0);
+		auto a = angle(gen);
+		query.update(Vec3f(pos(gen), pos(gen), pos(gen)), Vec3f(std::cos(a), 0.0f, std::sin(a)));
+		EXPECT_EQ(intersections(aabbTree, query), intersections(quadTree, query));
+	}
+}
+
+static void expectBalanced(const AABBTree &tree) {
+	// a balanced tree has logarithmic height
+	auto n = static_cast<float>(tree.numItems());
+	EXPECT_LE(tree.height(), static_cast<int>(2.0f * std::log2(n) + 1.0f));
+	// every item is in a leaf, and there are n-1 internal nodes
+	EXPECT_EQ(tree.numNodes(), 2u * tree.numItems() - 1u);
+}
+
+TEST(AABBTreeTest, EmptyTree) {
+	AABBTree tree;
+	tree.update(0.0f);
+	EXPECT_EQ(tree.numItems(), 0u);
+	EXPECT_EQ(tree.numNodes(), 0u);
+	EXPECT_FALSE(tree.hasIntersection(BoundingSphere(Vec3f(0.0f), 10.0f)));
+}
+
+TEST(AABBTreeTest, RandomScene_sameAsQuadTree) {
+	AABBTree aabbTree;
+	QuadTree quadTree;
+	auto scene = randomScene(1000, 42);
+	for (auto &shape: scene.shapes) {
+		aabbTree.insert(shape);
+	}
+	for (auto &shape: randomScene(1000, 42).shapes) {
+		quadTree.insert(shape);
+	}
+	aabbTree.update(0.0f);
+	quadTree.update(0.0f);
+	EXPECT_EQ(aabbTree.numItems(), scene.shapes.size());
+	expectBalanced(aabbTree);
+	expectSameIntersections(aabbTree, quadTree, 7);
+}
+
+TEST(AABBTreeTest, RandomScene_remove) {
+	AABBTree tree;
+	auto scene = randomScene(500, 1);
+	for (auto &shape: scene.shapes) {
+		tree.insert(shape);
+	}
+	tree.update(0.0f);
+	// remove every second sphere
+	QuadTree quadTree;
+	auto quadTreeScene = randomScene(500, 1);
+	for (unsigned int i = 0; i < scene.shapes.size(); ++i) {
+		if (i % 2 == 0) {
+			tree.remove(scene.shapes[i]);
+		} else {
+			quadTree.insert(quadTreeScene.shapes[i]);
+		}
+	}
+	tree.update(0.0f);
+	quadTree.update(0.0f);
+	EXPECT_EQ(tree.numItems(), 250u);
+	expectBalanced(tree);
+	expectSameIntersections(tree, quadTree, 3);
+}
+
+TEST(AABBTreeTest, RandomScene_moving) {
+	AABBTree aabbTree;
+	aabbTree.setMargin(1.0f);
+	QuadTree quadTree;
+	auto scene = randomScene(1000, 5);
+	auto quadTreeScene = randomScene(1000, 5);
+	for (auto &shape: scene.shapes) {
+		aabbTree.insert(shape);
+	}
+	for (auto &shape: quadTreeScene.shapes) {
+		quadTree.insert(shape);
+	}
+	aabbTree.update(0.0f);
+	quadTree.update(0.0f);
+
+	std::mt19937 gen(11);
+	std::uniform_real_distribution<float> step(-0.5f, 0.5f);
+	std::uniform_real_distribution<float> jump(-100.0f, 100.0f);
+	for (unsigned int frame = 0; frame < 10; ++frame) {
+		for (unsigned int i = 0; i < scene.positions.size(); ++i) {
+			auto p = scene.positions[i]->getVertex(0).r;
+			if (i % 10 == 0) {
+				// some items jump far away, and must be re-inserted
+				p = Vec3f(jump(gen), jump(gen), jump(gen));
+			} else if (i % 2 == 0) {
+				// small movements stay within the fat bounds
+				p += Vec3f(step(gen), step(gen), step(gen)) * 0.1f;
+			} else {
+				continue;
+			}
+			scene.positions[i]->setVertex(0, p);
+			quadTreeScene.positions[i]->setVertex(0, p);
+		}
+		aabbTree.update(0.0f);
+		quadTree.update(0.0f);
+	}
+	EXPECT_EQ(aabbTree.numReinserts(), 10u * scene.shapes.size() / 10u);
+	expectBalanced(aabbTree);
+	expectSameIntersections(aabbTree, quadTree, 13);
+}
@@ -0,0 +1,148 @@
+#include <random>
+#include <cmath>
+#include "gtest/gtest.h"
+#include "regen/shapes/instanced-bounding-volume.h"
+#include "regen/shapes/bounding-sphere.h"
+#include "regen/shapes/aabb.h"
+#include "regen/shapes/frustum.h"
+
+using namespace regen;
+
+// fixture class for testing
+class InstancedBoundingVolumeTest : public ::testing::Test {
+
+};
+
+// odd number of instances such that the scalar tail of the kernel is used
+#define TEST_NUM_INSTANCES 1003
+
+static ref_ptr<ShaderInput3f> randomOffsets(unsigned int count, unsigned int seed) {
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<float> pos(-100.0f, 100.0f);
+	auto offsets = ref_ptr<ShaderInput3f>::alloc("modelOffset");
+	offsets->setInstanceData(count, 1, nullptr);
+	auto mapped = offsets->mapClientData<Vec3f>(ShaderData::WRITE);
+	for (unsigned int i = 0; i < count; ++i) {
+		mapped.w[i] = Vec3f(pos(gen), pos(gen), pos(gen));
+	}
+	return offsets;
+}
+
+static std::vector<Frustum> randomFrusta(unsigned int count, unsigned int seed) {
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<float> pos(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> angle(0.0f, 2.0f * M_PI);
+	std::vector<Frustum> frusta(count);
+	for (auto &frustum: frusta) {
+		frustum.setPerspective(1.0, 45.0, 0.1, 100.0);
+		auto a = angle(gen);
+		frustum.update(Vec3f(pos(gen), pos(gen), pos(gen)), Vec3f(std::cos(a), 0.0f, std::sin(a)));
+	}
+	return frusta;
+}
+
+static std::vector<unsigned int> cull(const InstancedBoundingVolume &volume, const BoundingShape &shape) {
+	std::vector<unsigned int> visible(volume.numInstances());
+	visible.resize(volume.cull(shape, visible.data()));
+	return visible;
+}
+
+static std::vector<unsigned int> sphereFrustumReference(
+		const ref_ptr<ShaderInput3f> &offsets, float radius, const Frustum &frustum) {
+	std::vector<unsigned int> visible;
+	for (unsigned int i = 0; i < offsets->numInstances(); ++i) {
+		if (frustum.hasIntersectionWithSphere(offsets->getVertex(i).r, radius)) {
+			visible.push_back(i);
+		}
+	}
+	return visible;
+}
+
+TEST(InstancedBoundingVolumeTest, Spheres_frustum) {
+	auto offsets = randomOffsets(TEST_NUM_INSTANCES, 42);
+	auto sphere = ref_ptr<BoundingSphere>::alloc(Vec3f(0.0f), 2.0f);
+	sphere->setTransform(offsets);
+	InstancedBoundingVolume volume(sphere);
+	EXPECT_EQ(volume.numInstances(), TEST_NUM_INSTANCES);
+	EXPECT_TRUE(volume.isSphere());
+
+	unsigned int numVisible = 0;
+	for (auto &frustum: randomFrusta(20, 7)) {
+		auto visible = cull(volume, frustum);
+		EXPECT_EQ(visible, sphereFrustumReference(offsets, 2.0f, frustum));
+		numVisible += visible.size();
+	}
+	EXPECT_GT(numVisible, 0u);
+}
+
+TEST(InstancedBoundingVolumeTest, Spheres_sphere) {
+	auto offsets = randomOffsets(TEST_NUM_INSTANCES, 3);
+	auto sphere = ref_ptr<BoundingSphere>::alloc(Vec3f(0.0f), 1.5f);
+	sphere->setTransform(offsets);
+	InstancedBoundingVolume volume(sphere);
+
+	std::mt19937 gen(11);
+	std::uniform_real_distribution<float> pos(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> radius(1.0f, 40.0f);
+	for (unsigned int i = 0; i < 50; ++i) {
+		BoundingSphere query(Vec3f(pos(gen), pos(gen), pos(gen)), radius(gen));
+		std::vector<unsigned int> expected;
+		for (unsigned int j = 0; j < TEST_NUM_INSTANCES; ++j) {
+			if ((offsets->getVertex(j).r - query.getCenterPosition()).length() <= 1.5f + query.radius()) {
+				expected.push_back(j);
+			}
+		}
+		EXPECT_EQ(cull(volume, query), expected);
+	}
+}
+
+TEST(InstancedBoundingVolumeTest, Boxes_frustum) {
+	auto offsets = randomOffsets(TEST_NUM_INSTANCES, 5);
+	Bounds<Vec3f> bounds(Vec3f(-1.0f, 0.0f, -2.0f), Vec3f(1.0f, 3.0f, 2.0f));
+	auto box = ref_ptr<AABB>::alloc(bounds);
+	box->setTransform(offsets);
+	InstancedBoundingVolume volume(box);
+	EXPECT_FALSE(volume.isSphere());
+
+	// compare with the intersection test of one AABB per instance
+	std::vector<ref_ptr<AABB>> boxes;
+	for (unsigned int i = 0; i < TEST_NUM_INSTANCES; ++i) {
+		auto instanceBox = ref_ptr<AABB>::alloc(bounds);
+		instanceBox->setTransform(offsets, i);
+		instanceBox->updateTransform(true);
+		boxes.push_back(instanceBox);
+	}
+	for (auto &frustum: randomFrusta(20, 13)) {
+		std::vector<unsigned int> expected;
+		for (unsigned int i = 0; i < TEST_NUM_INSTANCES; ++i) {
+			if (frustum.hasIntersectionWithFrustum(*boxes[i].get())) {
+				expected.push_back(i);
+			}
+		}
+		EXPECT_EQ(cull(volume, frustum), expected);
+	}
+}
+
+TEST(InstancedBoundingVolumeTest, Spheres_moving) {
+	auto offsets = randomOffsets(TEST_NUM_INSTANCES, 17);
+	auto sphere = ref_ptr<BoundingSphere>::alloc(Vec3f(0.0f), 1.0f);
+	sphere->setTransform(offsets);
+	InstancedBoundingVolume volume(sphere);
+	EXPECT_FALSE(volume.update());
+
+	// move all instances far away, except for one
+	auto mapped = offsets->mapClientData<Vec3f>(ShaderData::WRITE);
+	for (unsigned int i = 0; i < TEST_NUM_INSTANCES; ++i) {
+		mapped.w[i] = Vec3f(1000.0f + static_cast<float>(i), 0.0f, 0.0f);
+	}
+	mapped.w[TEST_NUM_INSTANCES / 2] = Vec3f(0.0f);
+	mapped.unmap();
+	EXPECT_TRUE(volume.update());
+	EXPECT_FALSE(volume.update());
+
+	auto visible = cull(volume, BoundingSphere(Vec3f(0.0f), 10.0f));
+	ASSERT_EQ(visible.size(), 1u);
+	EXPECT_EQ(visible[0], TEST_NUM_INSTANCES / 2);
+	EXPECT_LE(volume.bounds().min.x, -1.0f);
+	EXPECT_GE(volume.bounds().max.x, 1000.0f + TEST_NUM_INSTANCES - 1);
+}
@@ -0,0 +1,135 @@
+#include <random>
+#include "gtest/gtest.h"
+#include "regen/shapes/linear-quad-tree.h"
+#include "regen/shapes/bounding-sphere.h"
+
+using namespace regen;
+
+// fixture class for testing
+class LinearQuadTreeTest : public ::testing::Test {
+
+};
+
+static std::vector<ref_ptr<BoundingShape>> randomSpheres(unsigned int count, unsigned int seed) {
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<float> pos(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> radius(0.1f, 5.0f);
+	std::vector<ref_ptr<BoundingShape>> spheres;
+	for (unsigned int i = 0; i < count; ++i) {
+		auto sphere = ref_ptr<BoundingSphere>::alloc(
+				Vec3f(pos(gen), pos(gen) * 0.1f, pos(gen)), radius(gen));
+		sphere->setName("sphere");
+		sphere->setInstanceID(i);
+		spheres.emplace_back(sphere);
+	}
+	return spheres;
+}
+
+static std::set<const BoundingShape *> bruteForce(
+		const std::vector<ref_ptr<BoundingShape>> &shapes,
+		const BoundingShape &query) {
+	std::set<const BoundingShape *> result;
+	for (auto &shape: shapes) {
+		if (shape->hasIntersectionWith(query)) {
+			result.insert(shape.get());
+		}
+	}
+	return result;
+}
+
+TEST(LinearQuadTreeTest, EmptyTree) {
+	LinearQuadTree tree;
+	tree.update(0.0f);
+	EXPECT_EQ(tree.numItems(), 0u);
+	EXPECT_EQ(tree.numNodes(), 0u);
+	BoundingSphere query(Vec3f(0, 0, 0), 10.0f);
+	EXPECT_FALSE(tree.hasIntersection(query));
+}
+
+TEST(LinearQuadTreeTest, OneSphere) {
+	LinearQuadTree tree;
+	tree.insert(ref_ptr<BoundingSphere>::alloc(Vec3f(0, 0, 0), 0.5f));
+	tree.update(0.0f);
+	EXPECT_EQ(tree.numItems(), 1u);
+	EXPECT_EQ(tree.numNodes(), 1u);
+	EXPECT_EQ(tree.bounds().min, Vec2f(-0.5f, -0.5f));
+	EXPECT_EQ(tree.bounds().max, Vec2f(0.5f, 0.5f));
+	EXPECT_EQ(tree.numIntersections(BoundingSphere(Vec3f(0.5f, 0, 0.5f), 0.5f)), 1);
+	EXPECT_EQ(tree.numIntersections(BoundingSphere(Vec3f(5, 0, 5), 0.5f)), 0);
+}
+
+TEST(LinearQuadTreeTest, RandomSpheres_brute_force) {
+	LinearQuadTree tree;
+	tree.setMaxDepth(6);
+	auto spheres = randomSpheres(2000, 42);
+	for (auto &sphere: spheres) {
+		tree.insert(sphere);
+	}
+	tree.update(0.0f);
+	EXPECT_EQ(tree.numItems(), spheres.size());
+
+	auto queries = randomSpheres(100, 7);
+	for (auto &query: queries) {
+		std::set<const BoundingShape *> result;
+		tree.foreachIntersection(*query.get(), [&result](const BoundingShape &shape) {
+			// each shape must be reported only once
+			EXPECT_TRUE(result.insert(&shape).second);
+		});
+		EXPECT_EQ(result, bruteForce(spheres, *query.get()));
+	}
+}
+
+TEST(LinearQuadTreeTest, RandomSpheres_remove) {
+	LinearQuadTree tree;
+	auto spheres = randomSpheres(500, 1);
+	for (auto &sphere: spheres) {
+		tree.insert(sphere);
+	}
+	tree.update(0.0f);
+	// remove every second sphere
+	std::vector<ref_ptr<BoundingShape>> remaining;
+	for (unsigned int i = 0; i < spheres.size(); ++i) {
+		if (i % 2 == 0) {
+			tree.remove(spheres[i]);
+		} else {
+			remaining.push_back(spheres[i]);
+		}
+	}
+	tree.update(0.0f);
+	EXPECT_EQ(tree.numItems(), remaining.size());
+
+	BoundingSphere query(Vec3f(0, 0, 0), 50.0f);
+	std::set<const BoundingShape *> result;
+	tree.foreachIntersection(query, [&result](const BoundingShape &shape) {
+		result.insert(&shape);
+	});
+	EXPECT_EQ(result, bruteForce(remaining, query));
+}
+
+TEST(LinearQuadTreeTest, RandomSpheres_remove_before_update) {
+	LinearQuadTree tree;
+	auto spheres = randomSpheres(500, 3);
+	for (auto &sphere: spheres) {
+		tree.insert(sphere);
+	}
+	tree.update(0.0f);
+	// query after each removal without updating the tree in between
+	BoundingSphere query(Vec3f(0, 0, 0), 50.0f);
+	std::vector<ref_ptr<BoundingShape>> remaining(spheres);
+	for (unsigned int i = 0; i < 100; ++i) {
+		tree.remove(remaining.front());
+		remaining.erase(remaining.begin());
+		std::set<const BoundingShape *> result;
+		tree.foreachIntersection(query, [&result](const BoundingShape &shape) {
+			EXPECT_TRUE(result.insert(&shape).second);
+		});
+		ASSERT_EQ(result, bruteForce(remaining, query));
+	}
+	EXPECT_EQ(tree.numItems(), remaining.size());
+	tree.update(0.0f);
+	std::set<const BoundingShape *> result;
+	tree.foreachIntersection(query, [&result](const BoundingShape &shape) {
+		result.insert(&shape);
+	});
+	EXPECT_EQ(result, bruteForce(remaining, query));
+}
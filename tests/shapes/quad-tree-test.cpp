@@ -1,4 +1,5 @@
 
+#include <random>
 #include "gtest/gtest.h"
 #include "regen/shapes/quad-tree.h"
 #include "regen/shapes/bounding-sphere.h"
@@ -34,6 +35,72 @@ TEST(QuadTreeTest, EmptyTree) {
 	EXPECT_EQ(tree.root(), nullptr);
 }
 
+TEST(QuadTreeTest, RandomSpheres_visitedOnce) {
+	QuadTree tree;
+	std::mt19937 gen(42);
+	std::uniform_real_distribution<float> pos(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> radius(0.1f, 10.0f);
+	std::vector<ref_ptr<BoundingShape>> spheres;
+	for (unsigned int i = 0; i < 1000; ++i) {
+		auto sphere = ref_ptr<BoundingSphere>::alloc(Vec3f(pos(gen), 0.0f, pos(gen)), radius(gen));
+		tree.insert(sphere);
+		spheres.emplace_back(sphere);
+	}
+	tree.update(0.0f);
+
+	for (unsigned int i = 0; i < 50; ++i) {
+		BoundingSphere query(Vec3f(pos(gen), 0.0f, pos(gen)), 5.0f * radius(gen));
+		std::set<const BoundingShape *> expected, result;
+		for (auto &sphere: spheres) {
+			if (sphere->hasIntersectionWith(query)) expected.insert(sphere.get());
+		}
+		tree.foreachIntersection(query, [&result](const BoundingShape &shape) {
+			// items that appear in multiple nodes must be reported only once
+			EXPECT_TRUE(result.insert(&shape).second);
+		});
+		EXPECT_EQ(result, expected);
+	}
+}
+
+TEST(QuadTreeTest, Regrow_reusesTree) {
+	QuadTree tree;
+	std::vector<ref_ptr<BoundingShape>> spheres;
+	for (int i = 0; i < 10; ++i) {
+		for (int j = 0; j < 10; ++j) {
+			auto sphere = ref_ptr<BoundingSphere>::alloc(Vec3f(i, 0.0f, j), 0.25f);
+			tree.insert(sphere);
+			spheres.emplace_back(sphere);
+		}
+	}
+	tree.update(0.0f);
+	EXPECT_EQ(tree.numRebuilds(), 1u);
+	EXPECT_EQ(tree.numRegrows(), 0u);
+	auto *oldRoot = tree.root();
+
+	// insert shapes outside of the root bounds, on both sides
+	for (auto &pos: {Vec3f(25.0f, 0.0f, 25.0f), Vec3f(-30.0f, 0.0f, -30.0f)}) {
+		auto sphere = ref_ptr<BoundingSphere>::alloc(pos, 0.25f);
+		tree.insert(sphere);
+		spheres.emplace_back(sphere);
+		tree.update(0.0f);
+	}
+	// the tree must not be rebuilt, but the old root is wrapped into a larger root
+	EXPECT_EQ(tree.numRebuilds(), 1u);
+	EXPECT_GT(tree.numRegrows(), 0u);
+	auto *node = oldRoot;
+	while (node->parent) node = node->parent;
+	EXPECT_EQ(node, tree.root());
+
+	for (auto &sphere: spheres) {
+		// each sphere must be found at its own position
+		BoundingSphere query(sphere->getCenterPosition(), 0.1f);
+		EXPECT_EQ(tree.numIntersections(query), 1);
+	}
+	EXPECT_EQ(tree.numIntersections(BoundingSphere(Vec3f(25.0f, 0.0f, 25.0f), 1.0f)), 1);
+	EXPECT_EQ(tree.numIntersections(BoundingSphere(Vec3f(-30.0f, 0.0f, -30.0f), 1.0f)), 1);
+	EXPECT_EQ(tree.numIntersections(BoundingSphere(Vec3f(5.0f, 0.0f, 5.0f), 0.5f)), 1);
+}
+
 /*
 TEST(QuadTreeTest, OneSphere_bounds) {
 	QuadTree tree;
@@ -120,3 +187,69 @@ TEST(QuadTreeTest, SphereAABB_intersection) {
 	EXPECT_EQ(tree.hasIntersection(testAABB(Vec3f(1.0f, 0, -2.5f), Vec3f(0.45))), 0);
 }
 */
+
+static std::vector<ref_ptr<BoundingShape>> randomSpheres(QuadTree &tree, unsigned int count, unsigned int seed) {
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<float> pos(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> radius(0.1f, 10.0f);
+	std::vector<ref_ptr<BoundingShape>> spheres;
+	for (unsigned int i = 0; i < count; ++i) {
+		auto sphere = ref_ptr<BoundingSphere>::alloc(Vec3f(pos(gen), pos(gen), pos(gen)), radius(gen));
+		sphere->setName("sphere");
+		tree.insert(sphere);
+		spheres.emplace_back(sphere);
+	}
+	tree.update(0.0f);
+	return spheres;
+}
+
+TEST(QuadTreeTest, RandomSpheres_withinRadius) {
+	QuadTree tree;
+	auto spheres = randomSpheres(tree, 1000, 3);
+	std::mt19937 gen(5);
+	std::uniform_real_distribution<float> pos(-120.0f, 120.0f);
+	std::uniform_real_distribution<float> radius(1.0f, 50.0f);
+	for (unsigned int i = 0; i < 50; ++i) {
+		Vec3f point(pos(gen), pos(gen), pos(gen));
+		float r = radius(gen);
+		std::set<const BoundingShape *> expected, result;
+		// the default implementation tests all shapes
+		tree.SpatialIndex::foreachWithinRadius(point, r, [&expected](const BoundingShape &shape) {
+			expected.insert(&shape);
+		});
+		tree.foreachWithinRadius(point, r, [&result](const BoundingShape &shape) {
+			EXPECT_TRUE(result.insert(&shape).second);
+		});
+		EXPECT_EQ(result, expected);
+	}
+}
+
+TEST(QuadTreeTest, RandomSpheres_kNearest) {
+	QuadTree tree;
+	auto spheres = randomSpheres(tree, 1000, 9);
+	std::mt19937 gen(13);
+	std::uniform_real_distribution<float> pos(-150.0f, 150.0f);
+	std::vector<SpatialIndex::Neighbor> expected, result;
+	for (unsigned int k: {1u, 5u, 32u, 2000u}) {
+		for (unsigned int i = 0; i < 20; ++i) {
+			Vec3f point(pos(gen), pos(gen), pos(gen));
+			tree.SpatialIndex::kNearest(point, k, expected);
+			tree.kNearest(point, k, result);
+			ASSERT_EQ(result.size(), std::min(k, 1000u));
+			ASSERT_EQ(result.size(), expected.size());
+			for (unsigned int j = 0; j < result.size(); ++j) {
+				EXPECT_FLOAT_EQ(result[j].distance, expected[j].distance);
+				if (j > 0) {
+					EXPECT_LE(result[j - 1].distance, result[j].distance);
+				}
+			}
+		}
+	}
+	// with a maximum distance, fewer than k shapes may be found
+	tree.kNearest(Vec3f(0.0f), 100, result, 20.0f);
+	tree.SpatialIndex::kNearest(Vec3f(0.0f), 100, expected, 20.0f);
+	EXPECT_EQ(result.size(), expected.size());
+	for (auto &neighbor: result) {
+		EXPECT_LE(neighbor.distance, 20.0f);
+	}
+}
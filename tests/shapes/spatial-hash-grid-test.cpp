@@ -0,0 +1,140 @@
+#include <random>
+#include "gtest/gtest.h"
+#include "regen/shapes/spatial-hash-grid.h"
+#include "regen/shapes/bounding-sphere.h"
+#include "regen/shapes/frustum.h"
+
+using namespace regen;
+
+// fixture class for testing
+class SpatialHashGridTest : public ::testing::Test {
+
+};
+
+static std::vector<ref_ptr<ShaderInput3f>> randomSpheres(
+		SpatialHashGrid &grid,
+		std::vector<ref_ptr<BoundingShape>> &spheres,
+		unsigned int count, unsigned int seed) {
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<float> pos(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> radius(0.1f, 5.0f);
+	std::vector<ref_ptr<ShaderInput3f>> positions;
+	for (unsigned int i = 0; i < count; ++i) {
+		auto position = ref_ptr<ShaderInput3f>::alloc("position");
+		position->setUniformData(Vec3f(pos(gen), 0.0f, pos(gen)));
+		auto sphere = ref_ptr<BoundingSphere>::alloc(Vec3f(0.0f), radius(gen));
+		sphere->setTransform(position);
+		sphere->setName("sphere");
+		sphere->setInstanceID(i);
+		grid.insert(sphere);
+		spheres.emplace_back(sphere);
+		positions.emplace_back(position);
+	}
+	return positions;
+}
+
+static void expectBruteForce(
+		SpatialHashGrid &grid,
+		const std::vector<ref_ptr<BoundingShape>> &spheres,
+		unsigned int seed) {
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<float> pos(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> radius(1.0f, 40.0f);
+	for (unsigned int i = 0; i < 50; ++i) {
+		BoundingSphere query(Vec3f(pos(gen), 0.0f, pos(gen)), radius(gen));
+		std::set<const BoundingShape *> expected, result;
+		for (auto &sphere: spheres) {
+			if (sphere->hasIntersectionWith(query)) expected.insert(sphere.get());
+		}
+		grid.foreachIntersection(query, [&result](const BoundingShape &shape) {
+			// items that appear in multiple cells must be reported only once
+			EXPECT_TRUE(result.insert(&shape).second);
+		});
+		EXPECT_EQ(result, expected);
+	}
+}
+
+TEST(SpatialHashGridTest, EmptyGrid) {
+	SpatialHashGrid grid;
+	grid.update(0.0f);
+	EXPECT_EQ(grid.numCells(), 0u);
+	EXPECT_FALSE(grid.hasIntersection(BoundingSphere(Vec3f(0.0f), 10.0f)));
+}
+
+TEST(SpatialHashGridTest, OneSphere_cells) {
+	SpatialHashGrid grid(1.0f);
+	// sphere overlaps 2x2 cells
+	grid.insert(ref_ptr<BoundingSphere>::alloc(Vec3f(0.0f), 0.5f));
+	EXPECT_EQ(grid.numCells(), 4u);
+	// sphere bounds overlap 4x4 cells, but its circle does not reach the corner cells
+	grid.insert(ref_ptr<BoundingSphere>::alloc(Vec3f(10.0f, 0.0f, 10.0f), 1.2f));
+	EXPECT_EQ(grid.numCells(), 4u + 12u);
+	EXPECT_EQ(grid.numIntersections(BoundingSphere(Vec3f(0.2f, 0.0f, 0.2f), 0.1f)), 1);
+}
+
+TEST(SpatialHashGridTest, RandomSpheres_brute_force) {
+	SpatialHashGrid grid(5.0f);
+	std::vector<ref_ptr<BoundingShape>> spheres;
+	randomSpheres(grid, spheres, 2000, 42);
+	grid.update(0.0f);
+	expectBruteForce(grid, spheres, 7);
+	// the result must not depend on the cell size
+	grid.setCellSize(0.5f);
+	expectBruteForce(grid, spheres, 7);
+	grid.setCellSize(200.0f);
+	expectBruteForce(grid, spheres, 7);
+}
+
+TEST(SpatialHashGridTest, RandomSpheres_moving) {
+	SpatialHashGrid grid(4.0f);
+	std::vector<ref_ptr<BoundingShape>> spheres;
+	auto positions = randomSpheres(grid, spheres, 1000, 5);
+	grid.update(0.0f);
+
+	std::mt19937 gen(11);
+	std::uniform_real_distribution<float> step(-2.0f, 2.0f);
+	for (unsigned int frame = 0; frame < 10; ++frame) {
+		for (auto &position: positions) {
+			auto p = position->getVertex(0).r;
+			position->setVertex(0, p + Vec3f(step(gen), 0.0f, step(gen)));
+		}
+		grid.update(0.0f);
+	}
+	expectBruteForce(grid, spheres, 13);
+}
+
+TEST(SpatialHashGridTest, RandomSpheres_remove) {
+	SpatialHashGrid grid(5.0f);
+	std::vector<ref_ptr<BoundingShape>> spheres, remaining;
+	randomSpheres(grid, spheres, 500, 1);
+	for (unsigned int i = 0; i < spheres.size(); ++i) {
+		if (i % 2 == 0) {
+			grid.remove(spheres[i]);
+		} else {
+			remaining.push_back(spheres[i]);
+		}
+	}
+	grid.update(0.0f);
+	EXPECT_EQ(grid.numItems(), remaining.size());
+	expectBruteForce(grid, remaining, 3);
+}
+
+TEST(SpatialHashGridTest, HugeQuery) {
+	SpatialHashGrid grid(1.0f);
+	std::vector<ref_ptr<BoundingShape>> spheres;
+	auto positions = randomSpheres(grid, spheres, 100, 5);
+	grid.update(0.0f);
+	// the projection of the frustum spans the whole clamped cell range
+	Frustum query;
+	query.setPerspective(1.0, 90.0, 0.1, 1.0e12);
+	query.update(Vec3f(0.0f), Vec3f(1.0f, 0.0f, 0.0f));
+	std::set<const BoundingShape *> expected, result;
+	for (auto &sphere: spheres) {
+		if (sphere->hasIntersectionWith(query)) expected.insert(sphere.get());
+	}
+	grid.foreachIntersection(query, [&result](const BoundingShape &shape) {
+		result.insert(&shape);
+	});
+	EXPECT_FALSE(expected.empty());
+	EXPECT_EQ(result, expected);
+}
@@ -0,0 +1,195 @@
+#include <random>
+#include <chrono>
+#include <iostream>
+#include "gtest/gtest.h"
+#include "regen/shapes/quad-tree.h"
+#include "regen/shapes/linear-quad-tree.h"
+#include "regen/shapes/aabb-tree.h"
+#include "regen/shapes/spatial-hash-grid.h"
+#include "regen/shapes/bounding-sphere.h"
+#include "regen/shapes/instanced-bounding-volume.h"
+#include "regen/shapes/frustum.h"
+
+using namespace regen;
+
+// fixture class for benchmarking
+class SpatialIndexBenchmark : public ::testing::Test {
+
+};
+
+#define BENCHMARK_NUM_ITEMS 50000
+#define BENCHMARK_NUM_QUERIES 200
+
+static std::vector<ref_ptr<BoundingShape>> benchmarkSpheres(
+		unsigned int count, float extent, float maxRadius, unsigned int seed) {
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<float> pos(-extent, extent);
+	std::uniform_real_distribution<float> radius(0.1f, maxRadius);
+	std::vector<ref_ptr<BoundingShape>> spheres;
+	spheres.reserve(count);
+	for (unsigned int i = 0; i < count; ++i) {
+		auto sphere = ref_ptr<BoundingSphere>::alloc(
+				Vec3f(pos(gen), pos(gen) * 0.01f, pos(gen)), radius(gen));
+		sphere->setName("sphere");
+		sphere->setInstanceID(i);
+		spheres.emplace_back(sphere);
+	}
+	return spheres;
+}
+
+/**
+ * Inserts 50k items into the index, and measures the average time
+ * of foreachIntersection for large query shapes.
+ * @return the average query time in milliseconds.
+ */
+static double benchmarkQueries(SpatialIndex &index, const char *name) {
+	auto items = benchmarkSpheres(BENCHMARK_NUM_ITEMS, 1000.0f, 4.0f, 42);
+	for (auto &item: items) {
+		index.insert(item);
+	}
+	index.update(0.0f);
+	auto queries = benchmarkSpheres(BENCHMARK_NUM_QUERIES, 1000.0f, 200.0f, 7);
+
+	unsigned long numHits = 0;
+	auto t1 = std::chrono::high_resolution_clock::now();
+	for (auto &query: queries) {
+		index.foreachIntersection(*query.get(), [&numHits](const BoundingShape &) {
+			numHits += 1;
+		});
+	}
+	auto t2 = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double, std::milli> elapsed = t2 - t1;
+	double avgTime = elapsed.count() / BENCHMARK_NUM_QUERIES;
+	std::cout << name << ": " << BENCHMARK_NUM_ITEMS << " items, " <<
+			numHits << " hits, " << avgTime << " ms per query" << std::endl;
+	EXPECT_GT(numHits, 0u);
+	return avgTime;
+}
+
+TEST(SpatialIndexBenchmark, QuadTree_50k) {
+	QuadTree tree;
+	benchmarkQueries(tree, "QuadTree");
+}
+
+TEST(SpatialIndexBenchmark, LinearQuadTree_50k) {
+	LinearQuadTree tree;
+	benchmarkQueries(tree, "LinearQuadTree");
+}
+
+TEST(SpatialIndexBenchmark, AABBTree_50k) {
+	AABBTree tree;
+	benchmarkQueries(tree, "AABBTree");
+}
+
+TEST(SpatialIndexBenchmark, SpatialHashGrid_50k) {
+	SpatialHashGrid grid(10.0f);
+	benchmarkQueries(grid, "SpatialHashGrid");
+}
+
+#define BENCHMARK_NUM_INSTANCES 20000
+
+/**
+ * Compares frustum culling of 20k instances of one shape, with one shape per
+ * instance in a quad tree, and with a batched instanced volume.
+ */
+TEST(SpatialIndexBenchmark, InstancedVolume_20k) {
+	std::mt19937 gen(42);
+	std::uniform_real_distribution<float> pos(-500.0f, 500.0f);
+	auto offsets = ref_ptr<ShaderInput3f>::alloc("modelOffset");
+	offsets->setInstanceData(BENCHMARK_NUM_INSTANCES, 1, nullptr);
+	{
+		auto mapped = offsets->mapClientData<Vec3f>(ShaderData::WRITE);
+		for (unsigned int i = 0; i < BENCHMARK_NUM_INSTANCES; ++i) {
+			mapped.w[i] = Vec3f(pos(gen), 0.0f, pos(gen));
+		}
+	}
+	QuadTree tree;
+	for (unsigned int i = 0; i < BENCHMARK_NUM_INSTANCES; ++i) {
+		auto sphere = ref_ptr<BoundingSphere>::alloc(Vec3f(0.0f), 1.0f);
+		sphere->setTransform(offsets, i);
+		sphere->setName("grass");
+		sphere->setInstanceID(i);
+		tree.insert(sphere);
+	}
+	tree.update(0.0f);
+	auto prototype = ref_ptr<BoundingSphere>::alloc(Vec3f(0.0f), 1.0f);
+	prototype->setTransform(offsets);
+	InstancedBoundingVolume volume(prototype);
+
+	std::vector<Frustum> frusta(BENCHMARK_NUM_QUERIES);
+	for (auto &frustum: frusta) {
+		frustum.setPerspective(1.0, 60.0, 0.1, 300.0);
+		frustum.update(Vec3f(pos(gen), 1.0f, pos(gen)), Vec3f(1.0f, 0.0f, 0.0f));
+	}
+	unsigned long numTreeHits = 0, numVolumeHits = 0;
+	auto t1 = std::chrono::high_resolution_clock::now();
+	for (auto &frustum: frusta) {
+		tree.foreachIntersection(frustum, [&numTreeHits](const BoundingShape &) {
+			numTreeHits += 1;
+		});
+	}
+	auto t2 = std::chrono::high_resolution_clock::now();
+	std::vector<unsigned int> visibleIDs(BENCHMARK_NUM_INSTANCES);
+	for (auto &frustum: frusta) {
+		numVolumeHits += volume.cullFrustum(frustum, visibleIDs.data());
+	}
+	auto t3 = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double, std::milli> treeTime = t2 - t1;
+	std::chrono::duration<double, std::milli> volumeTime = t3 - t2;
+	std::cout << "QuadTree: " << BENCHMARK_NUM_INSTANCES << " instances, " <<
+			numTreeHits << " hits, " << treeTime.count() / BENCHMARK_NUM_QUERIES << " ms per frustum" << std::endl;
+	std::cout << "InstancedBoundingVolume (batch size " << InstancedBoundingVolume::batchSize() << "): " <<
+			BENCHMARK_NUM_INSTANCES << " instances, " << numVolumeHits << " hits, " <<
+			volumeTime.count() / BENCHMARK_NUM_QUERIES << " ms per frustum" << std::endl;
+	EXPECT_EQ(numTreeHits, numVolumeHits);
+}
+
+/**
+ * Compares the k-nearest and radius queries of the quad tree with the
+ * default implementations that test all shapes.
+ */
+TEST(SpatialIndexBenchmark, QuadTree_kNearest_50k) {
+	QuadTree tree;
+	auto items = benchmarkSpheres(BENCHMARK_NUM_ITEMS, 1000.0f, 4.0f, 42);
+	for (auto &item: items) {
+		tree.insert(item);
+	}
+	tree.update(0.0f);
+	auto queries = benchmarkSpheres(BENCHMARK_NUM_QUERIES, 1000.0f, 1.0f, 7);
+	std::vector<SpatialIndex::Neighbor> result;
+
+	auto t1 = std::chrono::high_resolution_clock::now();
+	for (auto &query: queries) {
+		tree.kNearest(query->getCenterPosition(), 16, result);
+	}
+	auto t2 = std::chrono::high_resolution_clock::now();
+	for (auto &query: queries) {
+		tree.SpatialIndex::kNearest(query->getCenterPosition(), 16, result);
+	}
+	auto t3 = std::chrono::high_resolution_clock::now();
+	unsigned long numTreeHits = 0, numBruteForceHits = 0;
+	for (auto &query: queries) {
+		tree.foreachWithinRadius(query->getCenterPosition(), 50.0f, [&numTreeHits](const BoundingShape &) {
+			numTreeHits += 1;
+		});
+	}
+	auto t4 = std::chrono::high_resolution_clock::now();
+	for (auto &query: queries) {
+		tree.SpatialIndex::foreachWithinRadius(query->getCenterPosition(), 50.0f,
+				[&numBruteForceHits](const BoundingShape &) {
+			numBruteForceHits += 1;
+		});
+	}
+	auto t5 = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double, std::milli> kNearestTime = t2 - t1;
+	std::chrono::duration<double, std::milli> kNearestBruteForceTime = t3 - t2;
+	std::chrono::duration<double, std::milli> radiusTime = t4 - t3;
+	std::chrono::duration<double, std::milli> radiusBruteForceTime = t5 - t4;
+	std::cout << "QuadTree kNearest(16): " <<
+			kNearestTime.count() / BENCHMARK_NUM_QUERIES << " ms per query, " <<
+			kNearestBruteForceTime.count() / BENCHMARK_NUM_QUERIES << " ms without index" << std::endl;
+	std::cout << "QuadTree foreachWithinRadius(50): " <<
+			radiusTime.count() / BENCHMARK_NUM_QUERIES << " ms per query, " <<
+			radiusBruteForceTime.count() / BENCHMARK_NUM_QUERIES << " ms without index" << std::endl;
+	EXPECT_EQ(numTreeHits, numBruteForceHits);
+}
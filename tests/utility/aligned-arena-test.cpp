@@ -0,0 +1,133 @@
+#include <cstdint>
+#include <vector>
+#include "gtest/gtest.h"
+#include "regen/utility/aligned-arena.h"
+#include "regen/gl-types/shader-input.h"
+
+using namespace regen;
+
+// fixture class for testing
+class AlignedArenaTest : public ::testing::Test {
+
+};
+
+static bool isAligned(const void *ptr) {
+	return reinterpret_cast<uintptr_t>(ptr) % REGEN_ARENA_ALIGNMENT == 0;
+}
+
+TEST(AlignedArenaTest, SizeClasses) {
+	EXPECT_EQ(AlignedArena::blockSize(1), 64u);
+	EXPECT_EQ(AlignedArena::blockSize(64), 64u);
+	EXPECT_EQ(AlignedArena::blockSize(65), 128u);
+	EXPECT_EQ(AlignedArena::blockSize(512), 512u);
+	EXPECT_EQ(AlignedArena::blockSize(513), 640u);
+	EXPECT_EQ(AlignedArena::blockSize(1024), 1024u);
+	EXPECT_EQ(AlignedArena::blockSize(REGEN_ARENA_MAX_CLASS_SIZE), REGEN_ARENA_MAX_CLASS_SIZE);
+	size_t lastBlockSize = 0;
+	unsigned int lastClass = 0;
+	for (size_t size = 1; size <= REGEN_ARENA_MAX_CLASS_SIZE; size += 7) {
+		auto blockSize = AlignedArena::blockSize(size);
+		auto sizeClass = AlignedArena::sizeClass(size);
+		ASSERT_GE(blockSize, size);
+		ASSERT_EQ(blockSize % REGEN_ARENA_ALIGNMENT, 0u);
+		ASSERT_GE(blockSize, lastBlockSize);
+		ASSERT_GE(sizeClass, lastClass);
+		// the rounding wastes at most a quarter of the block
+		if (size > 512) ASSERT_LE(blockSize - size, blockSize / 4);
+		lastBlockSize = blockSize;
+		lastClass = sizeClass;
+	}
+}
+
+TEST(AlignedArenaTest, Alignment) {
+	AlignedArena arena;
+	for (size_t size: {size_t(1), size_t(12), size_t(100), size_t(3000), size_t(REGEN_ARENA_MAX_CLASS_SIZE + 1)}) {
+		auto *a = arena.allocate(size);
+		auto *b = arena.allocate(size);
+		EXPECT_TRUE(isAligned(a)) << "size " << size;
+		EXPECT_TRUE(isAligned(b)) << "size " << size;
+		arena.deallocate(a, size);
+		arena.deallocate(b, size);
+	}
+}
+
+TEST(AlignedArenaTest, Reuse) {
+	AlignedArena arena;
+	auto *a = arena.allocate(200);
+	auto *b = arena.allocate(200);
+	// blocks of one size class are adjacent
+	EXPECT_EQ(static_cast<std::byte *>(b) - static_cast<std::byte *>(a),
+			  static_cast<ptrdiff_t>(AlignedArena::blockSize(200)));
+	arena.deallocate(a, 200);
+	// a freed block is reused by the same size class
+	EXPECT_EQ(arena.allocate(250), a);
+	arena.deallocate(a, 250);
+	arena.deallocate(b, 200);
+	EXPECT_EQ(arena.numChunkBytes(), size_t(REGEN_ARENA_CHUNK_SIZE));
+}
+
+TEST(AlignedArenaTest, Statistics) {
+	AlignedArena arena;
+	auto tag = arena.tag("test");
+	EXPECT_EQ(arena.tag("test"), tag);
+	EXPECT_EQ(arena.tagName(tag), "test");
+	auto *a = arena.allocate(100, tag);
+	auto *b = arena.allocate(REGEN_ARENA_MAX_CLASS_SIZE + 1, tag);
+	auto stats = arena.statistics(tag);
+	EXPECT_EQ(stats.numBlocks, 2u);
+	EXPECT_EQ(stats.numBytes, 100u + REGEN_ARENA_MAX_CLASS_SIZE + 1);
+	EXPECT_EQ(stats.numReservedBytes, 128u + REGEN_ARENA_MAX_CLASS_SIZE + 64);
+	EXPECT_EQ(arena.statistics(AlignedArena::DEFAULT_TAG).numBlocks, 0u);
+	arena.deallocate(a, 100, tag);
+	arena.deallocate(b, REGEN_ARENA_MAX_CLASS_SIZE + 1, tag);
+	EXPECT_EQ(arena.statistics(tag).numBytes, 0u);
+}
+
+TEST(AlignedArenaTest, ShaderInputSlots) {
+	auto &arena = AlignedArena::get();
+	ref_ptr<ShaderInputMat4> in;
+	{
+		AlignedArena::Scope scope("shader-input-test");
+		EXPECT_EQ(AlignedArena::currentTag(), arena.tag("shader-input-test"));
+		in = ref_ptr<ShaderInputMat4>::alloc("in", 10);
+		in->setUniformUntyped();
+	}
+	EXPECT_EQ(AlignedArena::currentTag(), AlignedArena::DEFAULT_TAG);
+	auto tag = arena.tag("shader-input-test");
+	EXPECT_EQ(arena.statistics(tag).numBlocks, 1u);
+	EXPECT_EQ(arena.statistics(tag).numBytes, in->inputSize());
+	{
+		auto mapped = in->mapClientData<Mat4f>(ShaderData::READ);
+		EXPECT_TRUE(isAligned(mapped.r));
+	}
+	// a buffer for exchange has the same tag
+	auto *data = in->allocateClientBuffer();
+	EXPECT_TRUE(isAligned(data));
+	EXPECT_EQ(arena.statistics(tag).numBlocks, 2u);
+	in->freeClientBuffer(in->exchangeClientData(data));
+	in = ref_ptr<ShaderInputMat4>();
+	EXPECT_EQ(arena.statistics(tag).numBlocks, 0u);
+}
+
+TEST(AlignedArenaTest, ClientBufferAfterResize) {
+	auto &arena = AlignedArena::get();
+	AlignedArena::Scope scope("client-buffer-test");
+	auto tag = arena.tag("client-buffer-test");
+	auto in = ref_ptr<ShaderInput1ui>::alloc("in", 100);
+	in->setUniformUntyped();
+	auto *data = in->allocateClientBuffer();
+	// buffers of the previous size are rejected, but can still be freed
+	std::vector<unsigned int> resized(200, 1u);
+	in->setInstanceData(2, 1, reinterpret_cast<const byte *>(resized.data()));
+	EXPECT_EQ(in->exchangeClientData(data), nullptr);
+	EXPECT_EQ(in->getVertex(0).r, 1u);
+	in->freeClientBuffer(data);
+	EXPECT_EQ(arena.statistics(tag).numBytes, in->inputSize());
+	// buffers of the current size are exchanged
+	data = in->allocateClientBuffer();
+	auto *previous = in->exchangeClientData(data);
+	EXPECT_NE(previous, nullptr);
+	in->freeClientBuffer(previous);
+	in = ref_ptr<ShaderInput1ui>();
+	EXPECT_EQ(arena.statistics(tag).numBytes, 0u);
+}
@@ -0,0 +1,79 @@
+#include <chrono>
+#include <iostream>
+#include <atomic>
+#include <cmath>
+#include "gtest/gtest.h"
+#include "regen/utility/job-system.h"
+#include "regen/utility/ThreadPool.h"
+
+using namespace regen;
+
+// fixture class for benchmarking
+class JobSystemBenchmark : public ::testing::Test {
+
+};
+
+#define BENCHMARK_NUM_TASKS 20000
+#define BENCHMARK_TASK_SIZE 200
+
+// a small amount of work, comparable to processing one quad-tree node
+static float benchmarkTask(unsigned int seed) {
+	float x = static_cast<float>(seed);
+	for (unsigned int i = 0; i < BENCHMARK_TASK_SIZE; ++i) {
+		x = std::sqrt(x + static_cast<float>(i));
+	}
+	return x;
+}
+
+TEST(JobSystemBenchmark, FineGrainedTasks) {
+	unsigned int numThreads = std::max(2u, std::thread::hardware_concurrency()) - 1u;
+	std::atomic<float> result(0.0f);
+	auto accumulate = [&result](float v) {
+		float expected = result.load();
+		while (!result.compare_exchange_weak(expected, expected + v)) {}
+	};
+
+	// one runner per task, as done with the existing thread pool
+	ThreadPool threadPool(numThreads);
+	auto t1 = std::chrono::high_resolution_clock::now();
+	std::vector<std::shared_ptr<ThreadPool::LambdaRunner>> runners(BENCHMARK_NUM_TASKS);
+	for (unsigned int i = 0; i < BENCHMARK_NUM_TASKS; ++i) {
+		runners[i] = std::make_shared<ThreadPool::LambdaRunner>(
+				[&accumulate, i](const ThreadPool::LambdaRunner::StopChecker &) {
+					accumulate(benchmarkTask(i));
+				});
+		threadPool.pushWork(runners[i], [](const std::exception &) {});
+	}
+	for (auto &runner: runners) {
+		runner->join();
+	}
+	auto t2 = std::chrono::high_resolution_clock::now();
+	auto threadPoolTime = std::chrono::duration<double, std::milli>(t2 - t1).count();
+	auto threadPoolResult = result.exchange(0.0f);
+
+	JobSystem jobSystem(numThreads);
+	t1 = std::chrono::high_resolution_clock::now();
+	JobSystem::Counter counter;
+	for (unsigned int i = 0; i < BENCHMARK_NUM_TASKS; ++i) {
+		jobSystem.run([&accumulate, i]() { accumulate(benchmarkTask(i)); }, &counter);
+	}
+	jobSystem.wait(counter);
+	t2 = std::chrono::high_resolution_clock::now();
+	auto jobSystemTime = std::chrono::duration<double, std::milli>(t2 - t1).count();
+	auto jobSystemResult = result.exchange(0.0f);
+
+	t1 = std::chrono::high_resolution_clock::now();
+	jobSystem.parallelFor(BENCHMARK_NUM_TASKS, 64, [&accumulate](unsigned int i) {
+		accumulate(benchmarkTask(i));
+	});
+	t2 = std::chrono::high_resolution_clock::now();
+	auto parallelForTime = std::chrono::duration<double, std::milli>(t2 - t1).count();
+
+	std::cout << "ThreadPool: " << BENCHMARK_NUM_TASKS << " tasks, " <<
+			numThreads << " threads, " << threadPoolTime << " ms" << std::endl;
+	std::cout << "JobSystem run: " << BENCHMARK_NUM_TASKS << " tasks, " <<
+			numThreads << " threads, " << jobSystemTime << " ms" << std::endl;
+	std::cout << "JobSystem parallelFor: " << BENCHMARK_NUM_TASKS << " tasks, " <<
+			numThreads << " threads, " << parallelForTime << " ms" << std::endl;
+	EXPECT_NEAR(threadPoolResult, jobSystemResult, std::abs(threadPoolResult) * 1e-3f);
+}
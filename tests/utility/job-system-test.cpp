@@ -0,0 +1,89 @@
+#include <array>
+#include <atomic>
+#include <vector>
+#include "gtest/gtest.h"
+#include "regen/utility/job-system.h"
+
+using namespace regen;
+
+// fixture class for testing
+class JobSystemTest : public ::testing::Test {
+
+};
+
+TEST(JobSystemTest, ParallelFor) {
+	JobSystem jobs(3);
+	std::vector<std::atomic<unsigned int>> visits(100000);
+	jobs.parallelFor(visits.size(), 64, [&visits](unsigned int i) {
+		visits[i] += 1;
+	});
+	for (auto &v: visits) {
+		ASSERT_EQ(v.load(), 1u);
+	}
+}
+
+TEST(JobSystemTest, WaitForCounter) {
+	JobSystem jobs(3);
+	JobSystem::Counter counter;
+	std::atomic<unsigned int> sum(0);
+	for (unsigned int i = 0; i < 1000; ++i) {
+		jobs.run([&sum, i]() { sum += i; }, &counter);
+	}
+	jobs.wait(counter);
+	EXPECT_TRUE(counter.isDone());
+	EXPECT_EQ(sum.load(), 999u * 1000u / 2u);
+}
+
+TEST(JobSystemTest, LargeCallable) {
+	JobSystem jobs(2);
+	JobSystem::Counter counter;
+	std::array<unsigned int, 64> values{};
+	values.fill(2u);
+	std::atomic<unsigned int> sum(0);
+	// the callable does not fit into the inline storage of a job
+	for (unsigned int i = 0; i < 10; ++i) {
+		jobs.run([&sum, values]() {
+			for (auto v: values) sum += v;
+		}, &counter);
+	}
+	jobs.wait(counter);
+	EXPECT_EQ(sum.load(), 10u * 64u * 2u);
+}
+
+TEST(JobSystemTest, Nested) {
+	JobSystem jobs(3);
+	std::atomic<unsigned int> count(0);
+	// the waiting threads execute the inner jobs
+	jobs.parallelFor(16, 1, [&](unsigned int) {
+		jobs.parallelFor(1000, 10, [&count](unsigned int) {
+			count += 1;
+		});
+	});
+	EXPECT_EQ(count.load(), 16000u);
+}
+
+TEST(JobSystemTest, QueueOverflow) {
+	JobSystem jobs(1);
+	JobSystem::Counter counter;
+	std::atomic<unsigned int> count(0);
+	// more jobs than fit into the queue, the rest is executed immediately
+	for (unsigned int i = 0; i < 3 * REGEN_JOB_QUEUE_SIZE; ++i) {
+		jobs.run([&count]() { count += 1; }, &counter);
+	}
+	jobs.wait(counter);
+	EXPECT_EQ(count.load(), 3u * REGEN_JOB_QUEUE_SIZE);
+}
+
+TEST(JobSystemTest, NoWorkers) {
+	JobSystem jobs(0);
+	JobSystem::Counter counter;
+	std::atomic<unsigned int> count(0);
+	for (unsigned int i = 0; i < 100; ++i) {
+		jobs.run([&count]() { count += 1; }, &counter);
+	}
+	// the waiting thread executes all jobs
+	jobs.wait(counter);
+	EXPECT_EQ(count.load(), 100u);
+	jobs.parallelFor(100, 7, [&count](unsigned int) { count += 1; });
+	EXPECT_EQ(count.load(), 200u);
+}
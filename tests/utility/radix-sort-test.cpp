@@ -0,0 +1,62 @@
+#include <random>
+#include "gtest/gtest.h"
+#include "regen/utility/radix-sort.h"
+
+using namespace regen;
+
+// fixture class for testing
+class RadixSortTest : public ::testing::Test {
+
+};
+
+struct SortItem {
+	unsigned int id;
+	float key;
+};
+
+static std::vector<SortItem> randomItems(unsigned int count, float min, float max, unsigned int seed) {
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<float> key(min, max);
+	std::vector<SortItem> items(count);
+	for (unsigned int i = 0; i < count; ++i) {
+		items[i] = {i, key(gen)};
+	}
+	return items;
+}
+
+static void expectSortedLikeStableSort(std::vector<SortItem> items) {
+	auto expected = items;
+	std::stable_sort(expected.begin(), expected.end(), [](const SortItem &a, const SortItem &b) {
+		return a.key < b.key;
+	});
+	std::vector<SortItem> tmp;
+	radixSort(items, tmp, [](const SortItem &x) { return x.key; });
+	ASSERT_EQ(items.size(), expected.size());
+	for (unsigned int i = 0; i < items.size(); ++i) {
+		EXPECT_EQ(items[i].id, expected[i].id);
+	}
+}
+
+TEST(RadixSortTest, Empty) {
+	expectSortedLikeStableSort({});
+}
+
+TEST(RadixSortTest, SmallArray) {
+	expectSortedLikeStableSort(randomItems(10, 0.0f, 100.0f, 1));
+}
+
+TEST(RadixSortTest, SquaredDistances) {
+	expectSortedLikeStableSort(randomItems(10000, 0.0f, 1.0e6f, 42));
+}
+
+TEST(RadixSortTest, NegativeKeys) {
+	expectSortedLikeStableSort(randomItems(5000, -1000.0f, 1000.0f, 7));
+}
+
+TEST(RadixSortTest, DuplicateKeys_stable) {
+	auto items = randomItems(1000, 0.0f, 100.0f, 3);
+	for (auto &item: items) {
+		item.key = std::floor(item.key / 10.0f);
+	}
+	expectSortedLikeStableSort(items);
+}
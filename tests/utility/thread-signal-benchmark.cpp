@@ -0,0 +1,76 @@
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <ctime>
+#include "gtest/gtest.h"
+#include "regen/utility/thread-signal.h"
+
+using namespace regen;
+
+// fixture class for benchmarking
+class ThreadSignalBenchmark : public ::testing::Test {
+
+};
+
+#define BENCHMARK_NUM_FRAMES 200
+// time between two notifications, e.g. a vsync limited render loop
+#define BENCHMARK_FRAME_TIME_US 2000
+
+static double threadCPUTime() {
+	timespec ts{};
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return static_cast<double>(ts.tv_sec) * 1000.0 + static_cast<double>(ts.tv_nsec) / 1.0e6;
+}
+
+static int64_t nowNanoseconds() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static const char *modeName(ThreadSignal::Mode mode) {
+	switch (mode) {
+		case ThreadSignal::SPIN_SLEEP:
+			return "spin-sleep";
+		case ThreadSignal::BLOCKING:
+			return "blocking";
+		case ThreadSignal::ADAPTIVE_SPIN:
+			return "adaptive";
+	}
+	return "unknown";
+}
+
+// measures the CPU time a thread spends waiting for periodic notifications,
+// and the latency between notification and wake-up.
+TEST(ThreadSignalBenchmark, PeriodicWakeUp) {
+	for (auto mode: {ThreadSignal::SPIN_SLEEP, ThreadSignal::BLOCKING, ThreadSignal::ADAPTIVE_SPIN}) {
+		ThreadSignal signal(mode);
+		std::atomic<int64_t> notifyTime(0);
+		std::atomic<unsigned int> numWakeUps(0);
+		double latency = 0.0, cpuTime = 0.0, wallTime = 0.0;
+		std::thread waiter([&]() {
+			auto t0 = std::chrono::steady_clock::now();
+			auto c0 = threadCPUTime();
+			for (unsigned int i = 0; i < BENCHMARK_NUM_FRAMES; ++i) {
+				signal.wait();
+				latency += static_cast<double>(nowNanoseconds() - notifyTime.load()) / 1000.0;
+				numWakeUps += 1;
+			}
+			cpuTime = threadCPUTime() - c0;
+			wallTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+		});
+		for (unsigned int i = 0; i < BENCHMARK_NUM_FRAMES; ++i) {
+			std::this_thread::sleep_for(std::chrono::microseconds(BENCHMARK_FRAME_TIME_US));
+			notifyTime = nowNanoseconds();
+			signal.notify();
+			// do not merge notifications if the waiter is slow to wake up
+			while (numWakeUps.load() <= i) {
+				std::this_thread::yield();
+			}
+		}
+		waiter.join();
+		std::cout << modeName(mode) << ": " <<
+				  latency / BENCHMARK_NUM_FRAMES << " us wake-up latency, " <<
+				  100.0 * cpuTime / wallTime << "% CPU while waiting" << std::endl;
+	}
+}
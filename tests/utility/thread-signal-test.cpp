@@ -0,0 +1,65 @@
+#include <thread>
+#include <atomic>
+#include "gtest/gtest.h"
+#include "regen/utility/thread-signal.h"
+
+using namespace regen;
+
+// fixture class for testing
+class ThreadSignalTest : public ::testing::Test {
+
+};
+
+// two threads alternately wait for each other, as the animation and render thread do
+static void pingPong(ThreadSignal::Mode mode, unsigned int numRounds) {
+	ThreadSignal ping(mode), pong(mode);
+	unsigned int counter = 0;
+	std::thread other([&]() {
+		for (unsigned int i = 0; i < numRounds; ++i) {
+			ping.wait();
+			counter += 1;
+			pong.notify();
+		}
+	});
+	for (unsigned int i = 0; i < numRounds; ++i) {
+		ping.notify();
+		pong.wait();
+		ASSERT_EQ(counter, i + 1);
+	}
+	other.join();
+}
+
+TEST(ThreadSignalTest, PingPong_spinSleep) {
+	pingPong(ThreadSignal::SPIN_SLEEP, 500);
+}
+
+TEST(ThreadSignalTest, PingPong_blocking) {
+	pingPong(ThreadSignal::BLOCKING, 5000);
+}
+
+TEST(ThreadSignalTest, PingPong_adaptive) {
+	pingPong(ThreadSignal::ADAPTIVE_SPIN, 5000);
+}
+
+TEST(ThreadSignalTest, MergedNotifications) {
+	ThreadSignal signal(ThreadSignal::BLOCKING);
+	EXPECT_FALSE(signal.tryWait());
+	signal.notify();
+	signal.notify();
+	EXPECT_TRUE(signal.tryWait());
+	EXPECT_FALSE(signal.tryWait());
+}
+
+TEST(ThreadSignalTest, SwitchModeWhileWaiting) {
+	ThreadSignal signal(ThreadSignal::BLOCKING);
+	std::atomic<bool> isDone(false);
+	std::thread waiter([&]() {
+		signal.wait();
+		isDone = true;
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	signal.setMode(ThreadSignal::SPIN_SLEEP);
+	signal.notify();
+	waiter.join();
+	EXPECT_TRUE(isDone.load());
+}